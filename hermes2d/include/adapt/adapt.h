@@ -122,6 +122,13 @@ namespace Hermes
       void set_norm_form(int i, int j, MatrixFormVolError* form);
       void set_norm_form(MatrixFormVolError* form);   ///< i = j = 0
 
+      /// Sets the number of threads used to select refinements in adapt().
+      /// Has effect only if Hermes was built WITH_OPENMP. The selected refinements do not depend
+      /// on the number of threads. Selectors which cannot be cloned (see RefinementSelectors::Selector::clone()),
+      /// reference solutions other than plain Solutions and meshes with both triangles and quads
+      /// are always processed serially.
+      void set_num_threads(int num_threads);
+
       /// Type-safe version of calc_err_est() for one solution.
       /// @param[in] solutions_for_adapt - if sln and rsln are the solutions error of which is used in the function adapt().
       double calc_err_est(Solution<Scalar>*sln, Solution<Scalar>*rsln, bool solutions_for_adapt = true,
@@ -211,6 +218,30 @@ namespace Hermes
       Hermes::vector<ElementReference> regular_queue; ///< A queue of elements which should be processes. The queue had to be filled by the method fill_regular_queue().
       std::vector<ElementToRefine> last_refinements; ///< A vector of refinements generated during the last finished execution of the method adapt().
 
+      /// A refinement of an element of the regular queue selected in advance by one of the threads.
+      struct SelectedRefinement {
+        bool done; ///< True if the refinement has been selected.
+        bool refined; ///< The value returned by the selector.
+        ElementToRefine refinement; ///< The selected refinement.
+        SelectedRefinement() : done(false), refined(false) {}; ///< Constructor.
+      };
+
+      /// Prepares a selector and a copy of the reference solution of every component for every thread.
+      /** The thread 0 uses the original selectors and reference solutions.
+      *  \return False if the refinements have to be selected serially. */
+      bool init_selection_threads(Mesh** meshes, Hermes::vector<RefinementSelectors::Selector<Scalar>*>& refinement_selectors,
+        std::vector<Hermes::vector<RefinementSelectors::Selector<Scalar>*> >& thread_selectors,
+        std::vector<Hermes::vector<Solution<Scalar>*> >& thread_rslns);
+
+      /// Selects refinements of the elements first, ..., last - 1 of the regular queue by all threads.
+      /** The selection does not depend on the order in which the elements are processed,
+      *  so adapt() uses the results as if they were selected serially. */
+      void select_refinements_ahead(int first, int last,
+        std::vector<Hermes::vector<RefinementSelectors::Selector<Scalar>*> >& thread_selectors,
+        std::vector<Hermes::vector<Solution<Scalar>*> >& thread_rslns, std::vector<SelectedRefinement>& selected);
+
+      int num_threads;                      ///< Number of threads used to select refinements.
+
       /// Returns true if a given element should be ignored and not processed through refinement selection.
       /** Overload this method to omit some elements from processing.
       *  \param[in] inx_element An index of an element in the regular queue. -1 if the element cames from the priority queue.
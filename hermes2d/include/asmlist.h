@@ -64,6 +64,8 @@ namespace Hermes
       template<typename T> friend class L2Space;
       template<typename T> friend class HcurlSpace;
       template<typename T> friend class HdivSpace;
+      template<typename T> friend class SumFactorization;
+      template<typename T> friend class LocalProjection;
     };
   }
 }
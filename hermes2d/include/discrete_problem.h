@@ -23,6 +23,7 @@
 #include "weakform/weakform.h"
 #include "function/function.h"
 #include "neighbor.h"
+#include "mesh/geometry_store.h"
 #include "refinement_selectors/selector.h"
 #include "exceptions.h"
 
@@ -109,7 +110,67 @@ namespace Hermes
 
       void set_spaces(const Space<Scalar>* space);
 
+      /// Set the number of threads used in assembling (default 1).
+      /// Has effect only if Hermes was built WITH_OPENMP. Stages containing DG forms,
+      /// external functions other than Solutions, or meshes with both triangles and quads
+      /// are always assembled serially.
+      void set_num_threads(int num_threads);
+
+      /// Sets the coefficient vector of the state in which apply() linearizes the problem (the previous
+      /// Newton iterate). The vector is copied. NULL (the default) means zero external solutions, as
+      /// in the light versions of assemble(). The parameter add_dir_lift has the same meaning as in assemble().
+      /// The external solutions and the assembling stages are made here once and reused by all the calls
+      /// to apply() until the spaces or the weak form change.
+      void set_linearization_point(Scalar* coeff_vec, bool add_dir_lift = true);
+
+      /// Matrix-free operator application, y = A x, where A is the matrix assemble() would
+      /// produce at the linearization point (see set_linearization_point()). The product is
+      /// accumulated element by element from the local matrices, the global matrix is neither
+      /// stored nor is its sparse structure created. x and y are of length get_num_dofs().
+      /// For use with Krylov solvers see MatrixFreeOperator.
+      void apply(const Scalar* x, Scalar* y);
+
+      /// Keeps the geometry of the elements (physical coordinates of the integration points, jacobians,
+      /// also multiplied by the integration weights, inverse reference maps) between the calls to assemble() as long as the meshes do not change,
+      /// see GeometryStore. Trades memory for the time of recalculating the geometry in every
+      /// assembling, which pays off over many Newton iterations or time steps on a fixed mesh.
+      /// \param mode [in] Which elements to keep, see GeometryStoreMode.
+      void set_geometry_store(bool enable, GeometryStoreMode mode = HERMES_GEOMETRY_STORE_ALL);
+
+      /// Memory taken by the geometry stores (see set_geometry_store()) in bytes.
+      size_t get_geometry_store_memory_size() const;
+
+      /// Statistics of the memoized integration orders (see calc_order_matrix_form_vol(), calc_order_vector_form_vol()).
+      /// Number of integration orders found in the table.
+      unsigned int get_order_table_hits() const;
+      /// Number of integration orders that had to be calculated by parsing the form.
+      unsigned int get_order_table_misses() const;
+
+      /// Statistics of the caches of shape function and external function values and of the memoized
+      /// integration orders on the assembling path: number of lookups, of those successful, and memory taken by the tables in bytes.
+      void get_cache_statistics(unsigned int& lookups, unsigned int& hits, size_t& memory);
+
+      /// Keeps the local matrices and vectors of the volumetric forms between the calls to assemble(), so that
+      /// after an adaptivity step only the elements whose geometry or shape functions have changed are integrated
+      /// again, the local matrices of the others are only added to the global matrix in the new numbering of the DOFs.
+      /// A cached local matrix is reused if the element (with its sub-element transformation), its vertices and
+      /// the shape function indices in its assembly lists are the same; curved elements, forms with external
+      /// functions and the Runge-Kutta stages are always integrated. In the assemblings with coeff_vec (as in the
+      /// NewtonSolver) only the forms that do not depend on the iterate are cached (see MatrixFormVol::uses_u_ext),
+      /// e.g. the Jacobian of a linear problem, not the residual. Only for problems whose cached forms depend on the
+      /// geometry and the shape functions alone, i.e. with constant parameters; after changing a parameter
+      /// of a form call set_local_cache() again, which empties the cache.
+      void set_local_cache(bool enable);
+
+      /// Statistics of the cache of local matrices and vectors (see set_local_cache()).
+      /// Number of the local matrices and vectors taken from the cache.
+      unsigned int get_local_cache_hits() const;
+      /// Number of the local matrices and vectors that had to be integrated (and were stored in the cache).
+      unsigned int get_local_cache_misses() const;
+
     protected:
+      class AssemblingCaches;
+
       /// Get the number of unknowns.
       int get_num_dofs();
 
@@ -139,6 +200,25 @@ namespace Hermes
       void create_sparse_structure(SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs = NULL,
         bool force_diagonal_blocks = false, Table* block_weights = NULL);
 
+      /// Assembling of the forms into an already created matrix structure, the part of assemble()
+      /// after create_sparse_structure().
+      void assemble_forms(Scalar* coeff_vec, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
+        bool force_diagonal_blocks, bool add_dir_lift, Table* block_weights);
+
+      /// Assembling of the given stages with the external solutions u_ext, the part of assemble_forms()
+      /// after the coefficient vector is converted and the stages are created. Also used by apply().
+      void assemble_stages(Hermes::vector<Stage<Scalar> >& stages, Hermes::vector<Solution<Scalar>*>& u_ext,
+        SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs, bool force_diagonal_blocks, Table* block_weights);
+
+      /// Converts the coefficient vector into the external solutions, one per equation.
+      void convert_coeff_vec(Scalar* coeff_vec, bool add_dir_lift, Hermes::vector<Solution<Scalar>*>& u_ext);
+
+      /// Makes the external solutions and the stages of apply() for the current spaces and weak form.
+      void init_linearization();
+
+      /// Deletes the external solutions and the stages of apply().
+      void free_linearization();
+
       /// Assembling utilities.
       /// Check whether it is sane to assemble.
       /// Throws errors if not.
@@ -150,6 +230,9 @@ namespace Hermes
       /// Initializes refmaps.
       void initialize_refmaps(Hermes::vector<RefMap*>& refmap);
 
+      /// Attaches the refmaps to the geometry stores (see set_geometry_store()), sets the stores to the meshes.
+      void attach_geometry_stores(Hermes::vector<RefMap*>& refmap);
+
       /// Initialize a state, returns a non-NULL Element.
       Element* init_state(Stage<Scalar>& stage, Hermes::vector<PrecalcShapeset*>& spss,
         Hermes::vector<RefMap*>& refmap, Element** e, Hermes::vector<AsmList<Scalar>*>& al);
@@ -162,6 +245,35 @@ namespace Hermes
         SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs, bool force_diagonal_blocks, Table* block_weights,
         Hermes::vector<PrecalcShapeset*>& spss, Hermes::vector<RefMap*>& refmap, Hermes::vector<Solution<Scalar>*>& u_ext);
 
+      /// One assembling state recorded for the threaded assembling.
+      struct ThreadedState
+      {
+        /// Elements of the state (one per stage mesh).
+        Element** e;
+        /// Sub-element transformations of the stage functions.
+        uint64_t* sub_idx;
+        bool bnd[4];
+        SurfPos surf_pos[4];
+        Element* base;
+        /// Color of the state, states of the same color do not share any DOF.
+        int color;
+      };
+
+      /// Decides whether the stage can be assembled by multiple threads into mat and rhs.
+      bool is_stage_threadable(Stage<Scalar>& stage, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs);
+
+      /// Assemble one stage using num_threads threads.
+      /// The states are colored so that no two states of the same color share a DOF, each
+      /// color is then assembled in parallel, every thread using its own scratch DiscreteProblem
+      /// (PrecalcShapesets, RefMaps, caches, matrix buffer) and its own copies of the external Solutions,
+      /// see thread_workers.
+      void assemble_one_stage_threaded(Stage<Scalar>& stage,
+        SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs, bool force_diagonal_blocks, Table* block_weights,
+        Hermes::vector<Solution<Scalar>*>& u_ext);
+
+      /// Returns the thread-private copy of an external function (or the function itself in the serial case).
+      MeshFunction<Scalar>* get_thread_ext_fn(MeshFunction<Scalar>* fn);
+
       /// Assemble one state.
       void assemble_one_state(Stage<Scalar>& stage,
         SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs, bool force_diagonal_blocks, Table* block_weights,
@@ -244,6 +356,29 @@ namespace Hermes
       Scalar eval_form(MatrixFormVol<Scalar>* mfv, Hermes::vector<Solution<Scalar>*> u_ext,
         PrecalcShapeset* fu, PrecalcShapeset* fv, RefMap* ru, RefMap* rv);
 
+      /// Evaluates the volumetric matrix form for all pairs of basis functions (alu) and test functions (alv)
+      /// of the current element at once by sum factorization on parallelogram quads (see SumFactorization)
+      /// or using MatrixFormVol::value_block(), storing the values
+      /// (including the form's scaling factor) into result[i][j], i indexing alv, j indexing alu.
+      /// All pairs are integrated with the order needed by the pair of highest polynomial degree.
+      /// Returns false if the form does not provide the batched evaluation.
+      bool eval_form_block(MatrixFormVol<Scalar>* mfv, Hermes::vector<Solution<Scalar>*> u_ext,
+        PrecalcShapeset* fu, PrecalcShapeset* fv, RefMap* ru, RefMap* rv,
+        AsmList<Scalar>* alu, AsmList<Scalar>* alv, Scalar** result);
+
+      /// Evaluates the volumetric vector form for all test functions (alv) of the current element at once
+      /// by sum factorization (see SumFactorization), storing the values (including the form's scaling
+      /// factor) into result[i]. Returns false if the element or the form do not allow it.
+      bool eval_form_block(VectorFormVol<Scalar>* vfv, Hermes::vector<Solution<Scalar>*> u_ext,
+        PrecalcShapeset* fv, RefMap* rv, AsmList<Scalar>* alv, Scalar* result);
+
+      /// Fills the orders of the previous iteration solutions and of the external functions into key.
+      void init_order_key(typename AssemblingCaches::KeyOrder& key, Hermes::vector<Solution<Scalar>*>& u_ext,
+        int u_ext_offset, int inc, Hermes::vector<MeshFunction<Scalar>*>& ext);
+
+      /// Looks up a memoized integration order, returns false if not present.
+      bool get_memoized_order(const typename AssemblingCaches::KeyOrder& key, int& order);
+
       /// Calculates the necessary integration order to use for a particular volumetric matrix form.
       int calc_order_matrix_form_vol(MatrixFormVol<Scalar>* mfv, Hermes::vector<Solution<Scalar>*> u_ext,
         PrecalcShapeset* fu, PrecalcShapeset* fv, RefMap* ru, RefMap* rv);
@@ -356,6 +491,15 @@ namespace Hermes
       /// Uses assembling_caches to get (possibly chached) dummy function for calculation of the integration order.
       Func<Hermes::Ord>* get_fn_ord(const int order);
 
+      /// Uses assembling_caches to get the values of an external function (or a solution from
+      /// the previous iteration) in the quadrature points of the current assembling state.
+      /// The returned function is owned by the cache and must not be freed.
+      Func<Scalar>* get_ext_fn(MeshFunction<Scalar>* fn, const int order);
+
+      /// Values of a solution from the previous iteration for a form. Cached by get_ext_fn(), except for
+      /// Runge-Kutta where the values are modified by the form evaluation (and have to be freed).
+      Func<Scalar>* get_prev_fn(Solution<Scalar>* sln, const int order);
+
       /// Initialize all caches.
       void init_cache();
 
@@ -395,9 +539,27 @@ namespace Hermes
       void traverse_multimesh_subtree(NeighborNode* node, Hermes::vector<Hermes::vector<unsigned int>*>& running_central_transformations,
         Hermes::vector<Hermes::vector<unsigned int>*>& running_neighbor_transformations, const typename NeighborSearch<Scalar>::NeighborEdgeInfo& edge_info, const int& active_edge, const int& mode);
 
+      /// Fills local with the values of the volumetric matrix form on the current state for all the pairs of
+      /// the assembly lists (not multiplied by the coefficients of the lists), taken from the local cache,
+      /// or integrated and stored there. Returns false if the form or the state can not be cached.
+      bool get_cached_local_matrix(MatrixFormVol<Scalar>* mfv, Hermes::vector<Solution<Scalar>*>& u_ext,
+        Hermes::vector<PrecalcShapeset*>& spss, Hermes::vector<RefMap*>& refmap,
+        Hermes::vector<AsmList<Scalar>*>& al, Scalar** local);
+
+      /// The same as get_cached_local_matrix() for a volumetric vector form.
+      bool get_cached_local_vector(VectorFormVol<Scalar>* vfv, Hermes::vector<Solution<Scalar>*>& u_ext,
+        Hermes::vector<PrecalcShapeset*>& spss, Hermes::vector<RefMap*>& refmap,
+        Hermes::vector<AsmList<Scalar>*>& al, Scalar* local);
+
       /// Returns the matrix_buffer of the size n.
       Scalar** get_matrix_buffer(int n);
 
+      /// Returns the vector_buffer of the size n (at least), kept between the elements and the assemblings.
+      Scalar* get_vector_buffer(int n);
+
+      /// Returns the coef_buffer of the size n (at least), kept between the elements and the assemblings.
+      Scalar* get_coef_buffer(int n);
+
       /// Matrix structure as well as spaces and weak formulation is up-to-date.
       bool is_up_to_date();
 
@@ -434,6 +596,10 @@ namespace Hermes
 
       int matrix_buffer_dim;///< dimension of the matrix held by 'matrix_buffer'
 
+      Hermes::vector<Scalar> vector_buffer;///< buffer for holding the local vector of a volumetric vector form (during assembling)
+
+      Hermes::vector<Scalar> coef_buffer;///< buffer for holding the coefficients of a form in the quadrature points (see eval_form_block())
+
       /// Matrix structure can be reused.
       /// If other conditions apply.
       bool have_matrix;
@@ -459,6 +625,63 @@ namespace Hermes
       /// Number of spaces in the original problem in a Runge-Kutta method.
       int RK_original_spaces_count;
 
+      /// Volumetric matrix forms found not to implement MatrixFormVol::value_block() during the current assembling.
+      std::set<MatrixFormVol<Scalar>*> mfvol_without_block;
+
+      /// Volumetric vector forms found not to implement VectorFormVol::value_coefficients() during the current assembling.
+      std::set<VectorFormVol<Scalar>*> vfvol_without_coefficients;
+
+      /// Hits and misses of AssemblingCaches::order_table.
+      unsigned int order_table_hits;
+      unsigned int order_table_misses;
+
+      /// Number of threads used in assembling.
+      int num_threads;
+
+      /// Geometry stores (one per equation, shared by the equations on the same mesh), empty if not used.
+      Hermes::vector<GeometryStore*> geometry_stores;
+      bool geometry_store_enabled;
+      GeometryStoreMode geometry_store_mode;
+
+      /// Linearization point of apply(), NULL for zero external solutions.
+      Scalar* linearization_point;
+      bool linearization_dir_lift;
+
+      /// External solutions of the linearization point and the assembling stages of apply(), made in
+      /// set_linearization_point() and kept until the spaces or the weak form change.
+      Hermes::vector<Solution<Scalar>*> linearization_u_ext;
+      Hermes::vector<Stage<Scalar> > linearization_stages;
+      /// Sequence numbers of the spaces and of the weak form the above were made for.
+      Hermes::vector<int> linearization_sp_seq;
+      int linearization_wf_seq;
+
+      class LocalCache;
+
+      /// Local matrices and vectors kept between the assemblings, NULL if not used (see set_local_cache()).
+      /// The scratch instances of assemble_one_stage_threaded() share the one of this instance.
+      LocalCache* local_cache;
+
+      /// Thread-private copies of external functions (filled only in the scratch instances
+      /// used by assemble_one_stage_threaded()).
+      std::map<MeshFunction<Scalar>*, MeshFunction<Scalar>*> thread_ext_fns;
+
+      /// Scratch instance of assemble_one_stage_threaded() for one thread.
+      struct ThreadWorker
+      {
+        DiscreteProblem<Scalar>* dp;
+        Hermes::vector<PrecalcShapeset*> spss;
+        Hermes::vector<RefMap*> refmaps;
+        /// Copies of the external Solutions of the stage, refreshed in every assembling.
+        Hermes::vector<Solution<Scalar>*> ext_copies;
+      };
+
+      /// The scratch instances of the threads, kept between the assemblings.
+      Hermes::vector<ThreadWorker> thread_workers;
+
+      /// Deletes the scratch instances of the threads; done when the spaces, the number
+      /// of threads or the geometry stores change.
+      void free_thread_workers();
+
       /// Class handling various caches used in assembling.
       class AssemblingCaches
       {
@@ -482,6 +705,7 @@ namespace Hermes
 #endif
           int shapeset_type;
           double inv_ref_map[2][2];
+          KeyConst() {}
 #ifdef _MSC_VER
           KeyConst(int index, int order, UINT64 sub_idx, int shapeset_type, double2x2* inv_ref_map);
 #else
@@ -489,17 +713,18 @@ namespace Hermes
 #endif
         };
 
-        /// Functor that compares two above keys (needed e.g. to create a std::map indexed by these keys);
-        struct CompareConst
+        /// Functor hashing and comparing the above keys (needed to create a FlatHashMap indexed by these keys).
+        struct HashConst
         {
-          bool operator()(KeyConst a, KeyConst b) const;
+          size_t operator()(const KeyConst& a) const;
+          bool operator()(const KeyConst& a, const KeyConst& b) const;
         };
 
         /// PrecalcShapeset stored values for Elements with constant jacobian of the reference mapping for triangles.
-        std::map<KeyConst, Func<double>* , CompareConst> const_cache_fn_triangles;
+        FlatHashMap<KeyConst, Func<double>*, HashConst> const_cache_fn_triangles;
 
         /// PrecalcShapeset stored values for Elements with constant jacobian of the reference mapping for quads.
-        std::map<KeyConst, Func<double>* , CompareConst> const_cache_fn_quads;
+        FlatHashMap<KeyConst, Func<double>*, HashConst> const_cache_fn_quads;
 
         /// The same setup for elements with non-constant jacobians.
         /// This cache is deleted with every change of the state in assembling.
@@ -513,6 +738,7 @@ namespace Hermes
           unsigned int sub_idx;
 #endif
           int shapeset_type;
+          KeyNonConst() {}
 #ifdef _MSC_VER
           KeyNonConst(int index, int order, UINT64 sub_idx, int shapeset_type);
 #else
@@ -520,28 +746,144 @@ namespace Hermes
 #endif
         };
 
-        /// Functor that compares two above keys (needed e.g. to create a std::map indexed by these keys);
-        struct CompareNonConst
+        /// Functor hashing and comparing the above keys (needed to create a FlatHashMap indexed by these keys).
+        struct HashNonConst
         {
-          bool operator()(KeyNonConst a, KeyNonConst b) const;
+          size_t operator()(const KeyNonConst& a) const;
+          bool operator()(const KeyNonConst& a, const KeyNonConst& b) const;
         };
 
         /// PrecalcShapeset stored values for Elements with non-constant jacobian of the reference mapping for triangles.
-        std::map<KeyNonConst, Func<double>* , CompareNonConst> cache_fn_triangles;
+        FlatHashMap<KeyNonConst, Func<double>*, HashNonConst> cache_fn_triangles;
 
         /// PrecalcShapeset stored values for Elements with non-constant jacobian of the reference mapping for quads.
-        std::map<KeyNonConst, Func<double>* , CompareNonConst> cache_fn_quads;
+        FlatHashMap<KeyNonConst, Func<double>*, HashNonConst> cache_fn_quads;
 
         LightArray<Func<Hermes::Ord>*> cache_fn_ord;
+
+        /// Key for the memoized integration orders: the form and the orders of all the functions it is evaluated with,
+        /// packed into a fixed array so that building and hashing the key allocates nothing.
+        struct KeyOrder
+        {
+          /// Maximum number of orders in the key, forms with more functions are not memoized.
+          static const int H2D_ORDER_KEY_SIZE = 16;
+
+          const void* form;
+          /// Number of orders used, -1 if they did not fit.
+          int num_orders;
+          /// Shape function orders (test function last, -1 for vector forms), inverse reference map order,
+          /// element mode, orders of the previous iteration solutions and of the external functions.
+          short orders[H2D_ORDER_KEY_SIZE];
+          KeyOrder() {}
+          KeyOrder(const void* form);
+          void add(int order);
+        };
+
+        /// Functor hashing and comparing the above keys (needed to create a FlatHashMap indexed by these keys).
+        struct HashOrder
+        {
+          size_t operator()(const KeyOrder& a) const;
+          bool operator()(const KeyOrder& a, const KeyOrder& b) const;
+        };
+
+        /// Memoized integration orders of volumetric forms.
+        /// The threads of one assembling start from a copy of this table and their new items are merged back.
+        FlatHashMap<KeyOrder, int, HashOrder> order_table;
+
+        /// WeakForm seq number the order_table was created for.
+        int order_table_wf_seq;
+
+        /// Functor hashing and comparing the keys of cache_ext_fn.
+        struct HashExtFn
+        {
+          size_t operator()(const std::pair<MeshFunction<Scalar>*, int>& a) const;
+          bool operator()(const std::pair<MeshFunction<Scalar>*, int>& a, const std::pair<MeshFunction<Scalar>*, int>& b) const;
+        };
+
+        /// Values of external functions and solutions from the previous iteration in the quadrature
+        /// points of the current assembling state, indexed by the function and the quadrature order.
+        /// Shared by all forms of the stage, cleared when the state changes.
+        FlatHashMap<std::pair<MeshFunction<Scalar>*, int>, Func<Scalar>*, HashExtFn> cache_ext_fn;
+
+        /// Statistics of the above caches, see DiscreteProblem::get_cache_statistics().
+        void get_statistics(unsigned int& lookups, unsigned int& hits, size_t& memory);
       };
 
       /// An AssemblingCaches instance for this instance of DiscreteProblem.
       AssemblingCaches assembling_caches;
 
+      /// Cache of the local matrices and vectors of volumetric forms, see set_local_cache().
+      class LocalCache
+      {
+      public:
+        LocalCache();
+        ~LocalCache();
+
+        /// Identification of a local matrix: the form and the element with the sub-element
+        /// transformation of the basis functions [0] and of the test functions [1].
+        struct Key
+        {
+          const void* form;
+          int id[2];
+          uint64_t sub_idx[2];
+        };
+
+        /// Functor that compares two above keys.
+        struct Compare
+        {
+          bool operator()(const Key& a, const Key& b) const;
+        };
+
+        /// A local matrix (a vector for cols == 0) together with the data it is checked against before a reuse.
+        struct Entry
+        {
+          bool matrix;
+          unsigned int rows, cols;
+          /// Shape function indices of the test functions (rows) followed by those of the basis functions (cols).
+          int* idx;
+          /// Vertex coordinates of the elements of the basis functions [0] and of the test functions [1].
+          double coords[2][4][2];
+          double scaling_factor;
+          /// Values not multiplied by the coefficients of the assembly lists, rows x max(cols, 1).
+          Scalar* values;
+          /// The last assembling the entry was used in.
+          unsigned int generation;
+          ~Entry();
+        };
+
+        std::map<Key, Entry*, Compare> entries;
+
+        /// Number of the current assembling.
+        unsigned int generation;
+
+        /// WeakForm seq number the entries were created for.
+        int wf_seq;
+
+        unsigned int hits;
+        unsigned int misses;
+
+        /// Fills the key and the vertex coordinates of the current state, returns false for curved elements.
+        bool init_key(Key& key, double coords[2][4][2], const void* form, PrecalcShapeset* fu, PrecalcShapeset* fv);
+
+        /// Returns the entry if it is valid for the state, the assembly lists and the form, or NULL.
+        Entry* find(const Key& key, double coords[2][4][2], AsmList<Scalar>* alv, AsmList<Scalar>* alu,
+          double scaling_factor);
+
+        /// Stores (a copy of) the values, replacing a stale entry of the same key.
+        void insert(const Key& key, double coords[2][4][2], AsmList<Scalar>* alv, AsmList<Scalar>* alu,
+          double scaling_factor, bool matrix, Scalar** matrix_values, Scalar* vector_values);
+
+        /// Removes the matrices (vectors) not used in the current assembling and starts a new one.
+        void finish_assembling(bool matrices, bool vectors);
+
+        void clear();
+      };
+
       template<typename T> friend class KellyTypeAdapt;
       template<typename T> friend class NewtonSolver;
       template<typename T> friend class PicardSolver;
       template<typename T> friend class RungeKutta;
+      template<typename T> friend class MatrixFreeOperator;
     };
   }
 }
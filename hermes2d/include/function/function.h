@@ -197,7 +197,7 @@ namespace Hermes
       int num_components; ///< number of vector components
 
       /// Table of Node tables, for each possible transformation there can be a different Node table.
-      std::map<uint64_t, LightArray<Node*>*>* sub_tables;
+      FlatHashMap<uint64_t, LightArray<Node*>*>* sub_tables;
 
       /// Table of nodes.
       LightArray<Node*>* nodes;
@@ -95,6 +95,7 @@ namespace Hermes
       template<typename T> friend class DiscontinuousFunc;
       template<typename T> friend class DiscreteProblem;
       template<typename T> friend class NeighborSearch;
+      template<typename T> friend class Global;
     };
   }
 }
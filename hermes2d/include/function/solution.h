@@ -19,6 +19,7 @@
 #include "../function/mesh_function.h"
 #include "../space/space.h"
 #include "../mesh/refmap.h"
+#include "../mesh/point_locator.h"
 #include "exceptions.h"
 
 namespace Hermes
@@ -117,10 +118,18 @@ namespace Hermes
       /// Returns solution value or derivatives at the physical domain point (x, y).
       /// 'item' controls the returned value: H2D_FN_VAL_0, H2D_FN_VAL_1, H2D_FN_DX_0, H2D_FN_DX_1, H2D_FN_DY_0, ....
       /// NOTE: This function should be used for postprocessing only, it is not effective
-      /// enough for calculations. Since it searches for an element sequentinally, it is extremelly
-      /// slow. Prefer Solution::get_ref_value if possible.
+      /// enough for calculations. Prefer Solution::get_ref_value if possible, and get_pt_values()
+      /// for many points.
       virtual Scalar get_pt_value(double x, double y, int item = H2D_FN_VAL_0);
 
+      /// Returns solution values or derivatives at the n physical domain points (x[i], y[i]) in
+      /// values[i], 'item' as in get_pt_value(); points outside the mesh get NAN. The elements are
+      /// found through a grid over the mesh (see PointLocator) and the points are processed sorted
+      /// by the grid cells, so that consecutive points mostly lie in the same element. With
+      /// num_threads > 1 (requires OpenMP) the points are split among the threads, every thread
+      /// evaluates a copy of the solution.
+      void get_pt_values(const double* x, const double* y, int n, Scalar* values, int item = H2D_FN_VAL_0, int num_threads = 1);
+
       /// Multiplies the function represented by this class by the given coefficient.
       void multiply(Scalar coef);
 
@@ -214,7 +223,7 @@ namespace Hermes
       /// a table from the lowest layer.
       /// The highest layer (in contrast to the PrecalcShapeset class) is represented
       /// here only by this array.
-      std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>* tables[4][4];
+      FlatHashMap<uint64_t, LightArray<struct Function<Scalar>::Node*>*>* tables[4][4];
 
       Element* elems[4][4];
       int cur_elem, oldest[4];
@@ -241,6 +250,16 @@ namespace Hermes
 
       Element* e_last; ///< last visited element when getting solution values at specific points
 
+      /// Grid over the active elements of the mesh for get_pt_value(), built when first needed.
+      PointLocator* point_locator;
+
+      /// Decodes 'item' of get_pt_value() into the component a and the value / derivative b.
+      void decode_pt_item(int item, int& a, int& b);
+
+      /// Finds the active element containing the point (x, y), trying e_last and its neighbors
+      /// first. The refmap is left set to the element.
+      Element* find_pt_element(PointLocator* locator, double x, double y, double& xi1, double& xi2);
+
       friend class RefMap;
       template<typename T> friend class KellyTypeAdapt;
       template<typename T> friend class CalculationContinuity;
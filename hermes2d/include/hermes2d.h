@@ -49,10 +49,14 @@
 #include "shapeset/shapeset_l2_all.h"
 
 #include "mesh/refmap.h"
+#include "mesh/geometry_store.h"
+#include "mesh/point_locator.h"
 #include "mesh/traverse.h"
 
 #include "weakform/weakform.h"
 #include "discrete_problem.h"
+#include "matrix_free_operator.h"
+#include "sum_factorization.h"
 #include "forms.h"
 
 #include "integrals/h1.h"
@@ -137,7 +137,40 @@ namespace Hermes
       HERMES_UNSET_NORM
     };
 
+    /// Orderings of the DOFs of a Space, see Space::set_dof_ordering().
+    enum DofOrdering
+    {
+      /// The order in which the nodes are visited in assign_dofs().
+      HERMES_DOF_ORDERING_NATURAL,
+      /// Reverse Cuthill-McKee, reduces the bandwidth.
+      HERMES_DOF_ORDERING_RCM,
+      /// Nested dissection, reduces the fill-in of direct solvers.
+      HERMES_DOF_ORDERING_ND
+    };
+
+    /// Orders in which Traverse visits the elements, see Traverse::set_element_ordering().
+    enum ElementOrdering
+    {
+      /// Base elements by their id, sons of an element in the order of the refinement tree.
+      HERMES_ELEMENT_ORDERING_NATURAL,
+      /// Hilbert curve through the base elements and the sons of quadrilaterals.
+      HERMES_ELEMENT_ORDERING_HILBERT,
+      /// Morton (Z-order) curve through the base elements and the sons of quadrilaterals.
+      HERMES_ELEMENT_ORDERING_MORTON
+    };
+
+    /// Elements whose geometry is kept by a GeometryStore.
+    enum GeometryStoreMode
+    {
+      /// Only elements with a constant jacobian (triangles and parallelograms), the
+      /// physical coordinates are the costly part for those.
+      HERMES_GEOMETRY_STORE_AFFINE,
+      /// All elements, including the curvilinear ones.
+      HERMES_GEOMETRY_STORE_ALL
+    };
+
     class RefMap;
+    class GeometryStore;
     template<typename Scalar> class DiscreteProblem;
     template<typename Scalar> class Space;
     template<typename Scalar> class WeakForm;
@@ -167,6 +200,32 @@ namespace Hermes
       static double calc_abs_errors(Hermes::vector<Solution<Scalar>*> slns1, Hermes::vector<Solution<Scalar>*> slns2);
       static double calc_rel_errors(Hermes::vector<Solution<Scalar>*> slns1, Hermes::vector<Solution<Scalar>*> slns2);
 
+      /// One of the quantities evaluated by calc_norms_and_errors().
+      struct NormQuantity
+      {
+        /// The norm of sln1 (sln2 == NULL) or the norm of the difference sln1 - sln2.
+        NormQuantity(MeshFunction<Scalar>* sln1, MeshFunction<Scalar>* sln2, int norm_type, double* element_values = NULL);
+
+        MeshFunction<Scalar>* sln1;
+        MeshFunction<Scalar>* sln2;
+        int norm_type;
+        /// If not NULL, the squares of the contributions of the elements of the mesh of sln1 are stored
+        /// here, indexed by the element id (the array must have get_max_element_id() entries).
+        double* element_values;
+        /// The resulting norm.
+        double value;
+      };
+
+      /// Evaluates all the quantities in a single traversal of the union mesh of all the functions
+      /// involved. The values of a function appearing in several quantities are calculated only once.
+      /// With num_threads > 1 the states of the traversal are processed in parallel (requires OpenMP
+      /// and all the functions being computed Solutions, otherwise the evaluation is serial). The
+      /// results do not depend on the number of threads.
+      /// The functions on the mesh of geometry_store (see GeometryStore::set_mesh()) take the geometry
+      /// of the elements from the store, which keeps it for the next evaluations on the same mesh.
+      static void calc_norms_and_errors(Hermes::vector<NormQuantity>& quantities, int num_threads = 1,
+        GeometryStore* geometry_store = NULL);
+
       static double error_fn_l2(MeshFunction<Scalar>* sln1, MeshFunction<Scalar>* sln2, RefMap* ru, RefMap* rv);
       static double norm_fn_l2(MeshFunction<Scalar>* sln, RefMap* ru);
 
@@ -189,6 +248,13 @@ namespace Hermes
       static int make_edge_order(int edge, int encoded_order, int mode);
 
       static double get_l2_norm(Vector<Scalar>* vec);
+
+    protected:
+      /// The squared norm (sln2 == NULL) or error on the current state of the traversal.
+      static double calc_state_quantity(MeshFunction<Scalar>* sln1, MeshFunction<Scalar>* sln2, int norm_type);
+
+      /// The norm natural for the space of the solution.
+      static int get_space_norm(Solution<Scalar>* sln);
     };
   }
 }
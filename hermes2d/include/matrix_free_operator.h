@@ -0,0 +1,85 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_MATRIX_FREE_OPERATOR_H
+#define __H2D_MATRIX_FREE_OPERATOR_H
+
+#include "hermes2d_common_defs.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    template<typename Scalar> class DiscreteProblem;
+
+    /// \brief The matrix of a DiscreteProblem that is never assembled.
+    ///
+    /// multiply_with_vector() calls DiscreteProblem::apply(), so the operator can be passed to the
+    /// Krylov solvers (IterativeSolver) in place of an assembled matrix. Preconditioners still need
+    /// an assembled (possibly cheaper, e.g. lower order) matrix, see the IterativeSolver constructors.
+    ///
+    /// Internally, this is also the "matrix" DiscreteProblem::apply() assembles into: the local
+    /// matrices passed to add() are multiplied with the input vector x right away and the products
+    /// accumulated into y.
+    template<typename Scalar>
+    class HERMES_API MatrixFreeOperator : public SparseMatrix<Scalar>
+    {
+    public:
+      /// The operator of dp at its linearization point (see DiscreteProblem::set_linearization_point()).
+      MatrixFreeOperator(DiscreteProblem<Scalar>* dp);
+
+      virtual ~MatrixFreeOperator();
+
+      /// vector_out = A * vector_in.
+      virtual void multiply_with_vector(Scalar* vector_in, Scalar* vector_out);
+
+      /// The number of unknowns of the problem.
+      virtual unsigned int get_size();
+
+      virtual unsigned int get_matrix_size() const;
+
+      virtual double get_fill_in() const;
+
+      /// There is no storage, the following are empty.
+      virtual void alloc();
+      virtual void free();
+      virtual void zero();
+      virtual void prealloc(unsigned int n);
+      virtual void pre_add_ij(unsigned int row, unsigned int col);
+      virtual void finish();
+
+      /// Single entries of the operator are not available.
+      virtual Scalar get(unsigned int m, unsigned int n);
+      virtual void add_to_diagonal(Scalar v);
+      virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE);
+
+      /// y[m] += v * x[n].
+      virtual void add(unsigned int m, unsigned int n, Scalar v);
+
+      /// y[rows[i]] += \sum_j mat[i][j] * x[cols[j]], negative indices are skipped.
+      virtual void add(unsigned int m, unsigned int n, Scalar **mat, int *rows, int *cols);
+
+    protected:
+      DiscreteProblem<Scalar>* dp;
+
+      /// Input and output vector of the product being assembled.
+      const Scalar* x;
+      Scalar* y;
+
+      template<typename T> friend class DiscreteProblem;
+    };
+  }
+}
+#endif
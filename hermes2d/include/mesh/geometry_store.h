@@ -0,0 +1,138 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_GEOMETRY_STORE_H
+#define __H2D_GEOMETRY_STORE_H
+
+#include "../hermes2d_common_defs.h"
+#include "../quadrature/quad_all.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    class Element;
+    class Mesh;
+
+    /// \brief Geometry of the elements of one mesh kept between assemblings.
+    ///
+    /// RefMap calculates the physical coordinates of the integration points, the jacobians (also
+    /// multiplied by the integration weights) and the inverse reference maps anew every time it is
+    /// set to an element. For a mesh that
+    /// does not change over many Newton iterations or time steps, this is the same work every
+    /// time. A RefMap with a GeometryStore attached (RefMap::set_geometry_store()) takes these
+    /// tables from the store instead; the RefMap calculates the tables of an element and order
+    /// the first time they are needed (or in advance, see precompute()) and hands them over to the
+    /// store, which keeps them until the mesh changes (another mesh or Mesh::get_seq()).
+    ///
+    /// The tables are kept as structures of arrays, one set per element mode and quadrature order,
+    /// filled only for the elements stored (all of them or the affine ones, see GeometryStoreMode):
+    /// an index maps the element id to its slot, the slots are allocated in chunks of
+    /// H2D_GEOMETRY_STORE_CHUNK elements, x[k * np + i], y[k * np + i], jacobian[k * np + i],
+    /// jwt[k * np + i] and inv_ref_map[k * np + i] for the slot k within its chunk and the integration
+    /// point i. Only the untransformed elements (sub_idx 0) are stored.
+    ///
+    /// The store may be shared by RefMaps in several threads. The tables are calculated by the
+    /// RefMaps outside of the store's critical section, only adding them is serialized. Looking up
+    /// needs no lock: the tables of a slot are complete before the slot is published in the index,
+    /// and neither the tables nor the chunks ever move until the mesh changes.
+    class HERMES_API GeometryStore
+    {
+    public:
+      /// \param mode [in] Elements kept, see GeometryStoreMode.
+      /// \param quad_2d [in] Quadrature the tables are calculated for.
+      GeometryStore(GeometryStoreMode mode = HERMES_GEOMETRY_STORE_ALL, Quad2D* quad_2d = &g_quad_2d_std);
+
+      ~GeometryStore();
+
+      /// Sets the mesh the elements passed to the store belong to. All the tables are dropped if
+      /// the mesh is not the one passed last time or if it has changed since (Mesh::get_seq()).
+      void set_mesh(const Mesh* mesh);
+
+      /// Calculates the tables of the given order for all active elements of the mesh.
+      void precompute(int order);
+
+      /// Returns true if the tables of the element e on the quadrature quad_2d are kept by the store.
+      bool covers(Element* e, Quad2D* quad_2d, bool is_affine) const;
+
+      /// Returns the mesh set last by set_mesh().
+      const Mesh* get_mesh() const;
+
+      /// Frees all tables.
+      void free();
+
+      /// Memory taken by the tables in bytes.
+      size_t get_memory_size() const;
+
+    protected:
+      /// Number of elements whose tables are allocated at once.
+      static const int H2D_GEOMETRY_STORE_CHUNK = 64;
+
+      /// Tables of H2D_GEOMETRY_STORE_CHUNK elements.
+      struct Chunk
+      {
+        double* x;
+        double* y;
+        double* jacobian;
+        /// The jacobian multiplied by the integration weights.
+        double* jwt;
+        double2x2* inv_ref_map;
+      };
+
+      /// Tables of the stored elements for one element mode and quadrature order.
+      struct Tables
+      {
+        int np;
+        /// Slot of the element with the given id, -1 for the elements whose tables are not stored.
+        int* index;
+        /// Number of the slots used.
+        int num_slots;
+        /// Allocated for all the element ids at once, the chunks are never moved, the tables handed
+        /// out stay valid until the mesh changes.
+        Chunk* chunks;
+        int num_chunks;
+      };
+
+      /// Finds the stored tables of the element e for the quadrature order. Returns false if they
+      /// have not been stored yet.
+      bool get(Element* e, int order, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map);
+
+      /// Stores the tables of the element e for the quadrature order calculated by a RefMap (copies them),
+      /// unless another thread has stored them meanwhile. Returns the stored tables in the same arguments.
+      void add(Element* e, int order, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map);
+
+      /// Pointers to the tables of the slot.
+      void get_slot(Tables* t, int slot, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map) const;
+
+      static const int H2D_NUM_TABLES = g_max_quad + 1 + 4 * g_max_quad + 4;
+
+      Tables* tables[H2D_NUM_MODES][H2D_NUM_TABLES];
+
+      GeometryStoreMode mode;
+
+      Quad2D* quad_2d;
+
+      const Mesh* mesh;
+
+      unsigned int mesh_seq;
+
+      /// Number of element ids the indices are allocated for.
+      int num_elements;
+
+      friend class RefMap;
+    };
+  }
+}
+#endif
@@ -70,12 +70,13 @@ namespace Hermes
       /// created first.
       Node* get_edge_node(int p1, int p2);
 
-      static const int H2D_DEFAULT_HASH_SIZE = 0x8000; // 32K entries
+      /// Initial number of buckets, the tables grow as the nodes are added.
+      static const int H2D_DEFAULT_HASH_SIZE = 0x1000; // 4K entries
 
       Array<Node> nodes; ///< Array storing all nodes
 
       /// Initializes the hash table.
-      /// \param size [in] Hash table size; must be a power of two.
+      /// \param size [in] Initial hash table size; must be a power of two.
       void init(int size = H2D_DEFAULT_HASH_SIZE);
 
       /// Copies another hash table contents
@@ -87,7 +88,7 @@ namespace Hermes
       /// Frees all memory used by the instance.
       void free();
 
-      /// Prints hash table statistics for debugging purposes.
+      /// Prints hash table statistics (sizes, probe lengths) for debugging purposes.
       void dump_hash_stat();
 
       /// Removes a vertex node with parent id's p1 and p2.
@@ -103,10 +104,29 @@ namespace Hermes
       Node** v_table; ///< Vertex node hash table
       Node** e_table; ///< Edge node hash table
 
-      int mask;
-      int nqueries, ncollisions;
+      /// The tables have 2^v_bits and 2^e_bits buckets.
+      int v_bits, e_bits;
 
-      int hash(int p1, int p2) { return (984120265*p1 + 125965121*p2) & mask; }
+      /// Numbers of the nodes stored in the tables.
+      int v_count, e_count;
+
+      /// Statistics: searches, nodes compared in them, the longest search, table doublings.
+      uint64_t nqueries, nprobes;
+      int max_probes, nrehashes;
+
+      /// Fibonacci hashing of the pair (p1, p2): one multiplication, the bucket is given by
+      /// the highest bits of the product, which depend on all bits of both ids.
+      static int hash(int p1, int p2, int bits)
+      {
+        uint64_t key = ((uint64_t) (unsigned) p1 << 32) | (unsigned) p2;
+        return (int) ((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+      }
+
+      /// Enlarges the table (by doubling) until it has at least as many buckets as nodes.
+      void grow_table(Node**& table, int& bits, int count);
+
+      /// Inserts the node to the table.
+      static void insert(Node** table, int bits, Node* node);
 
       /// Searches a list of hash synonyms given the first list item.
       /// Returns the node matching the parent ids p1 and p2.
@@ -115,6 +135,9 @@ namespace Hermes
       /// Creates a copy of a hash synonym list.
       void copy_list(Node** ptr, Node* node);
 
+      /// Length of the longest synonym list of the table.
+      static int get_max_chain(Node** table, int bits);
+
       friend struct Node;
       friend class MeshReaderH2D;
       template<typename Scalar> friend class NeighborSearch;
@@ -0,0 +1,92 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_POINT_LOCATOR_H
+#define __H2D_POINT_LOCATOR_H
+
+#include "../hermes2d_common_defs.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    class Element;
+    class Mesh;
+    class RefMap;
+
+    /// \brief Finds the active element of a mesh containing a given point.
+    ///
+    /// The bounding boxes of the active elements are sorted into a uniform grid with about
+    /// one cell per element, so that only the few elements registered in the cell of the point
+    /// have to be tested by RefMap::untransform(). The bounding boxes of curvilinear elements
+    /// are taken from points sampled along their edges.
+    ///
+    /// The grid is built the first time it is needed and kept as long as it is used with the same
+    /// mesh (the same instance, Mesh::get_seq() and maximum element id).
+    /// Once built, find() may be called from several threads, each with its own RefMap.
+    class HERMES_API PointLocator
+    {
+    public:
+      PointLocator();
+
+      ~PointLocator();
+
+      /// Builds the grid for the active elements of the mesh, unless it has already been built
+      /// for this mesh and the mesh has not changed since. A reference mesh has the seq number
+      /// of its coarse mesh, so the seq number alone does not identify the mesh.
+      void set_mesh(Mesh* mesh);
+
+      /// Returns the active element containing the point (x, y) and the reference coordinates
+      /// (xi1, xi2) of the point in it, or NULL if the point lies outside the mesh. The RefMap
+      /// is left set to the element found.
+      Element* find(double x, double y, RefMap* refmap, double& xi1, double& xi2) const;
+
+      /// Returns the index of the grid cell containing the point (x, y). Points in the same cell
+      /// are likely to lie in the same element, queries can be sorted by the cell index.
+      int get_cell(double x, double y) const;
+
+      /// Frees the grid.
+      void free();
+
+      /// Returns true if (xi1, xi2) lies in the reference domain of the element.
+      static bool is_in_ref_domain(Element* e, double xi1, double xi2);
+
+    protected:
+      /// The mesh the grid was built for.
+      Mesh* mesh;
+      unsigned mesh_seq;
+      int mesh_max_id;
+
+      /// The grid: nx times ny cells of the size hx times hy, starting at (x0, y0).
+      double x0, y0, hx, hy;
+      int nx, ny;
+
+      /// Ids of the elements overlapping the cell i are cell_elems[cell_start[i]] ...
+      /// cell_elems[cell_start[i + 1] - 1].
+      std::vector<int> cell_start;
+      std::vector<int> cell_elems;
+
+      /// Bounding boxes of the elements, [x_min, y_min, x_max, y_max] at 4 * id.
+      std::vector<double> boxes;
+
+      /// Calculates the bounding box of the element e.
+      void calc_bounding_box(Element* e, RefMap* refmap, double* box);
+
+      /// Range of the cells overlapped by the box.
+      void get_cell_range(const double* box, int& i0, int& j0, int& i1, int& j1) const;
+    };
+  }
+}
+#endif
@@ -25,6 +25,7 @@ namespace Hermes
   namespace Hermes2D
   {
     class Element;
+    class GeometryStore;
     namespace Views{
       class Orderizer;
       class Linearizer;
@@ -92,9 +93,18 @@ namespace Hermes
       /// Returns the jacobian of the reference map precalculated at the integration
       /// points of the specified order. Intended for non-constant jacobian elements.
       double* get_jacobian(int order);
+
+      /// Returns the jacobian of the reference map multiplied by the weights of the integration points
+      /// of the specified order, for constant and non-constant jacobian elements alike.
+      double* get_jacobian_x_weights(int order);
       
       /// Returns the increase in the integration order due to the reference map.
       int get_inv_ref_order() const;
+
+      /// Takes the physical coordinates, jacobians and inverse reference maps of the elements
+      /// covered by the store from it instead of calculating them (see GeometryStore). NULL (the
+      /// default) switches the store off.
+      void set_geometry_store(GeometryStore* geometry_store);
       
     private:
       /// If the reference map is constant, this is the fast way to obtain
@@ -154,15 +164,19 @@ namespace Hermes
       struct Node
       {
         double* jacobian[H2D_MAX_TABLES];
+        double* jwt[H2D_MAX_TABLES];
         double2x2* inv_ref_map[H2D_MAX_TABLES];
         double3x2* second_ref_map[H2D_MAX_TABLES];
         double* phys_x[H2D_MAX_TABLES];
         double* phys_y[H2D_MAX_TABLES];
         double3* tan[4];
+        /// The physical coordinates, jacobians (also multiplied by the weights) and inverse maps are
+        /// owned by the geometry store.
+        bool stored;
       };
 
       /// Table of RefMap::Nodes, indexed by a sub-element mapping.
-      std::map<uint64_t, Node*> nodes;
+      FlatHashMap<uint64_t, Node*> nodes;
 
       Node* cur_node;
 
@@ -170,20 +184,17 @@ namespace Hermes
 
       void update_cur_node()
       {
-        Node* updated_node = new Node;
-
-        if (sub_idx > H2D_MAX_IDX) {
-          delete updated_node;
+        if (sub_idx > H2D_MAX_IDX)
           cur_node = handle_overflow();
-        }
         else {
-          if(nodes.insert(std::make_pair(sub_idx, updated_node)).second == false)
-            /// The value had already existed.
-            delete updated_node;
-          else
-            /// The value had not existed.
-            init_node(updated_node);
-          cur_node = nodes[sub_idx];
+          Node** found = nodes.find(sub_idx);
+          if (found != NULL)
+            cur_node = *found;
+          else {
+            Node* new_node = new Node;
+            init_node(new_node);
+            cur_node = nodes.add(sub_idx, new_node);
+          }
         }
       }
 
@@ -195,6 +206,8 @@ namespace Hermes
 
       void calc_second_ref_map(int order);
 
+      void calc_jacobian_x_weights(int order);
+
       bool is_parallelogram();
 
       void calc_phys_x(int order);
@@ -213,8 +226,18 @@ namespace Hermes
 
       Node* handle_overflow();
 
+      GeometryStore* geometry_store;
+
+      /// Sets the tables of the given order of the current node from the geometry store, calculates
+      /// them and passes them to the store first if it does not have them yet.
+      void get_stored_tables(int order);
+
       Quad1DStd quad_1d;
 
+      /// Values of the shape functions of the reference map. Each instance has its own, so that
+      /// RefMaps used by different threads need no synchronization.
+      PrecalcShapeset ref_map_pss;
+
       int indices[70];
 
       int nc;
@@ -237,6 +260,9 @@ namespace Hermes
       friend class VonMisesFilter;
       template<typename T> friend class Func;
       template<typename T> friend class Geom;
+      template<typename T> friend class SumFactorization;
+      friend class GeometryStore;
+      friend class PointLocator;
       friend Geom<double>* init_geom_vol(RefMap *rm, const int order);
       friend Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order);
       friend Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order);
@@ -59,6 +59,21 @@ namespace Hermes
     ///
     class HERMES_API Traverse
     {
+    public:
+      /// \brief Sets the order in which all traversals (assembling, adaptivity, views, ...) visit the elements.
+      /// \details The space-filling curves order the base elements by the positions of their centers and
+      /// the sons of quadrilaterals by their quadrants, so that the consecutive elements are close to
+      /// each other and share nodes, DOFs and the related data. The sons of triangles are always visited
+      /// in the natural order.
+      static void set_element_ordering(ElementOrdering ordering);
+      static ElementOrdering get_element_ordering();
+
+      /// \brief Lists the ids of the active elements of the mesh in the order in which the traversals
+      /// visit them with the current element ordering.
+      /// \param mesh [in] The mesh.
+      /// \param ids [out] The element ids.
+      static void get_visiting_order(Mesh* mesh, Hermes::vector<int>& ids);
+
     private:
 
       void begin(int n, Mesh** meshes, Transformable** fn = NULL);
@@ -77,6 +92,8 @@ namespace Hermes
       int top, size;
 
       int id;
+      /// Base element ids in the order of visiting, NULL for the natural ordering.
+      int* base_order;
       bool tri;
       Element* base;
       int4* sons;
@@ -90,6 +107,11 @@ namespace Hermes
       void union_recurrent(Rect* cr, Element** e, Rect* er, uint64_t* idx, Element* uni);
       uint64_t init_idx(Rect* cr, Rect* er);
 
+      /// Orders the base elements along the space-filling curve of element_ordering.
+      void init_base_order();
+
+      static ElementOrdering element_ordering;
+
       Mesh* unimesh;
       template<typename T> friend class Adapt;
       template<typename T> friend class KellyTypeAdapt;
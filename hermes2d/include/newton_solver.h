@@ -80,6 +80,10 @@ namespace Hermes
     protected:
       void init_linear_solver();
 
+      /// Sets the iterative method and the preconditioner (see set_iterative_method() and
+      /// set_preconditioner()) to the linear solver if it is an iterative one.
+      void configure_linear_solver();
+
       /// Jacobian.
       SparseMatrix<Scalar>* jacobian;
 
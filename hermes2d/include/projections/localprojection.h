@@ -32,7 +32,17 @@ namespace Hermes
     public:
       LocalProjection();
 
-      // Main functionality.
+      /// Projection-based interpolation of meshfn to the space: the vertex DOFs take the values of meshfn
+      /// in the vertices, the edge DOFs are the L2 projection (on the edge) of the rest after the vertex
+      /// functions, the bubble DOFs the L2 projection (on the element) of the rest after the vertex and edge
+      /// functions. The local problems are small dense systems, no global system is solved, and meshfn is
+      /// reproduced exactly wherever it is a polynomial of the element orders of the space.
+      /// So the previous reference solution prolongated to a new reference space (see
+      /// Space::update_refined_space_orders()) is exact on all elements except the coarsened ones and is a good
+      /// initial guess for the Newton solver (coeff_vec) or an iterative matrix solver. Meshfns of the
+      /// type Solution are evaluated in batches (see Solution::get_pt_values()). Implemented for H1 and
+      /// L2 spaces, the other spaces are projected by OGProjection::project_global() with matrix_solver
+      /// and proj_norm, which are not used otherwise.
       static void project_local(const Space<Scalar>* space, MeshFunction<Scalar>* meshfn,
           Scalar* target_vec, Hermes::MatrixSolverType matrix_solver = SOLVER_UMFPACK,
           ProjNormType proj_norm = HERMES_UNSET_NORM);
@@ -60,6 +70,29 @@ namespace Hermes
           Hermes::vector<ProjNormType> proj_norms = Hermes::vector<ProjNormType>(), bool delete_old_mesh = false);
 
     protected:
+      /// DOFs of one edge (surf >= 0) or of the bubble functions (surf == -1) of the element e, solved
+      /// together as one local problem, and their points in the arrays of the values of meshfn.
+      struct LocalDofs
+      {
+        Element* e;
+        int surf;
+        int first_dof, num_dofs;
+        int first_point, num_points;
+      };
+
+      /// Sets refmap to the element of the local problem, returns the quadrature points (in the
+      /// reference domain) and their table index for RefMap::get_phys_x().
+      static double3* get_local_points(const Space<Scalar>* space, RefMap* refmap, const LocalDofs& local,
+          int& num_points, int& order);
+
+      /// Evaluates meshfn in the points (x[i], y[i]).
+      static void get_pt_values(MeshFunction<Scalar>* meshfn, std::vector<double>& x, std::vector<double>& y,
+          std::vector<Scalar>& values);
+
+      /// Solves the local problem for the values of meshfn in its points. Returns false without solving if
+      /// some other DOF of the local assembly list is not known yet (unless force is set).
+      static bool solve_local(const Space<Scalar>* space, RefMap* refmap, const LocalDofs& local,
+          const Scalar* values, Scalar* target_vec, std::vector<bool>& known, bool force);
 
       // Jacobian matrix (same as stiffness matrix since projections are linear).
       class ProjectionMatrixFormVol : public MatrixFormVol<Scalar>
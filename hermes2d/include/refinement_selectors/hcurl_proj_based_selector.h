@@ -42,6 +42,9 @@ namespace Hermes
         virtual ~HcurlProjBasedSelector();
 
       protected: //overloads
+        /// Creates a selector for another thread. For details, see Selector::clone().
+        virtual Selector<std::complex<double> >* clone();
+
         /// A function expansion of a function f used by this selector.
         enum LocalFuncExpansion {
           H2D_HCFE_VALUE0 = 0, ///< A function expansion: f_0.
@@ -38,6 +38,9 @@ namespace Hermes
         *  \param[in] user_shapeset A shapeset. If NULL, it will use internal instance of the class L2Shapeset. */
         L2ProjBasedSelector(CandList cand_list = H2D_HP_ANISO, double conv_exp = 1.0, int max_order = H2DRS_DEFAULT_ORDER, L2Shapeset* user_shapeset = NULL);
       protected: //overloads
+        /// Creates a selector for another thread. For details, see Selector::clone().
+        virtual Selector<Scalar>* clone();
+
         /// A function expansion of a function f used by this selector.
         enum LocalFuncExpansion {
           H2D_L2FE_VALUE = 0, ///< A function expansion: f.
@@ -171,6 +171,10 @@ namespace Hermes
         *  \param[in] edge_bubble_order A range of orders for edge and bubble functions. Use an empty range (i.e. Range()) to skip edge and bubble functions. */
         ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, Shapeset* shapeset, const typename OptimumSelector<Scalar>::Range& vertex_order, const typename OptimumSelector<Scalar>::Range& edge_bubble_order);
 
+        /// Copies options and error weights to a selector created by clone().
+        /** \param[in] copy A new selector of the same type constructed with the same parameters. */
+        void copy_settings(ProjBasedSelector<Scalar>* copy) const;
+
       protected: //internal logic
         /// True if the selector has already warned about possible inefficiency.
         /** If OptimumSelector::cand_list does not generate candidates with elements of
@@ -16,6 +16,7 @@
 #ifndef __H2D_REFINEMENT_SELECTOR_H
 #define __H2D_REFINEMENT_SELECTOR_H
 
+#include <vector>
 #ifndef _MSC_VER
 #include "../mesh/refinement_type.h"
 
@@ -80,6 +81,30 @@ namespace Hermes
         /** \param[in] max_order A maximum order used by this selector. If it is ::H2DRS_DEFAULT_ORDER, a maximum supported order is used. */
         Selector(int max_order = H2DRS_DEFAULT_ORDER) : max_order(max_order) {};
 
+        /// Copy constructor. The selectors of other threads are not copied.
+        Selector(const Selector<Scalar>& other) : max_order(other.max_order) {};
+
+      public:
+        /// Destructor. Deletes the selectors created for other threads.
+        virtual ~Selector();
+
+      protected:
+        /// Creates a selector with the same settings for another thread.
+        /** The new selector has its own caches and Adapt::adapt() uses it to select refinements of other elements
+        *  concurrently with this selector. Selecting a refinement of an element has to give the same result
+        *  with either of them. The default implementation returns NULL, i.e., the selector is used by one thread only.
+        *  \return A new selector or NULL if the selector does not support multiple threads. */
+        virtual Selector<Scalar>* clone();
+
+        /// Returns the selector used by a thread.
+        /** The thread 0 uses this selector. Selectors of other threads are created by clone() when they are needed
+        *  for the first time and they are kept, including their caches, until this selector is destroyed.
+        *  \param[in] thread An index of the thread.
+        *  \return The selector or NULL if this selector cannot be cloned. */
+        Selector<Scalar>* get_thread_selector(int thread);
+
+        std::vector<Selector<Scalar>*> thread_selectors; ///< Selectors of the threads 1, 2, ... created by get_thread_selector().
+
         /// Selects a refinement.
         /** This methods has to be implemented.
         *  \param[in] element An element which is being refined.
@@ -108,6 +133,9 @@ namespace Hermes
         /// Constructor.
         HOnlySelector() : Selector<Scalar>() {};
       protected:
+        /// Creates a selector for another thread. For details, see Selector::clone().
+        virtual Selector<Scalar>* clone();
+
         /// Selects a refinement.
         /** Selects a H-refienements. For details, see Selector::select_refinement. */
         virtual bool select_refinement(Element* element, int quad_order, Solution<Scalar>* rsln, ElementToRefine& refinement);
@@ -133,6 +161,9 @@ namespace Hermes
         POnlySelector(int max_order, int order_h_inc, int order_v_inc);
 
       protected:
+        /// Creates a selector for another thread. For details, see Selector::clone().
+        virtual Selector<Scalar>* clone();
+
         /// Selects a refinement.
         /** Increases an order ising POnlySelector::order_h_inc and POnlySelector::order_v_inc. Fails if the order cannot be increased due to the maximum order. For details, see Selector::select_refinement. */
         virtual bool select_refinement(Element* element, int quad_order, Solution<Scalar>* rsln, ElementToRefine& refinement);
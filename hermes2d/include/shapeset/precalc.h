@@ -49,6 +49,19 @@ namespace Hermes
 
       /// Destructor.
       virtual ~PrecalcShapeset();
+
+      /// \brief Sets the memory limit of the tables kept in the process-wide cache shared by all
+      /// instances (see precalculate()), 0 disables the cache.
+      /// \param max_bytes [in] Limit in bytes, the default is 32 MB.
+      static void set_shared_tables_limit(size_t max_bytes);
+
+      /// \brief Frees all tables of the shared cache.
+      static void free_shared_tables();
+
+      /// Number of tables taken from the shared cache.
+      static unsigned int get_shared_tables_hits();
+      /// Number of tables that had to be calculated.
+      static unsigned int get_shared_tables_misses();
     
     private:
       virtual void set_quad_2d(Quad2D* quad_2d);
@@ -101,7 +114,7 @@ namespace Hermes
       /// The highest and most complicated one maps a key formed by
       /// quadrature table selector (0-7), mode of the shape function (triangle/quad),
       /// and shape function index to a table from the middle layer.
-      LightArray<std::map<uint64_t, LightArray<Node*>*>*> tables;
+      LightArray<FlatHashMap<uint64_t, LightArray<Node*>*>*> tables;
 
       int mode;
 
@@ -114,6 +127,13 @@ namespace Hermes
       /// Returns true iff this is a precalculated shapeset for test functions.
       bool is_slave() const;
 
+      /// Fills the tables of the active shape in the points of the given order. Tables on the
+      /// standard quadrature are first looked up in the process-wide cache, keyed by the shapeset
+      /// id, mode, shape index, order and sub-element transform, so that the values precalculated
+      /// by one instance (of a DiscreteProblem, Adapt, OGProjection, ...) are reused by all the
+      /// others. Newly calculated tables are added to the cache, the least recently used ones are
+      /// dropped when over the limit (see set_shared_tables_limit()). Inside OpenMP parallel regions
+      /// the cache is bypassed.
       virtual void precalculate(int order, int mask);
 
       void update_max_index();
@@ -131,6 +151,7 @@ namespace Hermes
       template<typename T> friend class DiscreteProblem;
       template<typename T> friend class NeighborSearch;
       friend class CurvMap;
+      template<typename T> friend class SumFactorization;
     };
   }
 }
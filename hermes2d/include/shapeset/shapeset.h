@@ -43,6 +43,8 @@ namespace Hermes
       class HcurlProjBasedSelector;
     }
 
+    template<typename Scalar> class SumFactorization;
+
     /// \brief Defines a set of shape functions.
     ///
     /// This class stores mainly the definitions of the polynomials for all shape functions,
@@ -90,6 +92,8 @@ namespace Hermes
       int get_order(int index, int mode_) const;
 
     protected:
+      Shapeset();
+
       /// Selects HERMES_MODE_TRIANGLE or HERMES_MODE_QUAD.
       virtual void set_mode(int mode);
 
@@ -127,6 +131,15 @@ namespace Hermes
       /// domain, component is 0 for Scalar shapesets and 0 or 1 for vector shapesets.
       double get_value(int n, int index, double x, double y, int component);
 
+      /// Obtains the values of the given shape function in the points (x[i], y[i]), i = 0 ... np - 1,
+      /// into result. The shape function is looked up only once for all the points.
+      void get_values(int n, int index, int np, const double* x, const double* y, int component, double* result);
+
+      /// The same for several shape functions at once, result[i] receives the values of indices[i].
+      /// If the functions of the current mode are tensor products (see tensor_factors), the
+      /// one-dimensional functions are evaluated by recurrences only once for all of them.
+      void get_values(int n, int num_indices, const int* indices, int np, const double* x, const double* y, int component, double** result);
+
       double get_fn_value (int index, double x, double y, int component);
       double get_dx_value (int index, double x, double y, int component);
       double get_dy_value (int index, double x, double y, int component);
@@ -154,6 +167,10 @@ namespace Hermes
       int**  bubble_count;
       int**  index_to_order;
 
+      /// For each mode either NULL, or the factorization of all shape functions of that mode into
+      /// products of Lobatto functions: index -> { i, j, sign } for sign * l_i(x) * l_j(y).
+      int (*tensor_factors[2])[3];
+
       double2 ref_vert[2][4];
       int max_order;
       int max_index[2];
@@ -203,7 +220,19 @@ namespace Hermes
       ///
       double get_constrained_value(int n, int index, double x, double y, int component);
 
+      /// Batch version of get_constrained_value().
+      void get_constrained_values(int n, int index, int np, const double* x, const double* y, int component, double* result);
+
+      /// Values (der = 0), first (der = 1) or second (der = 2) derivatives of the Lobatto functions
+      /// l_0 ... l_max_k in np points: out[k * np + i] is the value for l_k and x[i].
+      static void get_lobatto_values(int max_k, int der, int np, const double* x, double* out);
+
+      /// Batch evaluation of tensor product shape functions, see tensor_factors.
+      void get_tensor_values(int n, int num_indices, const int* indices, int np, const double* x, const double* y, double** result);
+
       template<typename Scalar> friend class DiscreteProblem; template<typename Scalar> friend class Solution; friend class CurvMap; friend class RefMap; template<typename Scalar> friend class RefinementSelectors::H1ProjBasedSelector; template<typename Scalar> friend class RefinementSelectors::L2ProjBasedSelector; friend class RefinementSelectors::HcurlProjBasedSelector; template<typename Scalar> friend class RefinementSelectors::OptimumSelector; friend class PrecalcShapeset;
+      template<typename Scalar> friend class SumFactorization;
+      template<typename Scalar> friend class LocalProjection;
       friend void check_leg_tri(Shapeset* shapeset);
       friend void check_gradleg_tri(Shapeset* shapeset);
       template<typename Scalar> friend class Space;
@@ -29,6 +29,7 @@ extern int* simple_quad_edge_indices[4];
 extern int* simple_quad_bubble_indices[];
 extern int simple_quad_bubble_count[];
 extern int simple_quad_index_to_order[];
+extern int simple_quad_tensor_factors[][3];
 
 
 #endif
@@ -0,0 +1,80 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_GRAPH_ORDERING_H
+#define __H2D_GRAPH_ORDERING_H
+
+#include "../hermes2d_common_defs.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    /// \brief Orderings of the vertices of an undirected graph reducing the bandwidth / fill-in
+    /// of the matrices with this graph. Used by Space to renumber the DOFs (the vertices are
+    /// then groups of DOFs belonging to one node or element, the edges are the couplings
+    /// through elements).
+    ///
+    /// The graph is given by the adjacency lists in the compressed row format
+    /// (adj[adj_ptr[v]] ... adj[adj_ptr[v + 1] - 1] are the neighbors of v, without v itself).
+    /// The arrays are not copied.
+    ///
+    /// In both orderings, perm[k] is the (old) vertex placed at the position k.
+    class HERMES_API GraphOrdering
+    {
+    public:
+      GraphOrdering(int n, const int* adj_ptr, const int* adj);
+
+      /// Reverse Cuthill-McKee ordering. Each connected component is started from a pseudo-peripheral
+      /// vertex found from 'start' (for the first component) or from its first vertex.
+      void reverse_cuthill_mckee(int* perm, int start = 0) const;
+
+      /// Nested dissection by level structures: the middle level of a rooted level structure
+      /// separates the rest of the graph, both parts are ordered recursively and the separator
+      /// is placed after them. Parts smaller than ND_LEAF_SIZE are ordered by reverse Cuthill-McKee.
+      void nested_dissection(int* perm, int start = 0) const;
+
+      static const int ND_LEAF_SIZE = 64;
+
+    protected:
+      /// Rooted level structure of the component of 'root' in the subgraph of the vertices v with
+      /// part[v] == p. The vertices are stored level by level in 'order', the levels start at 'level_ptr'.
+      /// @return The number of levels.
+      int level_structure(int root, const std::vector<int>& part, int p, std::vector<int>& order, std::vector<int>& level_ptr) const;
+
+      /// Finds a pseudo-peripheral vertex (George & Liu) starting the search from 'start', its level
+      /// structure is left in 'order' and 'level_ptr'.
+      int pseudo_peripheral(int start, const std::vector<int>& part, int p, std::vector<int>& order, std::vector<int>& level_ptr) const;
+
+      /// Appends the reverse Cuthill-McKee ordering of the component of 'start' in the subgraph
+      /// (part[v] == p) to perm, starting at the position pos.
+      void rcm_component(int start, const std::vector<int>& part, int p, int* perm, int& pos) const;
+
+      /// Appends the nested dissection ordering of the subgraph (part[v] == p) formed by 'vertices'.
+      void dissect(const std::vector<int>& vertices, int start, std::vector<int>& part, int p, int& num_parts, int* perm, int& pos) const;
+
+      int degree(int v) const { return adj_ptr[v + 1] - adj_ptr[v]; }
+
+      int n;
+      const int* adj_ptr;
+      const int* adj;
+
+      /// Marks of visited vertices (compared with the stamp to avoid clearing).
+      mutable std::vector<int> mark;
+      mutable int stamp;
+    };
+  }
+}
+#endif
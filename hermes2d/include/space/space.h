@@ -189,6 +189,25 @@ namespace Hermes
       /// \brief Assings the degrees of freedom to all Spaces in the Hermes::vector.
       static int assign_dofs(Hermes::vector<Space<Scalar>*> spaces);
 
+      /// \brief Sets the ordering of the DOFs applied in assign_dofs().
+      /// \details The DOFs of one node (or of the bubble functions of one element) stay consecutive
+      /// and the DOFs of the space stay in the range given by first_dof, so that the coupled
+      /// systems keep their block structure; only the nodes are renumbered. Does not call assign_dofs().
+      void set_dof_ordering(DofOrdering dof_ordering);
+
+      /// \brief Sets the ordering of the DOFs to all Spaces in the Hermes::vector.
+      /// \details The search for the starting node starts from the same element in all spaces, so
+      /// the spaces on one mesh are ordered consistently and also the off-diagonal blocks of the
+      /// coupled matrix are banded.
+      static void set_dof_ordering(Hermes::vector<Space<Scalar>*> spaces, DofOrdering dof_ordering);
+
+      DofOrdering get_dof_ordering() const;
+
+      /// \brief Bandwidth and profile (sum of the distances of the first nonzero from the diagonal
+      /// over the rows) of the matrix pattern of the space before and after the renumbering in the last
+      /// assign_dofs(). All are -1 if the DOFs were not renumbered.
+      void get_dof_ordering_stats(int& bandwidth_before, int& bandwidth_after, long long& profile_before, long long& profile_after) const;
+
       /// Creates a copy of the space, increases order of all elements by
       /// "order_increase".
       virtual Space<Scalar>* dup(Mesh* mesh, int order_increase = 0) const = 0;
@@ -297,6 +316,10 @@ namespace Hermes
 
       void copy_orders_recurrent(Element* e, int order);
 
+      /// Returns true if the mesh of this space is the mesh coarse refined once by refine_all_elements(refinement_type),
+      /// element by element with the same ids, i.e. if the reference space can be updated in place.
+      bool is_refinement_of(Mesh* coarse, int refinement_type) const;
+
       virtual void reset_dof_assignment(); ///< Resets assignment of DOF to an unassigned state.
       virtual void assign_vertex_dofs() = 0;
       virtual void assign_edge_dofs() = 0;
@@ -326,6 +349,14 @@ namespace Hermes
 
       void free_bc_data();
 
+      /// Renumbers the DOFs assigned by assign_vertex_dofs(), assign_edge_dofs() and assign_bubble_dofs()
+      /// according to dof_ordering and computes the bandwidth and profile before and after.
+      void renumber_dofs();
+
+      DofOrdering dof_ordering;
+      int bandwidth_before, bandwidth_after;
+      long long profile_before, profile_after;
+
       /// Internal. Used by DiscreteProblem to detect changes in the space.
       int get_seq() const;
 
@@ -342,6 +373,22 @@ namespace Hermes
       static Space<Scalar>* construct_refined_space(Space<Scalar>* coarse, int order_increase = 1,
                                                     int refinement_type = 0);
 
+      /// Updates the element orders of the globally refined space of the previous adaptivity step to the
+      /// current coarse space, provided the coarse mesh has not changed since: the mesh of ref_space must
+      /// still be the coarse mesh refined by refinement_type (see is_refinement_of()). Then the orders of
+      /// coarse increased by order_increase are copied to ref_space, its DOFs are assigned anew and true is
+      /// returned. This saves the copy and refinement of the mesh and the construction of the space in the
+      /// adaptivity steps that change only the orders. Otherwise ref_space is left untouched and false is
+      /// returned, the reference space has to be constructed by construct_refined_space() then.
+      static bool update_refined_space_orders(Space<Scalar>* coarse, Space<Scalar>* ref_space,
+                                              int order_increase = 1, int refinement_type = 0);
+
+      /// The same as update_refined_space_orders() for several spaces. Either all the reference spaces
+      /// are updated (true is returned), or none of them is.
+      static bool update_refined_spaces_orders(Hermes::vector<Space<Scalar>*> coarse,
+                                               Hermes::vector<Space<Scalar>*> ref_spaces,
+                                               int order_increase = 1, int refinement_type = 0);
+
       static void update_essential_bc_values(Hermes::vector<Space<Scalar>*> spaces, double time);
 
       static void update_essential_bc_values(Space<Scalar>*s, double time);
@@ -0,0 +1,141 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_SUM_FACTORIZATION_H
+#define __H2D_SUM_FACTORIZATION_H
+
+#include "hermes2d_common_defs.h"
+#include "asmlist.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    class PrecalcShapeset;
+    class RefMap;
+
+    /// Highest element order with fixed-size sum factorization kernels.
+    const int H2D_SF_MAX_FIXED_ORDER = 10;
+
+    /// \brief Sum factorization of volumetric integrals on parallelogram quads.
+    ///
+    /// The H1 shape functions on quads are products l_i(x) l_j(y) of Lobatto functions (see
+    /// Shapeset::tensor_factors) and the quadrature points on quads are a cartesian product
+    /// of 1D Gauss points. If the element map is affine (constant jacobian), also the physical
+    /// derivatives of the shape functions are combinations of such products, and the integrals
+    ///
+    ///   \sum_k \sum_{a,b} c_ab(k) D_a v_i(k) D_b u_j(k),   D_0 = value, D_1 = d/dx, D_2 = d/dy,
+    ///
+    /// can be evaluated by contracting the 1D tables one direction at a time. For order p
+    /// elements this takes O(p^5) operations for an element matrix instead of O(p^6), and
+    /// O(p^3) for an element vector instead of O(p^4). The coefficients c_ab in the quadrature
+    /// points are provided by the forms, see MatrixFormVol::value_coefficients() and
+    /// VectorFormVol::value_coefficients().
+    ///
+    /// For the element orders 1 ... H2D_SF_MAX_FIXED_ORDER and the usual numbers of quadrature
+    /// points, the contractions are done by kernels with the number of functions and points fixed
+    /// at compile time, which the compiler unrolls and vectorizes. Other cases use the generic
+    /// kernels with runtime loop bounds.
+    template<typename Scalar>
+    class HERMES_API SumFactorization
+    {
+    public:
+      /// Returns true if the shape functions al->idx of fn on the active element of rm can be
+      /// integrated by sum factorization using the quadrature of the given order.
+      static bool is_applicable(PrecalcShapeset* fn, RefMap* rm, AsmList<Scalar>* al, int order);
+
+      /// Returns false if the active element of rm excludes sum factorization whatever the functions and the
+      /// order (a triangle, or a curved or non-parallelogram quad), for a check before the order is known.
+      static bool is_applicable(RefMap* rm);
+
+      /// Element matrix: result[i][j] = \sum_k \sum_{a,b} coef[3a + b][k] D_a v_i(k) D_b u_j(k),
+      /// i indexing alv, j indexing alu. coef[3a + b] == NULL stands for a zero coefficient.
+      static void integrate_matrix(int order, PrecalcShapeset* fu, PrecalcShapeset* fv, RefMap* ru, RefMap* rv,
+        AsmList<Scalar>* alu, AsmList<Scalar>* alv, Scalar** coef, Scalar** result);
+
+      /// Element vector: result[i] = \sum_k \sum_a coef[a][k] D_a v_i(k), i indexing alv.
+      /// coef[a] == NULL stands for a zero coefficient.
+      static void integrate_vector(int order, PrecalcShapeset* fv, RefMap* rv,
+        AsmList<Scalar>* alv, Scalar** coef, Scalar* result);
+
+      /// Enables (the default) or disables the fixed-size kernels, for comparisons.
+      static void set_fixed_kernels(bool enable);
+
+      /// Returns true if there is a fixed-size kernel for q 1D functions and n1 1D points.
+      static bool has_fixed_kernel(int q, int n1);
+
+      /// Number of element matrices and vectors integrated by sum factorization since the last
+      /// reset_counters(), and how many of them by the fixed-size kernels.
+      static unsigned int get_num_integrations();
+      static unsigned int get_num_fixed_integrations();
+      static void reset_counters();
+
+    protected:
+      /// 1D tables of the shape functions of one element.
+      struct Tables
+      {
+        /// Number of 1D quadrature points.
+        int n1;
+        /// Highest Lobatto function index in the x and y directions.
+        int max_i, max_j;
+        /// Values (der = 0) and derivatives (der = 1) of l_0 ... l_max_i in the x-points,
+        /// x[der][i * n1 + k], the same for y.
+        std::vector<double> x[2], y[2];
+        /// Factorization of the shape functions of the assembly list.
+        std::vector<int> fi, fj;
+        std::vector<double> sign;
+        /// Physical derivatives in terms of the reference ones, D_a = \sum_b t[a][b] D^ref_b.
+        double t[3][3];
+      };
+
+      /// Fills the tables for the functions al->idx of fn on the active element of rm. If max_index
+      /// is not negative, the 1D tables cover l_0 ... l_max_index in both directions.
+      static void init_tables(Tables& tab, int order, PrecalcShapeset* fn, RefMap* rm, AsmList<Scalar>* al, int max_index = -1);
+
+      /// Returns the highest Lobatto function index in the factors of the functions al->idx.
+      static int get_max_index(PrecalcShapeset* fn, AsmList<Scalar>* al);
+
+      /// Contracts the coefficients c of D^ref_alpha v D^ref_beta u with the 1D tables and adds
+      /// the result to the element matrix. QU, QV and N1 are the numbers of 1D functions of u and v
+      /// and of 1D points if known at compile time, zero otherwise (then qu, qv and n1 are used).
+      /// w and a are scratch arrays of n1 entries, tmp of qv * qu * n1 entries.
+      template<int QU, int QV, int N1>
+      static void contract_matrix(int qu, int qv, int n1, const Tables& tu, const Tables& tv, int alpha, int beta,
+        const Scalar* c, Scalar* w, double* a, Scalar* tmp, Scalar** result);
+
+      /// The same for the element vector, Q is the number of 1D functions in the x direction,
+      /// tmp has q * n1 entries.
+      template<int Q, int N1>
+      static void contract_vector(int q, int n1, const Tables& tv, int alpha, const Scalar* c, Scalar* tmp, Scalar* result);
+
+      typedef void (*matrix_kernel_t)(int qu, int qv, int n1, const Tables& tu, const Tables& tv, int alpha, int beta,
+        const Scalar* c, Scalar* w, double* a, Scalar* tmp, Scalar** result);
+      typedef void (*vector_kernel_t)(int q, int n1, const Tables& tv, int alpha, const Scalar* c, Scalar* tmp, Scalar* result);
+
+      /// Returns the fixed-size kernel for q 1D functions and n1 1D points, or NULL.
+      static matrix_kernel_t get_matrix_kernel(int q, int n1);
+      static vector_kernel_t get_vector_kernel(int q, int n1);
+
+      static bool fixed_kernels;
+
+      /// Increments the counters of get_num_integrations() and get_num_fixed_integrations().
+      static void count_integration(bool fixed);
+
+      static unsigned int num_integrations;
+      static unsigned int num_fixed_integrations;
+    };
+  }
+}
+#endif
@@ -240,9 +240,31 @@ namespace Hermes
 
       int sym;
 
+      /// Whether the values of the form depend on the solutions of the previous iteration (u_ext[]).
+      /// Forms that do not may set it to false, then the cache of local matrices (see
+      /// DiscreteProblem::set_local_cache()) reuses their values also in the assemblings with a coefficient
+      /// vector, e.g. in the NewtonSolver. True by default.
+      bool uses_u_ext;
+
       virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *u, Func<double> *v,
         Geom<double> *e, ExtData<Scalar> *ext) const;
 
+      /// Optional batched evaluation of the form for all basis and test functions of one element.
+      /// Fills result[i][j] with value(n, wt, u_ext, u[j], v[i], e, ext) for all i < nv, j < nu,
+      /// all functions being evaluated in the same n quadrature points.
+      /// The default implementation returns false, the form is then evaluated pair by pair using value().
+      virtual bool value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+        int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const;
+
+      /// Optional representation of the form by its coefficients in the n quadrature points, for forms
+      /// of the type value() = \sum_k \sum_{a,b} coef[3a + b][k] * D_a v(k) * D_b u(k), where
+      /// D_0 = val, D_1 = dx, D_2 = dy. The weights wt are to be included in the coefficients.
+      /// The nine arrays coef[] of length n are preallocated, the form sets those that are zero to NULL.
+      /// Used for the sum factorization on parallelogram quads (see SumFactorization).
+      /// The default implementation returns false.
+      virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const;
+
       virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *u, Func<Hermes::Ord> *v,
         Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
     };
@@ -290,9 +312,21 @@ namespace Hermes
 
       unsigned int i;
 
+      /// Whether the values of the form depend on the solutions of the previous iteration (u_ext[]).
+      /// Forms that do not may set it to false, then the cache of local vectors (see
+      /// DiscreteProblem::set_local_cache()) reuses their values also in the assemblings with a coefficient
+      /// vector, e.g. in the NewtonSolver. True by default.
+      bool uses_u_ext;
+
       virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *v,
         Geom<double> *e, ExtData<Scalar> *ext) const;
 
+      /// Optional representation of the form by its coefficients in the n quadrature points, for forms
+      /// of the type value() = \sum_k \sum_a coef[a][k] * D_a v(k), D_0 = val, D_1 = dx, D_2 = dy,
+      /// see MatrixFormVol::value_coefficients(). The default implementation returns false.
+      virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const;
+
       virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *v, Geom<Hermes::Ord> *e,
         ExtData<Hermes::Ord> *ext) const;
     };
@@ -48,6 +48,12 @@ namespace Hermes
         virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *u, Func<double> *v,
           Geom<double> *e, ExtData<Scalar> *ext) const;
 
+        virtual bool value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+          int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const;
+
+        virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+          ExtData<Scalar> *ext, Scalar **coef) const;
+
         virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *u,
           Func<Hermes::Ord> *v, Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
 
@@ -80,6 +86,12 @@ namespace Hermes
         virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *u,
           Func<double> *v, Geom<double> *e, ExtData<Scalar> *ext) const;
 
+        virtual bool value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+          int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const;
+
+        virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+          ExtData<Scalar> *ext, Scalar **coef) const;
+
         virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *u, Func<Hermes::Ord> *v,
           Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
 
@@ -148,6 +160,9 @@ namespace Hermes
         virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *v,
           Geom<double> *e, ExtData<Scalar> *ext) const;
 
+        virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+          ExtData<Scalar> *ext, Scalar **coef) const;
+
         virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *v,
           Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
 
@@ -178,6 +193,9 @@ namespace Hermes
         virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *v,
           Geom<double> *e, ExtData<Scalar> *ext) const;
 
+        virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+          ExtData<Scalar> *ext, Scalar **coef) const;
+
         virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *v,
           Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
 
@@ -211,6 +229,9 @@ namespace Hermes
         virtual Scalar value(int n, double *wt, Func<Scalar> *u_ext[], Func<double> *v,
           Geom<double> *e, ExtData<Scalar> *ext) const;
 
+        virtual bool value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+          ExtData<Scalar> *ext, Scalar **coef) const;
+
         virtual Hermes::Ord ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *v,
           Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const;
 
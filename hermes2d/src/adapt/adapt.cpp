@@ -26,6 +26,9 @@
 #include "refinement_selectors/selector.h"
 #include "matrix.h"
 #include "common_time_period.h"
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
 
 namespace Hermes
 {
@@ -36,6 +39,7 @@ namespace Hermes
       Hermes::vector<ProjNormType> proj_norms) :
     spaces(spaces),
       num_act_elems(-1),
+      num_threads(1),
       have_errors(false),
       have_coarse_solutions(false),
       have_reference_solutions(false)
@@ -98,6 +102,7 @@ namespace Hermes
     Adapt<Scalar>::Adapt(Space<Scalar>* space, ProjNormType proj_norm) :
     spaces(Hermes::vector<Space<Scalar>*>()),
       num_act_elems(-1),
+      num_threads(1),
       have_errors(false),
       have_coarse_solutions(false),
       have_reference_solutions(false)
@@ -160,6 +165,7 @@ namespace Hermes
       int regularize, double to_be_processed)
     {
       _F_
+      HERMES_PROFILE("adaptation");
       error_if(!have_errors, "element errors have to be calculated first, call Adapt<Scalar>::calc_err_est().");
 
       if (refinement_selectors.empty())
@@ -198,6 +204,14 @@ namespace Hermes
         for(int l = 0; l < this->num; l++)
           idx[j][l] = -1; // element not refined
 
+      // Refinements of the regular queue selected in advance by several threads, empty if the selection is serial.
+      std::vector<Hermes::vector<RefinementSelectors::Selector<Scalar>*> > thread_selectors;
+      std::vector<Hermes::vector<Solution<Scalar>*> > thread_rslns;
+      std::vector<SelectedRefinement> selected;
+      int num_ahead = 8 * num_threads; // a number of elements selected in advance, doubled every time
+      if (init_selection_threads(meshes, refinement_selectors, thread_selectors, thread_rslns))
+        selected.resize(regular_queue.size());
+
       double err0_squared = 1000.0;
       double processed_error_squared = 0.0;
 
@@ -271,9 +285,27 @@ namespace Hermes
 
           // get refinement suggestion
           ElementToRefine elem_ref(id, comp);
-          int current = this->spaces[comp]->get_element_order(id);
-          // rsln[comp] may be unset if refinement_selectors[comp] == HOnlySelector or POnlySelector
-          bool refined = refinement_selectors[comp]->select_refinement(e, current, rsln[comp], elem_ref);
+          bool refined;
+          if (inx_element >= 0 && !selected.empty())
+          {
+            // The stop conditions depend on the refinements of the preceding elements, so the following
+            // elements are selected in advance and their refinements are used in the serial order.
+            if (!selected[inx_element].done)
+            {
+              int last = std::min(inx_element + num_ahead, std::min(num_act_elems, (int)regular_queue.size()));
+              select_refinements_ahead(inx_element, last, thread_selectors, thread_rslns, selected);
+              num_ahead *= 2;
+            }
+            refined = selected[inx_element].refined;
+            elem_ref = selected[inx_element].refinement;
+          }
+          else
+          {
+            int current = this->spaces[comp]->get_element_order(id);
+            // rsln[comp] may be unset if refinement_selectors[comp] == HOnlySelector or POnlySelector
+            HERMES_PROFILE("adaptation/selection");
+            refined = refinement_selectors[comp]->select_refinement(e, current, rsln[comp], elem_ref);
+          }
 
           //add to a list of elements that are going to be refined
           if (can_refine_element(mesh, e, refined, elem_ref) )
@@ -296,6 +328,11 @@ namespace Hermes
         }
       }
 
+      // the thread 0 uses the original reference solutions
+      for (unsigned int t = 1; t < thread_rslns.size(); t++)
+        for (int j = 0; j < this->num; j++)
+          delete thread_rslns[t][j];
+
       verbose("Examined elements: %d", num_exam_elem);
       verbose(" Elements taken from priority queue: %d", num_priority_elem);
       verbose(" Ignored elements: %d", num_ignored_elem);
@@ -609,6 +646,106 @@ namespace Hermes
       }
     }
 
+    template<typename Scalar>
+    void Adapt<Scalar>::set_num_threads(int num_threads)
+    {
+      _F_
+      if (num_threads < 1)
+        throw Exceptions::ValueException("num_threads", num_threads, 1);
+#ifndef WITH_OPENMP
+      if (num_threads > 1)
+        warn("Hermes was built without OpenMP, refinements will be selected serially.");
+#endif
+      this->num_threads = num_threads;
+    }
+
+    template<typename Scalar>
+    bool Adapt<Scalar>::init_selection_threads(Mesh** meshes, Hermes::vector<RefinementSelectors::Selector<Scalar>*>& refinement_selectors,
+      std::vector<Hermes::vector<RefinementSelectors::Selector<Scalar>*> >& thread_selectors,
+      std::vector<Hermes::vector<Solution<Scalar>*> >& thread_rslns)
+    {
+      _F_
+#ifndef WITH_OPENMP
+      return false;
+#else
+      if (num_threads < 2)
+        return false;
+
+      // Reference solutions are copied for every thread, this is only implemented for Solutions.
+      for (int j = 0; j < this->num; j++)
+        if (rsln[j] != NULL && rsln[j]->get_type() != HERMES_SLN)
+          return false;
+
+      // The mode of the shapesets and of the quadrature is shared by all threads.
+      int mode = -1;
+      for (int j = 0; j < this->num; j++)
+      {
+        Element* e;
+        for_all_active_elements(e, meshes[j])
+        {
+          if (mode == -1)
+            mode = e->get_mode();
+          else if (mode != e->get_mode())
+            return false;
+        }
+      }
+
+      // Every thread uses its own selectors, they are kept by the original selectors.
+      thread_selectors.resize(num_threads);
+      for (int t = 0; t < num_threads; t++)
+        for (int j = 0; j < this->num; j++)
+        {
+          RefinementSelectors::Selector<Scalar>* selector = refinement_selectors[j]->get_thread_selector(t);
+          if (selector == NULL)
+          {
+            thread_selectors.clear();
+            return false;
+          }
+          thread_selectors[t].push_back(selector);
+        }
+
+      thread_rslns.resize(num_threads);
+      for (int t = 0; t < num_threads; t++)
+        for (int j = 0; j < this->num; j++)
+        {
+          Solution<Scalar>* copy = rsln[j];
+          if (t > 0 && rsln[j] != NULL)
+          {
+            copy = new Solution<Scalar>();
+            copy->copy(rsln[j]);
+            copy->set_quad_2d(&g_quad_2d_std);
+            copy->enable_transform(false);
+          }
+          thread_rslns[t].push_back(copy);
+        }
+      verbose("Selecting refinements by %d threads.", num_threads);
+      return true;
+#endif
+    }
+
+    template<typename Scalar>
+    void Adapt<Scalar>::select_refinements_ahead(int first, int last,
+      std::vector<Hermes::vector<RefinementSelectors::Selector<Scalar>*> >& thread_selectors,
+      std::vector<Hermes::vector<Solution<Scalar>*> >& thread_rslns, std::vector<SelectedRefinement>& selected)
+    {
+      _F_
+#ifdef WITH_OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+      for (int i = first; i < last; i++)
+      {
+        HERMES_PROFILE("adaptation/selection");
+        int t = omp_get_thread_num();
+        int id = regular_queue[i].id, comp = regular_queue[i].comp;
+        Element* e = this->spaces[comp]->get_mesh()->get_element(id);
+        int current = this->spaces[comp]->get_element_order(id);
+        ElementToRefine elem_ref(id, comp);
+        selected[i].refined = thread_selectors[t][comp]->select_refinement(e, current, thread_rslns[t][comp], elem_ref);
+        selected[i].refinement = elem_ref;
+        selected[i].done = true;
+      }
+#endif
+    }
+
     template<typename Scalar>
     double Adapt<Scalar>::get_element_error_squared(int component, int id) const
     {
@@ -990,6 +1127,7 @@ namespace Hermes
       Hermes::vector<double>* component_errors, bool solutions_for_adapt, unsigned int error_flags)
     {
       _F_;
+      HERMES_PROFILE("adaptation/error estimation");
       int i, j;
 
       int n = slns.size();
@@ -23,6 +23,11 @@
 #include "mesh/refmap.h"
 #include "function/solution.h"
 #include "neighbor.h"
+#include "sum_factorization.h"
+#include "matrix_free_operator.h"
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
 
 using namespace Hermes::Algebra::DenseMatrixOperations;
 
@@ -68,6 +73,14 @@ namespace Hermes
       matrix_buffer = NULL;
       matrix_buffer_dim = 0;
       have_matrix = false;
+      num_threads = 1;
+      order_table_hits = order_table_misses = 0;
+      linearization_point = NULL;
+      linearization_dir_lift = true;
+      linearization_wf_seq = -1;
+      geometry_store_enabled = false;
+      geometry_store_mode = HERMES_GEOMETRY_STORE_ALL;
+      local_cache = NULL;
     }
 
     template<typename Scalar>
@@ -97,6 +110,19 @@ namespace Hermes
       matrix_buffer_dim = 0;
       have_matrix = false;
 
+      // Serial assembling by default.
+      num_threads = 1;
+
+      order_table_hits = order_table_misses = 0;
+
+      // No linearization point for apply() yet.
+      linearization_point = NULL;
+      linearization_dir_lift = true;
+      linearization_wf_seq = -1;
+      geometry_store_enabled = false;
+      geometry_store_mode = HERMES_GEOMETRY_STORE_ALL;
+      local_cache = NULL;
+
       // Initialize precalc shapesets according to spaces provided.
       pss = new PrecalcShapeset*[wf->get_neq()];
 
@@ -122,6 +148,13 @@ namespace Hermes
       _F_;
       free();
       if (sp_seq != NULL) delete [] sp_seq;
+      if (linearization_point != NULL) delete [] linearization_point;
+      free_linearization();
+      free_thread_workers();
+      for (unsigned int i = 0; i < geometry_stores.size(); i++)
+        delete geometry_stores[i];
+      if (local_cache != NULL)
+        delete local_cache;
       if (pss != NULL)
       {
         for(unsigned int i = 0; i < wf->get_neq(); i++)
@@ -161,6 +194,24 @@ namespace Hermes
       return (matrix_buffer = new_matrix<Scalar>(n, n));
     }
 
+    template<typename Scalar>
+    Scalar* DiscreteProblem<Scalar>::get_vector_buffer(int n)
+    {
+      _F_;
+      if (vector_buffer.size() < (unsigned int) n)
+        vector_buffer.resize(n);
+      return &vector_buffer[0];
+    }
+
+    template<typename Scalar>
+    Scalar* DiscreteProblem<Scalar>::get_coef_buffer(int n)
+    {
+      _F_;
+      if (coef_buffer.size() < (unsigned int) n)
+        coef_buffer.resize(n);
+      return &coef_buffer[0];
+    }
+
     template<typename Scalar>
     const Space<Scalar>* DiscreteProblem<Scalar>::get_space(int n)
     {
@@ -227,11 +278,88 @@ namespace Hermes
       this->is_fvm = true;
     }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_geometry_store(bool enable, GeometryStoreMode mode)
+    {
+      _F_;
+      // The refmaps of the threads refer to the stores.
+      free_thread_workers();
+      for (unsigned int i = 0; i < geometry_stores.size(); i++)
+        delete geometry_stores[i];
+      geometry_stores.clear();
+      geometry_store_enabled = enable;
+      geometry_store_mode = mode;
+    }
+
+    template<typename Scalar>
+    size_t DiscreteProblem<Scalar>::get_geometry_store_memory_size() const
+    {
+      size_t size = 0;
+      for (unsigned int i = 0; i < geometry_stores.size(); i++)
+        size += geometry_stores[i]->get_memory_size();
+      return size;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_num_threads(int num_threads)
+    {
+      _F_;
+      if(num_threads < 1)
+        throw Exceptions::ValueException("num_threads", num_threads, 1);
+#ifndef WITH_OPENMP
+      if(num_threads > 1)
+        warning("Hermes was built without OpenMP, assembling will be serial.");
+#endif
+      if(num_threads != this->num_threads)
+        free_thread_workers();
+      this->num_threads = num_threads;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_local_cache(bool enable)
+    {
+      _F_;
+      if (local_cache != NULL)
+        delete local_cache;
+      local_cache = enable ? new LocalCache : NULL;
+    }
+
+    template<typename Scalar>
+    unsigned int DiscreteProblem<Scalar>::get_local_cache_hits() const
+    {
+      return local_cache != NULL ? local_cache->hits : 0;
+    }
+
+    template<typename Scalar>
+    unsigned int DiscreteProblem<Scalar>::get_local_cache_misses() const
+    {
+      return local_cache != NULL ? local_cache->misses : 0;
+    }
+
+    template<typename Scalar>
+    unsigned int DiscreteProblem<Scalar>::get_order_table_hits() const
+    {
+      return order_table_hits;
+    }
+
+    template<typename Scalar>
+    unsigned int DiscreteProblem<Scalar>::get_order_table_misses() const
+    {
+      return order_table_misses;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::get_cache_statistics(unsigned int& lookups, unsigned int& hits, size_t& memory)
+    {
+      assembling_caches.get_statistics(lookups, hits, memory);
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::create_sparse_structure(SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
       bool force_diagonal_blocks, Table* block_weights)
     {
       _F_;
+      HERMES_PROFILE("assembly/sparse structure");
 
       if (is_up_to_date())
       {
@@ -481,6 +609,7 @@ namespace Hermes
 
       this->spaces = spaces;
       this->ndof = Space<Scalar>::get_num_dofs(spaces);
+      free_thread_workers();
       
       this->invalidate_matrix();
     }
@@ -513,6 +642,27 @@ namespace Hermes
         refmap.push_back(new RefMap());
         refmap[i]->set_quad_2d(&g_quad_2d_std);
       }
+      attach_geometry_stores(refmap);
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::attach_geometry_stores(Hermes::vector<RefMap *>& refmap)
+    {
+      _F_;
+      if (!geometry_store_enabled)
+        return;
+      while (geometry_stores.size() < wf->get_neq())
+        geometry_stores.push_back(new GeometryStore(geometry_store_mode));
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+      {
+        // Equations on the same mesh share the store of the first one.
+        unsigned int j = 0;
+        while (spaces[j]->get_mesh()->get_seq() != spaces[i]->get_mesh()->get_seq())
+          j++;
+        if (j == i)
+          geometry_stores[i]->set_mesh(spaces[i]->get_mesh());
+        refmap[i]->set_geometry_store(geometry_stores[j]);
+      }
     }
 
     template<typename Scalar>
@@ -531,8 +681,36 @@ namespace Hermes
       // Creating matrix sparse structure.
       create_sparse_structure(mat, rhs, force_diagonal_blocks, block_weights);
 
+      assemble_forms(coeff_vec, mat, rhs, force_diagonal_blocks, add_dir_lift, block_weights);
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::assemble_forms(Scalar* coeff_vec, SparseMatrix<Scalar>* mat,
+      Vector<Scalar>* rhs, bool force_diagonal_blocks, bool add_dir_lift, Table* block_weights)
+    {
+      _F_;
       // Convert the coefficient vector into vector of external solutions.
       Hermes::vector<Solution<Scalar>*> u_ext;
+      convert_coeff_vec(coeff_vec, add_dir_lift, u_ext);
+
+      // Create assembling stages.
+      Hermes::vector<Stage<Scalar> > stages = Hermes::vector<Stage<Scalar> >();
+      bool want_matrix = (mat != NULL);
+      bool want_vector = (rhs != NULL);
+      wf->get_stages(spaces, u_ext, stages, want_matrix, want_vector);
+
+      assemble_stages(stages, u_ext, mat, rhs, force_diagonal_blocks, block_weights);
+
+      // Delete the vector u_ext.
+      for(typename Hermes::vector<Solution<Scalar>*>::iterator it = u_ext.begin(); it != u_ext.end(); it++)
+        delete *it;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::convert_coeff_vec(Scalar* coeff_vec, bool add_dir_lift,
+      Hermes::vector<Solution<Scalar>*>& u_ext)
+    {
+      _F_;
       int first_dof = 0;
       if (coeff_vec != NULL) for (int i = 0; i < wf->get_neq(); i++)
       {
@@ -541,10 +719,29 @@ namespace Hermes
         u_ext.push_back(external_solution_i);
         first_dof += spaces[i]->get_num_dofs();
       }
+    }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::assemble_stages(Hermes::vector<Stage<Scalar> >& stages,
+      Hermes::vector<Solution<Scalar>*>& u_ext, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
+      bool force_diagonal_blocks, Table* block_weights)
+    {
+      _F_;
+      HERMES_PROFILE("assembly");
       // Reset the warnings about insufficiently high integration order.
       reset_warn_order();
 
+      // Forms are again tried for the batched evaluation.
+      mfvol_without_block.clear();
+      vfvol_without_coefficients.clear();
+
+      // Forms may have been added or removed, the form pointers are no longer a valid key of the local cache.
+      if (local_cache != NULL && local_cache->wf_seq != wf->get_seq())
+      {
+        local_cache->clear();
+        local_cache->wf_seq = wf->get_seq();
+      }
+
       // Create slave pss's, refmaps.
       Hermes::vector<PrecalcShapeset *> spss;
       Hermes::vector<RefMap *> refmap;
@@ -559,12 +756,6 @@ namespace Hermes
       if (mat != NULL)
         get_matrix_buffer(9);
 
-      // Create assembling stages.
-      Hermes::vector<Stage<Scalar> > stages = Hermes::vector<Stage<Scalar> >();
-      bool want_matrix = (mat != NULL);
-      bool want_vector = (rhs != NULL);
-      wf->get_stages(spaces, u_ext, stages, want_matrix, want_vector);
-
       // Loop through all assembling stages -- the purpose of this is increased performance
       // in multi-mesh calculations, where, e.g., only the right hand side uses two meshes.
       // In such a case, the matrix forms are assembled over one mesh, and only the rhs
@@ -581,6 +772,10 @@ namespace Hermes
         assemble_one_stage(stages[ss], mat, rhs, force_diagonal_blocks,
         block_weights, spss, refmap, u_ext);
 
+      // Local matrices and vectors of the elements that are no longer there are dropped.
+      if (local_cache != NULL)
+        local_cache->finish_assembling(mat != NULL, rhs != NULL);
+
       // Deinitialize matrix buffer.
       if(matrix_buffer != NULL)
         delete [] matrix_buffer;
@@ -592,10 +787,6 @@ namespace Hermes
         delete *it;
       for(Hermes::vector<RefMap *>::iterator it = refmap.begin(); it != refmap.end(); it++)
         delete *it;
-
-      // Delete the vector u_ext.
-      for(typename Hermes::vector<Solution<Scalar>*>::iterator it = u_ext.begin(); it != u_ext.end(); it++)
-        delete *it;
     }
 
     template<typename Scalar>
@@ -607,6 +798,68 @@ namespace Hermes
       assemble(coeff_vec, NULL, rhs, force_diagonal_blocks, add_dir_lift, block_weights);
     }
 
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::set_linearization_point(Scalar* coeff_vec, bool add_dir_lift)
+    {
+      _F_;
+      if (linearization_point != NULL)
+        delete [] linearization_point;
+      linearization_point = NULL;
+      linearization_dir_lift = add_dir_lift;
+      if (coeff_vec != NULL)
+      {
+        int n = get_num_dofs();
+        linearization_point = new Scalar[n];
+        memcpy(linearization_point, coeff_vec, n * sizeof(Scalar));
+      }
+      init_linearization();
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::init_linearization()
+    {
+      _F_;
+      free_linearization();
+      convert_coeff_vec(linearization_point, linearization_dir_lift, linearization_u_ext);
+      wf->get_stages(spaces, linearization_u_ext, linearization_stages, true, false);
+      for (unsigned int i = 0; i < wf->get_neq(); i++)
+        linearization_sp_seq.push_back(spaces[i]->get_seq());
+      linearization_wf_seq = wf->get_seq();
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::free_linearization()
+    {
+      _F_;
+      for(typename Hermes::vector<Solution<Scalar>*>::iterator it = linearization_u_ext.begin(); it != linearization_u_ext.end(); it++)
+        delete *it;
+      linearization_u_ext.clear();
+      linearization_stages.clear();
+      linearization_sp_seq.clear();
+      linearization_wf_seq = -1;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::apply(const Scalar* x, Scalar* y)
+    {
+      _F_;
+      memset(y, 0, get_num_dofs() * sizeof(Scalar));
+
+      // The local matrices are multiplied with x as they are added, see MatrixFreeOperator::add().
+      // The external solutions and the stages are made again only if the spaces or the weak form have changed.
+      bool up_to_date = linearization_wf_seq == wf->get_seq() && linearization_sp_seq.size() == wf->get_neq();
+      for (unsigned int i = 0; i < linearization_sp_seq.size() && up_to_date; i++)
+        if (linearization_sp_seq[i] != spaces[i]->get_seq())
+          up_to_date = false;
+      if (!up_to_date)
+        init_linearization();
+
+      MatrixFreeOperator<Scalar> op(this);
+      op.x = x;
+      op.y = y;
+      assemble_stages(linearization_stages, linearization_u_ext, &op, NULL, false, NULL);
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::assemble_one_stage(Stage<Scalar>& stage,
       SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
@@ -623,13 +876,10 @@ namespace Hermes
       // Info about the boundary edge.
       SurfPos surf_pos[4];
 
-      // Create the assembling states.
-      Traverse trav;
       for (unsigned i = 0; i < stage.idx.size(); i++)
         stage.fns[i] = pss[stage.idx[i]];
       for (unsigned i = 0; i < stage.ext.size(); i++)
         stage.ext[i]->set_quad_2d(&g_quad_2d_std);
-      trav.begin(stage.meshes.size(), &(stage.meshes.front()), &(stage.fns.front()));
 
       // Check that there is a DG form, so that the DG assembling procedure needs to be performed.
       DG_matrix_forms_present = false;
@@ -667,6 +917,18 @@ namespace Hermes
         }
       }
 
+#ifdef WITH_OPENMP
+      if(num_threads > 1 && is_stage_threadable(stage, mat, rhs))
+      {
+        assemble_one_stage_threaded(stage, mat, rhs, force_diagonal_blocks, block_weights, u_ext);
+        return;
+      }
+#endif
+
+      // Create the assembling states.
+      Traverse trav;
+      trav.begin(stage.meshes.size(), &(stage.meshes.front()), &(stage.fns.front()));
+
       // Loop through all assembling states.
       // Assemble each one.
       Element** e;
@@ -696,6 +958,276 @@ namespace Hermes
       }
     }
 
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::is_stage_threadable(Stage<Scalar>& stage, SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs)
+    {
+      _F_;
+      if(DG_matrix_forms_present || DG_vector_forms_present)
+        return false;
+
+      // The threads add to distinct entries of the matrix and of the vector at the same time. That is
+      // safe only for the backends adding into preallocated arrays, not for those buffering the entries
+      // or communicating (PETSc, Epetra, MUMPS).
+      bool safe_mat = (mat == NULL || dynamic_cast<MatrixFreeOperator<Scalar>*>(mat) != NULL);
+      bool safe_rhs = (rhs == NULL);
+#ifdef WITH_UMFPACK
+      safe_mat = safe_mat || dynamic_cast<CSCMatrix<Scalar>*>(mat) != NULL;
+      safe_rhs = safe_rhs || dynamic_cast<UMFPackVector<Scalar>*>(rhs) != NULL;
+#endif
+#ifdef WITH_SUPERLU
+      safe_mat = safe_mat || dynamic_cast<SuperLUMatrix<Scalar>*>(mat) != NULL;
+      safe_rhs = safe_rhs || dynamic_cast<SuperLUVector<Scalar>*>(rhs) != NULL;
+#endif
+      if(!safe_mat || !safe_rhs)
+        return false;
+
+      // External functions are copied for every thread, this is only implemented for Solutions.
+      for (unsigned int i = 0; i < stage.ext.size(); i++)
+      {
+        Solution<Scalar>* sln = dynamic_cast<Solution<Scalar>*>(stage.ext[i]);
+        if(sln == NULL || sln->get_type() != HERMES_SLN)
+          return false;
+      }
+
+      // The mode of the shapesets and of the quadrature is shared by all threads.
+      int mode = -1;
+      for (unsigned int i = 0; i < stage.meshes.size(); i++)
+      {
+        Element* e;
+        for_all_active_elements(e, stage.meshes[i])
+        {
+          if(mode == -1)
+            mode = e->get_mode();
+          else if(mode != e->get_mode())
+            return false;
+        }
+      }
+      return true;
+    }
+
+    template<typename Scalar>
+    MeshFunction<Scalar>* DiscreteProblem<Scalar>::get_thread_ext_fn(MeshFunction<Scalar>* fn)
+    {
+      if(thread_ext_fns.empty() || fn == NULL)
+        return fn;
+      typename std::map<MeshFunction<Scalar>*, MeshFunction<Scalar>*>::iterator it = thread_ext_fns.find(fn);
+      if(it == thread_ext_fns.end())
+        return fn;
+      return it->second;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::free_thread_workers()
+    {
+      _F_;
+      for (unsigned int t = 0; t < thread_workers.size(); t++)
+      {
+        ThreadWorker& worker = thread_workers[t];
+        for (unsigned int i = 0; i < worker.spss.size(); i++)
+          delete worker.spss[i];
+        for (unsigned int i = 0; i < worker.refmaps.size(); i++)
+          delete worker.refmaps[i];
+        for (unsigned int i = 0; i < worker.ext_copies.size(); i++)
+          delete worker.ext_copies[i];
+        if (worker.dp->matrix_buffer != NULL)
+          delete [] worker.dp->matrix_buffer;
+        worker.dp->matrix_buffer = NULL;
+        // The local cache belongs to this instance.
+        worker.dp->local_cache = NULL;
+        delete worker.dp;
+      }
+      thread_workers.clear();
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::assemble_one_stage_threaded(Stage<Scalar>& stage,
+      SparseMatrix<Scalar>* mat, Vector<Scalar>* rhs,
+      bool force_diagonal_blocks, Table* block_weights,
+      Hermes::vector<Solution<Scalar>*>& u_ext)
+    {
+      _F_;
+#ifdef WITH_OPENMP
+      // Maximum number of colors, states that would need more are assembled serially at the end.
+      const int max_colors = 64;
+      unsigned int num_fns = stage.fns.size();
+
+      // Record all the assembling states together with the sub-element transformations
+      // of all the stage functions, and color them greedily so that no two states
+      // of the same color contribute to the same DOF.
+      Hermes::vector<ThreadedState> states;
+      std::vector<uint64_t> dof_colors(ndof, 0);
+      std::vector<int> state_dofs;
+      AsmList<Scalar> al;
+
+      Traverse trav;
+      trav.begin(stage.meshes.size(), &(stage.meshes.front()), &(stage.fns.front()));
+      Element** e;
+      ThreadedState state;
+      while ((e = trav.get_next_state(state.bnd, state.surf_pos)) != NULL)
+      {
+        state.e = new Element*[num_fns];
+        state.sub_idx = new uint64_t[num_fns];
+        for (unsigned int i = 0; i < num_fns; i++)
+        {
+          state.e[i] = e[i];
+          state.sub_idx[i] = (e[i] != NULL) ? stage.fns[i]->get_transform() : 0;
+        }
+        state.base = trav.get_base();
+
+        state_dofs.clear();
+        uint64_t used_colors = 0;
+        for (unsigned int i = 0; i < stage.idx.size(); i++)
+        {
+          if (e[i] == NULL)
+            continue;
+          int j = stage.idx[i];
+          spaces[j]->get_element_assembly_list(e[i], &al, spaces_first_dofs[j]);
+          for (unsigned int k = 0; k < al.cnt; k++)
+          {
+            if (al.dof[k] < 0)
+              continue;
+            state_dofs.push_back(al.dof[k]);
+            used_colors |= dof_colors[al.dof[k]];
+          }
+        }
+
+        state.color = 0;
+        while (state.color < max_colors && (used_colors & ((uint64_t) 1 << state.color)))
+          state.color++;
+        if (state.color < max_colors)
+          for (unsigned int k = 0; k < state_dofs.size(); k++)
+            dof_colors[state_dofs[k]] |= (uint64_t) 1 << state.color;
+
+        states.push_back(state);
+      }
+      trav.finish();
+
+      std::vector<std::vector<unsigned int> > colors(max_colors + 1);
+      for (unsigned int i = 0; i < states.size(); i++)
+        colors[states[i].color].push_back(i);
+
+      // Per-thread scratch data, created in the first threaded assembling.
+      if (thread_workers.size() != (unsigned int) num_threads)
+      {
+        free_thread_workers();
+        for (int t = 0; t < num_threads; t++)
+        {
+          ThreadWorker worker;
+          worker.dp = new DiscreteProblem<Scalar>(wf, spaces);
+          worker.dp->initialize_psss(worker.spss);
+          // The refmaps of the workers share the geometry stores of this instance.
+          initialize_refmaps(worker.refmaps);
+          thread_workers.push_back(worker);
+        }
+      }
+      else
+        // The stores drop their tables when the meshes change, the refmaps must not keep pointers to them.
+        for (int t = 0; t < num_threads; t++)
+          attach_geometry_stores(thread_workers[t].refmaps);
+
+      // The workers start from the integration orders memoized by this instance (see get_memoized_order()).
+      if(assembling_caches.order_table_wf_seq != wf->get_seq())
+      {
+        assembling_caches.order_table.clear();
+        assembling_caches.order_table_wf_seq = wf->get_seq();
+      }
+
+      Hermes::vector<Stage<Scalar> > worker_stages;
+      std::vector<Hermes::vector<Solution<Scalar>*> > worker_u_ext(num_threads);
+      for (int t = 0; t < num_threads; t++)
+      {
+        ThreadWorker& worker = thread_workers[t];
+        DiscreteProblem<Scalar>* dp = worker.dp;
+        dp->spaces_first_dofs = spaces_first_dofs;
+        dp->ndof = ndof;
+        dp->is_fvm = is_fvm;
+        dp->RungeKutta = RungeKutta;
+        dp->RK_original_spaces_count = RK_original_spaces_count;
+        dp->DG_matrix_forms_present = false;
+        dp->DG_vector_forms_present = false;
+        dp->local_cache = local_cache;
+        dp->mfvol_without_block.clear();
+        dp->vfvol_without_coefficients.clear();
+        dp->assembling_caches.order_table = assembling_caches.order_table;
+        dp->assembling_caches.order_table_wf_seq = assembling_caches.order_table_wf_seq;
+        if (mat != NULL)
+          dp->get_matrix_buffer(9);
+
+        Stage<Scalar> worker_stage = stage;
+        for (unsigned int i = 0; i < stage.idx.size(); i++)
+          worker_stage.fns[i] = dp->pss[stage.idx[i]];
+        // The external Solutions may have changed since the last assembling, the copies are refreshed.
+        dp->thread_ext_fns.clear();
+        while (worker.ext_copies.size() < stage.ext.size())
+          worker.ext_copies.push_back(new Solution<Scalar>());
+        for (unsigned int i = 0; i < stage.ext.size(); i++)
+        {
+          Solution<Scalar>* copy = worker.ext_copies[i];
+          copy->copy(static_cast<Solution<Scalar>*>(stage.ext[i]));
+          copy->set_quad_2d(&g_quad_2d_std);
+          worker_stage.ext[i] = copy;
+          worker_stage.fns[stage.idx.size() + i] = copy;
+          dp->thread_ext_fns[stage.ext[i]] = copy;
+        }
+        for (unsigned int i = 0; i < u_ext.size(); i++)
+          worker_u_ext[t].push_back(static_cast<Solution<Scalar>*>(dp->get_thread_ext_fn(u_ext[i])));
+
+        worker_stages.push_back(worker_stage);
+      }
+
+      // Assemble the colors one by one, states of one color in parallel.
+      for (unsigned int c = 0; c <= (unsigned int) max_colors; c++)
+      {
+        int color_size = colors[c].size();
+        int threads = (c < (unsigned int) max_colors) ? num_threads : 1;
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (int s = 0; s < color_size; s++)
+        {
+          int t = omp_get_thread_num();
+          ThreadedState& st = states[colors[c][s]];
+          Stage<Scalar>& worker_stage = worker_stages[t];
+          for (unsigned int i = 0; i < num_fns; i++)
+          {
+            if (st.e[i] == NULL)
+              continue;
+            worker_stage.fns[i]->set_active_element(st.e[i]);
+            worker_stage.fns[i]->set_transform(st.sub_idx[i]);
+          }
+          thread_workers[t].dp->assemble_one_state(worker_stage, mat, rhs, force_diagonal_blocks,
+            block_weights, thread_workers[t].spss, thread_workers[t].refmaps,
+            worker_u_ext[t], st.e, st.bnd, st.surf_pos, st.base);
+        }
+      }
+      // The backends assembled by threads (see is_stage_threadable()) only need finish() to mark the values changed.
+      if (mat != NULL)
+        mat->finish();
+      if (rhs != NULL)
+        rhs->finish();
+
+      // Merge the integration orders the workers had to calculate, sum their statistics.
+      for (int t = 0; t < num_threads; t++)
+      {
+        DiscreteProblem<Scalar>* dp = thread_workers[t].dp;
+        if (dp->order_table_misses > 0)
+          for (typename FlatHashMap<typename AssemblingCaches::KeyOrder, int, typename AssemblingCaches::HashOrder>::iterator it =
+            dp->assembling_caches.order_table.begin(); it != dp->assembling_caches.order_table.end(); ++it)
+            if (assembling_caches.order_table.find(it->first) == NULL)
+              assembling_caches.order_table.add(it->first, it->second);
+        order_table_hits += dp->order_table_hits;
+        order_table_misses += dp->order_table_misses;
+        dp->order_table_hits = dp->order_table_misses = 0;
+      }
+
+      for (unsigned int i = 0; i < states.size(); i++)
+      {
+        delete [] states[i].e;
+        delete [] states[i].sub_idx;
+      }
+#else
+      error("Threaded assembling requires Hermes built WITH_OPENMP.");
+#endif
+    }
+
     template<typename Scalar>
     Element* DiscreteProblem<Scalar>::init_state(Stage<Scalar>& stage, Hermes::vector<PrecalcShapeset *>& spss,
       Hermes::vector<RefMap *>& refmap, Element** e, Hermes::vector<AsmList<Scalar>*>& al)
@@ -868,7 +1400,31 @@ namespace Hermes
         Scalar **local_stiffness_matrix = NULL;
         local_stiffness_matrix = get_matrix_buffer(std::max(al[m]->cnt, al[n]->cnt));
 
-        for (unsigned int i = 0; i < al[m]->cnt; i++)
+        // The local matrix kept from the previous assembling (see set_local_cache()),
+        // or the batched evaluation of all the pairs at once, if the form supports it.
+        bool block_evaluated = false;
+        if (mat != NULL)
+          block_evaluated = get_cached_local_matrix(mfv, u_ext, spss, refmap, al, local_stiffness_matrix);
+        if (mat != NULL && !block_evaluated && mfvol_without_block.find(mfv) == mfvol_without_block.end())
+        {
+          block_evaluated = eval_form_block(mfv, u_ext, pss[n], spss[m], refmap[n], refmap[m], al[n], al[m], local_stiffness_matrix);
+          if (!block_evaluated)
+            mfvol_without_block.insert(mfv);
+        }
+        if (block_evaluated)
+        {
+          for (unsigned int i = 0; i < al[m]->cnt; i++)
+            for (unsigned int j = 0; j < al[n]->cnt; j++)
+            {
+              // Keep the same zero pattern as in the pair by pair evaluation.
+              if (std::abs(al[m]->coef[i]) > 1e-12 && std::abs(al[n]->coef[j]) > 1e-12)
+                local_stiffness_matrix[i][j] *= block_scaling_coeff * al[n]->coef[j] * al[m]->coef[i];
+              else
+                local_stiffness_matrix[i][j] = 0;
+            }
+        }
+
+        for (unsigned int i = 0; i < al[m]->cnt && !block_evaluated; i++)
         {
           if (!tra && al[m]->dof[i] < 0) continue;
           spss[m]->set_active_shape(al[m]->idx[i]);
@@ -980,8 +1536,19 @@ namespace Hermes
         }
         if (assemble_this_form == false) continue;
 
-        Scalar* vector = NULL;
-        
+        // The local vector kept from the previous assembling (see set_local_cache()), or
+        // sum factorized evaluation for all the test functions at once, if possible.
+        Scalar* vector = get_vector_buffer(std::max(al[m]->cnt, 1u));
+        bool block_evaluated = get_cached_local_vector(vfv, u_ext, spss, refmap, al, vector);
+        if (!block_evaluated && vfvol_without_coefficients.find(vfv) == vfvol_without_coefficients.end())
+          block_evaluated = eval_form_block(vfv, u_ext, spss[m], refmap[m], al[m], vector);
+        if (block_evaluated)
+          for (unsigned int i = 0; i < al[m]->cnt; i++)
+            if (al[m]->dof[i] >= 0 && std::abs(al[m]->coef[i]) > 1e-12)
+              rhs->add(al[m]->dof[i], vector[i] * al[m]->coef[i]);
+        if (block_evaluated)
+          continue;
+
         for (unsigned int i = 0; i < al[m]->cnt; i++)
         {
           if (al[m]->dof[i] < 0) continue;
@@ -1923,7 +2490,7 @@ namespace Hermes
       fake_ext->nf = ext.size();
       Func<Hermes::Ord>** fake_ext_fn = new Func<Hermes::Ord>*[fake_ext->nf];
       for (int i = 0; i < fake_ext->nf; i++)
-        fake_ext_fn[i] = get_fn_ord(ext[i]->get_fn_order());
+        fake_ext_fn[i] = get_fn_ord(get_thread_ext_fn(ext[i])->get_fn_order());
       fake_ext->fn = fake_ext_fn;
 
       return fake_ext;
@@ -1940,7 +2507,7 @@ namespace Hermes
       Func<Scalar>** ext_fn = new Func<Scalar>*[ext.size()];
       for (unsigned i = 0; i < ext.size(); i++)
       {
-        if (ext[i] != NULL) ext_fn[i] = init_fn(ext[i], order);
+        if (ext[i] != NULL) ext_fn[i] = get_ext_fn(ext[i], order);
         else ext_fn[i] = NULL;
       }
       ext_data->nf = ext.size();
@@ -1960,7 +2527,7 @@ namespace Hermes
       fake_ext->nf = ext.size();
       Func<Hermes::Ord>** fake_ext_fn = new Func<Hermes::Ord>*[fake_ext->nf];
       for (int i = 0; i < fake_ext->nf; i++)
-        fake_ext_fn[i] = get_fn_ord(ext[i]->get_edge_fn_order(edge));
+        fake_ext_fn[i] = get_fn_ord(get_thread_ext_fn(ext[i])->get_edge_fn_order(edge));
       fake_ext->fn = fake_ext_fn;
 
       return fake_ext;
@@ -2008,35 +2575,25 @@ namespace Hermes
       if(rm->is_jacobian_const())
       {
         typename AssemblingCaches::KeyConst key(256 - fu->get_active_shape(), order, fu->get_transform(), fu->get_shapeset()->get_id(), rm->get_const_inv_ref_map());
-        if(rm->get_active_element()->get_mode() == HERMES_MODE_TRIANGLE)
-        {
-          if(assembling_caches.const_cache_fn_triangles.find(key) == assembling_caches.const_cache_fn_triangles.end())
-            assembling_caches.const_cache_fn_triangles[key] = init_fn(fu, rm, order);
-          return assembling_caches.const_cache_fn_triangles[key];
-        }
-        else
-        {
-          if(assembling_caches.const_cache_fn_quads.find(key) == assembling_caches.const_cache_fn_quads.end())
-            assembling_caches.const_cache_fn_quads[key] = init_fn(fu, rm, order);
-          return assembling_caches.const_cache_fn_quads[key];
-        }
+        FlatHashMap<typename AssemblingCaches::KeyConst, Func<double>*, typename AssemblingCaches::HashConst>& cache =
+          (rm->get_active_element()->get_mode() == HERMES_MODE_TRIANGLE) ? assembling_caches.const_cache_fn_triangles : assembling_caches.const_cache_fn_quads;
+        size_t hash = typename AssemblingCaches::HashConst()(key);
+        Func<double>** found = cache.find(key, hash);
+        if(found != NULL)
+          return *found;
+        return cache.add(key, hash, init_fn(fu, rm, order));
       }
       else
       {
         typename AssemblingCaches::KeyNonConst key(256 - fu->get_active_shape(), order,
           fu->get_transform(), fu->get_shapeset()->get_id());
-        if(rm->get_active_element()->get_mode() == HERMES_MODE_TRIANGLE)
-        {
-          if(assembling_caches.cache_fn_triangles.find(key) == assembling_caches.cache_fn_triangles.end())
-            assembling_caches.cache_fn_triangles[key] = init_fn(fu, rm, order);
-          return assembling_caches.cache_fn_triangles[key];
-        }
-        else
-        {
-          if(assembling_caches.cache_fn_quads.find(key) == assembling_caches.cache_fn_quads.end())
-            assembling_caches.cache_fn_quads[key] = init_fn(fu, rm, order);
-          return assembling_caches.cache_fn_quads[key];
-        }
+        FlatHashMap<typename AssemblingCaches::KeyNonConst, Func<double>*, typename AssemblingCaches::HashNonConst>& cache =
+          (rm->get_active_element()->get_mode() == HERMES_MODE_TRIANGLE) ? assembling_caches.cache_fn_triangles : assembling_caches.cache_fn_quads;
+        size_t hash = typename AssemblingCaches::HashNonConst()(key);
+        Func<double>** found = cache.find(key, hash);
+        if(found != NULL)
+          return *found;
+        return cache.add(key, hash, init_fn(fu, rm, order));
       }
     }
 
@@ -2051,6 +2608,27 @@ namespace Hermes
       return assembling_caches.cache_fn_ord.get(cached_order);
     }
 
+    template<typename Scalar>
+    Func<Scalar>* DiscreteProblem<Scalar>::get_ext_fn(MeshFunction<Scalar>* fn, const int order)
+    {
+      _F_;
+      fn = get_thread_ext_fn(fn);
+      std::pair<MeshFunction<Scalar>*, int> key(fn, order);
+      Func<Scalar>** found = assembling_caches.cache_ext_fn.find(key);
+      if(found != NULL)
+        return *found;
+      return assembling_caches.cache_ext_fn.add(key, init_fn(fn, order));
+    }
+
+    template<typename Scalar>
+    Func<Scalar>* DiscreteProblem<Scalar>::get_prev_fn(Solution<Scalar>* sln, const int order)
+    {
+      _F_;
+      if(RungeKutta)
+        return init_fn(sln, order);
+      return get_ext_fn(sln, order);
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::init_cache()
     {
@@ -2087,20 +2665,28 @@ namespace Hermes
         }
       }
 
-      for (typename std::map<typename AssemblingCaches::KeyNonConst, Func<double>*, typename AssemblingCaches::CompareNonConst>::const_iterator it = assembling_caches.cache_fn_quads.begin();
+      for (typename FlatHashMap<typename AssemblingCaches::KeyNonConst, Func<double>*, typename AssemblingCaches::HashNonConst>::iterator it = assembling_caches.cache_fn_quads.begin();
         it != assembling_caches.cache_fn_quads.end(); it++)
       {
         (it->second)->free_fn(); delete (it->second);
       }
       assembling_caches.cache_fn_quads.clear();
 
-      for (typename std::map<typename AssemblingCaches::KeyNonConst, Func<double>*, typename AssemblingCaches::CompareNonConst>::const_iterator it = assembling_caches.cache_fn_triangles.begin();
+      for (typename FlatHashMap<typename AssemblingCaches::KeyNonConst, Func<double>*, typename AssemblingCaches::HashNonConst>::iterator it = assembling_caches.cache_fn_triangles.begin();
         it != assembling_caches.cache_fn_triangles.end(); it++)
       {
         (it->second)->free_fn();
         delete (it->second);
       }
       assembling_caches.cache_fn_triangles.clear();
+
+      for (typename FlatHashMap<std::pair<MeshFunction<Scalar>*, int>, Func<Scalar>*, typename AssemblingCaches::HashExtFn>::iterator it = assembling_caches.cache_ext_fn.begin();
+        it != assembling_caches.cache_ext_fn.end(); it++)
+      {
+        (it->second)->free_fn();
+        delete (it->second);
+      }
+      assembling_caches.cache_ext_fn.clear();
     }
 
     template<typename Scalar>
@@ -2130,11 +2716,297 @@ namespace Hermes
       return result;
     }
     
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::eval_form_block(MatrixFormVol<Scalar> *mfv,
+      Hermes::vector<Solution<Scalar>*> u_ext,
+      PrecalcShapeset *fu, PrecalcShapeset *fv,
+      RefMap *ru, RefMap *rv,
+      AsmList<Scalar>* alu, AsmList<Scalar>* alv, Scalar** result)
+    {
+      _F_;
+      if (alu->cnt == 0 || alv->cnt == 0)
+        return true;
+
+      // Determine the integration order by parsing the form with the shape functions of the highest order.
+      int max_u = 0, max_v = 0;
+      for (unsigned int j = 0; j < alu->cnt; j++)
+      {
+        fu->set_active_shape(alu->idx[j]);
+        if (fu->get_fn_order() > max_u)
+          max_u = fu->get_fn_order();
+      }
+      for (unsigned int i = 0; i < alv->cnt; i++)
+      {
+        fv->set_active_shape(alv->idx[i]);
+        if (fv->get_fn_order() > max_v)
+          max_v = fv->get_fn_order();
+      }
+      for (unsigned int j = 0; j < alu->cnt; j++)
+      {
+        fu->set_active_shape(alu->idx[j]);
+        if (fu->get_fn_order() == max_u)
+          break;
+      }
+      for (unsigned int i = 0; i < alv->cnt; i++)
+      {
+        fv->set_active_shape(alv->idx[i]);
+        if (fv->get_fn_order() == max_v)
+          break;
+      }
+      int order = calc_order_matrix_form_vol(mfv, u_ext, fu, fv, ru, rv);
+
+      Quad2D* quad = fu->get_quad_2d();
+      int np = quad->get_num_points(order);
+
+      // Init geometry and jacobian*weights.
+      if (cache_e[order] == NULL)
+      {
+        cache_e[order] = init_geom_vol(ru, order);
+        cache_jwt[order] = new double[np];
+        memcpy(cache_jwt[order], ru->get_jacobian_x_weights(order), np * sizeof(double));
+      }
+      Geom<double>* e = cache_e[order];
+      double* jwt = cache_jwt[order];
+
+      // Values of the previous Newton iteration and external functions in quadrature points.
+      int prev_size = u_ext.size() - mfv->u_ext_offset;
+      if(RungeKutta)
+        prev_size = RK_original_spaces_count;
+
+      Func<Scalar>** prev = new Func<Scalar>*[prev_size];
+      if (u_ext != Hermes::vector<Solution<Scalar>*>())
+        for (int i = 0; i < prev_size; i++)
+          if (u_ext[i + mfv->u_ext_offset] != NULL)
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + mfv->u_ext_offset], order);
+          else
+            prev[i] = NULL;
+      else
+        for (int i = 0; i < prev_size; i++)
+          prev[i] = NULL;
+
+      ExtData<Scalar>* ext = init_ext_fns(mfv->ext, rv, order);
+
+      if(RungeKutta)
+        for(int ext_i = 0; ext_i < this->RK_original_spaces_count; ext_i++)
+          prev[ext_i]->add(*ext->fn[mfv->ext.size() - this->RK_original_spaces_count + ext_i]);
+
+      // Sum factorization on parallelogram quads, if the form provides its coefficients.
+      bool evaluated = false;
+      if (SumFactorization<Scalar>::is_applicable(fu, ru, alu, order) && SumFactorization<Scalar>::is_applicable(fv, rv, alv, order))
+      {
+        Scalar* coef_values = get_coef_buffer(9 * np);
+        Scalar* coef[9];
+        for (int ab = 0; ab < 9; ab++)
+          coef[ab] = coef_values + ab * np;
+        if (mfv->value_coefficients(np, jwt, prev, e, ext, coef))
+        {
+          SumFactorization<Scalar>::integrate_matrix(order, fu, fv, ru, rv, alu, alv, coef, result);
+          evaluated = true;
+        }
+      }
+
+      if (!evaluated)
+      {
+        // Shape function values of all basis and test functions.
+        Func<double>** u = new Func<double>*[alu->cnt];
+        for (unsigned int j = 0; j < alu->cnt; j++)
+        {
+          fu->set_active_shape(alu->idx[j]);
+          u[j] = get_fn(fu, ru, order);
+        }
+        Func<double>** v = new Func<double>*[alv->cnt];
+        for (unsigned int i = 0; i < alv->cnt; i++)
+        {
+          fv->set_active_shape(alv->idx[i]);
+          v[i] = get_fn(fv, rv, order);
+        }
+
+        evaluated = mfv->value_block(np, jwt, prev, alu->cnt, u, alv->cnt, v, e, ext, result);
+
+        delete [] u;
+        delete [] v;
+      }
+
+      if (evaluated)
+        for (unsigned int i = 0; i < alv->cnt; i++)
+          for (unsigned int j = 0; j < alu->cnt; j++)
+            result[i][j] *= mfv->scaling_factor;
+
+      // Clean up.
+      for(int i = 0; i < prev_size; i++)
+        if (prev[i] != NULL && RungeKutta)
+        {
+          prev[i]->free_fn();
+          delete prev[i];
+        }
+      delete [] prev;
+
+      if (ext != NULL)
+      {
+        // The functions themselves are owned by the assembling caches.
+        delete [] ext->fn;
+        delete ext;
+      }
+
+      return evaluated;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::get_cached_local_matrix(MatrixFormVol<Scalar>* mfv, Hermes::vector<Solution<Scalar>*>& u_ext,
+      Hermes::vector<PrecalcShapeset*>& spss, Hermes::vector<RefMap*>& refmap,
+      Hermes::vector<AsmList<Scalar>*>& al, Scalar** local)
+    {
+      _F_;
+      // The previous iterate is not a part of the key, only the forms independent of it are cached.
+      if (local_cache == NULL || RungeKutta || !mfv->ext.empty() || (mfv->uses_u_ext && !u_ext.empty()))
+        return false;
+      int m = mfv->i;
+      int n = mfv->j;
+      typename LocalCache::Key key;
+      double coords[2][4][2];
+      if (!local_cache->init_key(key, coords, mfv, pss[n], pss[m]))
+        return false;
+
+      // The states of one traversal have different keys, an entry found is not touched by the other threads.
+      typename LocalCache::Entry* entry;
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_local_cache)
+#endif
+      {
+        entry = local_cache->find(key, coords, al[m], al[n], mfv->scaling_factor);
+        if (entry != NULL)
+          local_cache->hits++;
+        else
+          local_cache->misses++;
+      }
+      if (entry != NULL)
+      {
+        for (unsigned int i = 0; i < al[m]->cnt; i++)
+          memcpy(local[i], entry->values + i * al[n]->cnt, al[n]->cnt * sizeof(Scalar));
+        return true;
+      }
+
+      // All the pairs are integrated, including the Dirichlet lifts and the zero coefficients,
+      // so that the entry is valid for any DOFs and coefficients of the assembly lists.
+      bool block_evaluated = false;
+      if (mfvol_without_block.find(mfv) == mfvol_without_block.end())
+      {
+        block_evaluated = eval_form_block(mfv, u_ext, pss[n], spss[m], refmap[n], refmap[m], al[n], al[m], local);
+        if (!block_evaluated)
+          mfvol_without_block.insert(mfv);
+      }
+      bool sym = (m == n) && (mfv->sym == 1);
+      for (unsigned int i = 0; i < al[m]->cnt && !block_evaluated; i++)
+      {
+        spss[m]->set_active_shape(al[m]->idx[i]);
+        for (unsigned int j = sym ? i : 0; j < al[n]->cnt; j++)
+        {
+          pss[n]->set_active_shape(al[n]->idx[j]);
+          local[i][j] = eval_form(mfv, u_ext, pss[n], spss[m], refmap[n], refmap[m]);
+          if (sym)
+            local[j][i] = local[i][j];
+        }
+      }
+
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_local_cache)
+#endif
+      local_cache->insert(key, coords, al[m], al[n], mfv->scaling_factor, true, local, NULL);
+      return true;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::get_cached_local_vector(VectorFormVol<Scalar>* vfv, Hermes::vector<Solution<Scalar>*>& u_ext,
+      Hermes::vector<PrecalcShapeset*>& spss, Hermes::vector<RefMap*>& refmap,
+      Hermes::vector<AsmList<Scalar>*>& al, Scalar* local)
+    {
+      _F_;
+      // The previous iterate is not a part of the key (residuals depend on it, they are never cached).
+      if (local_cache == NULL || RungeKutta || !vfv->ext.empty() || (vfv->uses_u_ext && !u_ext.empty()))
+        return false;
+      int m = vfv->i;
+      typename LocalCache::Key key;
+      double coords[2][4][2];
+      if (!local_cache->init_key(key, coords, vfv, pss[m], pss[m]))
+        return false;
+
+      typename LocalCache::Entry* entry;
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_local_cache)
+#endif
+      {
+        entry = local_cache->find(key, coords, al[m], NULL, vfv->scaling_factor);
+        if (entry != NULL)
+          local_cache->hits++;
+        else
+          local_cache->misses++;
+      }
+      if (entry != NULL)
+      {
+        memcpy(local, entry->values, al[m]->cnt * sizeof(Scalar));
+        return true;
+      }
+
+      bool block_evaluated = false;
+      if (vfvol_without_coefficients.find(vfv) == vfvol_without_coefficients.end())
+        block_evaluated = eval_form_block(vfv, u_ext, spss[m], refmap[m], al[m], local);
+      for (unsigned int i = 0; i < al[m]->cnt && !block_evaluated; i++)
+      {
+        spss[m]->set_active_shape(al[m]->idx[i]);
+        local[i] = eval_form(vfv, u_ext, spss[m], refmap[m]);
+      }
+
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_local_cache)
+#endif
+      local_cache->insert(key, coords, al[m], NULL, vfv->scaling_factor, false, NULL, local);
+      return true;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::init_order_key(typename AssemblingCaches::KeyOrder& key, Hermes::vector<Solution<Scalar>*>& u_ext,
+      int u_ext_offset, int inc, Hermes::vector<MeshFunction<Scalar>*>& ext)
+    {
+      // Same orders as used for the parsing of the form.
+      int u_ext_length = u_ext.size();
+      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+        if (u_ext[i + u_ext_offset] != NULL)
+          key.add(u_ext[i + u_ext_offset]->get_fn_order() + inc);
+        else
+          key.add(0);
+      for (unsigned int i = 0; i < ext.size(); i++)
+        key.add(get_thread_ext_fn(ext[i])->get_fn_order());
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::get_memoized_order(const typename AssemblingCaches::KeyOrder& key, int& order)
+    {
+      // Forms may have been added or removed, the form pointers are no longer a valid key.
+      if(assembling_caches.order_table_wf_seq != wf->get_seq())
+      {
+        assembling_caches.order_table.clear();
+        assembling_caches.order_table_wf_seq = wf->get_seq();
+      }
+
+      if(key.num_orders < 0)
+        return false;
+      int* stored = assembling_caches.order_table.find(key);
+      if(stored == NULL)
+      {
+        order_table_misses++;
+        return false;
+      }
+      order_table_hits++;
+      order = *stored;
+      return true;
+    }
+
     template<typename Scalar>
     int DiscreteProblem<Scalar>::calc_order_matrix_form_vol(MatrixFormVol<Scalar> *mfv, Hermes::vector<Solution<Scalar>*> u_ext,
       PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2149,6 +3021,16 @@ namespace Hermes
         // Increase for multi-valued shape functions.
         int inc = (fu->get_num_components() == 2) ? 1 : 0;
 
+        // The order only depends on the form and the orders of the functions, look it up first.
+        typename AssemblingCaches::KeyOrder key(mfv);
+        key.add(fu->get_fn_order() + inc);
+        key.add(fv->get_fn_order() + inc);
+        key.add(ru->get_inv_ref_order());
+        key.add(ru->get_active_element()->get_mode());
+        init_order_key(key, u_ext, u_ext_offset, inc, mfv->ext);
+        if(get_memoized_order(key, order))
+          return order;
+
         // Hermes::Order of solutions from the previous Newton iteration.
         Func<Hermes::Ord>** oi = new Func<Hermes::Ord>*[u_ext_length - u_ext_offset];
         if (u_ext != Hermes::vector<Solution<Scalar>*>())
@@ -2178,6 +3060,8 @@ namespace Hermes
         order = ru->get_inv_ref_order();
         order += o.get_order();
         limit_order(order, ru->get_active_element()->get_mode());
+        if(key.num_orders >= 0)
+          assembling_caches.order_table.add(key, order);
 
         // Cleanup.
         delete [] oi;
@@ -2199,24 +3083,14 @@ namespace Hermes
     {
       // Evaluate the form using numerical quadrature of order "order".
       Quad2D* quad = fu->get_quad_2d();
-      double3* pt = quad->get_points(order);
       int np = quad->get_num_points(order);
 
       // Init geometry and jacobian*weights.
       if (cache_e[order] == NULL)
       {
         cache_e[order] = init_geom_vol(ru, order);
-        double* jac = NULL;
-        if(!ru->is_jacobian_const())
-          jac = ru->get_jacobian(order);
         cache_jwt[order] = new double[np];
-        for(int i = 0; i < np; i++)
-        {
-          if(ru->is_jacobian_const())
-            cache_jwt[order][i] = pt[i][2] * ru->get_const_jacobian();
-          else
-            cache_jwt[order][i] = pt[i][2] * jac[i];
-        }
+        memcpy(cache_jwt[order], ru->get_jacobian_x_weights(order), np * sizeof(double));
       }
       Geom<double>* e = cache_e[order];
       double* jwt = cache_jwt[order];
@@ -2232,7 +3106,7 @@ namespace Hermes
       if (u_ext != Hermes::vector<Solution<Scalar>*>())
         for (int i = 0; i < prev_size; i++)
           if (u_ext[i + mfv->u_ext_offset] != NULL)
-            prev[i] = isempty[i] ? NULL : init_fn(u_ext[i + mfv->u_ext_offset], order);
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + mfv->u_ext_offset], order);
           else
             prev[i] = NULL;
       else
@@ -2252,9 +3126,9 @@ namespace Hermes
       // The actual calculation takes place here.
       Scalar res = mfv->value(np, jwt, prev, u, v, e, ext) * mfv->scaling_factor;
 
-      // Clean up.
+      // Clean up, the previous iteration values are cached unless Runge-Kutta is used.
       for(int i = 0; i < prev_size; i++)
-        if (prev[i] != NULL)
+        if (prev[i] != NULL && RungeKutta)
         {
           prev[i]->free_fn();
           delete prev[i];
@@ -2263,7 +3137,8 @@ namespace Hermes
 
         if (ext != NULL)
         {
-          ext->free();
+          // The functions themselves are owned by the assembling caches.
+          delete [] ext->fn;
           delete ext;
         }
 
@@ -2286,6 +3161,104 @@ namespace Hermes
 
       return result;
     }
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::eval_form_block(VectorFormVol<Scalar> *vfv,
+      Hermes::vector<Solution<Scalar>*> u_ext,
+      PrecalcShapeset *fv, RefMap *rv, AsmList<Scalar>* alv, Scalar* result)
+    {
+      _F_;
+      if (alv->cnt == 0)
+        return true;
+      // Triangles, curved and non-parallelogram quads are integrated function by function, no need to parse the form.
+      if (!SumFactorization<Scalar>::is_applicable(rv))
+        return false;
+
+      // Determine the integration order by parsing the form with the test function of the highest order.
+      int max_v = 0;
+      for (unsigned int i = 0; i < alv->cnt; i++)
+      {
+        fv->set_active_shape(alv->idx[i]);
+        if (fv->get_fn_order() > max_v)
+          max_v = fv->get_fn_order();
+      }
+      for (unsigned int i = 0; i < alv->cnt; i++)
+      {
+        fv->set_active_shape(alv->idx[i]);
+        if (fv->get_fn_order() == max_v)
+          break;
+      }
+      int order = calc_order_vector_form_vol(vfv, u_ext, fv, rv);
+      if (!SumFactorization<Scalar>::is_applicable(fv, rv, alv, order))
+        return false;
+
+      Quad2D* quad = fv->get_quad_2d();
+      int np = quad->get_num_points(order);
+
+      // Init geometry and jacobian*weights, the jacobian is constant here.
+      if (cache_e[order] == NULL)
+      {
+        cache_e[order] = init_geom_vol(rv, order);
+        cache_jwt[order] = new double[np];
+        memcpy(cache_jwt[order], rv->get_jacobian_x_weights(order), np * sizeof(double));
+      }
+      Geom<double>* e = cache_e[order];
+      double* jwt = cache_jwt[order];
+
+      // Values of the previous Newton iteration and external functions in quadrature points.
+      int prev_size = u_ext.size() - vfv->u_ext_offset;
+      if(RungeKutta)
+        prev_size = RK_original_spaces_count;
+
+      Func<Scalar>** prev = new Func<Scalar>*[prev_size];
+      if (u_ext != Hermes::vector<Solution<Scalar>*>())
+        for (int i = 0; i < prev_size; i++)
+          if (u_ext[i + vfv->u_ext_offset] != NULL)
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + vfv->u_ext_offset], order);
+          else
+            prev[i] = NULL;
+      else
+        for (int i = 0; i < prev_size; i++)
+          prev[i] = NULL;
+
+      ExtData<Scalar>* ext = init_ext_fns(vfv->ext, rv, order);
+
+      if(RungeKutta)
+        for(int ext_i = 0; ext_i < this->RK_original_spaces_count; ext_i++)
+          prev[ext_i]->add(*ext->fn[vfv->ext.size() - this->RK_original_spaces_count + ext_i]);
+
+      Scalar* coef_values = get_coef_buffer(3 * np);
+      Scalar* coef[3];
+      for (int a = 0; a < 3; a++)
+        coef[a] = coef_values + a * np;
+      bool evaluated = vfv->value_coefficients(np, jwt, prev, e, ext, coef);
+      if (evaluated)
+      {
+        SumFactorization<Scalar>::integrate_vector(order, fv, rv, alv, coef, result);
+        for (unsigned int i = 0; i < alv->cnt; i++)
+          result[i] *= vfv->scaling_factor;
+      }
+      else
+        vfvol_without_coefficients.insert(vfv);
+
+      // Clean up.
+      for(int i = 0; i < prev_size; i++)
+        if (prev[i] != NULL && RungeKutta)
+        {
+          prev[i]->free_fn();
+          delete prev[i];
+        }
+      delete [] prev;
+
+      if (ext != NULL)
+      {
+        // The functions themselves are owned by the assembling caches.
+        delete [] ext->fn;
+        delete ext;
+      }
+
+      return evaluated;
+    }
+
     template<typename Scalar>
     void DiscreteProblem<Scalar>::eval_form(MultiComponentVectorFormVol<Scalar>*vfv,
       Hermes::vector<Solution<Scalar>*> u_ext,
@@ -2297,24 +3270,14 @@ namespace Hermes
       int order = calc_order_vector_form_vol(vfv, u_ext, fv, rv);
       // Evaluate the form using numerical quadrature of order "order".
       Quad2D* quad = fv->get_quad_2d();
-      double3* pt = quad->get_points(order);
       int np = quad->get_num_points(order);
 
       // Init geometry and jacobian*weights.
       if (cache_e[order] == NULL)
       {
         cache_e[order] = init_geom_vol(rv, order);
-        double* jac = NULL;
-        if(!rv->is_jacobian_const())
-          jac = rv->get_jacobian(order);
         cache_jwt[order] = new double[np];
-        for(int i = 0; i < np; i++)
-        {
-          if(rv->is_jacobian_const())
-            cache_jwt[order][i] = pt[i][2] * rv->get_const_jacobian();
-          else
-            cache_jwt[order][i] = pt[i][2] * jac[i];
-        }
+        memcpy(cache_jwt[order], rv->get_jacobian_x_weights(order), np * sizeof(double));
       }
       Geom<double>* e = cache_e[order];
       double* jwt = cache_jwt[order];
@@ -2352,7 +3315,8 @@ namespace Hermes
 
       if (ext != NULL)
       {
-        ext->free();
+        // The functions themselves are owned by the assembling caches.
+        delete [] ext->fn;
         delete ext;
       }
     }
@@ -2363,6 +3327,7 @@ namespace Hermes
       PrecalcShapeset *fv, RefMap *rv)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2377,6 +3342,16 @@ namespace Hermes
         // Increase for multi-valued shape functions.
         int inc = (fv->get_num_components() == 2) ? 1 : 0;
 
+        // The order only depends on the form and the orders of the functions, look it up first.
+        typename AssemblingCaches::KeyOrder key(vfv);
+        key.add(-1);
+        key.add(fv->get_fn_order() + inc);
+        key.add(rv->get_inv_ref_order());
+        key.add(rv->get_active_element()->get_mode());
+        init_order_key(key, u_ext, u_ext_offset, inc, vfv->ext);
+        if(get_memoized_order(key, order))
+          return order;
+
         // Hermes::Order of solutions from the previous Newton iteration.
         Func<Hermes::Ord>** oi = new Func<Hermes::Ord>*[u_ext_length - u_ext_offset];
         if (u_ext != Hermes::vector<Solution<Scalar>*>())
@@ -2406,6 +3381,8 @@ namespace Hermes
         order = rv->get_inv_ref_order();
         order += o.get_order();
         limit_order(order, rv->get_active_element()->get_mode());
+        if(key.num_orders >= 0)
+          assembling_caches.order_table.add(key, order);
 
         // Cleanup.
         delete [] oi;
@@ -2425,6 +3402,7 @@ namespace Hermes
       PrecalcShapeset *fv, RefMap *rv)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2491,24 +3469,14 @@ namespace Hermes
 
       // Evaluate the form using numerical quadrature of order "order".
       Quad2D* quad = fv->get_quad_2d();
-      double3* pt = quad->get_points(order);
       int np = quad->get_num_points(order);
 
       // Init geometry and jacobian*weights.
       if (cache_e[order] == NULL)
       {
         cache_e[order] = init_geom_vol(rv, order);
-        double* jac = NULL;
-        if(!rv->is_jacobian_const())
-          jac = rv->get_jacobian(order);
         cache_jwt[order] = new double[np];
-        for(int i = 0; i < np; i++)
-        {
-          if(rv->is_jacobian_const())
-            cache_jwt[order][i] = pt[i][2] * rv->get_const_jacobian();
-          else
-            cache_jwt[order][i] = pt[i][2] * jac[i];
-        }
+        memcpy(cache_jwt[order], rv->get_jacobian_x_weights(order), np * sizeof(double));
       }
       Geom<double>* e = cache_e[order];
       double* jwt = cache_jwt[order];
@@ -2524,7 +3492,7 @@ namespace Hermes
       if (u_ext != Hermes::vector<Solution<Scalar>*>())
         for (int i = 0; i < prev_size; i++)
           if (u_ext[i + vfv->u_ext_offset] != NULL)
-            prev[i] = isempty[i] ? NULL : init_fn(u_ext[i + vfv->u_ext_offset], order);
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + vfv->u_ext_offset], order);
           else
             prev[i] = NULL;
       else
@@ -2542,9 +3510,9 @@ namespace Hermes
       // The actual calculation takes place here.
       Scalar res = vfv->value(np, jwt, prev, v, e, ext) * vfv->scaling_factor;
 
-      // Clean up.
+      // Clean up, the previous iteration values are cached unless Runge-Kutta is used.
       for(int i = 0; i < prev_size; i++)
-        if (prev[i] != NULL)
+        if (prev[i] != NULL && RungeKutta)
         {
           prev[i]->free_fn();
           delete prev[i];
@@ -2553,7 +3521,8 @@ namespace Hermes
 
       if (ext != NULL)
       {
-        ext->free();
+        // The functions themselves are owned by the assembling caches.
+        delete [] ext->fn;
         delete ext;
       }
 
@@ -2637,7 +3606,8 @@ namespace Hermes
 
       if (ext != NULL)
       {
-        ext->free();
+        // The functions themselves are owned by the assembling caches.
+        delete [] ext->fn;
         delete ext;
       }
     }
@@ -2647,6 +3617,7 @@ namespace Hermes
       PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2708,6 +3679,7 @@ namespace Hermes
       PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2800,7 +3772,7 @@ namespace Hermes
       if (u_ext != Hermes::vector<Solution<Scalar>*>())
         for (int i = 0; i < prev_size; i++)
           if (u_ext[i + mfs->u_ext_offset] != NULL)
-            prev[i] = isempty[i] ? NULL : init_fn(u_ext[i + mfs->u_ext_offset], eo);
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + mfs->u_ext_offset], eo);
           else
             prev[i] = NULL;
       else
@@ -2819,9 +3791,9 @@ namespace Hermes
       // The actual calculation takes place here.
       Scalar res = mfs->value(np, jwt, prev, u, v, e, ext) * mfs->scaling_factor;
 
-      // Clean up.
+      // Clean up, the previous iteration values are cached unless Runge-Kutta is used.
       for(int i = 0; i < prev_size; i++)
-        if (prev[i] != NULL)
+        if (prev[i] != NULL && RungeKutta)
         {
           prev[i]->free_fn();
           delete prev[i];
@@ -2830,7 +3802,8 @@ namespace Hermes
 
         if (ext != NULL)
         {
-          ext->free();
+          // The functions themselves are owned by the assembling caches.
+          delete [] ext->fn;
           delete ext;
         }
 
@@ -2914,7 +3887,8 @@ namespace Hermes
 
         if (ext != NULL)
         {
-          ext->free();
+          // The functions themselves are owned by the assembling caches.
+          delete [] ext->fn;
           delete ext;
         }
     }
@@ -2924,6 +3898,7 @@ namespace Hermes
       PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -2984,6 +3959,7 @@ namespace Hermes
       PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
     {
       _F_;
+      HERMES_PROFILE("assembly/order");
       // Hermes::Order that will be returned.
       int order;
 
@@ -3075,7 +4051,7 @@ namespace Hermes
       if (u_ext != Hermes::vector<Solution<Scalar>*>())
         for (int i = 0; i < prev_size; i++)
           if (u_ext[i + vfs->u_ext_offset] != NULL)
-            prev[i] = isempty[i] ? NULL : init_fn(u_ext[i + vfs->u_ext_offset], eo);
+            prev[i] = isempty[i] ? NULL : get_prev_fn(u_ext[i + vfs->u_ext_offset], eo);
           else
             prev[i] = NULL;
       else
@@ -3093,9 +4069,9 @@ namespace Hermes
       // The actual calculation takes place here.
       Scalar res = vfs->value(np, jwt, prev, v, e, ext) * vfs->scaling_factor;
 
-      // Clean up.
+      // Clean up, the previous iteration values are cached unless Runge-Kutta is used.
       for(int i = 0; i < prev_size; i++)
-        if (prev[i] != NULL)
+        if (prev[i] != NULL && RungeKutta)
         {
           prev[i]->free_fn();
           delete prev[i];
@@ -3104,7 +4080,8 @@ namespace Hermes
 
         if (ext != NULL)
         {
-          ext->free();
+          // The functions themselves are owned by the assembling caches.
+          delete [] ext->fn;
           delete ext;
         }
 
@@ -3118,6 +4095,7 @@ namespace Hermes
       PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
       bool neighbor_supp_u, bool neighbor_supp_v, LightArray<NeighborSearch<Scalar>*>& neighbor_searches, int neighbor_index_u)
     {
+      HERMES_PROFILE("assembly/order");
       NeighborSearch<Scalar>* nbs_u = neighbor_searches.get(neighbor_index_u);
       // Hermes::Order that will be returned.
       int order;
@@ -3284,6 +4262,7 @@ namespace Hermes
       PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos,
       LightArray<NeighborSearch<Scalar>*>& neighbor_searches, int neighbor_index_v)
     {
+      HERMES_PROFILE("assembly/order");
       NeighborSearch<Scalar>* nbs_v = neighbor_searches.get(neighbor_index_v);
       // Hermes::Order that will be returned.
       int order;
@@ -3476,7 +4455,7 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    DiscreteProblem<Scalar>::AssemblingCaches::AssemblingCaches()
+    DiscreteProblem<Scalar>::AssemblingCaches::AssemblingCaches() : order_table_wf_seq(-1)
     {
     };
 
@@ -3484,14 +4463,14 @@ namespace Hermes
     DiscreteProblem<Scalar>::AssemblingCaches::~AssemblingCaches()
     {
       _F_;
-      for (typename std::map<KeyConst, Func<double>*, CompareConst>::const_iterator it = const_cache_fn_triangles.begin();
+      for (typename FlatHashMap<KeyConst, Func<double>*, HashConst>::iterator it = const_cache_fn_triangles.begin();
         it != const_cache_fn_triangles.end(); it++)
       {
         (it->second)->free_fn(); delete (it->second);
       }
       const_cache_fn_triangles.clear();
 
-      for (typename std::map<KeyConst, Func<double>*, CompareConst>::const_iterator it = const_cache_fn_quads.begin();
+      for (typename FlatHashMap<KeyConst, Func<double>*, HashConst>::iterator it = const_cache_fn_quads.begin();
         it != const_cache_fn_quads.end(); it++)
       {
         (it->second)->free_fn(); delete (it->second);
@@ -3534,32 +4513,30 @@ namespace Hermes
     }
 #endif
 
+    /// Mixes value into the hash h.
+    static inline size_t hash_combine(size_t h, unsigned long long value)
+    {
+      return IntegerKeyHash()(value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+
     template<typename Scalar>
-    bool DiscreteProblem<Scalar>::AssemblingCaches::CompareConst::operator()(KeyConst a, KeyConst b) const
+    size_t DiscreteProblem<Scalar>::AssemblingCaches::HashConst::operator()(const KeyConst& a) const
     {
-      if(a.inv_ref_map[0][0] < b.inv_ref_map[0][0]) return true;
-      else if(a.inv_ref_map[0][0] > b.inv_ref_map[0][0]) return false;
-      else
-        if(a.inv_ref_map[0][1] < b.inv_ref_map[0][1]) return true;
-        else if(a.inv_ref_map[0][1] > b.inv_ref_map[0][1]) return false;
-        else
-          if(a.inv_ref_map[1][0] < b.inv_ref_map[1][0]) return true;
-          else if(a.inv_ref_map[1][0] > b.inv_ref_map[1][0]) return false;
-          else
-            if(a.inv_ref_map[1][1] < b.inv_ref_map[1][1]) return true;
-            else if(a.inv_ref_map[1][1] > b.inv_ref_map[1][1]) return false;
-            else
-              if (a.index < b.index) return true;
-              else if (a.index > b.index) return false;
-              else
-                if (a.order < b.order) return true;
-                else if (a.order > b.order) return false;
-                else
-                  if (a.sub_idx < b.sub_idx) return true;
-                  else if (a.sub_idx > b.sub_idx) return false;
-                  else
-                    if (a.shapeset_type < b.shapeset_type) return true;
-                    else return false;
+      unsigned long long bits[4];
+      memcpy(bits, a.inv_ref_map, sizeof(bits));
+      size_t h = hash_combine(hash_combine(0, (unsigned long long) a.index << 32 | (unsigned int) a.order), a.sub_idx);
+      h = hash_combine(h, a.shapeset_type);
+      for (int i = 0; i < 4; i++)
+        h = hash_combine(h, bits[i]);
+      return h;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::AssemblingCaches::HashConst::operator()(const KeyConst& a, const KeyConst& b) const
+    {
+      return a.index == b.index && a.order == b.order && a.sub_idx == b.sub_idx && a.shapeset_type == b.shapeset_type
+        && a.inv_ref_map[0][0] == b.inv_ref_map[0][0] && a.inv_ref_map[0][1] == b.inv_ref_map[0][1]
+        && a.inv_ref_map[1][0] == b.inv_ref_map[1][0] && a.inv_ref_map[1][1] == b.inv_ref_map[1][1];
     }
 
 #ifdef _MSC_VER
@@ -3582,25 +4559,205 @@ namespace Hermes
     }
 #endif
 
-    template<typename Scalar> bool DiscreteProblem<Scalar>::AssemblingCaches::CompareNonConst::operator()(KeyNonConst a, KeyNonConst b) const
+    template<typename Scalar>
+    size_t DiscreteProblem<Scalar>::AssemblingCaches::HashNonConst::operator()(const KeyNonConst& a) const
+    {
+      size_t h = hash_combine(hash_combine(0, (unsigned long long) a.index << 32 | (unsigned int) a.order), a.sub_idx);
+      return hash_combine(h, a.shapeset_type);
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::AssemblingCaches::HashNonConst::operator()(const KeyNonConst& a, const KeyNonConst& b) const
+    {
+      return a.index == b.index && a.order == b.order && a.sub_idx == b.sub_idx && a.shapeset_type == b.shapeset_type;
+    }
+
+    template<typename Scalar>
+    size_t DiscreteProblem<Scalar>::AssemblingCaches::HashExtFn::operator()(const std::pair<MeshFunction<Scalar>*, int>& a) const
+    {
+      return hash_combine(IntegerKeyHash()((unsigned long long) (size_t) a.first), a.second);
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::AssemblingCaches::HashExtFn::operator()(const std::pair<MeshFunction<Scalar>*, int>& a, const std::pair<MeshFunction<Scalar>*, int>& b) const
+    {
+      return a == b;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::AssemblingCaches::get_statistics(unsigned int& lookups, unsigned int& hits, size_t& memory)
+    {
+      lookups = const_cache_fn_triangles.get_num_lookups() + const_cache_fn_quads.get_num_lookups()
+        + cache_fn_triangles.get_num_lookups() + cache_fn_quads.get_num_lookups() + cache_ext_fn.get_num_lookups()
+        + order_table.get_num_lookups();
+      hits = const_cache_fn_triangles.get_num_hits() + const_cache_fn_quads.get_num_hits()
+        + cache_fn_triangles.get_num_hits() + cache_fn_quads.get_num_hits() + cache_ext_fn.get_num_hits()
+        + order_table.get_num_hits();
+      memory = const_cache_fn_triangles.get_memory_size() + const_cache_fn_quads.get_memory_size()
+        + cache_fn_triangles.get_memory_size() + cache_fn_quads.get_memory_size() + cache_ext_fn.get_memory_size()
+        + order_table.get_memory_size();
+    }
+
+    template<typename Scalar>
+    DiscreteProblem<Scalar>::AssemblingCaches::KeyOrder::KeyOrder(const void* form) : form(form), num_orders(0)
+    {
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::AssemblingCaches::KeyOrder::add(int order)
     {
-      if (a.index < b.index) return true;
-      else if (a.index > b.index) return false;
+      if(num_orders < 0)
+        return;
+      if(num_orders == H2D_ORDER_KEY_SIZE)
+        num_orders = -1;
       else
+        orders[num_orders++] = (short) order;
+    }
+
+    template<typename Scalar>
+    size_t DiscreteProblem<Scalar>::AssemblingCaches::HashOrder::operator()(const KeyOrder& a) const
+    {
+      size_t h = IntegerKeyHash()((unsigned long long) (size_t) a.form);
+      for (int i = 0; i < a.num_orders; i++)
+        h = hash_combine(h, (unsigned short) a.orders[i]);
+      return h;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::AssemblingCaches::HashOrder::operator()(const KeyOrder& a, const KeyOrder& b) const
+    {
+      if (a.form != b.form || a.num_orders != b.num_orders)
+        return false;
+      for (int i = 0; i < a.num_orders; i++)
+        if (a.orders[i] != b.orders[i])
+          return false;
+      return true;
+    }
+
+    template<typename Scalar>
+    DiscreteProblem<Scalar>::LocalCache::LocalCache() : generation(0), wf_seq(-1), hits(0), misses(0)
+    {
+    }
+
+    template<typename Scalar>
+    DiscreteProblem<Scalar>::LocalCache::~LocalCache()
+    {
+      clear();
+    }
+
+    template<typename Scalar>
+    DiscreteProblem<Scalar>::LocalCache::Entry::~Entry()
+    {
+      delete [] idx;
+      delete [] values;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::LocalCache::Compare::operator()(const Key& a, const Key& b) const
+    {
+      if (a.form != b.form) return a.form < b.form;
+      for (int k = 0; k < 2; k++)
       {
-        if (a.order < b.order) return true;
-        else if (a.order > b.order) return false;
-        else
+        if (a.id[k] != b.id[k]) return a.id[k] < b.id[k];
+        if (a.sub_idx[k] != b.sub_idx[k]) return a.sub_idx[k] < b.sub_idx[k];
+      }
+      return false;
+    }
+
+    template<typename Scalar>
+    bool DiscreteProblem<Scalar>::LocalCache::init_key(Key& key, double coords[2][4][2], const void* form,
+      PrecalcShapeset* fu, PrecalcShapeset* fv)
+    {
+      PrecalcShapeset* fns[2] = { fu, fv };
+      key.form = form;
+      for (int k = 0; k < 2; k++)
+      {
+        Element* e = fns[k]->get_active_element();
+        // The curved maps are not compared, these elements are integrated every time.
+        if (e->is_curved())
+          return false;
+        key.id[k] = e->id;
+        key.sub_idx[k] = fns[k]->get_transform();
+        for (int i = 0; i < 4; i++)
         {
-          if (a.sub_idx < b.sub_idx) return true;
-          else if (a.sub_idx > b.sub_idx) return false;
-          else
-          {
-            if (a.shapeset_type < b.shapeset_type) return true;
-            else return false;
-          }
+          coords[k][i][0] = (i < e->get_nvert()) ? e->vn[i]->x : 0.0;
+          coords[k][i][1] = (i < e->get_nvert()) ? e->vn[i]->y : 0.0;
         }
       }
+      return true;
+    }
+
+    template<typename Scalar>
+    typename DiscreteProblem<Scalar>::LocalCache::Entry* DiscreteProblem<Scalar>::LocalCache::find(const Key& key,
+      double coords[2][4][2], AsmList<Scalar>* alv, AsmList<Scalar>* alu, double scaling_factor)
+    {
+      typename std::map<Key, Entry*, Compare>::iterator it = entries.find(key);
+      if (it == entries.end())
+        return NULL;
+      Entry* entry = it->second;
+      unsigned int cols = (alu != NULL) ? alu->cnt : 0;
+      if (entry->rows != alv->cnt || entry->cols != cols || entry->scaling_factor != scaling_factor)
+        return NULL;
+      if (memcmp(entry->coords, coords, sizeof(entry->coords)) != 0)
+        return NULL;
+      if (memcmp(entry->idx, alv->idx, alv->cnt * sizeof(int)) != 0)
+        return NULL;
+      if (alu != NULL && memcmp(entry->idx + alv->cnt, alu->idx, cols * sizeof(int)) != 0)
+        return NULL;
+      entry->generation = generation;
+      return entry;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::LocalCache::insert(const Key& key, double coords[2][4][2], AsmList<Scalar>* alv,
+      AsmList<Scalar>* alu, double scaling_factor, bool matrix, Scalar** matrix_values, Scalar* vector_values)
+    {
+      Entry*& entry = entries[key];
+      if (entry != NULL)
+        delete entry;
+      entry = new Entry;
+      entry->matrix = matrix;
+      entry->rows = alv->cnt;
+      entry->cols = (alu != NULL) ? alu->cnt : 0;
+      entry->idx = new int[entry->rows + entry->cols];
+      memcpy(entry->idx, alv->idx, entry->rows * sizeof(int));
+      if (alu != NULL)
+        memcpy(entry->idx + entry->rows, alu->idx, entry->cols * sizeof(int));
+      memcpy(entry->coords, coords, sizeof(entry->coords));
+      entry->scaling_factor = scaling_factor;
+      entry->values = new Scalar[entry->rows * std::max(entry->cols, 1u)];
+      if (matrix)
+        for (unsigned int i = 0; i < entry->rows; i++)
+          memcpy(entry->values + i * entry->cols, matrix_values[i], entry->cols * sizeof(Scalar));
+      else
+        memcpy(entry->values, vector_values, entry->rows * sizeof(Scalar));
+      entry->generation = generation;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::LocalCache::finish_assembling(bool matrices, bool vectors)
+    {
+      typename std::map<Key, Entry*, Compare>::iterator it = entries.begin();
+      while (it != entries.end())
+      {
+        Entry* entry = it->second;
+        if (entry->generation != generation && (entry->matrix ? matrices : vectors))
+        {
+          delete entry;
+          entries.erase(it++);
+        }
+        else
+          it++;
+      }
+      generation++;
+    }
+
+    template<typename Scalar>
+    void DiscreteProblem<Scalar>::LocalCache::clear()
+    {
+      for (typename std::map<Key, Entry*, Compare>::iterator it = entries.begin(); it != entries.end(); it++)
+        delete it->second;
+      entries.clear();
     }
 
     template class HERMES_API DiscreteProblem<double>;
@@ -143,7 +143,7 @@ namespace Hermes
         }
       }
 
-      for(typename std::map<uint64_t, LightArray<struct Filter<Scalar>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
+      for(typename FlatHashMap<uint64_t, LightArray<struct Filter<Scalar>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
       {
         for(unsigned int l = 0; l < it->second->get_size(); l++)
           if(it->second->present(l))
@@ -163,7 +163,7 @@ namespace Hermes
     {
       for (int i = 0; i < num; i++)
       {
-        for(typename std::map<uint64_t, LightArray<struct Filter<Scalar>::Node*>*>::iterator it = tables[i].begin(); it != tables[i].end(); it++)
+        for(typename FlatHashMap<uint64_t, LightArray<struct Filter<Scalar>::Node*>*>::iterator it = tables[i].begin(); it != tables[i].end(); it++)
         {
           for(unsigned int l = 0; l < it->second->get_size(); l++)
             if(it->second->present(l))
@@ -358,7 +358,7 @@ namespace Hermes
 
     void ComplexFilter::free()
     {
-      for(std::map<uint64_t, LightArray<struct Filter<double>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
+      for(FlatHashMap<uint64_t, LightArray<struct Filter<double>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
       {
         for(unsigned int l = 0; l < it->second->get_size(); l++)
           if(it->second->present(l))
@@ -382,7 +382,7 @@ namespace Hermes
       
       memset(sln_sub, 0, sizeof(sln_sub));
 
-      for(std::map<uint64_t, LightArray<struct Filter<double>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
+      for(FlatHashMap<uint64_t, LightArray<struct Filter<double>::Node*>*>::iterator it = tables[this->cur_quad].begin(); it != tables[this->cur_quad].end(); it++)
       {
         for(unsigned int l = 0; l < it->second->get_size(); l++)
           if(it->second->present(l))
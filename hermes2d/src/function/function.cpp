@@ -215,9 +215,8 @@ namespace Hermes
       if (sub_idx > H2D_MAX_IDX)
         handle_overflow_idx();
       else {
-        if(sub_tables->find(sub_idx) == sub_tables->end())
-          sub_tables->insert(std::pair<uint64_t, LightArray<Node*>*>(sub_idx, new LightArray<Node*>));
-        nodes = sub_tables->find(sub_idx)->second;
+        LightArray<Node*>** found = sub_tables->find(sub_idx);
+        nodes = (found != NULL) ? *found : sub_tables->add(sub_idx, new LightArray<Node*>);
       }
     }
 
@@ -97,10 +97,11 @@ namespace Hermes
       own_mesh = false;
       this->num_components = 0;
       e_last = NULL;
+      point_locator = NULL;
 
       for(int i = 0; i < 4; i++)
         for(int j = 0; j < 4; j++)
-          tables[i][j] = new std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
+          tables[i][j] = new FlatHashMap<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
 
       mono_coeffs = NULL;
       elem_coeffs[0] = elem_coeffs[1] = NULL;
@@ -241,7 +242,7 @@ namespace Hermes
         for (int j = 0; j < 4; j++)
           if(tables[i][j] != NULL)
           {
-            for(typename std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[i][j]->begin(); it != tables[i][j]->end(); it++)
+            for(typename FlatHashMap<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[i][j]->begin(); it != tables[i][j]->end(); it++)
             {
               for(unsigned int l = 0; l < it->second->get_size(); l++)
                 if(it->second->present(l))
@@ -291,6 +292,8 @@ namespace Hermes
       free();
       space_type = HERMES_INVALID_SPACE;
       space = NULL;
+      if (point_locator != NULL)
+        delete point_locator;
     }
 
     static struct mono_lu_init
@@ -761,7 +764,7 @@ namespace Hermes
       {
         if(tables[this->cur_quad][oldest[this->cur_quad]] != NULL)
         {
-          for(typename std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[this->cur_quad][oldest[this->cur_quad]]->begin(); it != tables[this->cur_quad][oldest[this->cur_quad]]->end(); it++)
+          for(typename FlatHashMap<uint64_t, LightArray<struct Function<Scalar>::Node*>*>::iterator it = tables[this->cur_quad][oldest[this->cur_quad]]->begin(); it != tables[this->cur_quad][oldest[this->cur_quad]]->end(); it++)
           {
             for(unsigned int l = 0; l < it->second->get_size(); l++)
               if(it->second->present(l))
@@ -773,7 +776,7 @@ namespace Hermes
           elems[this->cur_quad][oldest[this->cur_quad]] = NULL;
         }
 
-        tables[this->cur_quad][oldest[this->cur_quad]] = new std::map<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
+        tables[this->cur_quad][oldest[this->cur_quad]] = new FlatHashMap<uint64_t, LightArray<struct Function<Scalar>::Node*>*>;
 
         cur_elem = oldest[this->cur_quad];
         if (++oldest[this->cur_quad] >= 4)
@@ -938,6 +941,7 @@ namespace Hermes
     template<typename Scalar>
     void Solution<Scalar>::precalculate(int order, int mask)
     {
+      HERMES_PROFILE("precalculation/solution");
       int i, j, k, l;
       struct Function<Scalar>::Node* node = NULL;
       Quad2D* quad = this->quads[this->cur_quad];
@@ -1371,16 +1375,6 @@ namespace Hermes
     }
 
 
-    static bool is_in_ref_domain(Element* e, double xi1, double xi2)
-    {
-      const double TOL = 1e-11;
-      if(e->get_num_surf() == 3)
-        return (xi1 + xi2 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 + 1.0 >= -TOL);
-      else
-        return (xi1 - 1.0 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 - 1.0 <= TOL) && (xi2 + 1.0 >= -TOL);
-    }
-
-
     template<typename Scalar>
     Scalar Solution<Scalar>::get_ref_value_transformed(Element* e, double xi1, double xi2, int a, int b)
     {
@@ -1444,15 +1438,51 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    Scalar Solution<Scalar>::get_pt_value(double x, double y, int item)
+    void Solution<Scalar>::decode_pt_item(int item, int& a, int& b)
     {
-      double xi1, xi2;
-
-      int a = 0, b = 0, mask = item; // a = component, b = val, dx, dy, dxx, dyy, dxy
+      int mask = item; // a = component, b = val, dx, dy, dxx, dyy, dxy
+      a = b = 0;
       if (this->num_components == 1) mask = mask & H2D_FN_COMPONENT_0;
       if ((mask & (mask - 1)) != 0) error("'item' is invalid. ");
       if (mask >= 0x40) { a = 1; mask >>= 6; }
       while (!(mask & 1)) { mask >>= 1; b++; }
+    }
+
+    template<typename Scalar>
+    Element* Solution<Scalar>::find_pt_element(PointLocator* locator, double x, double y, double& xi1, double& xi2)
+    {
+      // try the last visited element and its neighbours
+      if (e_last != NULL)
+      {
+        Element* elem[5];
+        elem[0] = e_last;
+        for (unsigned int i = 1; i <= e_last->get_num_surf(); i++)
+          elem[i] = e_last->get_neighbor(i-1);
+
+        for (unsigned int i = 0; i <= e_last->get_num_surf(); i++)
+          if (elem[i] != NULL)
+          {
+            this->refmap->set_active_element(elem[i]);
+            this->refmap->untransform(elem[i], x, y, xi1, xi2);
+            if (PointLocator::is_in_ref_domain(elem[i], xi1, xi2))
+              return e_last = elem[i];
+          }
+      }
+
+      // look the point up in the grid
+      Element* e = locator->find(x, y, this->refmap, xi1, xi2);
+      if (e != NULL)
+        e_last = e;
+      return e;
+    }
+
+    template<typename Scalar>
+    Scalar Solution<Scalar>::get_pt_value(double x, double y, int item)
+    {
+      double xi1, xi2;
+
+      int a, b; // a = component, b = val, dx, dy, dxx, dyy, dxy
+      decode_pt_item(item, a, b);
 
       if (sln_type == HERMES_EXACT)
       {
@@ -1481,44 +1511,87 @@ namespace Hermes
           "the solution on its right-hand side.");
       }
 
-      // try the last visited element and its neighbours
-      if (e_last != NULL)
+      if (point_locator == NULL)
+        point_locator = new PointLocator();
+      point_locator->set_mesh(this->mesh);
+
+      Element* e = find_pt_element(point_locator, x, y, xi1, xi2);
+      if (e != NULL)
+        return get_ref_value_transformed(e, xi1, xi2, a, b);
+
+      warn("Point (%g, %g) does not lie in any element.", x, y);
+      return NAN;
+    }
+
+    template<typename Scalar>
+    void Solution<Scalar>::get_pt_values(const double* x, const double* y, int n, Scalar* values, int item, int num_threads)
+    {
+      _F_;
+      if (sln_type != HERMES_SLN)
       {
-        Element* elem[5];
-        elem[0] = e_last;
-        for (unsigned int i = 1; i <= e_last->get_num_surf(); i++)
-          elem[i] = e_last->get_neighbor(i-1);
+        // Exact solutions are evaluated directly, undefined ones report the error.
+        for (int i = 0; i < n; i++)
+          values[i] = get_pt_value(x[i], y[i], item);
+        return;
+      }
 
-        for (unsigned int i = 0; i <= e_last->get_num_surf(); i++)
-          if (elem[i] != NULL)
-          {
-            this->refmap->set_active_element(elem[i]);
-            this->refmap->untransform(elem[i], x, y, xi1, xi2);
-            if (is_in_ref_domain(elem[i], xi1, xi2))
-            {
-              e_last = elem[i];
-              return get_ref_value_transformed(elem[i], xi1, xi2, a, b);
-            }
-          }
+      int a, b;
+      decode_pt_item(item, a, b);
+
+      if (point_locator == NULL)
+        point_locator = new PointLocator();
+      point_locator->set_mesh(this->mesh);
+
+      // Sort the points by the grid cells.
+      std::vector<std::pair<int, int> > order(n);
+      for (int i = 0; i < n; i++)
+        order[i] = std::make_pair(point_locator->get_cell(x[i], y[i]), i);
+      std::sort(order.begin(), order.end());
+
+#ifndef WITH_OPENMP
+      num_threads = 1;
+#endif
+      num_threads = std::max(1, std::min(num_threads, n));
+
+      // Every thread evaluates a contiguous part of the sorted points on its own copy.
+      Hermes::vector<Solution<Scalar>*> slns;
+      slns.push_back(this);
+      for (int t = 1; t < num_threads; t++)
+      {
+        Solution<Scalar>* copy = new Solution<Scalar>();
+        copy->copy(this);
+        slns.push_back(copy);
       }
 
-      // go through all elements
-      Element *e;
-      for_all_active_elements(e, this->mesh)
+      int num_missed = 0;
+#ifdef WITH_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(num_threads) reduction(+:num_missed)
+#endif
+      for (int t = 0; t < num_threads; t++)
       {
-        this->refmap->set_active_element(e);
-        this->refmap->untransform(e, x, y, xi1, xi2);
-        if (is_in_ref_domain(e, xi1, xi2))
+        Solution<Scalar>* sln = slns[t];
+        int begin = (int) ((long long) n * t / num_threads), end = (int) ((long long) n * (t + 1) / num_threads);
+        for (int k = begin; k < end; k++)
         {
-          e_last = e;
-          return get_ref_value_transformed(e, xi1, xi2, a, b);
+          int i = order[k].second;
+          double xi1, xi2;
+          Element* e = sln->find_pt_element(point_locator, x[i], y[i], xi1, xi2);
+          if (e != NULL)
+            values[i] = sln->get_ref_value_transformed(e, xi1, xi2, a, b);
+          else
+          {
+            values[i] = NAN;
+            num_missed++;
+          }
         }
       }
 
-      warn("Point (%g, %g) does not lie in any element.", x, y);
-      return NAN;
-    }
+      for (int t = 1; t < num_threads; t++)
+        delete slns[t];
 
+      if (num_missed > 0)
+        warn("%d of %d points do not lie in any element.", num_missed, n);
+    }
 
     template<typename Scalar>
     Space<Scalar>* Solution<Scalar>::get_space()
@@ -18,10 +18,14 @@
 #include "mesh.h"
 #include "traverse.h"
 #include "refmap.h"
+#include "geometry_store.h"
 #include "function/solution.h"
 #include "quadrature/limit_order.h"
 #include "integrals/h1.h"
 #include "discrete_problem.h"
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
 
 namespace Hermes
 {
@@ -29,6 +33,15 @@ namespace Hermes
   {
     class Transformable;
 
+/// Integrates the expression with the jacobian multiplied by the integration weights, which the
+/// reference map takes from its geometry store if it has one (see calc_norms_and_errors()).
+#define jwt_integrate_expression(exp) \
+    {int np = quad->get_num_points(o); \
+    double* jwt = ru->get_jacobian_x_weights(o); \
+    for (int i = 0; i < np; i++) \
+    result += jwt[i] * (exp); \
+    }
+
     template<typename Scalar>
     std::string Global<Scalar>::get_quad_order_str(const int quad_order)
     {
@@ -109,10 +122,16 @@ namespace Hermes
     template<typename Scalar>
     double Global<Scalar>::calc_rel_error(MeshFunction<Scalar>* sln, MeshFunction<Scalar>* ref_sln, int norm_type)
     {
-      double error = calc_abs_error(sln, ref_sln, norm_type);
-      double norm = calc_norm(ref_sln, norm_type);
+      // sanity checks
+      if (sln == NULL) error("sln is NULL in calc_rel_error().");
+      if (ref_sln == NULL) error("ref_sln is NULL in calc_rel_error().");
 
-      return error/norm;
+      Hermes::vector<NormQuantity> quantities;
+      quantities.push_back(NormQuantity(sln, ref_sln, norm_type));
+      quantities.push_back(NormQuantity(ref_sln, NULL, norm_type));
+      calc_norms_and_errors(quantities);
+
+      return quantities[0].value / quantities[1].value;
     }
 
     template<typename Scalar>
@@ -154,57 +173,277 @@ namespace Hermes
     }
 
     template<typename Scalar>
-    double Global<Scalar>::calc_norms(Hermes::vector<Solution<Scalar>*> slns)
+    int Global<Scalar>::get_space_norm(Solution<Scalar>* sln)
     {
-      // Calculate norms for all solutions.
-      Hermes::vector<double> norms;
-      int n = slns.size();
-      for (int i = 0; i<n; i++)
+      switch (sln->get_space_type())
       {
-        switch (slns[i]->get_space_type())
-        {
-        case HERMES_H1_SPACE: norms.push_back(calc_norm(slns[i], HERMES_H1_NORM)); break;
-        case HERMES_HCURL_SPACE: norms.push_back(calc_norm(slns[i], HERMES_HCURL_NORM)); break;
-        case HERMES_HDIV_SPACE: norms.push_back(calc_norm(slns[i], HERMES_HDIV_NORM)); break;
-        case HERMES_L2_SPACE: norms.push_back(calc_norm(slns[i], HERMES_L2_NORM)); break;
-        default: error("Internal in calc_norms(): unknown space type.");
-        }
+      case HERMES_H1_SPACE: return HERMES_H1_NORM;
+      case HERMES_HCURL_SPACE: return HERMES_HCURL_NORM;
+      case HERMES_HDIV_SPACE: return HERMES_HDIV_NORM;
+      case HERMES_L2_SPACE: return HERMES_L2_NORM;
+      default: error("Internal in calc_norms(): unknown space type.");
       }
+      return HERMES_UNSET_NORM;
+    }
+
+    template<typename Scalar>
+    double Global<Scalar>::calc_norms(Hermes::vector<Solution<Scalar>*> slns)
+    {
+      // Calculate norms for all solutions in one traversal.
+      Hermes::vector<NormQuantity> quantities;
+      int n = slns.size();
+      for (int i = 0; i < n; i++)
+        quantities.push_back(NormQuantity(slns[i], NULL, get_space_norm(slns[i])));
+      calc_norms_and_errors(quantities);
+
       // Calculate the resulting norm.
       double result = 0;
       for (int i = 0; i < n; i++)
-        result += norms[i] * norms[i];
+        result += quantities[i].value * quantities[i].value;
       return sqrt(result);
     }
 
     template<typename Scalar>
     double Global<Scalar>::calc_abs_errors(Hermes::vector<Solution<Scalar>*> slns1, Hermes::vector<Solution<Scalar>*> slns2)
     {
-      // Calculate errors for all solutions.
-      Hermes::vector<double> errors;
+      // Calculate errors for all solutions in one traversal.
+      Hermes::vector<NormQuantity> quantities;
       int n = slns1.size();
       for (int i = 0; i < n; i++)
-      {
-        switch (slns1[i]->get_space_type())
-        {
-        case HERMES_H1_SPACE: errors.push_back(calc_abs_error(slns1[i], slns2[i], HERMES_H1_NORM)); break;
-        case HERMES_HCURL_SPACE: errors.push_back(calc_abs_error(slns1[i], slns2[i], HERMES_HCURL_NORM)); break;
-        case HERMES_HDIV_SPACE: errors.push_back(calc_abs_error(slns1[i], slns2[i], HERMES_HDIV_NORM)); break;
-        case HERMES_L2_SPACE: errors.push_back(calc_abs_error(slns1[i], slns2[i], HERMES_L2_NORM)); break;
-        default: error("Internal in calc_norms(): unknown space type.");
-        }
-      }
+        quantities.push_back(NormQuantity(slns1[i], slns2[i], get_space_norm(slns1[i])));
+      calc_norms_and_errors(quantities);
+
       // Calculate the resulting error.
       double result = 0;
       for (int i = 0; i < n; i++)
-        result += errors[i] * errors[i];
+        result += quantities[i].value * quantities[i].value;
       return sqrt(result);
     }
 
     template<typename Scalar>
     double Global<Scalar>::calc_rel_errors(Hermes::vector<Solution<Scalar>*> slns1, Hermes::vector<Solution<Scalar>*> slns2)
     {
-      return calc_abs_errors(slns1, slns2) / calc_norms(slns2);
+      // Errors and norms of the reference solutions, all in one traversal.
+      Hermes::vector<NormQuantity> quantities;
+      int n = slns1.size();
+      for (int i = 0; i < n; i++)
+      {
+        int norm_type = get_space_norm(slns1[i]);
+        quantities.push_back(NormQuantity(slns1[i], slns2[i], norm_type));
+        quantities.push_back(NormQuantity(slns2[i], NULL, norm_type));
+      }
+      calc_norms_and_errors(quantities);
+
+      double error = 0, norm = 0;
+      for (int i = 0; i < n; i++)
+      {
+        error += quantities[2 * i].value * quantities[2 * i].value;
+        norm += quantities[2 * i + 1].value * quantities[2 * i + 1].value;
+      }
+      return sqrt(error) / sqrt(norm);
+    }
+
+    template<typename Scalar>
+    Global<Scalar>::NormQuantity::NormQuantity(MeshFunction<Scalar>* sln1, MeshFunction<Scalar>* sln2, int norm_type, double* element_values)
+      : sln1(sln1), sln2(sln2), norm_type(norm_type), element_values(element_values), value(0.0)
+    {
+    }
+
+    template<typename Scalar>
+    double Global<Scalar>::calc_state_quantity(MeshFunction<Scalar>* sln1, MeshFunction<Scalar>* sln2, int norm_type)
+    {
+      RefMap* ru = sln1->get_refmap();
+      if (sln2 == NULL)
+      {
+        switch (norm_type)
+        {
+        case HERMES_L2_NORM: return norm_fn_l2(sln1, ru);
+        case HERMES_H1_NORM: return norm_fn_h1(sln1, ru);
+        case HERMES_HCURL_NORM: return norm_fn_hc(sln1, ru);
+        case HERMES_HDIV_NORM: return norm_fn_hdiv(sln1, ru);
+        default: error("Unknown norm in calc_norms_and_errors().");
+        }
+      }
+      else
+      {
+        RefMap* rv = sln2->get_refmap();
+        switch (norm_type)
+        {
+        case HERMES_L2_NORM: return error_fn_l2(sln1, sln2, ru, rv);
+        case HERMES_H1_NORM: return error_fn_h1(sln1, sln2, ru, rv);
+        case HERMES_HCURL_NORM: return error_fn_hc(sln1, sln2, ru, rv);
+        case HERMES_HDIV_NORM: return error_fn_hdiv(sln1, sln2, ru, rv);
+        default: error("Unknown norm in calc_norms_and_errors().");
+        }
+      }
+      return 0.0;
+    }
+
+    template<typename Scalar>
+    void Global<Scalar>::calc_norms_and_errors(Hermes::vector<NormQuantity>& quantities, int num_threads,
+      GeometryStore* geometry_store)
+    {
+      _F_;
+      int nq = quantities.size();
+      if (nq == 0)
+        return;
+
+      // Every function is traversed once, no matter in how many quantities it appears.
+      Hermes::vector<MeshFunction<Scalar>*> fns;
+      std::vector<int> idx1(nq), idx2(nq);
+      for (int q = 0; q < nq; q++)
+      {
+        if (quantities[q].sln1 == NULL) error("sln1 is NULL in calc_norms_and_errors().");
+        MeshFunction<Scalar>* sln[2] = { quantities[q].sln1, quantities[q].sln2 };
+        int* idx[2] = { &idx1[q], &idx2[q] };
+        for (int k = 0; k < 2; k++)
+        {
+          *idx[k] = -1;
+          if (sln[k] == NULL)
+            continue;
+          for (unsigned int i = 0; i < fns.size() && *idx[k] < 0; i++)
+            if (fns[i] == sln[k])
+              *idx[k] = i;
+          if (*idx[k] < 0)
+          {
+            *idx[k] = fns.size();
+            fns.push_back(sln[k]);
+          }
+        }
+      }
+
+      int nf = fns.size();
+      Mesh** meshes = new Mesh*[nf];
+      Transformable** tr = new Transformable*[nf];
+      std::vector<bool> stored(nf, false);
+      // The tables of the store are dropped if its mesh has changed since they were calculated.
+      if (geometry_store != NULL && geometry_store->get_mesh() != NULL)
+        geometry_store->set_mesh(geometry_store->get_mesh());
+      for (int i = 0; i < nf; i++)
+      {
+        fns[i]->set_quad_2d(&g_quad_2d_std);
+        meshes[i] = fns[i]->get_mesh();
+        tr[i] = fns[i];
+        stored[i] = geometry_store != NULL && meshes[i] == geometry_store->get_mesh();
+        if (stored[i])
+          fns[i]->refmap->set_geometry_store(geometry_store);
+      }
+
+      std::vector<double> sums(nq, 0.0);
+      for (int q = 0; q < nq; q++)
+        if (quantities[q].element_values != NULL)
+          memset(quantities[q].element_values, 0, meshes[idx1[q]]->get_max_element_id() * sizeof(double));
+
+#ifdef WITH_OPENMP
+      for (int i = 0; i < nf && num_threads > 1; i++)
+        if (dynamic_cast<Solution<Scalar>*>(fns[i]) == NULL || static_cast<Solution<Scalar>*>(fns[i])->get_type() != HERMES_SLN)
+        {
+          warning("calc_norms_and_errors(): only computed Solutions can be evaluated in parallel, using one thread.");
+          num_threads = 1;
+        }
+#else
+      num_threads = 1;
+#endif
+
+      Traverse trav;
+      trav.begin(nf, meshes, tr);
+      Element** ee;
+      if (num_threads == 1)
+      {
+        while ((ee = trav.get_next_state(NULL, NULL)) != NULL)
+        {
+          for (int q = 0; q < nq; q++)
+          {
+            Element* e = ee[idx1[q]];
+            if (e == NULL || (idx2[q] >= 0 && ee[idx2[q]] == NULL))
+              continue;
+            update_limit_table(e->get_mode());
+
+            double value = calc_state_quantity(fns[idx1[q]], idx2[q] >= 0 ? fns[idx2[q]] : NULL, quantities[q].norm_type);
+            sums[q] += value;
+            if (quantities[q].element_values != NULL)
+              quantities[q].element_values[e->id] += value;
+          }
+        }
+        trav.finish();
+      }
+#ifdef WITH_OPENMP
+      else
+      {
+        // Record the states together with the sub-element transformations of the functions.
+        std::vector<Element*> state_e;
+        std::vector<uint64_t> state_sub_idx;
+        while ((ee = trav.get_next_state(NULL, NULL)) != NULL)
+          for (int i = 0; i < nf; i++)
+          {
+            state_e.push_back(ee[i]);
+            state_sub_idx.push_back(ee[i] != NULL ? fns[i]->get_transform() : 0);
+          }
+        trav.finish();
+        int num_states = state_e.size() / nf;
+
+        // Every thread evaluates its own copies of the solutions.
+        std::vector<Hermes::vector<MeshFunction<Scalar>*> > copies(num_threads);
+        for (int t = 0; t < num_threads; t++)
+          for (int i = 0; i < nf; i++)
+          {
+            Solution<Scalar>* copy = new Solution<Scalar>();
+            copy->copy(static_cast<Solution<Scalar>*>(fns[i]));
+            copy->set_quad_2d(&g_quad_2d_std);
+            if (stored[i])
+              copy->refmap->set_geometry_store(geometry_store);
+            copies[t].push_back(copy);
+          }
+
+        // The contributions are summed up in the order of the states afterwards, so
+        // that the results are the same as in the serial evaluation.
+        std::vector<double> values((size_t) num_states * nq, 0.0);
+#pragma omp parallel for schedule(dynamic, 16) num_threads(num_threads)
+        for (int s = 0; s < num_states; s++)
+        {
+          Hermes::vector<MeshFunction<Scalar>*>& fn = copies[omp_get_thread_num()];
+          Element** e = &state_e[(size_t) s * nf];
+          for (int i = 0; i < nf; i++)
+          {
+            if (e[i] == NULL)
+              continue;
+            fn[i]->set_active_element(e[i]);
+            fn[i]->set_transform(state_sub_idx[(size_t) s * nf + i]);
+          }
+          for (int q = 0; q < nq; q++)
+          {
+            if (e[idx1[q]] == NULL || (idx2[q] >= 0 && e[idx2[q]] == NULL))
+              continue;
+            values[(size_t) s * nq + q] = calc_state_quantity(fn[idx1[q]], idx2[q] >= 0 ? fn[idx2[q]] : NULL, quantities[q].norm_type);
+          }
+        }
+
+        for (int s = 0; s < num_states; s++)
+          for (int q = 0; q < nq; q++)
+          {
+            Element* e = state_e[(size_t) s * nf + idx1[q]];
+            if (e == NULL)
+              continue;
+            double value = values[(size_t) s * nq + q];
+            sums[q] += value;
+            if (quantities[q].element_values != NULL)
+              quantities[q].element_values[e->id] += value;
+          }
+
+        for (int t = 0; t < num_threads; t++)
+          for (int i = 0; i < nf; i++)
+            delete copies[t][i];
+      }
+#endif
+
+      for (int q = 0; q < nq; q++)
+        quantities[q].value = sqrt(sums[q]);
+
+      for (int i = 0; i < nf; i++)
+        if (stored[i])
+          fns[i]->refmap->set_geometry_store(NULL);
+      delete [] meshes;
+      delete [] tr;
     }
 
     template<typename Scalar>
@@ -225,7 +464,7 @@ namespace Hermes
       sln2->get_dx_dy_values(dvdx, dvdy);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval[i] - vval[i]) +
+      jwt_integrate_expression(Hermes::sqr(uval[i] - vval[i]) +
         sqr(dudx[i] - dvdx[i]) + sqr(dudy[i] - dvdy[i]));
       return result;
     }
@@ -245,7 +484,7 @@ namespace Hermes
       sln->get_dx_dy_values(dudx, dudy);
 
       double result = 0.0;
-      h1_integrate_expression(sqr(uval[i]) + sqr(dudx[i]) + sqr(dudy[i]));
+      jwt_integrate_expression(sqr(uval[i]) + sqr(dudx[i]) + sqr(dudy[i]));
       return result;
     }
 
@@ -265,7 +504,7 @@ namespace Hermes
       vval = sln2->get_fn_values();
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval[i] - vval[i]));
+      jwt_integrate_expression(Hermes::sqr(uval[i] - vval[i]));
       return result;
     }
 
@@ -282,7 +521,7 @@ namespace Hermes
       Scalar* uval = sln->get_fn_values();
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval[i]));
+      jwt_integrate_expression(Hermes::sqr(uval[i]));
       return result;
     }
 
@@ -304,7 +543,7 @@ namespace Hermes
       Scalar *vdx1  = sln2->get_dx_values(1), *vdy0  = sln2->get_dy_values(0);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]) +
+      jwt_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]) +
         sqr((udx1[i] - udy0[i]) - (vdx1[i] - vdy0[i])));
       return result;
     }
@@ -323,7 +562,7 @@ namespace Hermes
       Scalar *udx1  = sln->get_dx_values(1), *udy0  = sln->get_dy_values(0);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]) + Hermes::sqr(udx1[i] - udy0[i]));
+      jwt_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]) + Hermes::sqr(udx1[i] - udy0[i]));
       return result;
     }
 
@@ -343,7 +582,7 @@ namespace Hermes
       Scalar *vval0 = sln2->get_fn_values(0), *vval1 = sln2->get_fn_values(1);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]));
+      jwt_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]));
       return result;
     }
 
@@ -361,7 +600,7 @@ namespace Hermes
       Scalar *udx1  = sln->get_dx_values(1), *udy0  = sln->get_dy_values(0);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]));
+      jwt_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]));
       return result;
     }
 
@@ -386,7 +625,7 @@ namespace Hermes
       Scalar *vdx1  = sln2->get_dx_values(1), *vdy0  = sln2->get_dy_values(0);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]) +
+      jwt_integrate_expression(Hermes::sqr(uval0[i] - vval0[i]) + Hermes::sqr(uval1[i] - vval1[i]) +
         Hermes::sqr((udx1[i] - udy0[i]) - (vdx1[i] - vdy0[i])));
       return result;
     }
@@ -408,7 +647,7 @@ namespace Hermes
       Scalar *udx1  = sln->get_dx_values(1), *udy0  = sln->get_dy_values(0);
 
       double result = 0.0;
-      h1_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]) + Hermes::sqr(udx1[i] - udy0[i]));
+      jwt_integrate_expression(Hermes::sqr(uval0[i]) + Hermes::sqr(uval1[i]) + Hermes::sqr(udx1[i] - udy0[i]));
       return result;
     }
 
@@ -0,0 +1,136 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "matrix_free_operator.h"
+#include "discrete_problem.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    template<typename Scalar>
+    MatrixFreeOperator<Scalar>::MatrixFreeOperator(DiscreteProblem<Scalar>* dp) : SparseMatrix<Scalar>(), dp(dp), x(NULL), y(NULL)
+    {
+      _F_;
+    }
+
+    template<typename Scalar>
+    MatrixFreeOperator<Scalar>::~MatrixFreeOperator()
+    {
+      _F_;
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::multiply_with_vector(Scalar* vector_in, Scalar* vector_out)
+    {
+      _F_;
+      dp->apply(vector_in, vector_out);
+    }
+
+    template<typename Scalar>
+    unsigned int MatrixFreeOperator<Scalar>::get_size()
+    {
+      _F_;
+      return dp->get_num_dofs();
+    }
+
+    template<typename Scalar>
+    unsigned int MatrixFreeOperator<Scalar>::get_matrix_size() const
+    {
+      return 0;
+    }
+
+    template<typename Scalar>
+    double MatrixFreeOperator<Scalar>::get_fill_in() const
+    {
+      return 0.0;
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::alloc()
+    {
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::free()
+    {
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::zero()
+    {
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::prealloc(unsigned int n)
+    {
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::pre_add_ij(unsigned int row, unsigned int col)
+    {
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::finish()
+    {
+    }
+
+    template<typename Scalar>
+    Scalar MatrixFreeOperator<Scalar>::get(unsigned int m, unsigned int n)
+    {
+      _F_;
+      error("MatrixFreeOperator::get(): the entries of a matrix-free operator are not available.");
+      return 0.0;
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::add_to_diagonal(Scalar v)
+    {
+      _F_;
+      error("MatrixFreeOperator::add_to_diagonal(): the entries of a matrix-free operator are not available.");
+    }
+
+    template<typename Scalar>
+    bool MatrixFreeOperator<Scalar>::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt)
+    {
+      return false;
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::add(unsigned int m, unsigned int n, Scalar v)
+    {
+      y[m] += v * x[n];
+    }
+
+    template<typename Scalar>
+    void MatrixFreeOperator<Scalar>::add(unsigned int m, unsigned int n, Scalar **mat, int *rows, int *cols)
+    {
+      for (unsigned int i = 0; i < m; i++)
+      {
+        if (rows[i] < 0)
+          continue;
+        Scalar sum = 0;
+        for (unsigned int j = 0; j < n; j++)
+          if (cols[j] >= 0)
+            sum += mat[i][j] * x[cols[j]];
+        y[rows[i]] += sum;
+      }
+    }
+
+    template class HERMES_API MatrixFreeOperator<double>;
+    template class HERMES_API MatrixFreeOperator<std::complex<double> >;
+  }
+}
@@ -0,0 +1,202 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "geometry_store.h"
+#include "mesh.h"
+#include "refmap.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    GeometryStore::GeometryStore(GeometryStoreMode mode, Quad2D* quad_2d) : mode(mode), quad_2d(quad_2d),
+      mesh(NULL), mesh_seq(0), num_elements(0)
+    {
+      _F_;
+      memset(tables, 0, sizeof(tables));
+    }
+
+    GeometryStore::~GeometryStore()
+    {
+      _F_;
+      free();
+    }
+
+    void GeometryStore::free()
+    {
+      _F_;
+      for (int m = 0; m < H2D_NUM_MODES; m++)
+        for (int i = 0; i < H2D_NUM_TABLES; i++)
+          if (tables[m][i] != NULL)
+          {
+            for (int c = 0; c < tables[m][i]->num_chunks; c++)
+            {
+              delete [] tables[m][i]->chunks[c].x;
+              delete [] tables[m][i]->chunks[c].y;
+              delete [] tables[m][i]->chunks[c].jacobian;
+              delete [] tables[m][i]->chunks[c].jwt;
+              delete [] tables[m][i]->chunks[c].inv_ref_map;
+            }
+            delete [] tables[m][i]->chunks;
+            delete [] tables[m][i]->index;
+            delete tables[m][i];
+            tables[m][i] = NULL;
+          }
+      num_elements = 0;
+    }
+
+    void GeometryStore::set_mesh(const Mesh* mesh)
+    {
+      _F_;
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_geometry_store)
+#endif
+      {
+        if (this->mesh != mesh || mesh_seq != mesh->get_seq())
+        {
+          free();
+          this->mesh = mesh;
+          mesh_seq = mesh->get_seq();
+          num_elements = mesh->get_max_element_id();
+        }
+      }
+    }
+
+    void GeometryStore::precompute(int order)
+    {
+      _F_;
+      if (mesh == NULL)
+        error("GeometryStore::precompute(): the mesh has not been set.");
+      // A RefMap attached to the store calculates and stores the tables of the elements covered.
+      RefMap refmap;
+      refmap.set_quad_2d(quad_2d);
+      refmap.set_geometry_store(this);
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        refmap.set_active_element(e);
+        if (covers(e, quad_2d, refmap.is_jacobian_const()))
+          refmap.get_phys_x(order);
+      }
+    }
+
+    const Mesh* GeometryStore::get_mesh() const
+    {
+      return mesh;
+    }
+
+    bool GeometryStore::covers(Element* e, Quad2D* quad_2d, bool is_affine) const
+    {
+      return quad_2d == this->quad_2d && e->id < num_elements && (mode == HERMES_GEOMETRY_STORE_ALL || is_affine);
+    }
+
+    size_t GeometryStore::get_memory_size() const
+    {
+      size_t size = 0;
+      for (int m = 0; m < H2D_NUM_MODES; m++)
+        for (int i = 0; i < H2D_NUM_TABLES; i++)
+          if (tables[m][i] != NULL)
+            size += (size_t) num_elements * sizeof(int) + (size_t) tables[m][i]->num_chunks * H2D_GEOMETRY_STORE_CHUNK
+              * tables[m][i]->np * (4 * sizeof(double) + sizeof(double2x2));
+      return size;
+    }
+
+    void GeometryStore::get_slot(Tables* t, int slot, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map) const
+    {
+      Chunk& chunk = t->chunks[slot / H2D_GEOMETRY_STORE_CHUNK];
+      int offset = (slot % H2D_GEOMETRY_STORE_CHUNK) * t->np;
+      x = chunk.x + offset;
+      y = chunk.y + offset;
+      jacobian = chunk.jacobian + offset;
+      jwt = chunk.jwt + offset;
+      inv_ref_map = chunk.inv_ref_map + offset;
+    }
+
+    bool GeometryStore::get(Element* e, int order, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map)
+    {
+      // No lock, see add() for the order in which the tables and the index are written.
+      Tables* t = tables[e->get_mode()][order];
+      if (t == NULL)
+        return false;
+#ifdef WITH_OPENMP
+#pragma omp flush
+#endif
+      int slot = t->index[e->id];
+      if (slot < 0)
+        return false;
+#ifdef WITH_OPENMP
+#pragma omp flush
+#endif
+      get_slot(t, slot, x, y, jacobian, jwt, inv_ref_map);
+      return true;
+    }
+
+    void GeometryStore::add(Element* e, int order, double*& x, double*& y, double*& jacobian, double*& jwt, double2x2*& inv_ref_map)
+    {
+      _F_;
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_geometry_store)
+#endif
+      {
+        int mode = e->get_mode();
+        Tables* t = tables[mode][order];
+        if (t == NULL)
+        {
+          t = new Tables;
+          t->np = quad_2d->get_num_points(order, mode);
+          t->index = new int[num_elements];
+          for (int i = 0; i < num_elements; i++)
+            t->index[i] = -1;
+          t->num_slots = 0;
+          t->chunks = new Chunk[(num_elements + H2D_GEOMETRY_STORE_CHUNK - 1) / H2D_GEOMETRY_STORE_CHUNK];
+          t->num_chunks = 0;
+          // The tables are published only when complete.
+#ifdef WITH_OPENMP
+#pragma omp flush
+#endif
+          tables[mode][order] = t;
+        }
+
+        int np = t->np;
+        if (t->index[e->id] < 0)
+        {
+          if (t->num_slots == t->num_chunks * H2D_GEOMETRY_STORE_CHUNK)
+          {
+            Chunk& chunk = t->chunks[t->num_chunks++];
+            chunk.x = new double[H2D_GEOMETRY_STORE_CHUNK * np];
+            chunk.y = new double[H2D_GEOMETRY_STORE_CHUNK * np];
+            chunk.jacobian = new double[H2D_GEOMETRY_STORE_CHUNK * np];
+            chunk.jwt = new double[H2D_GEOMETRY_STORE_CHUNK * np];
+            chunk.inv_ref_map = new double2x2[H2D_GEOMETRY_STORE_CHUNK * np];
+          }
+          double *sx, *sy, *sjacobian, *sjwt;
+          double2x2* sinv_ref_map;
+          get_slot(t, t->num_slots, sx, sy, sjacobian, sjwt, sinv_ref_map);
+          memcpy(sx, x, np * sizeof(double));
+          memcpy(sy, y, np * sizeof(double));
+          memcpy(sjacobian, jacobian, np * sizeof(double));
+          memcpy(sjwt, jwt, np * sizeof(double));
+          memcpy(sinv_ref_map, inv_ref_map, np * sizeof(double2x2));
+          // The slot is published in the index only when its tables are complete.
+#ifdef WITH_OPENMP
+#pragma omp flush
+#endif
+          t->index[e->id] = t->num_slots++;
+        }
+        get_slot(t, t->index[e->id], x, y, jacobian, jwt, inv_ref_map);
+      }
+    }
+  }
+}
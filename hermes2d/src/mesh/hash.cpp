@@ -24,7 +24,10 @@ namespace Hermes
     HashTable::HashTable()
     {
       v_table = NULL; e_table = NULL;
-      nqueries = ncollisions = 0;
+      v_bits = e_bits = 0;
+      v_count = e_count = 0;
+      nqueries = nprobes = 0;
+      max_probes = nrehashes = 0;
     }
 
     HashTable::~HashTable()
@@ -35,10 +38,14 @@ namespace Hermes
     void HashTable::init(int size)
     {
       v_table = e_table = NULL;
-      nqueries = ncollisions = 0;
+      v_count = e_count = 0;
+      nqueries = nprobes = 0;
+      max_probes = nrehashes = 0;
 
-      mask = size-1;
-      if (size & mask) error("Parameter 'size' must be a power of two.");
+      if (size < 2 || (size & (size - 1))) error("Parameter 'size' must be a power of two.");
+      int bits = 0;
+      while ((1 << bits) < size) bits++;
+      v_bits = e_bits = bits;
 
       // allocate and initialize the hash tables
       v_table = new Node*[size];
@@ -46,8 +53,6 @@ namespace Hermes
 
       memset(v_table, 0, size * sizeof(Node*));
       memset(e_table, 0, size * sizeof(Node*));
-
-      nqueries = ncollisions = 0;
     }
 
     void HashTable::copy_list(Node** ptr, Node* node)
@@ -82,44 +87,83 @@ namespace Hermes
     {
       free();
       nodes.copy(ht->nodes);
-      mask = ht->mask;
-
-      v_table = new Node*[mask + 1];
-      e_table = new Node*[mask + 1];
-      for (int i = 0; i <= mask; i++)
-      {
+      if (ht->v_table == NULL)
+        return;
+      v_bits = ht->v_bits;
+      e_bits = ht->e_bits;
+      v_count = ht->v_count;
+      e_count = ht->e_count;
+
+      v_table = new Node*[1 << v_bits];
+      e_table = new Node*[1 << e_bits];
+      for (int i = 0; i < (1 << v_bits); i++)
         copy_list(v_table + i, ht->v_table[i]);
+      for (int i = 0; i < (1 << e_bits); i++)
         copy_list(e_table + i, ht->e_table[i]);
+    }
+
+    void HashTable::insert(Node** table, int bits, Node* node)
+    {
+      int idx = hash(std::min(node->p1, node->p2), std::max(node->p1, node->p2), bits);
+      node->next_hash = table[idx];
+      table[idx] = node;
+    }
+
+    void HashTable::grow_table(Node**& table, int& bits, int count)
+    {
+      int new_bits = bits;
+      while ((1 << new_bits) < count)
+        new_bits++;
+      if (new_bits == bits)
+        return;
+
+      Node** new_table = new Node*[1 << new_bits];
+      memset(new_table, 0, (1 << new_bits) * sizeof(Node*));
+      for (int i = 0; i < (1 << bits); i++)
+      {
+        Node* node = table[i];
+        while (node != NULL)
+        {
+          Node* next = node->next_hash;
+          insert(new_table, new_bits, node);
+          node = next;
+        }
       }
+      delete [] table;
+      table = new_table;
+      bits = new_bits;
+      nrehashes++;
     }
 
     void HashTable::rebuild()
     {
-      memset(v_table, 0, (mask + 1) * sizeof(Node*));
-      memset(e_table, 0, (mask + 1) * sizeof(Node*));
+      memset(v_table, 0, (1 << v_bits) * sizeof(Node*));
+      memset(e_table, 0, (1 << e_bits) * sizeof(Node*));
+      v_count = e_count = 0;
 
       Node* node;
       for_all_nodes(node, this)
       {
-        int p1 = node->p1, p2 = node->p2;
-        if (p1 > p2) std::swap(p1, p2);
-        int idx = hash(p1, p2);
-
         if (node->type == HERMES_TYPE_VERTEX)
         {
-          node->next_hash = v_table[idx];
-          v_table[idx] = node;
+          // top-level vertices are not hashed
+          if (node->p1 < 0) continue;
+          insert(v_table, v_bits, node);
+          v_count++;
         }
         else
         {
-          node->next_hash = e_table[idx];
-          e_table[idx] = node;
+          insert(e_table, e_bits, node);
+          e_count++;
         }
       }
+      grow_table(v_table, v_bits, v_count);
+      grow_table(e_table, e_bits, e_count);
     }
 
     void HashTable::free()
     {
+      dump_hash_stat();
       nodes.free();
       if (v_table != NULL)
       {
@@ -131,34 +175,55 @@ namespace Hermes
         delete [] e_table;
         e_table = NULL;
       }
-      dump_hash_stat();
+      v_count = e_count = 0;
     }
 
-    void HashTable::dump_hash_stat()
+    int HashTable::get_max_chain(Node** table, int bits)
     {
-      if (ncollisions > 2*nqueries)
+      int max_chain = 0;
+      for (int i = 0; i < (1 << bits); i++)
       {
-        warn("Hashtable: nqueries = %d ncollisions = %d", nqueries, ncollisions);
+        int length = 0;
+        for (Node* node = table[i]; node != NULL; node = node->next_hash)
+          length++;
+        max_chain = std::max(max_chain, length);
       }
+      return max_chain;
+    }
+
+    void HashTable::dump_hash_stat()
+    {
+      if (v_table == NULL || nqueries == 0)
+        return;
+
+      double avg_probes = (double) nprobes / nqueries;
+      verbose("Hashtable: %d vertex nodes in %d buckets (longest list %d), %d edge nodes in %d buckets (longest list %d), %d rehashes",
+        v_count, 1 << v_bits, get_max_chain(v_table, v_bits), e_count, 1 << e_bits, get_max_chain(e_table, e_bits), nrehashes);
+      verbose("Hashtable: %.0f queries, average probe length %.2f, longest probe %d", (double) nqueries, avg_probes, max_probes);
+      if (avg_probes > 3.0)
+        warn("Hashtable: %.0f queries, average probe length %.2f, longest probe %d", (double) nqueries, avg_probes, max_probes);
     }
 
     inline Node* HashTable::search_list(Node* node, int p1, int p2)
     {
-      nqueries++;
+      int probes = 0;
       while (node != NULL)
       {
-        if (node->p1 == p1 && node->p2 == p2) return node;
+        probes++;
+        if (node->p1 == p1 && node->p2 == p2) break;
         node = node->next_hash;
-        ncollisions++;
       }
-      return NULL;
+      nqueries++;
+      nprobes += probes;
+      if (probes > max_probes) max_probes = probes;
+      return node;
     }
 
     Node* HashTable::get_vertex_node(int p1, int p2)
     {
       // search for the node in the vertex hashtable
       if (p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
+      int i = hash(p1, p2, v_bits);
       Node* node = search_list(v_table[i], p1, p2);
       if (node != NULL) return node;
 
@@ -175,9 +240,11 @@ namespace Hermes
       newnode->x = (nodes[p1].x + nodes[p2].x) * 0.5;
       newnode->y = (nodes[p1].y + nodes[p2].y) * 0.5;
 
-      // insert into hashtable
+      // insert into hashtable, enlarge it if it gets too full
       newnode->next_hash = v_table[i];
       v_table[i] = newnode;
+      if (++v_count > (1 << v_bits))
+        grow_table(v_table, v_bits, v_count);
 
       return newnode;
     }
@@ -186,7 +253,7 @@ namespace Hermes
     {
       // search for the node in the edge hashtable
       if (p1 > p2) std::swap(p1, p2);
-      int i = hash(p1, p2);
+      int i = hash(p1, p2, e_bits);
       Node* node = search_list(e_table[i], p1, p2);
       if (node != NULL) return node;
 
@@ -202,9 +269,11 @@ namespace Hermes
       newnode->marker = 0;
       newnode->elem[0] = newnode->elem[1] = NULL;
 
-      // insert into hashtable
+      // insert into hashtable, enlarge it if it gets too full
       newnode->next_hash = e_table[i];
       e_table[i] = newnode;
+      if (++e_count > (1 << e_bits))
+        grow_table(e_table, e_bits, e_count);
 
       return newnode;
     }
@@ -212,19 +281,19 @@ namespace Hermes
     Node* HashTable::peek_vertex_node(int p1, int p2)
     {
       if (p1 > p2) std::swap(p1, p2);
-      return search_list(v_table[hash(p1, p2)], p1, p2);
+      return search_list(v_table[hash(p1, p2, v_bits)], p1, p2);
     }
 
     Node* HashTable::peek_edge_node(int p1, int p2)
     {
       if (p1 > p2) std::swap(p1, p2);
-      return search_list(e_table[hash(p1, p2)], p1, p2);
+      return search_list(e_table[hash(p1, p2, e_bits)], p1, p2);
     }
 
     void HashTable::remove_vertex_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
+      int i = hash(nodes[id].p1, nodes[id].p2, v_bits);
       Node** ptr = v_table + i;
       Node* node = *ptr;
       while (node != NULL)
@@ -232,6 +301,7 @@ namespace Hermes
         if (node->id == id)
         {
           *ptr = node->next_hash;
+          v_count--;
           break;
         }
         ptr = &node->next_hash;
@@ -245,7 +315,7 @@ namespace Hermes
     void HashTable::remove_edge_node(int id)
     {
       // remove the node from the hash table
-      int i = hash(nodes[id].p1, nodes[id].p2);
+      int i = hash(nodes[id].p1, nodes[id].p2, e_bits);
       Node** ptr = e_table + i;
       Node* node = *ptr;
       while (node != NULL)
@@ -253,6 +323,7 @@ namespace Hermes
         if (node->id == id)
         {
           *ptr = node->next_hash;
+          e_count--;
           break;
         }
         ptr = &node->next_hash;
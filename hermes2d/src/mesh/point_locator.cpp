@@ -0,0 +1,219 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "point_locator.h"
+#include "mesh.h"
+#include "refmap.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    // Number of points sampled along each edge of a curvilinear element.
+    static const int H2D_LOCATOR_EDGE_SAMPLES = 8;
+
+    PointLocator::PointLocator() : mesh(NULL), mesh_seq(0), mesh_max_id(0), x0(0.0), y0(0.0), hx(1.0), hy(1.0), nx(0), ny(0)
+    {
+    }
+
+    PointLocator::~PointLocator()
+    {
+      free();
+    }
+
+    void PointLocator::free()
+    {
+      mesh = NULL;
+      nx = ny = 0;
+      cell_start.clear();
+      cell_elems.clear();
+      boxes.clear();
+    }
+
+    bool PointLocator::is_in_ref_domain(Element* e, double xi1, double xi2)
+    {
+      const double TOL = 1e-11;
+      if(e->get_num_surf() == 3)
+        return (xi1 + xi2 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 + 1.0 >= -TOL);
+      else
+        return (xi1 - 1.0 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 - 1.0 <= TOL) && (xi2 + 1.0 >= -TOL);
+    }
+
+    void PointLocator::calc_bounding_box(Element* e, RefMap* refmap, double* box)
+    {
+      box[0] = box[1] = DBL_MAX;
+      box[2] = box[3] = -DBL_MAX;
+      for (unsigned int i = 0; i < e->get_num_surf(); i++)
+      {
+        box[0] = std::min(box[0], e->vn[i]->x);
+        box[1] = std::min(box[1], e->vn[i]->y);
+        box[2] = std::max(box[2], e->vn[i]->x);
+        box[3] = std::max(box[3], e->vn[i]->y);
+      }
+      if (!e->is_curved())
+        return;
+
+      // Curved edges may bulge out of the box of the vertices.
+      static const double ref_vertices[2][4][2] =
+      {
+        { { -1.0, -1.0 }, { 1.0, -1.0 }, { -1.0, 1.0 }, { 0.0, 0.0 } },
+        { { -1.0, -1.0 }, { 1.0, -1.0 }, { 1.0, 1.0 }, { -1.0, 1.0 } }
+      };
+      const double (*rv)[2] = ref_vertices[e->get_mode()];
+      refmap->set_active_element(e);
+      unsigned int nv = e->get_num_surf();
+      for (unsigned int i = 0; i < nv; i++)
+        for (int k = 1; k < H2D_LOCATOR_EDGE_SAMPLES; k++)
+        {
+          double t = (double) k / H2D_LOCATOR_EDGE_SAMPLES;
+          double xi1 = (1.0 - t) * rv[i][0] + t * rv[(i + 1) % nv][0];
+          double xi2 = (1.0 - t) * rv[i][1] + t * rv[(i + 1) % nv][1];
+          double x, y;
+          double2x2 m;
+          refmap->inv_ref_map_at_point(xi1, xi2, x, y, m);
+          box[0] = std::min(box[0], x);
+          box[1] = std::min(box[1], y);
+          box[2] = std::max(box[2], x);
+          box[3] = std::max(box[3], y);
+        }
+
+      // The edge between the samples may still reach a little further.
+      double margin = 0.05 * std::max(box[2] - box[0], box[3] - box[1]);
+      box[0] -= margin;
+      box[1] -= margin;
+      box[2] += margin;
+      box[3] += margin;
+    }
+
+    void PointLocator::get_cell_range(const double* box, int& i0, int& j0, int& i1, int& j1) const
+    {
+      i0 = std::max(0, std::min(nx - 1, (int) floor((box[0] - x0) / hx)));
+      j0 = std::max(0, std::min(ny - 1, (int) floor((box[1] - y0) / hy)));
+      i1 = std::max(0, std::min(nx - 1, (int) floor((box[2] - x0) / hx)));
+      j1 = std::max(0, std::min(ny - 1, (int) floor((box[3] - y0) / hy)));
+    }
+
+    int PointLocator::get_cell(double x, double y) const
+    {
+      if (nx == 0)
+        return 0;
+      int i = std::max(0, std::min(nx - 1, (int) floor((x - x0) / hx)));
+      int j = std::max(0, std::min(ny - 1, (int) floor((y - y0) / hy)));
+      return j * nx + i;
+    }
+
+    void PointLocator::set_mesh(Mesh* mesh)
+    {
+      _F_;
+      if (mesh == NULL)
+        error("Mesh is NULL in PointLocator::set_mesh().");
+      if (this->mesh == mesh && mesh->get_seq() == mesh_seq && mesh->get_max_element_id() == mesh_max_id)
+        return;
+
+      free();
+      this->mesh = mesh;
+      mesh_seq = mesh->get_seq();
+      mesh_max_id = mesh->get_max_element_id();
+
+      // Bounding boxes of the elements and of the whole mesh.
+      RefMap refmap;
+      refmap.set_quad_2d(&g_quad_2d_std);
+      boxes.resize(4 * mesh->get_max_element_id());
+      double mesh_box[4] = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX };
+      int num_active = 0;
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        double* box = &boxes[4 * e->id];
+        calc_bounding_box(e, &refmap, box);
+        mesh_box[0] = std::min(mesh_box[0], box[0]);
+        mesh_box[1] = std::min(mesh_box[1], box[1]);
+        mesh_box[2] = std::max(mesh_box[2], box[2]);
+        mesh_box[3] = std::max(mesh_box[3], box[3]);
+        num_active++;
+      }
+      if (num_active == 0)
+        return;
+
+      // Points on the element boundaries must not fall out of the boxes due to roundoff.
+      double w = mesh_box[2] - mesh_box[0], h = mesh_box[3] - mesh_box[1];
+      double eps = 1e-10 * std::max(w, h);
+      for_all_active_elements(e, mesh)
+      {
+        double* box = &boxes[4 * e->id];
+        box[0] -= eps;
+        box[1] -= eps;
+        box[2] += eps;
+        box[3] += eps;
+      }
+
+      // About one cell per element, the cells as square as possible.
+      w = std::max(w, eps);
+      h = std::max(h, eps);
+      nx = std::max(1, (int) ceil(sqrt(num_active * w / h)));
+      ny = std::max(1, (int) ceil((double) num_active / nx));
+      x0 = mesh_box[0] - eps;
+      y0 = mesh_box[1] - eps;
+      hx = (w + 2 * eps) / nx;
+      hy = (h + 2 * eps) / ny;
+
+      // Count the elements of each cell, then fill them in.
+      int i0, j0, i1, j1;
+      cell_start.assign(nx * ny + 1, 0);
+      for_all_active_elements(e, mesh)
+      {
+        get_cell_range(&boxes[4 * e->id], i0, j0, i1, j1);
+        for (int j = j0; j <= j1; j++)
+          for (int i = i0; i <= i1; i++)
+            cell_start[j * nx + i + 1]++;
+      }
+      for (int c = 0; c < nx * ny; c++)
+        cell_start[c + 1] += cell_start[c];
+
+      cell_elems.resize(cell_start[nx * ny]);
+      std::vector<int> pos(cell_start.begin(), cell_start.end() - 1);
+      for_all_active_elements(e, mesh)
+      {
+        get_cell_range(&boxes[4 * e->id], i0, j0, i1, j1);
+        for (int j = j0; j <= j1; j++)
+          for (int i = i0; i <= i1; i++)
+            cell_elems[pos[j * nx + i]++] = e->id;
+      }
+    }
+
+    Element* PointLocator::find(double x, double y, RefMap* refmap, double& xi1, double& xi2) const
+    {
+      if (mesh == NULL)
+        error("PointLocator::set_mesh() has to be called first.");
+      if (nx == 0)
+        return NULL;
+
+      int c = get_cell(x, y);
+      for (int k = cell_start[c]; k < cell_start[c + 1]; k++)
+      {
+        const double* box = &boxes[4 * cell_elems[k]];
+        if (x < box[0] || y < box[1] || x > box[2] || y > box[3])
+          continue;
+
+        Element* e = mesh->get_element(cell_elems[k]);
+        refmap->set_active_element(e);
+        refmap->untransform(e, x, y, xi1, xi2);
+        if (is_in_ref_domain(e, xi1, xi2))
+          return e;
+      }
+      return NULL;
+    }
+  }
+}
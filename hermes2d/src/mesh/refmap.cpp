@@ -16,6 +16,7 @@
 #include "hermes2d_common_defs.h"
 #include "mesh.h"
 #include "refmap.h"
+#include "geometry_store.h"
 #include "shapeset/shapeset_h1_all.h"
 
 namespace Hermes
@@ -23,17 +24,28 @@ namespace Hermes
   namespace Hermes2D
   {
     H1Shapeset ref_map_shapeset;
-    PrecalcShapeset ref_map_pss(&ref_map_shapeset);
 
-    RefMap::RefMap()
+    RefMap::RefMap() : ref_map_pss(&ref_map_shapeset)
     {
       quad_2d = NULL;
       num_tables = 0;
       cur_node = NULL;
       overflow = NULL;
+      geometry_store = NULL;
       set_quad_2d(&g_quad_2d_std); // default quadrature
     }
 
+    void RefMap::set_geometry_store(GeometryStore* geometry_store)
+    {
+      // The tables of the active element are set up anew, with or without the store.
+      Element* e = element;
+      free();
+      element = NULL;
+      this->geometry_store = geometry_store;
+      if (e != NULL)
+        set_active_element(e);
+    }
+
     RefMap::~RefMap() { free(); }
 
     /// Sets the quadrature points in which the reference map will be evaluated.
@@ -88,6 +100,13 @@ namespace Hermes
       return cur_node->jacobian[order];
     }
 
+    double* RefMap::get_jacobian_x_weights(int order)
+    {
+      if (cur_node->jwt[order] == NULL)
+        calc_jacobian_x_weights(order);
+      return cur_node->jwt[order];
+    }
+
     /// Returns the inverse matrices of the reference map precalculated at the
     /// integration points of the specified order. Intended for non-constant
     /// jacobian elements.
@@ -164,12 +183,12 @@ namespace Hermes
       if (e == element) return;
       element = e;
 
-      reset_transform();
-      update_cur_node();
-
       is_const = !element->is_curved() &&
         (element->is_triangle() || is_parallelogram());
 
+      reset_transform();
+      update_cur_node();
+
       // prepare the shapes and coefficients of the reference map
       int j, k = 0;
       for (unsigned int i = 0; i < e->get_num_surf(); i++)
@@ -226,8 +245,42 @@ namespace Hermes
       const_jacobian *= 4;
     }
 
+    void RefMap::get_stored_tables(int order)
+    {
+      if (geometry_store->get(element, order, cur_node->phys_x[order], cur_node->phys_y[order],
+        cur_node->jacobian[order], cur_node->jwt[order], cur_node->inv_ref_map[order]))
+        return;
+
+      // Not stored yet: calculate the tables as for an element the store does not cover (outside
+      // of the store's lock) and hand them over to the store, which keeps copies of them.
+      cur_node->stored = false;
+      calc_inv_ref_map(order);
+      calc_phys_x(order);
+      calc_phys_y(order);
+      calc_jacobian_x_weights(order);
+      cur_node->stored = true;
+
+      double* x = cur_node->phys_x[order];
+      double* y = cur_node->phys_y[order];
+      double* jacobian = cur_node->jacobian[order];
+      double* jwt = cur_node->jwt[order];
+      double2x2* inv_ref_map = cur_node->inv_ref_map[order];
+      geometry_store->add(element, order, cur_node->phys_x[order], cur_node->phys_y[order],
+        cur_node->jacobian[order], cur_node->jwt[order], cur_node->inv_ref_map[order]);
+      delete [] x;
+      delete [] y;
+      delete [] jacobian;
+      delete [] jwt;
+      delete [] inv_ref_map;
+    }
+
     void RefMap::calc_inv_ref_map(int order)
     {
+      if (cur_node->stored)
+      {
+        get_stored_tables(order);
+        return;
+      }
       assert(quad_2d != NULL);
       int i, j, np = quad_2d->get_num_points(order);
 
@@ -274,6 +327,27 @@ namespace Hermes
       delete [] m;
     }
 
+    void RefMap::calc_jacobian_x_weights(int order)
+    {
+      if (cur_node->stored)
+      {
+        get_stored_tables(order);
+        return;
+      }
+      int i, np = quad_2d->get_num_points(order);
+      double3* pt = quad_2d->get_points(order);
+      double* jwt = cur_node->jwt[order] = new double[np];
+      if (is_const)
+        for (i = 0; i < np; i++)
+          jwt[i] = pt[i][2] * const_jacobian;
+      else
+      {
+        double* jac = get_jacobian(order);
+        for (i = 0; i < np; i++)
+          jwt[i] = pt[i][2] * jac[i];
+      }
+    }
+
     void RefMap::calc_second_ref_map(int order)
     {
       assert(quad_2d != NULL);
@@ -361,6 +435,11 @@ namespace Hermes
 
     void RefMap::calc_phys_x(int order)
     {
+      if (cur_node->stored)
+      {
+        get_stored_tables(order);
+        return;
+      }
       // transform all x coordinates of the integration points
       int i, j, np = quad_2d->get_num_points(order);
       double* x = cur_node->phys_x[order] = new double[np];
@@ -378,6 +457,11 @@ namespace Hermes
 
     void RefMap::calc_phys_y(int order)
     {
+      if (cur_node->stored)
+      {
+        get_stored_tables(order);
+        return;
+      }
       // transform all y coordinates of the integration points
       int i, j, np = quad_2d->get_num_points(order);
       double* y = cur_node->phys_y[order] = new double[np];
@@ -417,7 +501,7 @@ namespace Hermes
       else
       {
         // construct jacobi matrices of the direct reference map at integration points along the edge
-        static double2x2 m[15];
+        double2x2 m[15];
         assert(np <= 15);
         memset(m, 0, np*sizeof(double2x2));
         ref_map_pss.force_transform(sub_idx, ctm);
@@ -615,6 +699,9 @@ namespace Hermes
       memset(pp->phys_x, 0, num_tables * sizeof(double*));
       memset(pp->phys_y, 0, num_tables * sizeof(double*));
       memset(pp->tan, 0, sizeof(pp->tan));
+      memset(pp->jacobian, 0, num_tables * sizeof(double*));
+      memset(pp->jwt, 0, num_tables * sizeof(double*));
+      pp->stored = geometry_store != NULL && sub_idx == 0 && geometry_store->covers(element, quad_2d, is_const);
     }
 
     void RefMap::free_node(Node* node)
@@ -622,12 +709,15 @@ namespace Hermes
       // destroy all precalculated tables
       for (int i = 0; i < num_tables; i++)
       {
+        if (node->second_ref_map[i] != NULL) delete [] node->second_ref_map[i];
+        if (node->stored)
+          continue;
         if (node->inv_ref_map[i] != NULL)
         {
           delete [] node->inv_ref_map[i];
           delete [] node->jacobian[i];
         }
-        if (node->second_ref_map[i] != NULL) delete [] node->second_ref_map[i];
+        if (node->jwt[i] != NULL) delete [] node->jwt[i];
         if (node->phys_x[i] != NULL) delete [] node->phys_x[i];
         if (node->phys_y[i] != NULL) delete [] node->phys_y[i];
       }
@@ -641,7 +731,7 @@ namespace Hermes
 
     void RefMap::free()
     {
-      std::map<uint64_t, Node*>::iterator it;
+      FlatHashMap<uint64_t, Node*>::iterator it;
 
       for (it = nodes.begin(); it != nodes.end(); it++)
         free_node(it->second);
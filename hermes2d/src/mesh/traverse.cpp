@@ -17,12 +17,29 @@
 #include "mesh.h"
 #include "transformable.h"
 #include "traverse.h"
+#include <algorithm>
 namespace Hermes
 {
   namespace Hermes2D
   {
     const uint64_t ONE = (uint64_t) 1 << 63;
 
+    /// Space-filling curves through the quadrants 0 (bottom-left), 1 (bottom-right), 2 (top-right)
+    /// and 3 (top-left) of a quadrilateral. Rows 0 - 3 are the four orientations of the Hilbert curve,
+    /// row 4 is the Morton curve. curve_sons[c] is the order of visiting the quadrants, curve_next[c]
+    /// are the curves in the respective quadrants.
+    static const int curve_sons[5][4] =
+    {
+      { 0, 3, 2, 1 }, { 0, 1, 2, 3 }, { 2, 1, 0, 3 }, { 2, 3, 0, 1 }, { 0, 1, 3, 2 }
+    };
+    static const int curve_next[5][4] =
+    {
+      { 1, 0, 0, 3 }, { 0, 1, 1, 2 }, { 3, 2, 2, 1 }, { 2, 3, 3, 0 }, { 4, 4, 4, 4 }
+    };
+    static const int H2D_MORTON_CURVE = 4;
+
+    ElementOrdering Traverse::element_ordering = HERMES_ELEMENT_ORDERING_NATURAL;
+
     struct Rect
     {
       uint64_t l, b, r, t;
@@ -37,6 +54,7 @@ namespace Hermes
       bool bnd[3];
       uint64_t lo[3], hi[3];
       int* trans;
+      int curve;
     };
 
 
@@ -249,7 +267,7 @@ namespace Hermes
             for (i = 0; i < num; i++)
             {
               // Retrieve the Element with this id on the i-th mesh.
-              s->e[i] = meshes[i]->get_element(id);
+              s->e[i] = meshes[i]->get_element(base_order == NULL ? id : base_order[id]);
               if (!s->e[i]->used)
               {
                 s->e[i] = NULL;
@@ -274,6 +292,7 @@ namespace Hermes
           // Sets necessary things for when the new base element is a triangle.
           tri = base->is_triangle();
           id++;
+          s->curve = (element_ordering == HERMES_ELEMENT_ORDERING_MORTON) ? H2D_MORTON_CURVE : 0;
 
           if (tri)
           {
@@ -396,9 +415,14 @@ namespace Hermes
               // Both splits: recur to four sons, similar to triangles.
               if (split == 3)
               {
-                for (son = 0; son <= 3; son++)
+                for (int k = 0; k <= 3; k++)
                 {
+                  // The states are visited in the reverse order of pushing.
+                  son = k;
+                  if (element_ordering != HERMES_ELEMENT_ORDERING_NATURAL)
+                    son = curve_sons[s->curve][3 - k];
                   State* ns = push_state();
+                  ns->curve = curve_next[s->curve][3 - k];
                   // Sets the son's "base" rectangle to the correct one.
                   move_to_son(&ns->cr, &s->cr, son);
 
@@ -430,9 +454,20 @@ namespace Hermes
                 int son0 = 4, son1 = 5;
                 if (split == 2) { son0 = 6; son1 = 7; }
 
-                for (son = son0; son <= son1; son++)
+                // The curve enters the element in its first quadrant, the half containing it is visited first.
+                int first_pushed = son0;
+                if (element_ordering != HERMES_ELEMENT_ORDERING_NATURAL)
+                {
+                  int q = curve_sons[s->curve][0];
+                  if ((split == 1 && q <= 1) || (split == 2 && (q == 0 || q == 3)))
+                    first_pushed = son1;
+                }
+
+                for (int k = 0; k <= 1; k++)
                 {
+                  son = (k == 0) ? first_pushed : son0 + son1 - first_pushed;
                   State* ns = push_state();
+                  ns->curve = s->curve;
                   move_to_son(&ns->cr, &s->cr, son);
 
                   j = (son == 4 || son == 6) ? 0 : 2;
@@ -460,6 +495,7 @@ namespace Hermes
               else
               {
                 State* ns = push_state();
+                ns->curve = s->curve;
                 memcpy(&ns->cr, &s->cr, sizeof(Rect));
 
                 for (i = 0; i < num; i++)
@@ -504,6 +540,10 @@ namespace Hermes
       subs = new uint64_t[num];
       id = 0;
 
+      base_order = NULL;
+      if (element_ordering != HERMES_ELEMENT_ORDERING_NATURAL)
+        init_base_order();
+
 #ifndef H2D_DISABLE_MULTIMESH_TESTS
       // Test whether all master meshes have the same number of elements.
       int base_elem_num = meshes[0]->get_num_base_elements();
@@ -569,6 +609,118 @@ namespace Hermes
 
       delete [] subs;
       delete [] sons;
+      delete [] base_order;
+      base_order = NULL;
+    }
+
+
+    void Traverse::set_element_ordering(ElementOrdering ordering)
+    {
+      element_ordering = ordering;
+    }
+
+
+    ElementOrdering Traverse::get_element_ordering()
+    {
+      return element_ordering;
+    }
+
+
+    void Traverse::get_visiting_order(Mesh* mesh, Hermes::vector<int>& ids)
+    {
+      ids.clear();
+      Traverse trav;
+      trav.begin(1, &mesh);
+      Element** ee;
+      while ((ee = trav.get_next_state(NULL, NULL)) != NULL)
+        ids.push_back(ee[0]->id);
+      trav.finish();
+    }
+
+
+    /// Index of the point (x, y) of the 2^bits x 2^bits grid along the Hilbert curve.
+    static uint64_t hilbert_index(uint64_t x, uint64_t y, int bits)
+    {
+      uint64_t n = (uint64_t) 1 << bits;
+      uint64_t d = 0;
+      for (uint64_t s = n >> 1; s > 0; s >>= 1)
+      {
+        uint64_t rx = (x & s) ? 1 : 0;
+        uint64_t ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant.
+        if (ry == 0)
+        {
+          if (rx == 1)
+          {
+            x = n - 1 - x;
+            y = n - 1 - y;
+          }
+          std::swap(x, y);
+        }
+      }
+      return d;
+    }
+
+
+    /// Index of the point (x, y) of the 2^bits x 2^bits grid along the Morton curve.
+    static uint64_t morton_index(uint64_t x, uint64_t y, int bits)
+    {
+      uint64_t d = 0;
+      for (int b = 0; b < bits; b++)
+        d |= (((x >> b) & 1) << (2 * b)) | (((y >> b) & 1) << (2 * b + 1));
+      return d;
+    }
+
+
+    void Traverse::init_base_order()
+    {
+      int nbase = meshes[0]->get_num_base_elements();
+      std::vector<double> cx(nbase), cy(nbase);
+      std::vector<bool> used(nbase, false);
+      double x_min = 1e300, x_max = -1e300, y_min = 1e300, y_max = -1e300;
+
+      // Centers of the base elements (of the first mesh where the element is used).
+      for (int b = 0; b < nbase; b++)
+      {
+        for (int i = 0; i < num && !used[b]; i++)
+        {
+          Element* e = meshes[i]->get_element(b);
+          if (!e->used)
+            continue;
+          used[b] = true;
+          cx[b] = cy[b] = 0.0;
+          for (unsigned int j = 0; j < e->get_nvert(); j++)
+          {
+            cx[b] += e->vn[j]->x;
+            cy[b] += e->vn[j]->y;
+          }
+          cx[b] /= e->get_nvert();
+          cy[b] /= e->get_nvert();
+          x_min = std::min(x_min, cx[b]); x_max = std::max(x_max, cx[b]);
+          y_min = std::min(y_min, cy[b]); y_max = std::max(y_max, cy[b]);
+        }
+      }
+
+      // The unused elements are skipped anyway, they go last.
+      const int bits = 16;
+      double scale = ((1 << bits) - 1) / std::max(std::max(x_max - x_min, y_max - y_min), 1e-300);
+      std::vector<std::pair<uint64_t, int> > keys(nbase);
+      for (int b = 0; b < nbase; b++)
+      {
+        uint64_t key = (uint64_t) -1;
+        if (used[b])
+        {
+          uint64_t x = (uint64_t) ((cx[b] - x_min) * scale), y = (uint64_t) ((cy[b] - y_min) * scale);
+          key = (element_ordering == HERMES_ELEMENT_ORDERING_HILBERT) ? hilbert_index(x, y, bits) : morton_index(x, y, bits);
+        }
+        keys[b] = std::pair<uint64_t, int>(key, b);
+      }
+      std::sort(keys.begin(), keys.end());
+
+      base_order = new int[nbase];
+      for (int b = 0; b < nbase; b++)
+        base_order[b] = keys[b].second;
     }
 
 
@@ -291,6 +291,7 @@ namespace Hermes
           delete linear_solver;
           // Create new matrix solver with correct matrix.
           linear_solver = create_linear_solver<Scalar>(this->matrix_solver_type, kept_jacobian, residual);
+          configure_linear_solver();
 
           this->dp->assemble(this->sln_vector, kept_jacobian);
           linear_solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
@@ -327,36 +328,41 @@ namespace Hermes
     void NewtonSolver<Scalar>::set_iterative_method(const char* iterative_method_name)
     {
       NonlinearSolver<Scalar>::set_iterative_method(iterative_method_name);
-      // Set iterative method and preconditioner in case of iterative solver AztecOO.
-#ifdef HAVE_AZTECOO
-      if(this->matrix_solver_type != SOLVER_AZTECOO)
-      {
-        warning("Trying to set iterative method for a different solver than AztecOO.");
-        return;
-      }
-      if (this->matrix_solver_type == SOLVER_AZTECOO)
-        dynamic_cast<Hermes::Solvers::AztecOOSolver<Scalar>*>(linear_solver)->set_solver(iterative_method_name);
-#else
-      warning("Trying to set iterative method without AztecOO present.");
-#endif
+      configure_linear_solver();
     }
 
     template<typename Scalar>
     void NewtonSolver<Scalar>::set_preconditioner(const char* preconditioner_name)
     {
       NonlinearSolver<Scalar>::set_preconditioner(preconditioner_name);
+      configure_linear_solver();
+    }
+
+    template<typename Scalar>
+    void NewtonSolver<Scalar>::configure_linear_solver()
+    {
       // Set iterative method and preconditioner in case of iterative solver AztecOO.
-#ifdef HAVE_AZTECOO
-      if(this->matrix_solver_type != SOLVER_AZTECOO)
-      {
-        warning("Trying to set iterative method for a different solver than AztecOO.");
-        return;
-      }
       if (this->matrix_solver_type == SOLVER_AZTECOO)
-        dynamic_cast<Hermes::Solvers::AztecOOSolver<Scalar> *>(linear_solver)->set_precond(preconditioner_name);
+      {
+#ifdef HAVE_AZTECOO
+        if (this->iterative_method != NULL)
+          dynamic_cast<Hermes::Solvers::AztecOOSolver<Scalar>*>(linear_solver)->set_solver(this->iterative_method);
+        if (this->preconditioner != NULL)
+          dynamic_cast<Hermes::Solvers::AztecOOSolver<Scalar>*>(linear_solver)->set_precond(this->preconditioner);
 #else
-      warning("Trying to set iterative method without AztecOO present.");
+        warning("Trying to set iterative method without AztecOO present.");
 #endif
+      }
+      // The same for the Hermes iterative solver (CG, GMRES, BiCGStab with Jacobi, ILU(0), SSOR or AMG).
+      if (this->matrix_solver_type == SOLVER_HERMES_ITERATIVE)
+      {
+#ifdef WITH_UMFPACK
+        if (this->iterative_method != NULL)
+          static_cast<Hermes::Solvers::IterativeSolver<Scalar>*>(linear_solver)->set_solver(this->iterative_method);
+        if (this->preconditioner != NULL)
+          static_cast<Hermes::Solvers::IterativeSolver<Scalar>*>(linear_solver)->set_precond(this->preconditioner);
+#endif
+      }
     }
 
     template<typename Scalar>
@@ -14,6 +14,8 @@
 // along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "projections/localprojection.h"
+#include "projections/ogprojection.h"
+#include "quadrature/limit_order.h"
 #include "space.h"
 #include "discrete_problem.h"
 
@@ -47,52 +49,249 @@ namespace Hermes
         }
       }
 
+      if (space->get_type() != HERMES_H1_SPACE && space->get_type() != HERMES_L2_SPACE)
+      {
+        OGProjection<Scalar>::project_global(space, meshfn, target_vec, matrix_solver, proj_norm);
+        return;
+      }
+
       // Get dimension of the space.
       int ndof = space->get_num_dofs();
 
       // Erase the target vector. 
       memset(target_vec, 0, ndof*sizeof(Scalar));
+      std::vector<bool> known(ndof, false);
 
-      // Dump into the first part of target_vec the values of active vertex dofs, then add values 
-      // of active edge dofs, and finally also values of active bubble dofs.
-      // Start with active vertex dofs.
+      // The DOFs are indexed from the first DOF of the space (as in the wrappers for several spaces).
       Mesh* mesh = space->get_mesh();
       Element* e;
-      // Go through all active elements in mesh to collect active vertex DOF.
-      for_all_active_elements(e, mesh)
+      std::vector<double> x, y;
+      std::vector<Scalar> values;
+      std::vector<int> dofs;
+
+      // Active vertex DOFs first, they take the values in the vertices.
+      if (space->get_type() == HERMES_H1_SPACE)
       {
-        int order = space->get_element_order(e->id);
-        if (order > 0)
+        for_all_active_elements(e, mesh)
         {
           for (unsigned int j = 0; j < e->get_nvert(); j++)
           {
-            // FIXME - the same vertex is visited several times since it 
-            // belongs to multiple elements!
             Node* vn = e->vn[j];
-            double x = e->vn[j]->x;
-            double y = e->vn[j]->y;
-            //info("Probing vertex %g %g\n", x, y);
             typename Space<Scalar>::NodeData* nd = space->ndata + vn->id;
             if (!vn->is_constrained_vertex() && nd->dof >= 0)
             {
-              int dof_num = nd->dof;
-              // FIXME: If this is a Solution, the it would be MUCH faster to just 
-              // retrieve the value from the coefficient vector stored in the Solution.
-
-              // FIXME: Retrieving the value through get_pt_value() is slow and this 
-              // should be only done if we are dealing with MeshFunction (not a Solution).
-              Scalar val = meshfn->get_pt_value(x, y);
-              //printf("Found active vertex %g %g, val = %g, dof_num = %d\n", x, y, std::abs(val), dof_num);
-              target_vec[dof_num] = val;
+              int index = (nd->dof - space->first_dof) / space->stride;
+              if (known[index])
+                continue;
+              known[index] = true;
+              x.push_back(vn->x);
+              y.push_back(vn->y);
+              dofs.push_back(index);
             }
           }
         }
+        get_pt_values(meshfn, x, y, values);
+        for (unsigned int i = 0; i < dofs.size(); i++)
+          target_vec[dofs[i]] = values[i];
+      }
+
+      RefMap refmap;
+      refmap.set_quad_2d(&g_quad_2d_std);
+
+      // Then the edge DOFs and the bubble DOFs, all points of one kind are evaluated at once.
+      for (int kind = 0; kind < 2; kind++)
+      {
+        if (kind == 0 && space->get_type() != HERMES_H1_SPACE)
+          continue;
+        std::vector<LocalDofs> local;
+        std::vector<bool> visited(space->nsize, false);
+        x.clear();
+        y.clear();
+        for_all_active_elements(e, mesh)
+        {
+          LocalDofs ld;
+          ld.e = e;
+          if (kind == 0)
+          {
+            for (unsigned int j = 0; j < e->get_nvert(); j++)
+            {
+              // Constrained edges (n == -1) are covered by the DOFs of their base edges.
+              Node* en = e->en[j];
+              typename Space<Scalar>::NodeData* nd = space->ndata + en->id;
+              if (visited[en->id] || nd->n <= 0 || nd->dof < 0)
+                continue;
+              visited[en->id] = true;
+              ld.surf = j;
+              ld.first_dof = nd->dof;
+              ld.num_dofs = nd->n;
+              local.push_back(ld);
+            }
+          }
+          else
+          {
+            typename Space<Scalar>::ElementData* ed = space->edata + e->id;
+            if (ed->n <= 0 || ed->bdof < 0)
+              continue;
+            ld.surf = -1;
+            ld.first_dof = ed->bdof;
+            ld.num_dofs = ed->n;
+            local.push_back(ld);
+          }
+        }
+
+        for (unsigned int i = 0; i < local.size(); i++)
+        {
+          int np, order;
+          get_local_points(space, &refmap, local[i], np, order);
+          double* phys_x = refmap.get_phys_x(order);
+          double* phys_y = refmap.get_phys_y(order);
+          local[i].first_point = x.size();
+          local[i].num_points = np;
+          for (int j = 0; j < np; j++)
+          {
+            x.push_back(phys_x[j]);
+            y.push_back(phys_y[j]);
+          }
+        }
+        get_pt_values(meshfn, x, y, values);
+
+        // An edge in a hanging node constraint can only be solved after the edges its vertices depend on,
+        // so the edges are swept until all are solved. Without progress the unknown DOFs are taken as zero.
+        std::vector<bool> solved(local.size(), false);
+        bool force = false;
+        for (unsigned int num_solved = 0; num_solved < local.size(); )
+        {
+          unsigned int num_before = num_solved;
+          for (unsigned int i = 0; i < local.size(); i++)
+            if (!solved[i] && solve_local(space, &refmap, local[i], &values[local[i].first_point], target_vec, known, force))
+            {
+              solved[i] = true;
+              num_solved++;
+            }
+          force = (num_solved == num_before);
+        }
+      }
+    }
+
+    template<typename Scalar>
+    double3* LocalProjection<Scalar>::get_local_points(const Space<Scalar>* space, RefMap* refmap,
+        const LocalDofs& local, int& num_points, int& order)
+    {
+      _F_
+      refmap->set_active_element(local.e);
+      int mode = local.e->get_mode();
+      int element_order = space->get_element_order(local.e->id);
+      order = 2 * std::max(H2D_GET_H_ORDER(element_order), H2D_GET_V_ORDER(element_order));
+      limit_order_nowarn(order, mode);
+
+      Quad2D* quad = refmap->get_quad_2d();
+      if (local.surf >= 0)
+        order = quad->get_edge_points(local.surf, order, mode);
+      num_points = quad->get_num_points(order, mode);
+      return quad->get_points(order, mode);
+    }
+
+    template<typename Scalar>
+    void LocalProjection<Scalar>::get_pt_values(MeshFunction<Scalar>* meshfn, std::vector<double>& x,
+        std::vector<double>& y, std::vector<Scalar>& values)
+    {
+      _F_
+      values.resize(x.size());
+      if (x.empty())
+        return;
+      Solution<Scalar>* sln = dynamic_cast<Solution<Scalar>*>(meshfn);
+      if (sln != NULL)
+        sln->get_pt_values(&x[0], &y[0], x.size(), &values[0]);
+      else
+        for (unsigned int i = 0; i < x.size(); i++)
+          values[i] = meshfn->get_pt_value(x[i], y[i]);
+    }
+
+    template<typename Scalar>
+    bool LocalProjection<Scalar>::solve_local(const Space<Scalar>* space, RefMap* refmap, const LocalDofs& local,
+        const Scalar* values, Scalar* target_vec, std::vector<bool>& known, bool force)
+    {
+      _F_
+      AsmList<Scalar> al;
+      if (local.surf >= 0)
+        space->get_boundary_assembly_list(local.e, local.surf, &al);
+      else
+        space->get_element_assembly_list(local.e, &al);
+
+      // Split the assembly list into the DOFs of the local problem and the rest, which must be known.
+      std::vector<int> own, rest;
+      for (unsigned int k = 0; k < al.cnt; k++)
+      {
+        int offset = al.dof[k] - local.first_dof;
+        if (offset >= 0 && offset < local.num_dofs * space->stride && offset % space->stride == 0)
+          own.push_back(k);
+        else
+        {
+          if (al.dof[k] >= 0 && !known[(al.dof[k] - space->first_dof) / space->stride] && !force)
+            return false;
+          rest.push_back(k);
+        }
+      }
 
-        // TODO: Calculate coefficients of edge functions and copy into target_vec_space[i] as well
+      int np, order;
+      double3* pt = get_local_points(space, refmap, local, np, order);
+      Shapeset* shapeset = space->get_shapeset();
+      shapeset->set_mode(local.e->get_mode());
 
-        // TODO: Calculate coefficients of bubble functions and copy into target_vec_space[i] as well.
+      // The rest of meshfn after the known functions.
+      std::vector<Scalar> residual(values, values + np);
+      for (unsigned int k = 0; k < rest.size(); k++)
+      {
+        int r = rest[k];
+        Scalar coef = al.coef[r];
+        if (al.dof[r] >= 0)
+          coef *= target_vec[(al.dof[r] - space->first_dof) / space->stride];
+        for (int j = 0; j < np; j++)
+          residual[j] -= coef * shapeset->get_fn_value(al.idx[r], pt[j][0], pt[j][1], 0);
+      }
 
+      // L2 projection to the shape functions of the local DOFs.
+      int n = own.size();
+      if (n == 0)
+        return true;
+      double** shape_values = new_matrix<double>(n, np);
+      for (int k = 0; k < n; k++)
+        for (int j = 0; j < np; j++)
+          shape_values[k][j] = shapeset->get_fn_value(al.idx[own[k]], pt[j][0], pt[j][1], 0);
+
+      double** matrix = new_matrix<double>(n, n);
+      Scalar* rhs = new Scalar[n];
+      for (int k = 0; k < n; k++)
+      {
+        for (int l = k; l < n; l++)
+        {
+          double value = 0.0;
+          for (int j = 0; j < np; j++)
+            value += pt[j][2] * shape_values[k][j] * shape_values[l][j];
+          matrix[k][l] = matrix[l][k] = value;
+        }
+        rhs[k] = 0.0;
+        for (int j = 0; j < np; j++)
+          rhs[k] += pt[j][2] * residual[j] * shape_values[k][j];
       }
+
+      double* p = new double[n];
+      choldc(matrix, n, p);
+      cholsl(matrix, n, p, rhs, rhs);
+
+      // The coefficients of the assembly list (e.g. edge orientation) are divided out.
+      for (int k = 0; k < n; k++)
+      {
+        int index = (al.dof[own[k]] - space->first_dof) / space->stride;
+        target_vec[index] = rhs[k] / al.coef[own[k]];
+        known[index] = true;
+      }
+
+      delete [] p;
+      delete [] rhs;
+      delete [] matrix;
+      delete [] shape_values;
+      return true;
     }
 
     template<typename Scalar>
@@ -104,7 +303,7 @@ namespace Hermes
       int ndof = space->get_num_dofs();
       Scalar* coeff_vec = new Scalar[ndof];
       project_local(space, source_sln, coeff_vec, matrix_solver, proj_norm);
-      Solution<Scalar>::vector_to_solution(coeff_vec, space, target_sln, proj_norm);
+      Solution<Scalar>::vector_to_solution(coeff_vec, space, target_sln);
       delete [] coeff_vec;
     }
 
@@ -1,3 +1,4 @@
+#include <typeinfo>
 #include "hermes2d_common_defs.h"
 #include "matrix.h"
 #include "solution.h"
@@ -20,6 +21,17 @@ namespace Hermes
       H1ProjBasedSelector<Scalar>::H1ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, H1Shapeset* user_shapeset)
         : ProjBasedSelector<Scalar>(cand_list, conv_exp, max_order, user_shapeset == NULL ? &default_shapeset : user_shapeset, typename OptimumSelector<Scalar>::Range(1, 1), typename OptimumSelector<Scalar>::Range(2, H2DRS_MAX_H1_ORDER)) {}
 
+      template<typename Scalar>
+      Selector<Scalar>* H1ProjBasedSelector<Scalar>::clone()
+      {
+        // A derived class may select differently.
+        if (typeid(*this) != typeid(H1ProjBasedSelector<Scalar>))
+          return NULL;
+        H1ProjBasedSelector<Scalar>* copy = new H1ProjBasedSelector<Scalar>(this->cand_list, this->conv_exp, this->max_order, static_cast<H1Shapeset*>(this->shapeset));
+        this->copy_settings(copy);
+        return copy;
+      }
+
       template<typename Scalar>
       void H1ProjBasedSelector<Scalar>::set_current_order_range(Element* element)
       {
@@ -47,28 +59,34 @@ namespace Hermes
           //allocate
           trf_svals.resize(max_shape_inx + 1);
 
-          //for all shapes
+          //transform coordinates of all GIP points
+          std::vector<double> ref_x(num_gip_points), ref_y(num_gip_points);
+          for(int k = 0; k < num_gip_points; k++)
+          {
+            ref_x[k] = gip_points[k][H2D_GIP2D_X] * trf.m[0] + trf.t[0];
+            ref_y[k] = gip_points[k][H2D_GIP2D_Y] * trf.m[1] + trf.t[1];
+          }
+
+          //for all shapes: allocate
           const int num_shapes = (int)shapes.size();
+          std::vector<int> inx_shapes(num_shapes);
+          std::vector<double*> values(num_shapes), dx_values(num_shapes), dy_values(num_shapes);
           for(int i = 0; i < num_shapes; i++)
           {
-            int inx_shape = shapes[i].inx;
-            typename ProjBasedSelector<Scalar>::TrfShapeExp& shape_exp = trf_svals[inx_shape];
-
-            //allocate
+            inx_shapes[i] = shapes[i].inx;
+            typename ProjBasedSelector<Scalar>::TrfShapeExp& shape_exp = trf_svals[inx_shapes[i]];
             shape_exp.allocate(H2D_H1FE_NUM, num_gip_points);
+            values[i] = shape_exp[H2D_H1FE_VALUE];
+            dx_values[i] = shape_exp[H2D_H1FE_DX];
+            dy_values[i] = shape_exp[H2D_H1FE_DY];
+          }
 
-            //for all GIP points
-            for(int k = 0; k < num_gip_points; k++)
-            {
-              //transform coordinates
-              double ref_x = gip_points[k][H2D_GIP2D_X] * trf.m[0] + trf.t[0];
-              double ref_y = gip_points[k][H2D_GIP2D_Y] * trf.m[1] + trf.t[1];
-
-              //for all expansions: retrieve values
-              shape_exp[H2D_H1FE_VALUE][k] = this->shapeset->get_fn_value(inx_shape, ref_x, ref_y, 0);
-              shape_exp[H2D_H1FE_DX][k] = this->shapeset->get_dx_value(inx_shape, ref_x, ref_y, 0);
-              shape_exp[H2D_H1FE_DY][k] = this->shapeset->get_dy_value(inx_shape, ref_x, ref_y, 0);
-            }
+          //for all expansions: retrieve values of all shapes at once
+          if (num_shapes > 0 && num_gip_points > 0)
+          {
+            this->shapeset->get_values(0, num_shapes, &inx_shapes[0], num_gip_points, &ref_x[0], &ref_y[0], 0, &values[0]);
+            this->shapeset->get_values(1, num_shapes, &inx_shapes[0], num_gip_points, &ref_x[0], &ref_y[0], 0, &dx_values[0]);
+            this->shapeset->get_values(2, num_shapes, &inx_shapes[0], num_gip_points, &ref_x[0], &ref_y[0], 0, &dy_values[0]);
           }
 
           //move to the next transformation
@@ -1,3 +1,4 @@
+#include <typeinfo>
 #include "hermes2d_common_defs.h"
 #include "matrix.h"
 #include "solution.h"
@@ -23,6 +24,16 @@ namespace Hermes
         delete[] precalc_rvals_curl;
       }
 
+      Selector<std::complex<double> >* HcurlProjBasedSelector::clone()
+      {
+        // A derived class may select differently.
+        if (typeid(*this) != typeid(HcurlProjBasedSelector))
+          return NULL;
+        HcurlProjBasedSelector* copy = new HcurlProjBasedSelector(cand_list, conv_exp, max_order, static_cast<HcurlShapeset*>(shapeset));
+        copy_settings(copy);
+        return copy;
+      }
+
       void HcurlProjBasedSelector::set_current_order_range(Element* element)
       {
         current_max_order = this->max_order;
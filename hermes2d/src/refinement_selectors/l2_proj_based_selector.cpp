@@ -1,3 +1,4 @@
+#include <typeinfo>
 #include "hermes2d_common_defs.h"
 #include "matrix.h"
 #include "solution.h"
@@ -21,6 +22,17 @@ namespace Hermes
       L2ProjBasedSelector<Scalar>::L2ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, L2Shapeset* user_shapeset)
         : ProjBasedSelector<Scalar>(cand_list, conv_exp, max_order, user_shapeset == NULL ? &default_shapeset : user_shapeset, typename OptimumSelector<Scalar>::Range(1, 1), typename OptimumSelector<Scalar>::Range(0, H2DRS_MAX_L2_ORDER)) {}
 
+      template<typename Scalar>
+      Selector<Scalar>* L2ProjBasedSelector<Scalar>::clone()
+      {
+        // A derived class may select differently.
+        if (typeid(*this) != typeid(L2ProjBasedSelector<Scalar>))
+          return NULL;
+        L2ProjBasedSelector<Scalar>* copy = new L2ProjBasedSelector<Scalar>(this->cand_list, this->conv_exp, this->max_order, static_cast<L2Shapeset*>(this->shapeset));
+        this->copy_settings(copy);
+        return copy;
+      }
+
       template<typename Scalar>
       void L2ProjBasedSelector<Scalar>::set_current_order_range(Element* element)
       {
@@ -689,6 +689,10 @@ namespace Hermes
         case H2D_APPLY_CONV_EXP_DOF: opt_apply_exp_dof = enable; break;
         default: error("Unknown option %d.", (int)option);
         }
+
+        // Selectors of other threads are clones of the same type.
+        for (unsigned int i = 0; i < this->thread_selectors.size(); i++)
+          static_cast<OptimumSelector<Scalar>*>(this->thread_selectors[i])->set_option(option, enable);
       }
       
       template<typename Scalar>
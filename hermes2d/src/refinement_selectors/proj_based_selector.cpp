@@ -60,6 +60,19 @@ namespace Hermes
         error_weight_h = weight_h;
         error_weight_p = weight_p;
         error_weight_aniso = weight_aniso;
+        for (unsigned int i = 0; i < this->thread_selectors.size(); i++)
+          static_cast<ProjBasedSelector<Scalar>*>(this->thread_selectors[i])->set_error_weights(weight_h, weight_p, weight_aniso);
+      }
+
+      template<typename Scalar>
+      void ProjBasedSelector<Scalar>::copy_settings(ProjBasedSelector<Scalar>* copy) const
+      {
+        copy->opt_symmetric_mesh = this->opt_symmetric_mesh;
+        copy->opt_apply_exp_dof = this->opt_apply_exp_dof;
+        copy->error_weight_h = error_weight_h;
+        copy->error_weight_p = error_weight_p;
+        copy->error_weight_aniso = error_weight_aniso;
+        copy->warn_uniform_orders = warn_uniform_orders;
       }
 
       template<typename Scalar>
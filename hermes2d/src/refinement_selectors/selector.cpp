@@ -1,3 +1,4 @@
+#include <typeinfo>
 #include "hermes2d_common_defs.h"
 #include "solution.h"
 #include "element_to_refine.h"
@@ -8,6 +9,42 @@ namespace Hermes
   {
     namespace RefinementSelectors
     {
+      template<typename Scalar>
+      Selector<Scalar>::~Selector()
+      {
+        for (unsigned int i = 0; i < thread_selectors.size(); i++)
+          delete thread_selectors[i];
+      }
+
+      template<typename Scalar>
+      Selector<Scalar>* Selector<Scalar>::clone()
+      {
+        return NULL;
+      }
+
+      template<typename Scalar>
+      Selector<Scalar>* Selector<Scalar>::get_thread_selector(int thread)
+      {
+        if (thread == 0)
+          return this;
+        while ((int)thread_selectors.size() < thread)
+        {
+          Selector<Scalar>* copy = clone();
+          if (copy == NULL)
+            return NULL;
+          thread_selectors.push_back(copy);
+        }
+        return thread_selectors[thread - 1];
+      }
+
+      template<typename Scalar>
+      Selector<Scalar>* HOnlySelector<Scalar>::clone()
+      {
+        // A derived class may select differently.
+        if (typeid(*this) != typeid(HOnlySelector<Scalar>))
+          return NULL;
+        return new HOnlySelector<Scalar>(*this);
+      }
 
       template<typename Scalar>
       bool HOnlySelector<Scalar>::select_refinement(Element* element, int quad_order, Solution<Scalar>* rsln, ElementToRefine& refinement)
@@ -37,6 +74,14 @@ namespace Hermes
         error_if(order_v_inc >= 0, "Vertical increase has to be greater or equal to zero.");
       }
 
+      template<typename Scalar>
+      Selector<Scalar>* POnlySelector<Scalar>::clone()
+      {
+        if (typeid(*this) != typeid(POnlySelector<Scalar>))
+          return NULL;
+        return new POnlySelector<Scalar>(*this);
+      }
+
       template<typename Scalar>
       bool POnlySelector<Scalar>::select_refinement(Element* element, int quad_order, Solution<Scalar>* rsln, ElementToRefine& refinement)
       {
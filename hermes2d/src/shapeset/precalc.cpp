@@ -17,10 +17,127 @@
 #include "quad_all.h"
 #include "precalc.h"
 #include "mesh.h"
+#include <list>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
 namespace Hermes
 {
   namespace Hermes2D
   {
+    /// Process-wide cache of the reference tables of shape functions, see PrecalcShapeset::precalculate().
+    /// It is not used inside parallel regions, so it needs no locking. A zero limit disables the cache.
+    struct SharedTables
+    {
+      struct Key
+      {
+        int shapeset_id, mode, index, order;
+        uint64_t sub_idx;
+
+        bool operator<(const Key& other) const
+        {
+          if (shapeset_id != other.shapeset_id) return shapeset_id < other.shapeset_id;
+          if (mode != other.mode) return mode < other.mode;
+          if (index != other.index) return index < other.index;
+          if (order != other.order) return order < other.order;
+          return sub_idx < other.sub_idx;
+        }
+      };
+
+      struct Entry
+      {
+        /// Tables present, a combination of H2D_FN_XXX.
+        int mask;
+        std::vector<double> values[2][6];
+        size_t bytes;
+        /// Position in lru.
+        std::list<Key>::iterator lru_pos;
+      };
+
+      std::map<Key, Entry> entries;
+
+      /// Keys of all the entries, most recently used first.
+      std::list<Key> lru;
+
+      /// Memory taken by the tables of all the entries.
+      size_t lru_bytes;
+      size_t max_lru_bytes;
+
+      unsigned int hits, misses;
+
+      SharedTables() : lru_bytes(0), max_lru_bytes(32 << 20), hits(0), misses(0) {}
+
+      /// The same as Function::idx2mask[k][j].
+      static int table_mask(int k, int j) { return 1 << (k + 6 * j); }
+
+      /// Copies the tables 'mask' of 'key' into values (of a Node), returns false if any of them is missing.
+      bool fetch(const Key& key, int mask, int num_components, int np, double* (*values)[6])
+      {
+        if (max_lru_bytes == 0)
+          return false;
+        std::map<Key, Entry>::iterator it = entries.find(key);
+        if (it == entries.end() || (it->second.mask & mask) != mask)
+        {
+          misses++;
+          return false;
+        }
+        for (int j = 0; j < num_components; j++)
+          for (int k = 0; k < 6; k++)
+            if (mask & table_mask(k, j))
+              memcpy(values[j][k], &it->second.values[j][k][0], np * sizeof(double));
+        lru.splice(lru.begin(), lru, it->second.lru_pos);
+        hits++;
+        return true;
+      }
+
+      /// Adds the tables 'mask' of values (of a Node) to the entry of key.
+      void store(const Key& key, int mask, int num_components, int np, double* (*values)[6])
+      {
+        if (max_lru_bytes == 0)
+          return;
+        std::pair<std::map<Key, Entry>::iterator, bool> ins = entries.insert(std::make_pair(key, Entry()));
+        Entry& entry = ins.first->second;
+        if (ins.second)
+        {
+          entry.mask = 0;
+          entry.bytes = 0;
+          lru.push_front(key);
+          entry.lru_pos = lru.begin();
+        }
+        else
+          lru.splice(lru.begin(), lru, entry.lru_pos);
+
+        for (int j = 0; j < num_components; j++)
+          for (int k = 0; k < 6; k++)
+            if ((mask & table_mask(k, j)) && !(entry.mask & table_mask(k, j)))
+            {
+              entry.values[j][k].assign(values[j][k], values[j][k] + np);
+              entry.bytes += np * sizeof(double);
+              lru_bytes += np * sizeof(double);
+            }
+        entry.mask |= mask;
+
+        // Drop the least recently used entries, never the one just stored. The tables of the elements
+        // themselves and of their sons are used all the time, so they stay near the front.
+        while (lru_bytes > max_lru_bytes && lru.size() > 1)
+        {
+          std::map<Key, Entry>::iterator victim = entries.find(lru.back());
+          lru_bytes -= victim->second.bytes;
+          entries.erase(victim);
+          lru.pop_back();
+        }
+      }
+
+      void free()
+      {
+        entries.clear();
+        lru.clear();
+        lru_bytes = 0;
+      }
+    };
+
+    static SharedTables shared_tables;
+
     PrecalcShapeset::PrecalcShapeset(Shapeset* shapeset) : Function<double>()
     {
       assert_msg(shapeset != NULL, "Shapeset cannot be NULL.");
@@ -82,13 +199,13 @@ namespace Hermes
       if(master_pss == NULL)
       {
         if(!tables.present(key))
-          tables.add(new std::map<uint64_t, LightArray<Node*>*>, key);
+          tables.add(new FlatHashMap<uint64_t, LightArray<Node*>*>, key);
         sub_tables = tables.get(key);
       }
       else
       {
         if(!master_pss->tables.present(key))
-          master_pss->tables.add(new std::map<uint64_t, LightArray<Node*>*>, key);
+          master_pss->tables.add(new FlatHashMap<uint64_t, LightArray<Node*>*>, key);
         sub_tables = master_pss->tables.get(key);
       }
 
@@ -120,6 +237,7 @@ namespace Hermes
 
     void PrecalcShapeset::precalculate(int order, int mask)
     {
+      HERMES_PROFILE("precalculation");
       int i, j, k;
 
       // initialization
@@ -133,22 +251,46 @@ namespace Hermes
       int newmask = mask | oldmask;
       Node* node = new_node(newmask, np);
 
-      // precalculate all required tables
+      // tables already present in this instance
       for (j = 0; j < num_components; j++)
-      {
         for (k = 0; k < 6; k++)
+          if (oldmask & idx2mask[k][j])
+            memcpy(node->values[j][k], cur_node->values[j][k], np * sizeof(double));
+
+      // the rest is taken from the shared cache or calculated
+      int missing = newmask & ~oldmask;
+      bool shared = (quad == &g_quad_2d_std && sub_idx <= H2D_MAX_IDX);
+#ifdef WITH_OPENMP
+      // The threads of a parallel assembling do not wait for each other on the cache, they calculate
+      // the tables of their own instances, which persist between the assemblings.
+      shared = shared && !omp_in_parallel();
+#endif
+      SharedTables::Key key = { shapeset->get_id(), mode, index, order, sub_idx };
+      bool found = false;
+      if (shared)
+        found = shared_tables.fetch(key, missing, num_components, np, node->values);
+
+      if (!found)
+      {
+        // points transformed to the sub-element, shared by all the tables
+        double* x = new double[2 * np];
+        double* y = x + np;
+        for (i = 0; i < np; i++)
         {
-          if (newmask & idx2mask[k][j])
-          {
-            if (oldmask & idx2mask[k][j])
-              memcpy(node->values[j][k], cur_node->values[j][k], np * sizeof(double));
-            else
-              for (i = 0; i < np; i++)
-                node->values[j][k][i] = shapeset->get_value(k, index, ctm->m[0] * pt[i][0] + ctm->t[0],
-                ctm->m[1] * pt[i][1] + ctm->t[1], j);
-          }
+          x[i] = ctm->m[0] * pt[i][0] + ctm->t[0];
+          y[i] = ctm->m[1] * pt[i][1] + ctm->t[1];
         }
+
+        for (j = 0; j < num_components; j++)
+          for (k = 0; k < 6; k++)
+            if (missing & idx2mask[k][j])
+              shapeset->get_values(k, index, np, x, y, j, node->values[j][k]);
+        delete [] x;
+
+        if (shared)
+          shared_tables.store(key, missing, num_components, np, node->values);
       }
+
       if(nodes->present(order))
       {
         assert(nodes->get(order) == cur_node);
@@ -166,7 +308,7 @@ namespace Hermes
       for(unsigned int i = 0; i < tables.get_size(); i++)
         if(tables.present(i))
         {
-          for(std::map<uint64_t, LightArray<Node*>*>::iterator it = tables.get(i)->begin(); it != tables.get(i)->end(); it++)
+          for(FlatHashMap<uint64_t, LightArray<Node*>*>::iterator it = tables.get(i)->begin(); it != tables.get(i)->end(); it++)
           {
             for(unsigned int k = 0; k < it->second->get_size(); k++)
               if(it->second->present(k))
@@ -185,7 +327,27 @@ namespace Hermes
         }
     }
 
-    extern PrecalcShapeset ref_map_pss;
+    void PrecalcShapeset::set_shared_tables_limit(size_t max_bytes)
+    {
+      shared_tables.max_lru_bytes = max_bytes;
+      if (max_bytes == 0)
+        shared_tables.free();
+    }
+
+    void PrecalcShapeset::free_shared_tables()
+    {
+      shared_tables.free();
+    }
+
+    unsigned int PrecalcShapeset::get_shared_tables_hits()
+    {
+      return shared_tables.hits;
+    }
+
+    unsigned int PrecalcShapeset::get_shared_tables_misses()
+    {
+      return shared_tables.misses;
+    }
 
     PrecalcShapeset::~PrecalcShapeset()
     {
@@ -16,6 +16,7 @@
 #include "hermes2d_common_defs.h"
 #include "shapeset.h"
 #include "matrix.h"
+#include <vector>
 
 using namespace Hermes::Algebra::DenseMatrixOperations;
 
@@ -101,36 +102,44 @@ namespace Hermes
     double* Shapeset::get_constrained_edge_combination(int order, int part, int ori, int& nitems)
     {
       int index = 2*((max_order + 1 - ebias)*part + (order - ebias)) + ori;
+      double* combination;
 
-      // allocate/reallocate the array if necessary
-      if (comb_table == NULL)
+      // The table is filled lazily and shared by all threads assembling with this shapeset.
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_shapeset_comb_table)
+#endif
       {
-        table_size = 1024;
-        while (table_size <= index) table_size *= 2;
-        comb_table = (double**) malloc(table_size * sizeof(double*));
-        memset(comb_table, 0, table_size * sizeof(double*));
-      }
-      else if (index >= table_size)
-      {
-        // adjust table_size to accommodate the required depth
-        int old_size = table_size;
-        while (index >= table_size) table_size *= 2;
-
-        // reallocate the table
-        verbose("Shapeset::get_constrained_edge_combination(): realloc to table_size = %d", table_size);
-        comb_table = (double**) realloc(comb_table, table_size * sizeof(double*));
-        memset(comb_table + old_size, 0, (table_size - old_size) * sizeof(double*));
-      }
+        // allocate/reallocate the array if necessary
+        if (comb_table == NULL)
+        {
+          table_size = 1024;
+          while (table_size <= index) table_size *= 2;
+          comb_table = (double**) malloc(table_size * sizeof(double*));
+          memset(comb_table, 0, table_size * sizeof(double*));
+        }
+        else if (index >= table_size)
+        {
+          // adjust table_size to accommodate the required depth
+          int old_size = table_size;
+          while (index >= table_size) table_size *= 2;
+
+          // reallocate the table
+          verbose("Shapeset::get_constrained_edge_combination(): realloc to table_size = %d", table_size);
+          comb_table = (double**) realloc(comb_table, table_size * sizeof(double*));
+          memset(comb_table + old_size, 0, (table_size - old_size) * sizeof(double*));
+        }
 
-      // do we have the required linear combination yet?
-      if (comb_table[index] == NULL)
-      {
-        // no, calculate it
-        comb_table[index] = calculate_constrained_edge_combination(order, part, ori);
+        // do we have the required linear combination yet?
+        if (comb_table[index] == NULL)
+        {
+          // no, calculate it
+          comb_table[index] = calculate_constrained_edge_combination(order, part, ori);
+        }
+        combination = comb_table[index];
       }
 
       nitems = order + 1 - ebias;
-      return comb_table[index];
+      return combination;
     }
 
     void Shapeset::free_constrained_edge_combinations()
@@ -166,6 +175,42 @@ namespace Hermes
       return sum;
     }
 
+    void Shapeset::get_constrained_values(int n, int index, int np, const double* x, const double* y, int component, double* result)
+    {
+      index = -1 - index;
+
+      int part = (unsigned) index >> 7;
+      int order = (index >> 3) & 15;
+      int edge = (index >> 1) & 3;
+      int ori = index & 1;
+
+      int i, j, nc;
+      double* comb = get_constrained_edge_combination(order, part, ori, nc);
+
+      memset(result, 0, np * sizeof(double));
+      if (nc <= 0 || np <= 0)
+        return;
+
+      std::vector<int> edge_indices(nc);
+      std::vector<double> values(nc * np);
+      std::vector<double*> edge_values(nc);
+      for (i = 0; i < nc; i++)
+      {
+        edge_indices[i] = get_edge_index(edge, ori, i + ebias);
+        edge_values[i] = &values[i * np];
+      }
+      get_values(n, nc, &edge_indices[0], np, x, y, component, &edge_values[0]);
+
+      for (i = 0; i < nc; i++)
+        for (j = 0; j < np; j++)
+          result[j] += comb[i] * edge_values[i][j];
+    }
+
+    Shapeset::Shapeset()
+    {
+      tensor_factors[0] = tensor_factors[1] = NULL;
+    }
+
     Shapeset::~Shapeset() { free_constrained_edge_combinations(); }
 
     /// Selects HERMES_MODE_TRIANGLE or HERMES_MODE_QUAD.
@@ -277,6 +322,147 @@ namespace Hermes
         return get_constrained_value(n, index, x, y, component);
     }
 
+    // The Legendre polynomials (and their derivatives) are obtained by the three-term recurrences
+    // with the loops over the points innermost, so that the compiler can vectorize them.
+    void Shapeset::get_lobatto_values(int max_k, int der, int np, const double* x, double* out)
+    {
+      int i, k;
+      std::vector<double> legendre((max_k + 1) * np);
+      double* L = &legendre[0];
+      for (i = 0; i < np; i++)
+        L[i] = 1.0;
+      if (max_k >= 1)
+        for (i = 0; i < np; i++)
+          L[np + i] = x[i];
+      for (k = 1; k < max_k; k++)
+      {
+        double a = (2.0 * k + 1.0) / (k + 1.0), b = (double) k / (k + 1.0);
+        const double* L_k = L + k * np;
+        const double* L_km1 = L + (k - 1) * np;
+        double* L_kp1 = L + (k + 1) * np;
+        for (i = 0; i < np; i++)
+          L_kp1[i] = a * x[i] * L_k[i] - b * L_km1[i];
+      }
+
+      // Derivatives of the Legendre polynomials, L'_(k + 1) = L'_(k - 1) + (2k + 1) L_k.
+      std::vector<double> d_legendre;
+      if (der == 2)
+      {
+        d_legendre.resize((max_k + 1) * np, 0.0);
+        double* dL = &d_legendre[0];
+        if (max_k >= 1)
+          for (i = 0; i < np; i++)
+            dL[np + i] = 1.0;
+        for (k = 1; k < max_k; k++)
+        {
+          const double* L_k = L + k * np;
+          const double* dL_km1 = dL + (k - 1) * np;
+          double* dL_kp1 = dL + (k + 1) * np;
+          for (i = 0; i < np; i++)
+            dL_kp1[i] = dL_km1[i] + (2.0 * k + 1.0) * L_k[i];
+        }
+      }
+
+      for (k = 0; k <= max_k; k++)
+      {
+        double* o = out + k * np;
+        if (k <= 1)
+        {
+          // l_0 = (1 - x) / 2, l_1 = (1 + x) / 2.
+          double s = (k == 0) ? -0.5 : 0.5;
+          for (i = 0; i < np; i++)
+            o[i] = (der == 0) ? 0.5 + s * x[i] : (der == 1) ? s : 0.0;
+        }
+        else if (der == 0)
+        {
+          // l_k = (L_k - L_(k - 2)) / sqrt(2 (2k - 1)).
+          double c = 1.0 / sqrt(2.0 * (2.0 * k - 1.0));
+          const double* L_k = L + k * np;
+          const double* L_km2 = L + (k - 2) * np;
+          for (i = 0; i < np; i++)
+            o[i] = c * (L_k[i] - L_km2[i]);
+        }
+        else
+        {
+          // l_k' = sqrt((2k - 1) / 2) L_(k - 1).
+          double c = sqrt((2.0 * k - 1.0) / 2.0);
+          const double* src = ((der == 1) ? L : &d_legendre[0]) + (k - 1) * np;
+          for (i = 0; i < np; i++)
+            o[i] = c * src[i];
+        }
+      }
+    }
+
+    void Shapeset::get_tensor_values(int n, int num_indices, const int* indices, int np, const double* x, const double* y, double** result)
+    {
+      // Orders of the derivatives in x and y for the function expansions (see FunctionExpansionIndex).
+      static const int der_x[6] = { 0, 1, 0, 2, 0, 1 };
+      static const int der_y[6] = { 0, 0, 1, 0, 2, 1 };
+
+      if (np <= 0 || num_indices <= 0)
+        return;
+
+      int (*factors)[3] = tensor_factors[mode];
+      int i, j, max_i = 0, max_j = 0;
+      for (i = 0; i < num_indices; i++)
+      {
+        assert(indices[i] >= 0 && indices[i] <= max_index[mode]);
+        max_i = std::max(max_i, factors[indices[i]][0]);
+        max_j = std::max(max_j, factors[indices[i]][1]);
+      }
+
+      std::vector<double> fx((max_i + 1) * np), fy((max_j + 1) * np);
+      get_lobatto_values(max_i, der_x[n], np, x, &fx[0]);
+      get_lobatto_values(max_j, der_y[n], np, y, &fy[0]);
+
+      for (i = 0; i < num_indices; i++)
+      {
+        const double* a = &fx[factors[indices[i]][0] * np];
+        const double* b = &fy[factors[indices[i]][1] * np];
+        double sign = factors[indices[i]][2];
+        double* r = result[i];
+        for (j = 0; j < np; j++)
+          r[j] = sign * a[j] * b[j];
+      }
+    }
+
+    void Shapeset::get_values(int n, int index, int np, const double* x, const double* y, int component, double* result)
+    {
+      if (index < 0)
+      {
+        get_constrained_values(n, index, np, x, y, component, result);
+        return;
+      }
+
+      assert(index <= max_index[mode]); assert(component >= 0 && component < num_components);
+      Shapeset::shape_fn_t** shape_expansion = shape_table[n][mode];
+      if (shape_expansion == NULL)
+      {
+        // Undefined expansion, get_value() warns and returns zeros.
+        for (int i = 0; i < np; i++)
+          result[i] = get_value(n, index, x[i], y[i], component);
+        return;
+      }
+
+      shape_fn_t fn = shape_expansion[component][index];
+      for (int i = 0; i < np; i++)
+        result[i] = fn(x[i], y[i]);
+    }
+
+    void Shapeset::get_values(int n, int num_indices, const int* indices, int np, const double* x, const double* y, int component, double** result)
+    {
+      bool tensor = (tensor_factors[mode] != NULL && shape_table[n][mode] != NULL);
+      for (int i = 0; i < num_indices && tensor; i++)
+        if (indices[i] < 0)
+          tensor = false;
+
+      if (tensor)
+        get_tensor_values(n, num_indices, indices, np, x, y, result);
+      else
+        for (int i = 0; i < num_indices; i++)
+          get_values(n, indices[i], np, x, y, component, result[i]);
+    }
+
     double Shapeset::get_fn_value (int index, double x, double y, int component)  { return get_value(0, index, x, y, component); }
     double Shapeset::get_dx_value (int index, double x, double y, int component)  { return get_value(1, index, x, y, component); }
     double Shapeset::get_dy_value (int index, double x, double y, int component)  { return get_value(2, index, x, y, component); }
@@ -4239,6 +4239,7 @@ namespace Hermes
       bubble_indices = jacobi_bubble_indices;
       bubble_count = jacobi_bubble_count;
       index_to_order = jacobi_index_to_order;
+      tensor_factors[HERMES_MODE_QUAD] = simple_quad_tensor_factors;
 
       ref_vert[0][0][0] = -1.0;
       ref_vert[0][0][1] = -1.0;
@@ -17013,6 +17013,7 @@ namespace Hermes
       bubble_indices = ortho2_bubble_indices;
       bubble_count = ortho2_bubble_count;
       index_to_order = ortho2_index_to_order;
+      tensor_factors[HERMES_MODE_QUAD] = simple_quad_tensor_factors;
 
       ref_vert[0][0][0] = -1.0;
       ref_vert[0][0][1] = -1.0;
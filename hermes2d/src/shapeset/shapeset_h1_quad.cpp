@@ -4476,5 +4476,39 @@ namespace Hermes
       XX(9, 1),   XX(9, 1),   oo(9, 2),   oo(9, 3),   oo(9, 4),   oo(9, 5),   oo(9, 6),   oo(9, 7),   oo(9, 8),   oo(9, 9),   oo(9, 10),
       oo(10, 1),  oo(10, 1),  oo(10, 2),  oo(10, 3),  oo(10, 4),  oo(10, 5),  oo(10, 6),  oo(10, 7),  oo(10, 8),  oo(10, 9),  oo(10, 10),
     };
+
+
+    /// The functions above as products sign * l_i(x) * l_j(y), { i, j, sign } for each index.
+    int simple_quad_tensor_factors[][3] =
+    {
+      {  0,  0,  1 }, {  0,  1,  1 }, {  0,  2,  1 }, {  0,  3, -1 }, {  0,  3,  1 },
+      {  0,  4,  1 }, {  0,  5, -1 }, {  0,  5,  1 }, {  0,  6,  1 }, {  0,  7, -1 },
+      {  0,  7,  1 }, {  0,  8,  1 }, {  0,  9, -1 }, {  0,  9,  1 }, {  0, 10,  1 },
+      {  1,  0,  1 }, {  1,  1,  1 }, {  1,  2,  1 }, {  1,  3,  1 }, {  1,  3, -1 },
+      {  1,  4,  1 }, {  1,  5,  1 }, {  1,  5, -1 }, {  1,  6,  1 }, {  1,  7,  1 },
+      {  1,  7, -1 }, {  1,  8,  1 }, {  1,  9,  1 }, {  1,  9, -1 }, {  1, 10,  1 },
+      {  2,  0,  1 }, {  2,  1,  1 }, {  2,  2,  1 }, {  2,  3,  1 }, {  2,  4,  1 },
+      {  2,  5,  1 }, {  2,  6,  1 }, {  2,  7,  1 }, {  2,  8,  1 }, {  2,  9,  1 },
+      {  2, 10,  1 }, {  3,  0,  1 }, {  3,  0, -1 }, {  3,  1, -1 }, {  3,  1,  1 },
+      {  3,  2,  1 }, {  3,  3,  1 }, {  3,  4,  1 }, {  3,  5,  1 }, {  3,  6,  1 },
+      {  3,  7,  1 }, {  3,  8,  1 }, {  3,  9,  1 }, {  3, 10,  1 }, {  4,  0,  1 },
+      {  4,  1,  1 }, {  4,  2,  1 }, {  4,  3,  1 }, {  4,  4,  1 }, {  4,  5,  1 },
+      {  4,  6,  1 }, {  4,  7,  1 }, {  4,  8,  1 }, {  4,  9,  1 }, {  4, 10,  1 },
+      {  5,  0,  1 }, {  5,  0, -1 }, {  5,  1, -1 }, {  5,  1,  1 }, {  5,  2,  1 },
+      {  5,  3,  1 }, {  5,  4,  1 }, {  5,  5,  1 }, {  5,  6,  1 }, {  5,  7,  1 },
+      {  5,  8,  1 }, {  5,  9,  1 }, {  5, 10,  1 }, {  6,  0,  1 }, {  6,  1,  1 },
+      {  6,  2,  1 }, {  6,  3,  1 }, {  6,  4,  1 }, {  6,  5,  1 }, {  6,  6,  1 },
+      {  6,  7,  1 }, {  6,  8,  1 }, {  6,  9,  1 }, {  6, 10,  1 }, {  7,  0,  1 },
+      {  7,  0, -1 }, {  7,  1, -1 }, {  7,  1,  1 }, {  7,  2,  1 }, {  7,  3,  1 },
+      {  7,  4,  1 }, {  7,  5,  1 }, {  7,  6,  1 }, {  7,  7,  1 }, {  7,  8,  1 },
+      {  7,  9,  1 }, {  7, 10,  1 }, {  8,  0,  1 }, {  8,  1,  1 }, {  8,  2,  1 },
+      {  8,  3,  1 }, {  8,  4,  1 }, {  8,  5,  1 }, {  8,  6,  1 }, {  8,  7,  1 },
+      {  8,  8,  1 }, {  8,  9,  1 }, {  8, 10,  1 }, {  9,  0,  1 }, {  9,  0, -1 },
+      {  9,  1, -1 }, {  9,  1,  1 }, {  9,  2,  1 }, {  9,  3,  1 }, {  9,  4,  1 },
+      {  9,  5,  1 }, {  9,  6,  1 }, {  9,  7,  1 }, {  9,  8,  1 }, {  9,  9,  1 },
+      {  9, 10,  1 }, { 10,  0,  1 }, { 10,  1,  1 }, { 10,  2,  1 }, { 10,  3,  1 },
+      { 10,  4,  1 }, { 10,  5,  1 }, { 10,  6,  1 }, { 10,  7,  1 }, { 10,  8,  1 },
+      { 10,  9,  1 }, { 10, 10,  1 },
+    };
   }
 }
\ No newline at end of file
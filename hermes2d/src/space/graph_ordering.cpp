@@ -0,0 +1,225 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "graph_ordering.h"
+#include <algorithm>
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    GraphOrdering::GraphOrdering(int n, const int* adj_ptr, const int* adj)
+      : n(n), adj_ptr(adj_ptr), adj(adj), mark(n, 0), stamp(0)
+    {
+    }
+
+    int GraphOrdering::level_structure(int root, const std::vector<int>& part, int p, std::vector<int>& order, std::vector<int>& level_ptr) const
+    {
+      stamp++;
+      order.clear();
+      level_ptr.clear();
+
+      order.push_back(root);
+      mark[root] = stamp;
+      level_ptr.push_back(0);
+
+      int begin = 0;
+      while (true)
+      {
+        int end = order.size();
+        for (int i = begin; i < end; i++)
+        {
+          int v = order[i];
+          for (int k = adj_ptr[v]; k < adj_ptr[v + 1]; k++)
+          {
+            int w = adj[k];
+            if (part[w] == p && mark[w] != stamp)
+            {
+              mark[w] = stamp;
+              order.push_back(w);
+            }
+          }
+        }
+        level_ptr.push_back(end);
+        if ((int) order.size() == end)
+          break;
+        begin = end;
+      }
+      return level_ptr.size() - 1;
+    }
+
+    int GraphOrdering::pseudo_peripheral(int start, const std::vector<int>& part, int p, std::vector<int>& order, std::vector<int>& level_ptr) const
+    {
+      int root = start;
+      int num_levels = level_structure(root, part, p, order, level_ptr);
+
+      std::vector<int> order_cand, level_ptr_cand;
+      while (true)
+      {
+        // The vertex of minimal degree in the last level.
+        int cand = -1;
+        for (int i = level_ptr[num_levels - 1]; i < level_ptr[num_levels]; i++)
+          if (cand < 0 || degree(order[i]) < degree(cand))
+            cand = order[i];
+
+        int num_levels_cand = level_structure(cand, part, p, order_cand, level_ptr_cand);
+        if (num_levels_cand <= num_levels)
+          break;
+
+        root = cand;
+        num_levels = num_levels_cand;
+        order.swap(order_cand);
+        level_ptr.swap(level_ptr_cand);
+      }
+      return root;
+    }
+
+    void GraphOrdering::rcm_component(int start, const std::vector<int>& part, int p, int* perm, int& pos) const
+    {
+      std::vector<int> order, level_ptr;
+      int root = pseudo_peripheral(start, part, p, order, level_ptr);
+
+      // Cuthill-McKee: breadth-first search visiting the neighbors by increasing degree.
+      stamp++;
+      int first = pos;
+      perm[pos++] = root;
+      mark[root] = stamp;
+      std::vector<std::pair<int, int> > neighbors;
+      for (int i = first; i < pos; i++)
+      {
+        int v = perm[i];
+        neighbors.clear();
+        for (int k = adj_ptr[v]; k < adj_ptr[v + 1]; k++)
+        {
+          int w = adj[k];
+          if (part[w] == p && mark[w] != stamp)
+          {
+            mark[w] = stamp;
+            neighbors.push_back(std::pair<int, int>(degree(w), w));
+          }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        for (unsigned int j = 0; j < neighbors.size(); j++)
+          perm[pos++] = neighbors[j].second;
+      }
+      std::reverse(perm + first, perm + pos);
+    }
+
+    void GraphOrdering::reverse_cuthill_mckee(int* perm, int start) const
+    {
+      if (n == 0)
+        return;
+
+      // Vertices already ordered are excluded from the search by part = -1.
+      std::vector<int> part(n, 0);
+      int pos = 0;
+      for (int v = start; pos < n; v = (v + 1) % n)
+      {
+        if (part[v] != 0)
+          continue;
+        int first = pos;
+        rcm_component(v, part, 0, perm, pos);
+        for (int i = first; i < pos; i++)
+          part[perm[i]] = -1;
+      }
+    }
+
+    void GraphOrdering::nested_dissection(int* perm, int start) const
+    {
+      if (n == 0)
+        return;
+
+      std::vector<int> part(n, 0);
+      std::vector<int> vertices(n);
+      for (int v = 0; v < n; v++)
+        vertices[v] = v;
+      int num_parts = 1;
+      int pos = 0;
+      dissect(vertices, start, part, 0, num_parts, perm, pos);
+    }
+
+    void GraphOrdering::dissect(const std::vector<int>& vertices, int start, std::vector<int>& part, int p, int& num_parts, int* perm, int& pos) const
+    {
+      std::vector<int> order, level_ptr;
+      int root = -1, num_levels = 0;
+      if ((int) vertices.size() > ND_LEAF_SIZE)
+      {
+        root = pseudo_peripheral(start, part, p, order, level_ptr);
+        num_levels = level_ptr.size() - 1;
+      }
+
+      // Small or "thin" parts.
+      if ((int) vertices.size() <= ND_LEAF_SIZE || (order.size() == vertices.size() && num_levels < 3))
+      {
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+          if (part[vertices[i]] != p)
+            continue;
+          int first = pos;
+          rcm_component(vertices[i], part, p, perm, pos);
+          for (int j = first; j < pos; j++)
+            part[perm[j]] = -1;
+        }
+        return;
+      }
+
+      // Disconnected subgraph: the component of the root, then the rest.
+      if (order.size() < vertices.size())
+      {
+        int p_comp = num_parts++, p_rest = num_parts++;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+          part[vertices[i]] = p_rest;
+        for (unsigned int i = 0; i < order.size(); i++)
+          part[order[i]] = p_comp;
+        std::vector<int> rest;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+          if (part[vertices[i]] == p_rest)
+            rest.push_back(vertices[i]);
+        dissect(order, root, part, p_comp, num_parts, perm, pos);
+        dissect(rest, rest[0], part, p_rest, num_parts, perm, pos);
+        return;
+      }
+
+      // The separator is the first level from which at least half of the vertices lie behind it.
+      int half = vertices.size() / 2;
+      int m = 1;
+      while (m < num_levels - 2 && level_ptr[m + 1] < half)
+        m++;
+
+      int p_first = num_parts++, p_second = num_parts++, p_separator = num_parts++;
+      std::vector<int> first(order.begin(), order.begin() + level_ptr[m]);
+      std::vector<int> second(order.begin() + level_ptr[m + 1], order.end());
+      std::vector<int> separator(order.begin() + level_ptr[m], order.begin() + level_ptr[m + 1]);
+      int second_start = order.back();
+      order.clear();
+      level_ptr.clear();
+
+      for (unsigned int i = 0; i < first.size(); i++)
+        part[first[i]] = p_first;
+      for (unsigned int i = 0; i < second.size(); i++)
+        part[second[i]] = p_second;
+      for (unsigned int i = 0; i < separator.size(); i++)
+        part[separator[i]] = p_separator;
+
+      dissect(first, root, part, p_first, num_parts, perm, pos);
+      dissect(second, second_start, part, p_second, num_parts, perm, pos);
+      for (unsigned int i = 0; i < separator.size(); i++)
+      {
+        perm[pos++] = separator[i];
+        part[separator[i]] = -1;
+      }
+    }
+  }
+}
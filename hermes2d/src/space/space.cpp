@@ -14,6 +14,7 @@
 // along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "space.h"
+#include "graph_ordering.h"
 
 // This is here mainly because XSD uses its own error, therefore it has to be undefined here.
 #ifdef error(...)
@@ -26,6 +27,7 @@
 #endif
 
 #include <iostream>
+#include <algorithm>
 #include "exceptions.h"
 
 namespace Hermes
@@ -50,6 +52,9 @@ namespace Hermes
       this->seq = g_space_seq;
       this->was_assigned = false;
       this->ndof = 0;
+      this->dof_ordering = HERMES_DOF_ORDERING_NATURAL;
+      this->bandwidth_before = this->bandwidth_after = -1;
+      this->profile_before = this->profile_after = -1;
 
       if(essential_bcs != NULL)
         for(typename Hermes::vector<EssentialBoundaryCondition<Scalar>*>::const_iterator it = essential_bcs->begin(); it != essential_bcs->end(); it++)
@@ -221,6 +226,89 @@ namespace Hermes
       return ref_space;
     }
 
+    template<typename Scalar>
+    bool Space<Scalar>::update_refined_space_orders(Space<Scalar>* coarse, Space<Scalar>* ref_space,
+                                                    int order_increase, int refinement_type)
+    {
+      _F_;
+      if (ref_space == NULL || ref_space->get_type() != coarse->get_type()
+          || !ref_space->is_refinement_of(coarse->get_mesh(), refinement_type))
+        return false;
+
+      // The reference mesh is still valid, only the orders have to follow the coarse space.
+      Element* e;
+      for_all_active_elements(e, ref_space->get_mesh())
+        ref_space->edata[e->id].changed_in_last_adaptation = false;
+      ref_space->dof_ordering = coarse->dof_ordering;
+      ref_space->copy_orders(coarse, order_increase);
+      return true;
+    }
+
+    template<typename Scalar>
+    bool Space<Scalar>::update_refined_spaces_orders(Hermes::vector<Space<Scalar>*> coarse,
+                                                     Hermes::vector<Space<Scalar>*> ref_spaces,
+                                                     int order_increase, int refinement_type)
+    {
+      _F_;
+      if (ref_spaces.size() != coarse.size())
+        return false;
+      for (unsigned int i = 0; i < coarse.size(); i++)
+        if (ref_spaces[i] == NULL || ref_spaces[i]->get_type() != coarse[i]->get_type()
+            || !ref_spaces[i]->is_refinement_of(coarse[i]->get_mesh(), refinement_type))
+          return false;
+
+      for (unsigned int i = 0; i < coarse.size(); i++)
+        update_refined_space_orders(coarse[i], ref_spaces[i], order_increase, refinement_type);
+      return true;
+    }
+
+    template<typename Scalar>
+    bool Space<Scalar>::is_refinement_of(Mesh* coarse, int refinement_type) const
+    {
+      _F_;
+      if (mesh->get_max_element_id() < coarse->get_max_element_id())
+        return false;
+
+      // Every element of the coarse mesh has its counterpart of the same id. The elements with higher ids
+      // can only be the sons created by refine_all_elements(), as they descend from the checked ones.
+      for (int id = 0; id < coarse->get_max_element_id(); id++)
+      {
+        Element* ce = coarse->get_element_fast(id);
+        Element* re = mesh->get_element_fast(id);
+        if (ce->used != re->used)
+          return false;
+        if (!ce->used)
+          continue;
+        if (ce->get_nvert() != re->get_nvert() || ce->is_curved() != re->is_curved() || re->active)
+          return false;
+        for (unsigned int i = 0; i < ce->get_nvert(); i++)
+          if (ce->vn[i]->id != re->vn[i]->id || ce->vn[i]->x != re->vn[i]->x || ce->vn[i]->y != re->vn[i]->y)
+            return false;
+
+        for (int i = 0; i < 4; i++)
+        {
+          if (!ce->active)
+          {
+            if ((ce->sons[i] == NULL) != (re->sons[i] == NULL)
+                || (ce->sons[i] != NULL && ce->sons[i]->id != re->sons[i]->id))
+              return false;
+          }
+          else
+          {
+            // Active coarse elements are split exactly once.
+            bool son;
+            if (ce->is_triangle())
+              son = (refinement_type != 3 || i < 3);
+            else
+              son = (refinement_type == 0 || (refinement_type == 1 && i < 2) || (refinement_type == 2 && i >= 2));
+            if ((re->sons[i] != NULL) != son || (son && !re->sons[i]->active))
+              return false;
+          }
+        }
+      }
+      return true;
+    }
+
     template<typename Scalar>
     void Space<Scalar>::update_essential_bc_values(Hermes::vector<Space<Scalar>*> spaces, double time)
     {
@@ -287,6 +375,37 @@ namespace Hermes
       return ndof;
     }
 
+    template<typename Scalar>
+    void Space<Scalar>::set_dof_ordering(DofOrdering dof_ordering)
+    {
+      _F_;
+      this->dof_ordering = dof_ordering;
+      seq = g_space_seq++;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::set_dof_ordering(Hermes::vector<Space<Scalar>*> spaces, DofOrdering dof_ordering)
+    {
+      _F_;
+      for (unsigned int i = 0; i < spaces.size(); i++)
+        spaces[i]->set_dof_ordering(dof_ordering);
+    }
+
+    template<typename Scalar>
+    DofOrdering Space<Scalar>::get_dof_ordering() const
+    {
+      return dof_ordering;
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::get_dof_ordering_stats(int& bandwidth_before, int& bandwidth_after, long long& profile_before, long long& profile_after) const
+    {
+      bandwidth_before = this->bandwidth_before;
+      bandwidth_after = this->bandwidth_after;
+      profile_before = this->profile_before;
+      profile_after = this->profile_after;
+    }
+
 
     template<typename Scalar>
     int Space<Scalar>::get_element_order(int id) const
@@ -718,6 +837,11 @@ namespace Hermes
       assign_edge_dofs();
       assign_bubble_dofs();
 
+      this->bandwidth_before = this->bandwidth_after = -1;
+      this->profile_before = this->profile_after = -1;
+      if (dof_ordering != HERMES_DOF_ORDERING_NATURAL)
+        renumber_dofs();
+
       free_bc_data();
       update_essential_bc_values();
       update_constraints();
@@ -730,6 +854,145 @@ namespace Hermes
       return this->ndof;
     }
 
+    /// Bandwidth and profile of the pattern where the blocks of DOFs (given by their starts and sizes)
+    /// are coupled according to the adjacency lists.
+    static void dof_pattern_stats(const std::vector<int>& start, const std::vector<int>& size,
+        const std::vector<int>& adj_ptr, const std::vector<int>& adj, int& bandwidth, long long& profile)
+    {
+      bandwidth = 0;
+      profile = 0;
+      for (unsigned int b = 0; b < start.size(); b++)
+      {
+        int first = start[b];
+        bandwidth = std::max(bandwidth, size[b] - 1);
+        for (int k = adj_ptr[b]; k < adj_ptr[b + 1]; k++)
+        {
+          int c = adj[k];
+          bandwidth = std::max(bandwidth, start[b] + size[b] - 1 - start[c]);
+          first = std::min(first, start[c]);
+        }
+        profile += (long long) size[b] * (start[b] - first) + (long long) size[b] * (size[b] - 1) / 2;
+      }
+    }
+
+    template<typename Scalar>
+    void Space<Scalar>::renumber_dofs()
+    {
+      _F_;
+      // Blocks of consecutive DOFs: the unconstrained nodes and the bubble functions of the elements.
+      // The blocks are numbered in the order of the active elements, so the first block belongs to
+      // the first active element in all spaces on the same mesh.
+      std::vector<int*> block_dof;
+      std::vector<int> block_size;
+      std::vector<int> node_block(mesh->get_max_node_id(), -1);
+      std::vector<int> elem_ptr(1, 0), elem_blocks;
+
+      Element* e;
+      for_all_active_elements(e, mesh)
+      {
+        for (unsigned int i = 0; i < e->get_nvert(); i++)
+        {
+          Node* nodes[2] = { e->vn[i], e->en[i] };
+          for (int j = 0; j < 2; j++)
+          {
+            if (node_block[nodes[j]->id] < 0)
+            {
+              NodeData* nd = ndata + nodes[j]->id;
+              if ((j == 0 && nodes[j]->is_constrained_vertex()) || nd->dof < 0 || nd->n <= 0)
+                continue;
+              node_block[nodes[j]->id] = block_dof.size();
+              block_dof.push_back(&nd->dof);
+              block_size.push_back(nd->n);
+            }
+            elem_blocks.push_back(node_block[nodes[j]->id]);
+          }
+        }
+        ElementData* ed = edata + e->id;
+        if (ed->n > 0)
+        {
+          elem_blocks.push_back(block_dof.size());
+          block_dof.push_back(&ed->bdof);
+          block_size.push_back(ed->n);
+        }
+        elem_ptr.push_back(elem_blocks.size());
+      }
+
+      // Nodes with DOFs not lying on active elements (edges constraining hanging nodes).
+      Node* node;
+      for_all_nodes(node, mesh)
+      {
+        if (node_block[node->id] >= 0 || (node->type == HERMES_TYPE_VERTEX && node->is_constrained_vertex()))
+          continue;
+        NodeData* nd = ndata + node->id;
+        if (nd->dof < 0 || nd->n <= 0)
+          continue;
+        node_block[node->id] = block_dof.size();
+        block_dof.push_back(&nd->dof);
+        block_size.push_back(nd->n);
+      }
+
+      int num_blocks = block_dof.size();
+      int num_dofs = 0;
+      for (int b = 0; b < num_blocks; b++)
+        num_dofs += block_size[b];
+      if (num_blocks == 0 || num_dofs * stride != next_dof - first_dof)
+      {
+        warn("DOFs of the space could not be grouped by nodes, the natural DOF ordering is used.");
+        return;
+      }
+
+      // Graph of the blocks coupled through the elements.
+      std::vector<int> adj_ptr(num_blocks + 1, 0);
+      for (unsigned int k = 0; k + 1 < elem_ptr.size(); k++)
+        for (int i = elem_ptr[k]; i < elem_ptr[k + 1]; i++)
+          adj_ptr[elem_blocks[i] + 1] += elem_ptr[k + 1] - elem_ptr[k] - 1;
+      for (int b = 0; b < num_blocks; b++)
+        adj_ptr[b + 1] += adj_ptr[b];
+      std::vector<int> adj(adj_ptr[num_blocks]);
+      std::vector<int> fill(adj_ptr.begin(), adj_ptr.end() - 1);
+      for (unsigned int k = 0; k + 1 < elem_ptr.size(); k++)
+        for (int i = elem_ptr[k]; i < elem_ptr[k + 1]; i++)
+          for (int j = elem_ptr[k]; j < elem_ptr[k + 1]; j++)
+            if (i != j)
+              adj[fill[elem_blocks[i]]++] = elem_blocks[j];
+      int pos = 0;
+      for (int b = 0; b < num_blocks; b++)
+      {
+        std::sort(adj.begin() + adj_ptr[b], adj.begin() + fill[b]);
+        int end = std::unique(adj.begin() + adj_ptr[b], adj.begin() + fill[b]) - adj.begin();
+        int begin = adj_ptr[b];
+        adj_ptr[b] = pos;
+        for (int k = begin; k < end; k++)
+          adj[pos++] = adj[k];
+      }
+      adj_ptr[num_blocks] = pos;
+
+      std::vector<int> start(num_blocks);
+      for (int b = 0; b < num_blocks; b++)
+        start[b] = (*block_dof[b] - first_dof) / stride;
+      dof_pattern_stats(start, block_size, adj_ptr, adj, bandwidth_before, profile_before);
+
+      std::vector<int> perm(num_blocks);
+      GraphOrdering ordering(num_blocks, &adj_ptr[0], adj.empty() ? NULL : &adj[0]);
+      if (dof_ordering == HERMES_DOF_ORDERING_RCM)
+        ordering.reverse_cuthill_mckee(&perm[0]);
+      else
+        ordering.nested_dissection(&perm[0]);
+
+      int dof = 0;
+      for (int k = 0; k < num_blocks; k++)
+      {
+        int b = perm[k];
+        start[b] = dof;
+        *block_dof[b] = first_dof + dof * stride;
+        dof += block_size[b];
+      }
+      dof_pattern_stats(start, block_size, adj_ptr, adj, bandwidth_after, profile_after);
+
+      info("DOF ordering (%s): bandwidth %d -> %d, profile %lld -> %lld.", dof_ordering == HERMES_DOF_ORDERING_RCM ? "RCM" : "ND",
+        bandwidth_before, bandwidth_after, profile_before, profile_after);
+    }
+
     template<typename Scalar>
     void Space<Scalar>::reset_dof_assignment()
     {
@@ -96,6 +96,7 @@ namespace Hermes
       for_all_active_elements(e, space->get_mesh())
         space->edata[e->id].changed_in_last_adaptation = false;
 
+      space->dof_ordering = this->dof_ordering;
       space->copy_orders(this, order_increase);
       return space;
     }
@@ -0,0 +1,413 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "sum_factorization.h"
+#include "quadrature/quad_all.h"
+#include "shapeset/precalc.h"
+#include "mesh/mesh.h"
+#include "mesh/refmap.h"
+
+namespace Hermes
+{
+  namespace Hermes2D
+  {
+    // Orders of the reference x- and y-derivatives of D^ref_0 = value, D^ref_1 = d/dxi, D^ref_2 = d/deta.
+    static const int der_x[3] = { 0, 1, 0 };
+    static const int der_y[3] = { 0, 0, 1 };
+
+    template<typename Scalar>
+    bool SumFactorization<Scalar>::is_applicable(RefMap* rm)
+    {
+      Element* e = rm->get_active_element();
+      return e != NULL && e->is_quad() && rm->is_jacobian_const();
+    }
+
+    template<typename Scalar>
+    bool SumFactorization<Scalar>::is_applicable(PrecalcShapeset* fn, RefMap* rm, AsmList<Scalar>* al, int order)
+    {
+      _F_;
+      if (!is_applicable(rm))
+        return false;
+
+      // The quadrature must be the cartesian product of the 1D Gauss points.
+      if (fn->get_quad_2d() != &g_quad_2d_std || order > g_quad_1d_std.get_max_order())
+        return false;
+      int n1 = g_quad_1d_std.get_num_points(order);
+      if (g_quad_2d_std.get_num_points(order) != n1 * n1)
+        return false;
+
+      Shapeset* shapeset = fn->get_shapeset();
+      if (shapeset->get_num_components() != 1 || shapeset->tensor_factors[HERMES_MODE_QUAD] == NULL)
+        return false;
+
+      // Constrained functions are not tensor products.
+      for (unsigned int i = 0; i < al->cnt; i++)
+        if (al->idx[i] < 0)
+          return false;
+
+      return true;
+    }
+
+    template<typename Scalar>
+    bool SumFactorization<Scalar>::fixed_kernels = true;
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::set_fixed_kernels(bool enable)
+    {
+      fixed_kernels = enable;
+    }
+
+    template<typename Scalar>
+    unsigned int SumFactorization<Scalar>::num_integrations = 0;
+
+    template<typename Scalar>
+    unsigned int SumFactorization<Scalar>::num_fixed_integrations = 0;
+
+    template<typename Scalar>
+    unsigned int SumFactorization<Scalar>::get_num_integrations()
+    {
+      return num_integrations;
+    }
+
+    template<typename Scalar>
+    unsigned int SumFactorization<Scalar>::get_num_fixed_integrations()
+    {
+      return num_fixed_integrations;
+    }
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::reset_counters()
+    {
+      num_integrations = 0;
+      num_fixed_integrations = 0;
+    }
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::count_integration(bool fixed)
+    {
+#ifdef WITH_OPENMP
+#pragma omp atomic
+#endif
+      num_integrations++;
+      if (fixed)
+      {
+#ifdef WITH_OPENMP
+#pragma omp atomic
+#endif
+        num_fixed_integrations++;
+      }
+    }
+
+    template<typename Scalar>
+    int SumFactorization<Scalar>::get_max_index(PrecalcShapeset* fn, AsmList<Scalar>* al)
+    {
+      int (*factors)[3] = fn->get_shapeset()->tensor_factors[HERMES_MODE_QUAD];
+      int max_index = 0;
+      for (unsigned int i = 0; i < al->cnt; i++)
+        max_index = std::max(max_index, std::max(factors[al->idx[i]][0], factors[al->idx[i]][1]));
+      return max_index;
+    }
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::init_tables(Tables& tab, int order, PrecalcShapeset* fn, RefMap* rm, AsmList<Scalar>* al, int max_index)
+    {
+      _F_;
+      int (*factors)[3] = fn->get_shapeset()->tensor_factors[HERMES_MODE_QUAD];
+
+      tab.fi.resize(al->cnt);
+      tab.fj.resize(al->cnt);
+      tab.sign.resize(al->cnt);
+      tab.max_i = tab.max_j = 0;
+      for (unsigned int i = 0; i < al->cnt; i++)
+      {
+        tab.fi[i] = factors[al->idx[i]][0];
+        tab.fj[i] = factors[al->idx[i]][1];
+        tab.sign[i] = factors[al->idx[i]][2];
+        tab.max_i = std::max(tab.max_i, tab.fi[i]);
+        tab.max_j = std::max(tab.max_j, tab.fj[i]);
+      }
+      if (max_index >= 0)
+        tab.max_i = tab.max_j = max_index;
+
+      // 1D points mapped to the sub-element the shape functions are restricted to.
+      int n1 = tab.n1 = g_quad_1d_std.get_num_points(order);
+      double2* pt = g_quad_1d_std.get_points(order);
+      Trf* ctm = fn->get_ctm();
+      std::vector<double> px(n1), py(n1);
+      for (int k = 0; k < n1; k++)
+      {
+        px[k] = ctm->m[0] * pt[k][0] + ctm->t[0];
+        py[k] = ctm->m[1] * pt[k][0] + ctm->t[1];
+      }
+
+      for (int der = 0; der < 2; der++)
+      {
+        tab.x[der].resize((tab.max_i + 1) * n1);
+        tab.y[der].resize((tab.max_j + 1) * n1);
+        Shapeset::get_lobatto_values(tab.max_i, der, n1, &px[0], &tab.x[der][0]);
+        Shapeset::get_lobatto_values(tab.max_j, der, n1, &py[0], &tab.y[der][0]);
+      }
+
+      // The same inverse reference map as in init_fn().
+      double2x2& m = *rm->get_const_inv_ref_map();
+      double t[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, m[0][0], m[0][1] }, { 0.0, m[1][0], m[1][1] } };
+      memcpy(tab.t, t, sizeof(t));
+    }
+
+    template<typename Scalar>
+    template<int QU, int QV, int N1>
+    void SumFactorization<Scalar>::contract_matrix(int qu, int qv, int n1, const Tables& tu, const Tables& tv, int alpha, int beta,
+      const Scalar* c, Scalar* w, double* a, Scalar* tmp, Scalar** result)
+    {
+      // The compile-time sizes, if known, replace the runtime ones.
+      if (QU) qu = QU;
+      if (QV) qv = QV;
+      if (N1) n1 = N1;
+      int nu = tu.fi.size(), nv = tv.fi.size();
+
+      const double* xv = &tv.x[der_x[alpha]][0];
+      const double* yv = &tv.y[der_y[alpha]][0];
+      const double* xu = &tu.x[der_x[beta]][0];
+      const double* yu = &tu.y[der_y[beta]][0];
+
+      // Contraction in y: tmp[(jv * qu + ju) * n1 + kx] = \sum_ky c(kx, ky) l_jv(y_ky) l_ju(y_ky).
+      // The points are ordered with x outer, see make_quad_table().
+      for (int jv = 0; jv < qv; jv++)
+        for (int kx = 0; kx < n1; kx++)
+        {
+          for (int ky = 0; ky < n1; ky++)
+            w[ky] = c[kx * n1 + ky] * yv[jv * n1 + ky];
+          for (int ju = 0; ju < qu; ju++)
+          {
+            Scalar sum = 0;
+            for (int ky = 0; ky < n1; ky++)
+              sum += w[ky] * yu[ju * n1 + ky];
+            tmp[(jv * qu + ju) * n1 + kx] = sum;
+          }
+        }
+
+      // Contraction in x for all pairs of the assembly lists.
+      for (int i = 0; i < nv; i++)
+      {
+        for (int kx = 0; kx < n1; kx++)
+          a[kx] = tv.sign[i] * xv[tv.fi[i] * n1 + kx];
+        for (int j = 0; j < nu; j++)
+        {
+          const double* b = xu + tu.fi[j] * n1;
+          const Scalar* s = tmp + (tv.fj[i] * qu + tu.fj[j]) * n1;
+          Scalar sum = 0;
+          for (int kx = 0; kx < n1; kx++)
+            sum += a[kx] * b[kx] * s[kx];
+          result[i][j] += tu.sign[j] * sum;
+        }
+      }
+    }
+
+    template<typename Scalar>
+    template<int Q, int N1>
+    void SumFactorization<Scalar>::contract_vector(int q, int n1, const Tables& tv, int alpha, const Scalar* c, Scalar* tmp, Scalar* result)
+    {
+      if (Q) q = Q;
+      if (N1) n1 = N1;
+      int nv = tv.fi.size();
+
+      const double* xv = &tv.x[der_x[alpha]][0];
+      const double* yv = &tv.y[der_y[alpha]][0];
+
+      // Contraction in x: tmp[iv * n1 + ky] = \sum_kx c(kx, ky) l_iv(x_kx).
+      for (int k = 0; k < q * n1; k++)
+        tmp[k] = 0;
+      for (int iv = 0; iv < q; iv++)
+        for (int kx = 0; kx < n1; kx++)
+        {
+          double l = xv[iv * n1 + kx];
+          for (int ky = 0; ky < n1; ky++)
+            tmp[iv * n1 + ky] += l * c[kx * n1 + ky];
+        }
+
+      // Contraction in y for all the test functions.
+      for (int i = 0; i < nv; i++)
+      {
+        const double* b = yv + tv.fj[i] * n1;
+        const Scalar* s = tmp + tv.fi[i] * n1;
+        Scalar sum = 0;
+        for (int ky = 0; ky < n1; ky++)
+          sum += b[ky] * s[ky];
+        result[i] += tv.sign[i] * sum;
+      }
+    }
+
+    // Kernels for q = p + 1 functions and q - 1, q, q + 1 points (integration orders 2p - 2 ... 2p + 3).
+#define H2D_SF_MATRIX_KERNELS(Q) \
+      case Q: \
+        if (n1 == Q - 1) return &contract_matrix<Q, Q, Q - 1>; \
+        if (n1 == Q) return &contract_matrix<Q, Q, Q>; \
+        if (n1 == Q + 1) return &contract_matrix<Q, Q, Q + 1>; \
+        break;
+
+#define H2D_SF_VECTOR_KERNELS(Q) \
+      case Q: \
+        if (n1 == Q - 1) return &contract_vector<Q, Q - 1>; \
+        if (n1 == Q) return &contract_vector<Q, Q>; \
+        if (n1 == Q + 1) return &contract_vector<Q, Q + 1>; \
+        break;
+
+    template<typename Scalar>
+    typename SumFactorization<Scalar>::matrix_kernel_t SumFactorization<Scalar>::get_matrix_kernel(int q, int n1)
+    {
+      switch (q)
+      {
+        H2D_SF_MATRIX_KERNELS(2)
+        H2D_SF_MATRIX_KERNELS(3)
+        H2D_SF_MATRIX_KERNELS(4)
+        H2D_SF_MATRIX_KERNELS(5)
+        H2D_SF_MATRIX_KERNELS(6)
+        H2D_SF_MATRIX_KERNELS(7)
+        H2D_SF_MATRIX_KERNELS(8)
+        H2D_SF_MATRIX_KERNELS(9)
+        H2D_SF_MATRIX_KERNELS(10)
+        H2D_SF_MATRIX_KERNELS(11)
+      }
+      return NULL;
+    }
+
+    template<typename Scalar>
+    typename SumFactorization<Scalar>::vector_kernel_t SumFactorization<Scalar>::get_vector_kernel(int q, int n1)
+    {
+      switch (q)
+      {
+        H2D_SF_VECTOR_KERNELS(2)
+        H2D_SF_VECTOR_KERNELS(3)
+        H2D_SF_VECTOR_KERNELS(4)
+        H2D_SF_VECTOR_KERNELS(5)
+        H2D_SF_VECTOR_KERNELS(6)
+        H2D_SF_VECTOR_KERNELS(7)
+        H2D_SF_VECTOR_KERNELS(8)
+        H2D_SF_VECTOR_KERNELS(9)
+        H2D_SF_VECTOR_KERNELS(10)
+        H2D_SF_VECTOR_KERNELS(11)
+      }
+      return NULL;
+    }
+
+#undef H2D_SF_MATRIX_KERNELS
+#undef H2D_SF_VECTOR_KERNELS
+
+    template<typename Scalar>
+    bool SumFactorization<Scalar>::has_fixed_kernel(int q, int n1)
+    {
+      return get_matrix_kernel(q, n1) != NULL;
+    }
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::integrate_matrix(int order, PrecalcShapeset* fu, PrecalcShapeset* fv, RefMap* ru, RefMap* rv,
+      AsmList<Scalar>* alu, AsmList<Scalar>* alv, Scalar** coef, Scalar** result)
+    {
+      _F_;
+      int nu = alu->cnt, nv = alv->cnt;
+      for (int i = 0; i < nv; i++)
+        memset(result[i], 0, nu * sizeof(Scalar));
+
+      // A fixed-size kernel needs the same number of 1D functions for u and v.
+      matrix_kernel_t kernel = NULL;
+      int q = std::max(get_max_index(fu, alu), get_max_index(fv, alv)) + 1;
+      if (fixed_kernels)
+        kernel = get_matrix_kernel(q, g_quad_1d_std.get_num_points(order));
+
+      Tables tu, tv;
+      init_tables(tu, order, fu, ru, alu, kernel != NULL ? q - 1 : -1);
+      init_tables(tv, order, fv, rv, alv, kernel != NULL ? q - 1 : -1);
+      int n1 = tu.n1, np = n1 * n1;
+      int qu = tu.max_j + 1, qv = tv.max_j + 1;
+      count_integration(kernel != NULL);
+      if (kernel == NULL)
+        kernel = &contract_matrix<0, 0, 0>;
+
+      std::vector<Scalar> c(np), tmp(qv * qu * n1), w(n1);
+      std::vector<double> a(n1);
+      for (int alpha = 0; alpha < 3; alpha++)
+      {
+        for (int beta = 0; beta < 3; beta++)
+        {
+          // Coefficient of D^ref_alpha v D^ref_beta u in the quadrature points.
+          bool nonzero = false;
+          for (int k = 0; k < np; k++)
+            c[k] = 0;
+          for (int ia = 0; ia < 3; ia++)
+            for (int ib = 0; ib < 3; ib++)
+            {
+              double f = tv.t[ia][alpha] * tu.t[ib][beta];
+              if (coef[3 * ia + ib] == NULL || f == 0.0)
+                continue;
+              nonzero = true;
+              for (int k = 0; k < np; k++)
+                c[k] += f * coef[3 * ia + ib][k];
+            }
+          if (!nonzero)
+            continue;
+
+          kernel(qu, qv, n1, tu, tv, alpha, beta, &c[0], &w[0], &a[0], &tmp[0], result);
+        }
+      }
+    }
+
+    template<typename Scalar>
+    void SumFactorization<Scalar>::integrate_vector(int order, PrecalcShapeset* fv, RefMap* rv,
+      AsmList<Scalar>* alv, Scalar** coef, Scalar* result)
+    {
+      _F_;
+      int nv = alv->cnt;
+      memset(result, 0, nv * sizeof(Scalar));
+
+      vector_kernel_t kernel = NULL;
+      int q = get_max_index(fv, alv) + 1;
+      if (fixed_kernels)
+        kernel = get_vector_kernel(q, g_quad_1d_std.get_num_points(order));
+
+      Tables tv;
+      init_tables(tv, order, fv, rv, alv, kernel != NULL ? q - 1 : -1);
+      int n1 = tv.n1, np = n1 * n1;
+      int pv = tv.max_i + 1;
+      count_integration(kernel != NULL);
+      if (kernel == NULL)
+        kernel = &contract_vector<0, 0>;
+
+      std::vector<Scalar> c(np), tmp(pv * n1);
+      for (int alpha = 0; alpha < 3; alpha++)
+      {
+        // Coefficient of D^ref_alpha v in the quadrature points.
+        bool nonzero = false;
+        for (int k = 0; k < np; k++)
+          c[k] = 0;
+        for (int ia = 0; ia < 3; ia++)
+        {
+          double f = tv.t[ia][alpha];
+          if (coef[ia] == NULL || f == 0.0)
+            continue;
+          nonzero = true;
+          for (int k = 0; k < np; k++)
+            c[k] += f * coef[ia][k];
+        }
+        if (!nonzero)
+          continue;
+
+        kernel(pv, n1, tv, alpha, &c[0], &tmp[0], result);
+      }
+    }
+
+    template class HERMES_API SumFactorization<double>;
+    template class HERMES_API SumFactorization<std::complex<double> >;
+  }
+}
@@ -82,7 +82,7 @@ namespace Hermes
     template<typename Scalar>
     MatrixFormVol<Scalar>::MatrixFormVol(unsigned int i, unsigned int j,
       std::string area, SymFlag sym, Hermes::vector<MeshFunction<Scalar>*> ext, double scaling_factor, int u_ext_offset) :
-    Form<Scalar>(area, ext, scaling_factor, u_ext_offset), i(i), j(j), sym(sym)
+    Form<Scalar>(area, ext, scaling_factor, u_ext_offset), i(i), j(j), sym(sym), uses_u_ext(true)
     {
     }
 
@@ -90,7 +90,7 @@ namespace Hermes
     MatrixFormVol<Scalar>::MatrixFormVol(unsigned int i, unsigned int j,
       Hermes::vector<std::string> areas, SymFlag sym, Hermes::vector<MeshFunction<Scalar>*> ext,
       double scaling_factor, int u_ext_offset) :
-    Form<Scalar>(areas, ext, scaling_factor, u_ext_offset), i(i), j(j), sym(sym)
+    Form<Scalar>(areas, ext, scaling_factor, u_ext_offset), i(i), j(j), sym(sym), uses_u_ext(true)
     {
     }
 
@@ -102,6 +102,20 @@ namespace Hermes
       return 0.0;
     }
 
+    template<typename Scalar>
+    bool MatrixFormVol<Scalar>::value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+      int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const
+    {
+      return false;
+    }
+
+    template<typename Scalar>
+    bool MatrixFormVol<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+      ExtData<Scalar> *ext, Scalar **coef) const
+    {
+      return false;
+    }
+
     template<typename Scalar>
     Hermes::Ord MatrixFormVol<Scalar>::ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *u, Func<Hermes::Ord> *v,
       Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const
@@ -157,14 +171,14 @@ namespace Hermes
     template<typename Scalar>
     VectorFormVol<Scalar>::VectorFormVol(unsigned int i, std::string area,
       Hermes::vector<MeshFunction<Scalar>*> ext, double scaling_factor, int u_ext_offset) :
-    Form<Scalar>(area, ext, scaling_factor, u_ext_offset), i(i)
+    Form<Scalar>(area, ext, scaling_factor, u_ext_offset), i(i), uses_u_ext(true)
     {
     }
 
     template<typename Scalar>
     VectorFormVol<Scalar>::VectorFormVol(unsigned int i, Hermes::vector<std::string> areas,
       Hermes::vector<MeshFunction<Scalar>*> ext, double scaling_factor, int u_ext_offset) :
-    Form<Scalar>(areas, ext, scaling_factor, u_ext_offset), i(i)
+    Form<Scalar>(areas, ext, scaling_factor, u_ext_offset), i(i), uses_u_ext(true)
     {
     }
 
@@ -176,6 +190,13 @@ namespace Hermes
       return 0.0;
     }
 
+    template<typename Scalar>
+    bool VectorFormVol<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+      ExtData<Scalar> *ext, Scalar **coef) const
+    {
+      return false;
+    }
+
     template<typename Scalar>
     Hermes::Ord VectorFormVol<Scalar>::ord(int n, double *wt, Func<Hermes::Ord> *u_ext[], Func<Hermes::Ord> *v,
       Geom<Hermes::Ord> *e, ExtData<Hermes::Ord> *ext) const
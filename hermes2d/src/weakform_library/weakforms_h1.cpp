@@ -25,6 +25,8 @@ namespace Hermes
       (int i, int j, Hermes2DFunction<double>* coeff, std::string area, SymFlag sym, GeomType gt)
         : MatrixFormVol<double>(i, j, area, sym), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE)
           this->coeff = new Hermes2DFunction<double>(1.0);
@@ -34,6 +36,8 @@ namespace Hermes
         (int i, int j, Hermes2DFunction<std::complex<double> >* coeff, std::string area, SymFlag sym, GeomType gt)
         : MatrixFormVol<std::complex<double> >(i, j, area, sym), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE)
           this->coeff = new Hermes2DFunction<std::complex<double> >(std::complex<double>(1.0, 0.0));
@@ -45,6 +49,8 @@ namespace Hermes
         Hermes2DFunction<double>* coeff, Hermes::vector<std::string> areas, SymFlag sym, GeomType gt)
         : MatrixFormVol<double>(i, j, areas, sym), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE)
           this->coeff = new Hermes2DFunction<double>(1.0);
@@ -55,6 +61,8 @@ namespace Hermes
         Hermes2DFunction<std::complex<double> >* coeff, Hermes::vector<std::string> areas, SymFlag sym, GeomType gt)
         : MatrixFormVol<std::complex<double> >(i, j, areas, sym), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE)
           this->coeff = new Hermes2DFunction<std::complex<double> >(std::complex<double>(1.0, 0.0));
@@ -93,6 +101,58 @@ namespace Hermes
         return result;
       }
 
+      template<typename Scalar>
+      bool DefaultMatrixFormVol<Scalar>::value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+        int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const
+      {
+        // Weights including the coefficient and the axisymmetric factor, evaluated once for all pairs.
+        Scalar* w = new Scalar[n];
+        for (int k = 0; k < n; k++)
+        {
+          w[k] = wt[k] * coeff->value(e->x[k], e->y[k]);
+          if (gt == HERMES_AXISYM_X)
+            w[k] *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            w[k] *= e->x[k];
+        }
+
+        Scalar* wv = new Scalar[n];
+        for (int i = 0; i < nv; i++)
+        {
+          for (int k = 0; k < n; k++)
+            wv[k] = w[k] * v[i]->val[k];
+          for (int j = 0; j < nu; j++)
+          {
+            double* uval = u[j]->val;
+            Scalar sum = 0;
+            for (int k = 0; k < n; k++)
+              sum += wv[k] * uval[k];
+            result[i][j] = sum;
+          }
+        }
+
+        delete [] wv;
+        delete [] w;
+        return true;
+      }
+
+      template<typename Scalar>
+      bool DefaultMatrixFormVol<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const
+      {
+        for (int k = 0; k < n; k++)
+        {
+          coef[0][k] = wt[k] * coeff->value(e->x[k], e->y[k]);
+          if (gt == HERMES_AXISYM_X)
+            coef[0][k] *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            coef[0][k] *= e->x[k];
+        }
+        for (int ab = 1; ab < 9; ab++)
+          coef[ab] = NULL;
+        return true;
+      }
+
       template<typename Scalar>
       Ord DefaultMatrixFormVol<Scalar>::ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u,
         Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -133,6 +193,8 @@ namespace Hermes
       {
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE) this->coeff = new Hermes1DFunction<Scalar>(1.0);
+        // With a constant coefficient the derivative term vanishes, the form does not depend on u_ext.
+        this->uses_u_ext = !this->coeff->is_constant();
       };
 
       template<typename Scalar>
@@ -142,6 +204,8 @@ namespace Hermes
       {
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE) this->coeff = new Hermes1DFunction<Scalar>(1.0);
+        // With a constant coefficient the derivative term vanishes, the form does not depend on u_ext.
+        this->uses_u_ext = !this->coeff->is_constant();
       }
 
       template<typename Scalar>
@@ -186,6 +250,79 @@ namespace Hermes
         return result;
       }
 
+      template<typename Scalar>
+      bool DefaultJacobianDiffusion<Scalar>::value_block(int n, double *wt, Func<Scalar> *u_ext[], int nu, Func<double> **u,
+        int nv, Func<double> **v, Geom<double> *e, ExtData<Scalar> *ext, Scalar **result) const
+      {
+        // Coefficients depending only on the previous iteration, evaluated once for all pairs.
+        Scalar* w_der = new Scalar[n];
+        Scalar* w_val = new Scalar[n];
+        for (int k = 0; k < n; k++)
+        {
+          double w = wt[k];
+          if (gt == HERMES_AXISYM_X)
+            w *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            w *= e->x[k];
+          w_der[k] = w * coeff->derivative(u_ext[idx_j]->val[k]);
+          w_val[k] = w * coeff->value(u_ext[idx_j]->val[k]);
+        }
+
+        // Test function dependent parts, the basis functions then enter linearly.
+        Scalar* t_val = new Scalar[n];
+        Scalar* t_dx = new Scalar[n];
+        Scalar* t_dy = new Scalar[n];
+        for (int i = 0; i < nv; i++)
+        {
+          for (int k = 0; k < n; k++)
+          {
+            t_val[k] = w_der[k] * (u_ext[idx_j]->dx[k] * v[i]->dx[k] + u_ext[idx_j]->dy[k] * v[i]->dy[k]);
+            t_dx[k] = w_val[k] * v[i]->dx[k];
+            t_dy[k] = w_val[k] * v[i]->dy[k];
+          }
+          for (int j = 0; j < nu; j++)
+          {
+            double* uval = u[j]->val;
+            double* udx = u[j]->dx;
+            double* udy = u[j]->dy;
+            Scalar sum = 0;
+            for (int k = 0; k < n; k++)
+              sum += t_val[k] * uval[k] + t_dx[k] * udx[k] + t_dy[k] * udy[k];
+            result[i][j] = sum;
+          }
+        }
+
+        delete [] t_dy;
+        delete [] t_dx;
+        delete [] t_val;
+        delete [] w_val;
+        delete [] w_der;
+        return true;
+      }
+
+      template<typename Scalar>
+      bool DefaultJacobianDiffusion<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const
+      {
+        // Indices 3a + b of the coefficients of D_a v D_b u: (dx, val), (dy, val), (dx, dx), (dy, dy).
+        for (int k = 0; k < n; k++)
+        {
+          double w = wt[k];
+          if (gt == HERMES_AXISYM_X)
+            w *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            w *= e->x[k];
+          Scalar w_der = w * coeff->derivative(u_ext[idx_j]->val[k]);
+          Scalar w_val = w * coeff->value(u_ext[idx_j]->val[k]);
+          coef[3][k] = w_der * u_ext[idx_j]->dx[k];
+          coef[6][k] = w_der * u_ext[idx_j]->dy[k];
+          coef[4][k] = w_val;
+          coef[8][k] = w_val;
+        }
+        coef[0] = coef[1] = coef[2] = coef[5] = coef[7] = NULL;
+        return true;
+      }
+
       template<typename Scalar>
       Ord DefaultJacobianDiffusion<Scalar>::ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v,
         Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -241,6 +378,8 @@ namespace Hermes
         // If coeff1 == HERMES_ONE or coeff22 == HERMES_ONE, initialize it to be constant 1.0.
         if (coeff1 == HERMES_ONE) this->coeff1 = new Hermes1DFunction<Scalar>(1.0);
         if (coeff2 == HERMES_ONE) this->coeff2 = new Hermes1DFunction<Scalar>(1.0);
+        // With constant coefficients the derivative terms vanish, the form does not depend on u_ext.
+        this->uses_u_ext = !this->coeff1->is_constant() || !this->coeff2->is_constant();
       }
 
       template<typename Scalar>
@@ -256,6 +395,8 @@ namespace Hermes
         // If coeff1 == HERMES_ONE or coeff22 == HERMES_ONE, initialize it to be constant 1.0.
         if (coeff1 == HERMES_ONE) this->coeff1 = new Hermes1DFunction<Scalar>(1.0);
         if (coeff2 == HERMES_ONE) this->coeff2 = new Hermes1DFunction<Scalar>(1.0);
+        // With constant coefficients the derivative terms vanish, the form does not depend on u_ext.
+        this->uses_u_ext = !this->coeff1->is_constant() || !this->coeff2->is_constant();
       }
 
       template<typename Scalar>
@@ -307,6 +448,8 @@ namespace Hermes
         GeomType gt)
         : VectorFormVol<Scalar>(i, area), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE) this->coeff = new Hermes2DFunction<Scalar>(1.0);
       }
@@ -317,6 +460,8 @@ namespace Hermes
         GeomType gt)
         : VectorFormVol<Scalar>(i, areas), coeff(coeff), gt(gt)
       {
+        // The coefficient is a function of x, y only.
+        this->uses_u_ext = false;
         // If coeff is HERMES_ONE, initialize it to be constant 1.0.
         if (coeff == HERMES_ONE) this->coeff = new Hermes2DFunction<Scalar>(1.0);
       }
@@ -353,6 +498,22 @@ namespace Hermes
         return result;
       }
 
+      template<typename Scalar>
+      bool DefaultVectorFormVol<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const
+      {
+        for (int k = 0; k < n; k++)
+        {
+          coef[0][k] = wt[k] * coeff->value(e->x[k], e->y[k]);
+          if (gt == HERMES_AXISYM_X)
+            coef[0][k] *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            coef[0][k] *= e->x[k];
+        }
+        coef[1] = coef[2] = NULL;
+        return true;
+      }
+
       template<typename Scalar>
       Ord DefaultVectorFormVol<Scalar>::ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v,
         Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -437,6 +598,22 @@ namespace Hermes
         return result;
       }
 
+      template<typename Scalar>
+      bool DefaultResidualVol<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const
+      {
+        for (int k = 0; k < n; k++)
+        {
+          coef[0][k] = wt[k] * coeff->value(e->x[k], e->y[k]) * u_ext[idx_i]->val[k];
+          if (gt == HERMES_AXISYM_X)
+            coef[0][k] *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            coef[0][k] *= e->x[k];
+        }
+        coef[1] = coef[2] = NULL;
+        return true;
+      }
+
       template<typename Scalar>
       Ord DefaultResidualVol<Scalar>::ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v,
         Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -523,6 +700,25 @@ namespace Hermes
         return result;
       }
 
+      template<typename Scalar>
+      bool DefaultResidualDiffusion<Scalar>::value_coefficients(int n, double *wt, Func<Scalar> *u_ext[], Geom<double> *e,
+        ExtData<Scalar> *ext, Scalar **coef) const
+      {
+        for (int k = 0; k < n; k++)
+        {
+          double w = wt[k];
+          if (gt == HERMES_AXISYM_X)
+            w *= e->y[k];
+          else if (gt == HERMES_AXISYM_Y)
+            w *= e->x[k];
+          Scalar c = w * coeff->value(u_ext[idx_i]->val[k]);
+          coef[1][k] = c * u_ext[idx_i]->dx[k];
+          coef[2][k] = c * u_ext[idx_i]->dy[k];
+        }
+        coef[0] = NULL;
+        return true;
+      }
+
       template<typename Scalar>
       Ord DefaultResidualDiffusion<Scalar>::ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v,
         Geom<Ord> *e, ExtData<Ord> *ext) const
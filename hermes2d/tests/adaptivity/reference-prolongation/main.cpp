@@ -0,0 +1,132 @@
+#define HERMES_REPORT_ALL
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This test prolongates a solution on a coarse mesh with hanging nodes to its reference space by
+// LocalProjection::project_local() (as the previous reference solution is prolongated to the next
+// reference space to warm-start the solver) and checks that the prolongated solution is exact,
+// for H1 spaces with nonzero Dirichlet conditions and for L2 spaces, on the given mesh.
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 2;
+
+// Number of the checked points in each element.
+const int NUM_POINTS = 3;
+
+// Weights of the element vertices in the checked points (inside the element, off its edges, where
+// the L2 solutions jump).
+const double POINT_WEIGHTS[NUM_POINTS][4] =
+{
+  { 0.5, 0.2, 0.2, 0.1 }, { 0.1, 0.3, 0.4, 0.2 }, { 0.25, 0.25, 0.15, 0.35 }
+};
+
+// Relative tolerance of the comparison.
+const double TOLERANCE = 1e-10;
+
+// Prolongates an arbitrary solution of the space to the reference space, returns the largest difference.
+double prolongate(Space<double>* space, double& size)
+{
+  int ndof = space->get_num_dofs();
+  double* coeff_vec = new double[ndof];
+  for (int i = 0; i < ndof; i++)
+    coeff_vec[i] = std::sin(1.0 + 0.7 * i);
+  Solution<double> sln;
+  Solution<double>::vector_to_solution(coeff_vec, space, &sln);
+  delete [] coeff_vec;
+
+  Space<double>* ref_space = Space<double>::construct_refined_space(space, 1);
+  Solution<double> ref_sln;
+  LocalProjection<double>::project_local(ref_space, &sln, &ref_sln);
+
+  double diff = 0.0;
+  size = 0.0;
+  Element* e;
+  for_all_active_elements(e, space->get_mesh())
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+      double x = 0.0, y = 0.0, sum = 0.0;
+      for (unsigned int j = 0; j < e->get_nvert(); j++)
+      {
+        x += POINT_WEIGHTS[i][j] * e->vn[j]->x;
+        y += POINT_WEIGHTS[i][j] * e->vn[j]->y;
+        sum += POINT_WEIGHTS[i][j];
+      }
+      x /= sum;
+      y /= sum;
+      double value = sln.get_pt_value(x, y);
+      diff = std::max(diff, std::abs(ref_sln.get_pt_value(x, y) - value));
+      size = std::max(size, std::abs(value));
+    }
+
+  delete ref_space->get_mesh();
+  delete ref_space;
+  return diff;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("please input as this format: reference-prolongation meshfile.mesh \n");
+    return TEST_FAILURE;
+  }
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(argv[1], &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  // Hanging nodes: refine every third element, then every fifth element once more.
+  for (int r = 3; r <= 5; r += 2)
+  {
+    Element* e;
+    std::vector<int> ids;
+    int k = 0;
+    for_all_active_elements(e, &mesh)
+      if (k++ % r == 0)
+        ids.push_back(e->id);
+    for (unsigned int i = 0; i < ids.size(); i++)
+      mesh.refine_element_id(ids[i]);
+  }
+
+  DefaultEssentialBCConst<double> bc("Bdy", 1.5);
+  EssentialBCs<double> bcs(&bc);
+  H1Space<double> h1_space(&mesh, &bcs, 2);
+  L2Space<double> l2_space(&mesh, 1);
+  Element* e;
+  int k = 0;
+  for_all_active_elements(e, &mesh)
+  {
+    if (k % 4 == 0)
+      h1_space.set_element_order_internal(e->id, e->is_triangle() ? 3 : H2D_MAKE_QUAD_ORDER(3, 2));
+    if (k++ % 3 == 0)
+      l2_space.set_element_order_internal(e->id, e->is_triangle() ? 2 : H2D_MAKE_QUAD_ORDER(2, 2));
+  }
+  h1_space.assign_dofs();
+  l2_space.assign_dofs();
+
+  bool success = true;
+  double size, diff = prolongate(&h1_space, size);
+  info("H1: difference %g (max. value %g)", diff, size);
+  if (diff > TOLERANCE * size)
+    success = false;
+
+  diff = prolongate(&l2_space, size);
+  info("L2: difference %g (max. value %g)", diff, size);
+  if (diff > TOLERANCE * size)
+    success = false;
+
+  if (success)
+  {
+    info("Success!");
+    return TEST_SUCCESS;
+  }
+  else
+  {
+    info("Failure!");
+    return TEST_FAILURE;
+  }
+}
@@ -0,0 +1,114 @@
+#define HERMES_REPORT_ALL
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This test changes the orders (and in one step also the mesh) of a coarse space on the given mesh
+// in several steps, updates the orders of the reference space of the previous step by
+// Space::update_refined_space_orders() with the given refinement type and checks that this succeeds
+// exactly in the steps without a mesh change and that the result agrees with a reference space
+// constructed anew by Space::construct_refined_space().
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 3;
+
+// Number of the changes of the coarse space.
+const int NUM_STEPS = 4;
+
+// The step in which an element of the coarse mesh is refined.
+const int H_REFINEMENT_STEP = 2;
+
+// Returns true if both reference spaces have the same mesh elements, orders and number of DOFs.
+bool same_spaces(Space<double>* ref_space, Space<double>* updated)
+{
+  if (ref_space->get_num_dofs() != updated->get_num_dofs())
+    return false;
+  if (ref_space->get_mesh()->get_num_active_elements() != updated->get_mesh()->get_num_active_elements())
+    return false;
+  Element* e;
+  for_all_active_elements(e, ref_space->get_mesh())
+  {
+    Element* u = updated->get_mesh()->get_element(e->id);
+    if (!u->active || ref_space->get_element_order(e->id) != updated->get_element_order(e->id))
+      return false;
+  }
+  return true;
+}
+
+// Runs the steps with the given refinement type of the reference mesh.
+bool test_updates(const char* mesh_file, int refinement_type)
+{
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(mesh_file, &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  DefaultEssentialBCConst<double> bc("Bdy", 0.0);
+  EssentialBCs<double> bcs(&bc);
+  H1Space<double> space(&mesh, &bcs, 2);
+  Space<double>* ref_space = Space<double>::construct_refined_space(&space, 1, refinement_type);
+
+  bool success = true;
+  for (int step = 0; step < NUM_STEPS; step++)
+  {
+    // Change the orders of every 7th element and refine one element in one of the steps.
+    Element* e;
+    int k = 0, refined_id = -1;
+    for_all_active_elements(e, &mesh)
+    {
+      if (k++ % 7 == step)
+        space.set_element_order_internal(e->id, e->is_triangle() ? 3 + step % 2 : H2D_MAKE_QUAD_ORDER(3 + step % 2, 3));
+      refined_id = e->id;
+    }
+    bool h_refined = (step == H_REFINEMENT_STEP);
+    if (h_refined)
+    {
+      mesh.refine_element_id(refined_id);
+      space.update_element_orders_after_refinement();
+    }
+    space.assign_dofs();
+
+    bool updated = Space<double>::update_refined_space_orders(&space, ref_space, 1, refinement_type);
+    if (!updated)
+    {
+      delete ref_space->get_mesh();
+      delete ref_space;
+      ref_space = Space<double>::construct_refined_space(&space, 1, refinement_type);
+    }
+    Space<double>* constructed = Space<double>::construct_refined_space(&space, 1, refinement_type);
+
+    if (updated == h_refined || !same_spaces(constructed, ref_space))
+      success = false;
+    info("step %d: reference space %s, %d DOFs", step, updated ? "updated" : "constructed", ref_space->get_num_dofs());
+
+    delete constructed->get_mesh();
+    delete constructed;
+  }
+  delete ref_space->get_mesh();
+  delete ref_space;
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    printf("please input as this format: refined-space-update meshfile.mesh refinement_type \n");
+    return TEST_FAILURE;
+  }
+
+  bool success = test_updates(argv[1], atoi(argv[2]));
+
+  if (success)
+  {
+    info("Success!");
+    return TEST_SUCCESS;
+  }
+  else
+  {
+    info("Failure!");
+    return TEST_FAILURE;
+  }
+}
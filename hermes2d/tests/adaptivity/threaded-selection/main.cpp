@@ -0,0 +1,97 @@
+#define HERMES_REPORT_ALL
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Hermes2D::RefinementSelectors;
+
+// This test runs one adaptivity step on the given mesh with the strategies 0, 1, 2, once selecting
+// the refinements serially and once by several threads (see Adapt::set_num_threads()), and checks
+// that the resulting meshes and orders are the same. It fails if Hermes was built without OpenMP,
+// as then both runs would be serial.
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 3;
+
+// Number of threads of the parallel selection.
+const int NUM_THREADS = 4;
+
+// Thresholds of the strategies 0, 1, 2.
+const double THRESHOLD[3] = { 0.5, 0.3, 1e-6 };
+
+// Runs one adaptivity step, returns the ids and orders of the active elements.
+std::vector<int> adapt_once(const char* mesh_file, int strategy, int num_threads, H1ProjBasedSelector<double>* selector)
+{
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(mesh_file, &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  H1Space<double> space(&mesh, 2);
+  Mesh ref_mesh;
+  ref_mesh.copy(&mesh);
+  ref_mesh.refine_all_elements();
+  H1Space<double> ref_space(&ref_mesh, 3);
+
+  // Some coarse and reference solutions with nonuniform element errors.
+  std::vector<double> coeffs(space.get_num_dofs()), ref_coeffs(ref_space.get_num_dofs());
+  for (unsigned int i = 0; i < coeffs.size(); i++)
+    coeffs[i] = 0.1 * std::sin(0.37 * i);
+  for (unsigned int i = 0; i < ref_coeffs.size(); i++)
+    ref_coeffs[i] = 0.1 * std::sin(0.37 * i) + 0.05 * std::cos(1.3 * i * i);
+  Solution<double> sln, ref_sln;
+  Solution<double>::vector_to_solution(&coeffs[0], &space, &sln);
+  Solution<double>::vector_to_solution(&ref_coeffs[0], &ref_space, &ref_sln);
+
+  Adapt<double> adaptivity(&space);
+  adaptivity.set_num_threads(num_threads);
+  adaptivity.calc_err_est(&sln, &ref_sln);
+  adaptivity.adapt(selector, THRESHOLD[strategy], strategy);
+
+  std::vector<int> result;
+  Element* e;
+  for_all_active_elements(e, &mesh)
+  {
+    result.push_back(e->id);
+    result.push_back(space.get_element_order(e->id));
+  }
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    printf("please input as this format: threaded-selection meshfile.mesh \n");
+    return TEST_FAILURE;
+  }
+#ifndef WITH_OPENMP
+  info("Failure! Hermes was built without OpenMP, the refinements cannot be selected by threads.");
+  return TEST_FAILURE;
+#endif
+
+  H1ProjBasedSelector<double> selector(H2D_HP_ANISO, 1.0, H2DRS_DEFAULT_ORDER);
+
+  bool success = true;
+  for (int strategy = 0; strategy < 3; strategy++)
+  {
+    std::vector<int> serial = adapt_once(argv[1], strategy, 1, &selector);
+    std::vector<int> threaded = adapt_once(argv[1], strategy, NUM_THREADS, &selector);
+    if (serial != threaded)
+      success = false;
+    info("strategy %d: %d elements, %s", strategy, (int) serial.size() / 2,
+      serial == threaded ? "same refinements" : "refinements differ");
+  }
+
+  if (success)
+  {
+    info("Success!");
+    return TEST_SUCCESS;
+  }
+  else
+  {
+    info("Failure!");
+    return TEST_FAILURE;
+  }
+}
@@ -0,0 +1,151 @@
+#define HERMES_REPORT_ALL
+#include "../../assembling_comparison.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+
+// This test checks the element orderings of Traverse::set_element_ordering(). On the quadrilateral
+// mesh refined to a 4 x 4 grid the elements must be visited along the known Hilbert and Morton curves,
+// so the consecutive elements of the Hilbert ordering are also edge neighbors. Then the same problem is
+// assembled on the irregularly refined mesh with each ordering and the matrices and the right-hand
+// sides must agree. The cache misses of the assemblings are logged where the hardware counters are
+// available (see CacheMissCounter).
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 4;
+
+// Polynomial degree of the elements.
+const int P_INIT = 3;
+
+// Relative tolerance of the comparison.
+const double TOLERANCE = 1e-12;
+
+// Positions of the cells of the 4 x 4 grid (column + 4 * row, starting in the corner of the vertex 0 of the
+// base element) along the curves.
+const int HILBERT_CURVE[16] = { 0, 1, 5, 4, 8, 12, 13, 9, 10, 14, 15, 11, 7, 6, 2, 3 };
+const int MORTON_CURVE[16] = { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15 };
+
+// Cell of the 4 x 4 grid of the base element (a parallelogram) containing the center of the element.
+int grid_cell(Element* base, Element* e)
+{
+  double cx = 0.0, cy = 0.0;
+  for (unsigned int j = 0; j < e->get_nvert(); j++)
+  {
+    cx += e->vn[j]->x / e->get_nvert();
+    cy += e->vn[j]->y / e->get_nvert();
+  }
+  double ax = base->vn[1]->x - base->vn[0]->x, ay = base->vn[1]->y - base->vn[0]->y;
+  double bx = base->vn[3]->x - base->vn[0]->x, by = base->vn[3]->y - base->vn[0]->y;
+  double px = cx - base->vn[0]->x, py = cy - base->vn[0]->y;
+  double det = ax * by - ay * bx;
+  int col = (int) (4.0 * (px * by - py * bx) / det);
+  int row = (int) (4.0 * (ax * py - ay * px) / det);
+  return col + 4 * row;
+}
+
+// Checks the visiting order of the 4 x 4 grid against the curve.
+bool follows_curve(Mesh* grid, const int* curve)
+{
+  Hermes::vector<int> ids;
+  Traverse::get_visiting_order(grid, ids);
+  if (ids.size() != 16)
+    return false;
+  for (int k = 0; k < 16; k++)
+    if (grid_cell(grid->get_element(0), grid->get_element(ids[k])) != curve[k])
+      return false;
+  return true;
+}
+
+// Checks that the consecutive elements of the visiting order share an edge.
+bool consecutive_are_neighbors(Mesh* grid)
+{
+  Hermes::vector<int> ids;
+  Traverse::get_visiting_order(grid, ids);
+  for (unsigned int k = 1; k < ids.size(); k++)
+  {
+    Element* e1 = grid->get_element(ids[k - 1]);
+    Element* e2 = grid->get_element(ids[k]);
+    int shared = 0;
+    for (unsigned int i = 0; i < e1->get_nvert(); i++)
+      for (unsigned int j = 0; j < e2->get_nvert(); j++)
+        if (e1->vn[i] == e2->vn[j])
+          shared++;
+    if (shared < 2)
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  Mesh grid;
+  if (!load_test_mesh(argc, argv, "element-ordering", &grid, 2))
+    return TEST_FAILURE;
+
+  bool success = true;
+  if (grid.get_element(0)->is_quad())
+  {
+    Traverse::set_element_ordering(HERMES_ELEMENT_ORDERING_HILBERT);
+    bool hilbert = follows_curve(&grid, HILBERT_CURVE) && consecutive_are_neighbors(&grid);
+    Traverse::set_element_ordering(HERMES_ELEMENT_ORDERING_MORTON);
+    bool morton = follows_curve(&grid, MORTON_CURVE);
+    Traverse::set_element_ordering(HERMES_ELEMENT_ORDERING_NATURAL);
+    info("4 x 4 grid: %s the Hilbert curve, %s the Morton curve", hilbert ? "follows" : "does not follow",
+      morton ? "follows" : "does not follow");
+    if (!hilbert || !morton)
+      success = false;
+  }
+
+  // Refine some of the elements once more to get hanging nodes.
+  Mesh mesh;
+  load_test_mesh(argc, argv, "element-ordering", &mesh, INIT_REF_NUM);
+  int max_id = mesh.get_max_element_id();
+  for (int id = 0; id < max_id; id++)
+  {
+    Element* e = mesh.get_element_fast(id);
+    if (e->used && e->active && id % 5 == 0)
+      mesh.refine_element_id(id);
+  }
+
+  H1Space<double> space(&mesh, P_INIT);
+  int ndof = space.get_num_dofs();
+
+  WeakForm<double> wf(1);
+  wf.add_matrix_form(new DefaultMatrixFormVol<double>(0, 0));
+  wf.add_vector_form(new DefaultVectorFormVol<double>(0));
+
+  const char* names[3] = { "natural", "Hilbert", "Morton" };
+  ElementOrdering orderings[3] = { HERMES_ELEMENT_ORDERING_NATURAL, HERMES_ELEMENT_ORDERING_HILBERT, HERMES_ELEMENT_ORDERING_MORTON };
+  std::vector<double> values[3];
+  for (int k = 0; k < 3; k++)
+  {
+    Traverse::set_element_ordering(orderings[k]);
+    DiscreteProblem<double> dp(&wf, &space);
+    SparseMatrix<double>* matrix = create_matrix<double>(SOLVER_UMFPACK);
+    Vector<double>* rhs = create_vector<double>(SOLVER_UMFPACK);
+
+    CacheMissCounter counter;
+    dp.assemble(matrix, rhs);
+    counter.tick();
+    if (counter.available())
+      info("%s ordering: %lld cache misses of %lld references", names[k],
+        counter.accumulated_misses(), counter.accumulated_references());
+
+    values[k] = assembled_values(matrix, rhs, ndof);
+    delete matrix;
+    delete rhs;
+
+    if (k > 0)
+    {
+      double diff = relative_difference(values[0], values[k]);
+      info("%s ordering: difference from the natural ordering %g", names[k], diff);
+      if (diff > TOLERANCE)
+        success = false;
+    }
+  }
+  Traverse::set_element_ordering(HERMES_ELEMENT_ORDERING_NATURAL);
+
+  return test_result(success);
+}
@@ -0,0 +1,114 @@
+#define HERMES_REPORT_ALL
+#include "../../assembling_comparison.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+
+// This test assembles the same Newton's system on the given mesh with the geometry of the elements kept in
+// a GeometryStore (see DiscreteProblem::set_geometry_store()) and without it, and evaluates the H1 norm
+// of a solution with and without a store (see Global::calc_norms_and_errors()). The assembling is repeated
+// with the stored geometry, and once more after an element has been h-refined. The quads of the mesh are
+// distorted first, so that their jacobians are not constant. In each step the results must agree and
+// the stores must have been used.
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 3;
+
+// Polynomial degree of the elements.
+const int P_INIT = 3;
+
+// Relative tolerance of the comparison.
+const double TOLERANCE = 1e-12;
+
+// Right-hand side depending on the physical coordinates of the integration points.
+class CustomSource : public Hermes2DFunction<double>
+{
+public:
+  CustomSource() : Hermes2DFunction<double>() { this->is_const = false; }
+
+  virtual double value(double x, double y) const { return x * y + 1.0; }
+
+  virtual Ord value(Ord x, Ord y) const { return x * y; }
+};
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  if (!load_test_mesh(argc, argv, "geometry-store", &mesh, 0))
+    return TEST_FAILURE;
+  if (mesh.get_element(0)->is_quad())
+    mesh.get_node(2)->x += 0.3;
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements();
+
+  DefaultEssentialBCConst<double> bc("Bdy", 1.0);
+  EssentialBCs<double> bcs(&bc);
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+
+  CustomSource source;
+  WeakForm<double> wf(1);
+  wf.add_matrix_form(new DefaultJacobianDiffusion<double>(0, 0));
+  wf.add_matrix_form(new DefaultMatrixFormVol<double>(0, 0));
+  wf.add_vector_form(new DefaultVectorFormVol<double>(0, &source));
+
+  DiscreteProblem<double> stored(&wf, &space), plain(&wf, &space);
+  stored.set_geometry_store(true);
+  GeometryStore norm_store;
+
+  SparseMatrix<double>* matrix_stored = create_matrix<double>(SOLVER_UMFPACK);
+  Vector<double>* rhs_stored = create_vector<double>(SOLVER_UMFPACK);
+  SparseMatrix<double>* matrix_plain = create_matrix<double>(SOLVER_UMFPACK);
+  Vector<double>* rhs_plain = create_vector<double>(SOLVER_UMFPACK);
+
+  const char* steps[3] = { "first assembling", "geometry reused", "one element h-refined" };
+  bool success = true;
+  for (int step = 0; step < 3; step++)
+  {
+    if (step == 2)
+    {
+      Element* e = mesh.get_element(0);
+      while (!e->active)
+        e = e->sons[0] != NULL ? e->sons[0] : e->sons[2];
+      mesh.refine_element_id(e->id);
+      space.update_element_orders_after_refinement();
+      space.assign_dofs();
+      stored.set_spaces(&space);
+      plain.set_spaces(&space);
+    }
+    norm_store.set_mesh(&mesh);
+
+    int ndof = space.get_num_dofs();
+    std::vector<double> coeff_vec(ndof);
+    for (int i = 0; i < ndof; i++)
+      coeff_vec[i] = std::sin(0.3 * i + step);
+
+    stored.assemble(&coeff_vec[0], matrix_stored, rhs_stored);
+    plain.assemble(&coeff_vec[0], matrix_plain, rhs_plain);
+    double diff = relative_difference(assembled_values(matrix_plain, rhs_plain, ndof),
+      assembled_values(matrix_stored, rhs_stored, ndof));
+    // The norm of the solution of the coefficient vector evaluated with the store and without it.
+    Solution<double> sln;
+    Solution<double>::vector_to_solution(&coeff_vec[0], &space, &sln);
+    Hermes::vector<Global<double>::NormQuantity> norm_stored, norm_plain;
+    norm_stored.push_back(Global<double>::NormQuantity(&sln, NULL, HERMES_H1_NORM));
+    norm_plain.push_back(Global<double>::NormQuantity(&sln, NULL, HERMES_H1_NORM));
+    Global<double>::calc_norms_and_errors(norm_stored, 1, &norm_store);
+    Global<double>::calc_norms_and_errors(norm_plain);
+    double norm_diff = std::abs(norm_stored[0].value - norm_plain[0].value) / norm_plain[0].value;
+
+    info("%s: %d DOFs, difference from the assembling without the store %g, of the norm %g", steps[step],
+      ndof, diff, norm_diff);
+    if (diff > TOLERANCE || norm_diff > TOLERANCE || stored.get_geometry_store_memory_size() == 0
+        || norm_store.get_memory_size() == 0)
+      success = false;
+  }
+
+  delete matrix_stored;
+  delete rhs_stored;
+  delete matrix_plain;
+  delete rhs_plain;
+
+  return test_result(success);
+}
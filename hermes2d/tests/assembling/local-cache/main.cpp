@@ -0,0 +1,90 @@
+#define HERMES_REPORT_ALL
+#include "../../assembling_comparison.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+
+// This test assembles the Newton's system of a linear problem on the given mesh with the cache of
+// local matrices and vectors (see DiscreteProblem::set_local_cache()) and without it, as the NewtonSolver
+// does (with a coefficient vector). Then it raises the order of one element and reassembles, and
+// after that h-refines one element and reassembles. In each assembling the cached and the uncached
+// results must agree, and after each change some of the local matrices must have been reused.
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 3;
+
+// Polynomial degree of the elements.
+const int P_INIT = 2;
+
+// Relative tolerance of the comparison.
+const double TOLERANCE = 1e-12;
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  if (!load_test_mesh(argc, argv, "local-cache", &mesh, INIT_REF_NUM))
+    return TEST_FAILURE;
+
+  // Dirichlet lifts and constrained functions make the coefficients of the assembly lists nontrivial.
+  DefaultEssentialBCConst<double> bc("Bdy", 1.0);
+  EssentialBCs<double> bcs(&bc);
+  H1Space<double> space(&mesh, &bcs, P_INIT);
+
+  // The Jacobian does not depend on the iterate and is cached, the residual is not.
+  WeakForm<double> wf(1);
+  wf.add_matrix_form(new DefaultJacobianDiffusion<double>(0, 0));
+  wf.add_vector_form(new DefaultResidualDiffusion<double>(0));
+  wf.add_vector_form(new DefaultVectorFormVol<double>(0));
+
+  DiscreteProblem<double> cached(&wf, &space), plain(&wf, &space);
+  cached.set_local_cache(true);
+  SparseMatrix<double>* matrix_cached = create_matrix<double>(SOLVER_UMFPACK);
+  Vector<double>* rhs_cached = create_vector<double>(SOLVER_UMFPACK);
+  SparseMatrix<double>* matrix_plain = create_matrix<double>(SOLVER_UMFPACK);
+  Vector<double>* rhs_plain = create_vector<double>(SOLVER_UMFPACK);
+
+  const char* steps[3] = { "initial mesh", "order of one element raised", "one element h-refined" };
+  bool success = true;
+  for (int step = 0; step < 3; step++)
+  {
+    Element* e = mesh.get_element(0);
+    while (!e->active)
+      e = e->sons[0] != NULL ? e->sons[0] : e->sons[2];
+    if (step == 1)
+      space.set_element_order(e->id, e->is_triangle() ? P_INIT + 1 : H2D_MAKE_QUAD_ORDER(P_INIT + 1, P_INIT + 1));
+    if (step == 2)
+    {
+      mesh.refine_element_id(e->id);
+      space.update_element_orders_after_refinement();
+      space.assign_dofs();
+    }
+    cached.set_spaces(&space);
+    plain.set_spaces(&space);
+
+    int ndof = space.get_num_dofs();
+    std::vector<double> coeff_vec(ndof);
+    for (int i = 0; i < ndof; i++)
+      coeff_vec[i] = std::sin(0.3 * i + step);
+
+    unsigned int hits = cached.get_local_cache_hits();
+    cached.assemble(&coeff_vec[0], matrix_cached, rhs_cached);
+    hits = cached.get_local_cache_hits() - hits;
+    plain.assemble(&coeff_vec[0], matrix_plain, rhs_plain);
+
+    double diff = relative_difference(assembled_values(matrix_plain, rhs_plain, ndof),
+      assembled_values(matrix_cached, rhs_cached, ndof));
+    info("%s: %d DOFs, %u local matrices reused, difference from the uncached assembling %g",
+      steps[step], ndof, hits, diff);
+    if (diff > TOLERANCE || (step > 0 && hits == 0))
+      success = false;
+  }
+
+  delete matrix_cached;
+  delete rhs_cached;
+  delete matrix_plain;
+  delete rhs_plain;
+
+  return test_result(success);
+}
@@ -0,0 +1,70 @@
+#ifndef __H2D_TESTS_ASSEMBLING_COMPARISON_H
+#define __H2D_TESTS_ASSEMBLING_COMPARISON_H
+
+#include "hermes2d.h"
+
+// Helpers of the tests that assemble one problem in two ways and compare the results.
+
+// Loads the mesh given as the first argument of the test and refines it uniformly.
+// Returns false if the argument is missing.
+inline bool load_test_mesh(int argc, char* argv[], const char* test_name, Hermes::Hermes2D::Mesh* mesh, int refinements)
+{
+  if (argc < 2)
+  {
+    printf("please input as this format: %s meshfile.mesh \n", test_name);
+    return false;
+  }
+  Hermes::Hermes2D::MeshReaderH2D mloader;
+  mloader.load(argv[1], mesh);
+  for (int i = 0; i < refinements; i++)
+    mesh->refine_all_elements();
+  return true;
+}
+
+// Assembled matrix and right-hand side in a form that does not depend on the storage: the product
+// of the matrix with a fixed vector and the values of the right-hand side, one after the other.
+inline std::vector<double> assembled_values(Hermes::Algebra::SparseMatrix<double>* matrix,
+  Hermes::Algebra::Vector<double>* rhs, int ndof)
+{
+  std::vector<double> values, x(ndof);
+  if (matrix != NULL)
+  {
+    for (int i = 0; i < ndof; i++)
+      x[i] = 1.0 + 0.01 * (i % 17);
+    values.resize(ndof);
+    matrix->multiply_with_vector(&x[0], &values[0]);
+  }
+  if (rhs != NULL)
+    for (int i = 0; i < ndof; i++)
+      values.push_back(rhs->get(i));
+  return values;
+}
+
+// Largest difference of two vectors of the same length relative to the largest entry of the first one.
+inline double relative_difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+  double diff = 0.0, size = 0.0;
+  for (unsigned int i = 0; i < a.size(); i++)
+  {
+    diff = std::max(diff, std::abs(a[i] - b[i]));
+    size = std::max(size, std::abs(a[i]));
+  }
+  return size > 0.0 ? diff / size : diff;
+}
+
+// Reports the result of the test and returns its exit code.
+inline int test_result(bool success)
+{
+  if (success)
+  {
+    info("Success!");
+    return TEST_SUCCESS;
+  }
+  else
+  {
+    info("Failure!");
+    return TEST_FAILURE;
+  }
+}
+
+#endif
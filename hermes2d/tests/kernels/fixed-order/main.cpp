@@ -0,0 +1,76 @@
+#define HERMES_REPORT_ALL
+#include "../../assembling_comparison.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+using namespace Hermes::Algebra;
+using namespace Hermes::Hermes2D::WeakFormsH1;
+
+// This test assembles the stiffness + mass matrix and a load vector on the given mesh of parallelograms
+// of the uniform orders 1 ... H2D_SF_MAX_FIXED_ORDER, once with the generic sum factorization
+// kernels and once with the fixed-size ones (see SumFactorization). It checks that the same element
+// matrices and vectors were integrated by sum factorization in both assemblings, that the fixed-size
+// kernels were used only when enabled (for the quadratures they cover), that the results agree, and
+// reports the assembling times of both.
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 3;
+
+// Repetitions of every assembling.
+const int NUM_REPEATS = 5;
+
+// Relative tolerance of the comparison.
+const double TOLERANCE = 1e-12;
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  if (!load_test_mesh(argc, argv, "fixed-order", &mesh, INIT_REF_NUM))
+    return TEST_FAILURE;
+
+  WeakForm<double> wf(1);
+  wf.add_matrix_form(new DefaultJacobianDiffusion<double>(0, 0));
+  wf.add_matrix_form(new DefaultMatrixFormVol<double>(0, 0));
+  wf.add_vector_form(new DefaultVectorFormVol<double>(0));
+
+  bool success = true;
+  for (int p = 1; p <= H2D_SF_MAX_FIXED_ORDER; p++)
+  {
+    H1Space<double> space(&mesh, p);
+    int ndof = space.get_num_dofs();
+    DiscreteProblem<double> dp(&wf, &space);
+    // Both kernels assemble into the same matrix, the problem allocates it only in the first assembling.
+    SparseMatrix<double>* matrix = create_matrix<double>(SOLVER_UMFPACK);
+    Vector<double>* vector = create_vector<double>(SOLVER_UMFPACK);
+
+    // The Jacobian form evaluates its (constant) coefficient at the previous iterate, zero here.
+    std::vector<double> coeff_vec(ndof, 0.0), values[2];
+    double time[2];
+    unsigned int integrations[2], fixed_integrations[2];
+    for (int fixed = 0; fixed < 2; fixed++)
+    {
+      SumFactorization<double>::set_fixed_kernels(fixed == 1);
+      SumFactorization<double>::reset_counters();
+      Hermes::TimePeriod timer;
+      for (int r = 0; r < NUM_REPEATS; r++)
+        dp.assemble(&coeff_vec[0], matrix, vector);
+      timer.tick();
+      time[fixed] = timer.accumulated() / NUM_REPEATS;
+      integrations[fixed] = SumFactorization<double>::get_num_integrations();
+      fixed_integrations[fixed] = SumFactorization<double>::get_num_fixed_integrations();
+      values[fixed] = assembled_values(matrix, vector, ndof);
+    }
+    delete matrix;
+    delete vector;
+
+    double diff = relative_difference(values[0], values[1]);
+    info("p = %2d, %5d DOFs: assembling %.3e s generic, %.3e s fixed (%.2fx), %u / %u fixed-size integrations, difference %g",
+      p, ndof, time[0], time[1], time[0] / time[1], fixed_integrations[1], integrations[1], diff);
+    if (diff > TOLERANCE || integrations[0] == 0 || fixed_integrations[0] != 0
+        || integrations[1] != integrations[0] || fixed_integrations[1] == 0)
+      success = false;
+  }
+  SumFactorization<double>::set_fixed_kernels(true);
+
+  return test_result(success);
+}
@@ -9,6 +9,7 @@
 #cmakedefine WITH_HDF5
 #cmakedefine WITH_EXODUSII
 #cmakedefine WITH_MPI
+#cmakedefine WITH_OPENMP
 
 // stacktrace
 #cmakedefine HAVE_TEUCHOS_LINK
@@ -13,12 +13,13 @@
 // You should have received a copy of the GNU General Public License
 // along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
 /*! \file array.h
-\brief File containing primarily the class Array<class TYPE> and LightArray<class TYPE>.
+\brief File containing primarily the class Array<class TYPE>, LightArray<class TYPE> and FlatHashMap<class KEY, class TYPE, class HASH>.
 */
 #ifndef __HERMES_COMMON_ARRAY_H
 #define __HERMES_COMMON_ARRAY_H
 
 #include <vector>
+#include <algorithm>
 #include <limits.h>
 
 #ifndef INVALID_IDX
@@ -356,6 +357,185 @@ namespace Hermes
       }
 
     };
+
+    /// Hash and equality of integer keys for FlatHashMap.
+    struct IntegerKeyHash
+    {
+      size_t operator()(unsigned long long key) const
+      {
+        // Finalizer of MurmurHash3, spreads the bits of sequential keys.
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (size_t) key;
+      }
+      bool operator()(unsigned long long a, unsigned long long b) const
+      {
+        return a == b;
+      }
+    };
+
+    /// \brief A hash table with open addressing, intended for the lookup caches on the assembling path.
+    ///
+    /// Items are stored in flat arrays (linear probing, at most half full) together with the hash
+    /// of their key, so that a lookup compares keys only for a matching hash and does not chase
+    /// pointers as a tree does. The last few successful lookups are remembered in a small direct-mapped
+    /// front cache indexed by the hash. Items cannot be removed one by one, only by clear().
+    /// HASH is a functor with 'size_t operator()(const KEY&)' returning the hash and
+    /// 'bool operator()(const KEY&, const KEY&)' deciding equality. KEY and TYPE must be default constructible.
+    /// Iteration is the same as for std::map (it->first, it->second), in no particular order.
+    template<class KEY, class TYPE, class HASH = IntegerKeyHash>
+    class FlatHashMap
+    {
+    public:
+      FlatHashMap(unsigned int initial_capacity = 16) : count(0), lookups(0), hits(0), front_hits(0)
+      {
+        unsigned int capacity = 16;
+        while (capacity < initial_capacity)
+          capacity *= 2;
+        resize(capacity);
+      }
+
+      /// Forward iterator over the items.
+      class iterator
+      {
+      public:
+        iterator() : map(NULL), slot(0) {}
+        iterator(FlatHashMap* map, unsigned int slot) : map(map), slot(slot) { skip(); }
+        std::pair<KEY, TYPE>* operator->() const { return &map->items[slot]; }
+        std::pair<KEY, TYPE>& operator*() const { return map->items[slot]; }
+        iterator& operator++() { slot++; skip(); return *this; }
+        iterator operator++(int) { iterator old = *this; ++(*this); return old; }
+        bool operator==(const iterator& other) const { return slot == other.slot; }
+        bool operator!=(const iterator& other) const { return slot != other.slot; }
+      protected:
+        void skip() { while (slot < map->used.size() && !map->used[slot]) slot++; }
+        FlatHashMap* map;
+        unsigned int slot;
+      };
+
+      iterator begin() { return iterator(this, 0); }
+      iterator end() { return iterator(this, used.size()); }
+
+      /// Returns the value stored for key, NULL if not present.
+      TYPE* find(const KEY& key)
+      {
+        return find(key, hasher(key));
+      }
+
+      /// The same with the hash of the key precomputed by the caller.
+      TYPE* find(const KEY& key, size_t hash)
+      {
+        lookups++;
+        unsigned int& front_slot = front[hash & (H2D_FRONT_SIZE - 1)];
+        if (used[front_slot] && hashes[front_slot] == hash && hasher(items[front_slot].first, key))
+        {
+          hits++;
+          front_hits++;
+          return &items[front_slot].second;
+        }
+        unsigned int slot = (unsigned int) hash & mask;
+        while (used[slot])
+        {
+          if (hashes[slot] == hash && hasher(items[slot].first, key))
+          {
+            hits++;
+            front_slot = slot;
+            return &items[slot].second;
+          }
+          slot = (slot + 1) & mask;
+        }
+        return NULL;
+      }
+
+      /// Adds an item, key must not be present yet. Returns the stored value.
+      TYPE& add(const KEY& key, const TYPE& value)
+      {
+        return add(key, hasher(key), value);
+      }
+
+      /// The same with the hash of the key precomputed by the caller.
+      TYPE& add(const KEY& key, size_t hash, const TYPE& value)
+      {
+        if (2 * (count + 1) > hashes.size())
+          resize(2 * hashes.size());
+        unsigned int slot = insert(key, hash, value);
+        count++;
+        return items[slot].second;
+      }
+
+      /// Removes all items, keeps the allocated memory.
+      void clear()
+      {
+        if (count == 0)
+          return;
+        std::fill(used.begin(), used.end(), 0);
+        count = 0;
+      }
+
+      /// Number of items.
+      unsigned int size() const { return count; }
+
+      bool empty() const { return count == 0; }
+
+      /// Statistics: number of calls to find(), of those successful, and of those served by the front cache.
+      unsigned int get_num_lookups() const { return lookups; }
+      unsigned int get_num_hits() const { return hits; }
+      unsigned int get_num_front_hits() const { return front_hits; }
+
+      /// Memory taken by the table in bytes (not counting memory the keys and values point to).
+      size_t get_memory_size() const
+      {
+        return hashes.size() * (sizeof(size_t) + sizeof(char) + sizeof(std::pair<KEY, TYPE>));
+      }
+
+    protected:
+      static const unsigned int H2D_FRONT_SIZE = 4;
+
+      unsigned int insert(const KEY& key, size_t hash, const TYPE& value)
+      {
+        unsigned int slot = (unsigned int) hash & mask;
+        while (used[slot])
+          slot = (slot + 1) & mask;
+        used[slot] = 1;
+        hashes[slot] = hash;
+        items[slot].first = key;
+        items[slot].second = value;
+        front[hash & (H2D_FRONT_SIZE - 1)] = slot;
+        return slot;
+      }
+
+      void resize(unsigned int capacity)
+      {
+        std::vector<size_t> old_hashes(capacity);
+        std::vector<char> old_used(capacity, 0);
+        std::vector<std::pair<KEY, TYPE> > old_items(capacity);
+        old_hashes.swap(hashes);
+        old_used.swap(used);
+        old_items.swap(items);
+        mask = capacity - 1;
+        for (unsigned int i = 0; i < H2D_FRONT_SIZE; i++)
+          front[i] = 0;
+        for (unsigned int i = 0; i < old_hashes.size(); i++)
+          if (old_used[i])
+            insert(old_items[i].first, old_hashes[i], old_items[i].second);
+      }
+
+      std::vector<size_t> hashes;
+      std::vector<char> used;
+      std::vector<std::pair<KEY, TYPE> > items;
+      unsigned int mask;
+      unsigned int count;
+
+      /// Slots of the recently found items, indexed by the low bits of the hash.
+      unsigned int front[H2D_FRONT_SIZE];
+
+      HASH hasher;
+
+      unsigned int lookups, hits, front_hits;
+    };
   }
 }
 #endif
@@ -25,8 +25,12 @@
 #include <stdio.h>
 #include "compat.h"
 
+// The call stack costs a push and a pop in every function marked by _F_, release builds
+// leave it out (HERMES_NO_CALLSTACK, see WITH_CALLSTACK_IN_RELEASE in CMakeLists.txt).
+#ifdef HERMES_NO_CALLSTACK
+  #define _F_
 // __PRETTY_FUNCTION__ missing on MSVC
-#ifndef __GNUC__
+#elif !defined(__GNUC__)
   #define _F_ CallStackObj __call_stack_obj(__LINE__, __FUNCTION__, __FILE__);
 #else
   #define _F_ CallStackObj __call_stack_obj(__LINE__, __PRETTY_FUNCTION__, __FILE__);
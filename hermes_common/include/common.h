@@ -57,6 +57,8 @@
 #include "hermes_logging.h"
 #include "hermes_function.h"
 #include "common_time_period.h"
+#include "common_cache_counter.h"
+#include "common_profiler.h"
 #include "compat.h"
 #include "callstack.h"
 #include "error.h"
@@ -149,16 +151,18 @@ namespace Hermes
     SOLVER_MUMPS,
     SOLVER_SUPERLU,
     SOLVER_AMESOS,
-    SOLVER_AZTECOO
+    SOLVER_AZTECOO,
+    SOLVER_HERMES_ITERATIVE
   };
 
-  const std::string MatrixSolverNames[6] = {
+  const std::string MatrixSolverNames[7] = {
     "UMFPACK",
     "PETSc",
     "MUMPS",
     "SuperLU",
     "Trilinos/Amesos",
-    "Trilinos/AztecOO"
+    "Trilinos/AztecOO",
+    "Hermes iterative"
   };
 
   struct HERMES_API SplineCoeff
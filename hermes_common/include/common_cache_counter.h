@@ -0,0 +1,64 @@
+// This file is part of HermesCommon
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file common_cache_counter.h
+    \brief File containing the class CacheMissCounter for measuring cache misses.
+*/
+#ifndef __HERMES_COMMON_CACHE_COUNTER_H
+#define __HERMES_COMMON_CACHE_COUNTER_H
+
+#include "compat.h"
+#include "common_time_period.h"
+
+#ifdef _MSC_VER
+#include <inttypes.h>
+#endif
+
+namespace Hermes
+{
+  /// Counts the cache misses (and the cache references) of the calling thread between ticks,
+  /// in the same way as TimePeriod measures time.
+  /** Uses the hardware counters of the Linux perf events. Where they are not available
+  *  (other systems, no permission, virtual machines without PMU), available() returns false
+  *  and all counts are -1. The class is not thread-safe. */
+  class HERMES_API CacheMissCounter
+  {
+  public:
+    CacheMissCounter(); ///< Opens the counters and starts counting.
+    ~CacheMissCounter();
+
+    /// Whether the hardware counters are available.
+    bool available() const;
+
+    const CacheMissCounter& reset(); ///< Resets accumulated counts.
+    const CacheMissCounter& tick(TimerPeriodTickType type = HERMES_ACCUMULATE); ///< Starts/ends a new period.
+
+    /// Accumulated number of cache misses.
+    long long accumulated_misses() const;
+    /// Accumulated number of cache references.
+    long long accumulated_references() const;
+    /// Cache misses of the last measured period.
+    long long last_misses() const;
+
+  private:
+    int fd_misses, fd_references;
+    long long last_count_misses, last_count_references;
+    long long accum_misses, accum_references;
+    long long last_period_misses;
+
+    long long read_counter(int fd) const;
+  };
+}
+#endif
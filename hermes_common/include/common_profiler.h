@@ -0,0 +1,166 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file common_profiler.h
+    \brief File containing the scoped timers and counters of the hot paths (class Profiler).
+*/
+#ifndef __HERMES_COMMON_PROFILER_H
+#define __HERMES_COMMON_PROFILER_H
+
+#include <stdio.h>
+#include "compat.h"
+
+/// Times the rest of the enclosing scope under the given section name.
+/** Expands to nothing unless the library is built with WITH_PROFILING. At most one per scope,
+*  sections of the same name (e.g. in several overloads) are summed in the report. */
+#ifdef WITH_PROFILING
+  #define HERMES_PROFILE(name) \
+    static Hermes::ProfilerSection __profiler_section(name); \
+    Hermes::ProfilerScope __profiler_scope(__profiler_section);
+  /// Adds n to the counter of the given name.
+  #define HERMES_PROFILE_COUNT(name, n) \
+    { static Hermes::ProfilerSection __profiler_counter(name); __profiler_counter.count(n); }
+#else
+  #define HERMES_PROFILE(name)
+  #define HERMES_PROFILE_COUNT(name, n)
+#endif
+
+namespace Hermes
+{
+  /// Number of threads (OpenMP thread numbers) recorded separately. Higher thread numbers are
+  /// not recorded.
+  const int HERMES_PROFILER_MAX_THREADS = 64;
+
+  /// Format of the report of the Profiler.
+  enum ProfilerReportFormat
+  {
+    HERMES_PROFILER_TEXT, ///< A table sorted by the total time.
+    HERMES_PROFILER_JSON ///< An array of objects, one per section.
+  };
+
+  /// One named section timed by HERMES_PROFILE or counted by HERMES_PROFILE_COUNT.
+  /** The sections are static objects created at the first use, every thread accumulates
+  *  into its own slot, the slots are only summed up in the report. */
+  class HERMES_API ProfilerSection
+  {
+  public:
+    ProfilerSection(const char* name);
+
+    /// Adds one call of the length time (in seconds) to the slot of the calling thread.
+    void add(double time);
+
+    /// Adds n to the counter of the calling thread.
+    void count(long long n);
+
+  protected:
+    /// Accumulated values of one thread, a cache line each so that the threads do not share one.
+    struct Slot
+    {
+      long long calls;
+      long long count;
+      double time;
+      char padding[64 - 2 * sizeof(long long) - sizeof(double)];
+    };
+
+    const char* name;
+    Slot slots[HERMES_PROFILER_MAX_THREADS];
+
+    /// The next section in the list of all sections.
+    ProfilerSection* next;
+
+    /// Returns the slot of the calling thread, or NULL.
+    Slot* get_slot();
+
+    friend class Profiler;
+  };
+
+  /// Measures the time between its construction and destruction into a ProfilerSection.
+  class HERMES_API ProfilerScope
+  {
+  public:
+    ProfilerScope(ProfilerSection& section);
+    ~ProfilerScope();
+
+  private:
+    ProfilerSection* section;
+    double start;
+  };
+
+  /// Collects the results of all profiler sections.
+  /** Profiling is compiled in by the build option WITH_PROFILING (without it HERMES_PROFILE
+  *  expands to nothing and the report is empty) and can be switched off at run time by
+  *  enable(false). Section times are inclusive, i.e. they contain the nested sections. */
+  class HERMES_API Profiler
+  {
+  public:
+    /// Switches the measurements on / off (they are on by default).
+    static void enable(bool enable = true);
+    static bool is_enabled();
+
+    /// Returns true if the library has been built with WITH_PROFILING.
+    static bool is_compiled_in();
+
+    /// Clears all accumulated times and counts.
+    static void reset();
+
+    /// Writes the results summed over all threads.
+    static void report(FILE* file, ProfilerReportFormat format = HERMES_PROFILER_TEXT);
+
+    /// Writes the results to the file of the given name, returns false if it can not be opened.
+    static bool report(const char* filename, ProfilerReportFormat format = HERMES_PROFILER_TEXT);
+
+    /// Writes the report to the file (stdout for NULL) when the program exits.
+    static void report_at_exit(const char* filename = NULL, ProfilerReportFormat format = HERMES_PROFILER_TEXT);
+
+    /// Returns the time (in seconds) and the number of calls of all sections of the given name.
+    static double get_time(const char* name, long long* calls = NULL);
+
+    /// Returns the sum of the counters of the given name.
+    static long long get_count(const char* name);
+
+    /// Current time (in seconds) of a monotonic clock.
+    static double now();
+
+  protected:
+    static bool enabled;
+
+    /// Head of the list of all sections.
+    static ProfilerSection* sections;
+
+    friend class ProfilerSection;
+    friend class ProfilerScope;
+  };
+
+  inline ProfilerScope::ProfilerScope(ProfilerSection& section)
+  {
+    if (Profiler::enabled)
+    {
+      this->section = &section;
+      start = Profiler::now();
+    }
+    else
+      this->section = NULL;
+  }
+
+  inline ProfilerScope::~ProfilerScope()
+  {
+    if (section != NULL)
+      section->add(Profiler::now() - start);
+  }
+}
+#endif
@@ -29,8 +29,11 @@
 #include "solvers/newton_solver_nox.h"
 #include "solvers/petsc_solver.h"
 #include "solvers/umfpack_solver.h"
+#include "solvers/iterative_solver.h"
 #include "solvers/superlu_solver.h"
 #include "solvers/precond.h"
 #include "solvers/precond_ifpack.h"
 #include "solvers/precond_ml.h"
+#include "solvers/precond_csc.h"
+#include "solvers/precond_amg.h"
 #include "solvers/eigensolver.h"
@@ -417,6 +417,12 @@ namespace Hermes
         error("multiply_with_vector() undefined.");
       };
 
+      /// Multiply with several vectors at once.
+      virtual void multiply_with_vectors(int num_vectors, Scalar** vectors_in, Scalar** vectors_out) {
+        for (int i = 0; i < num_vectors; i++)
+          multiply_with_vector(vectors_in[i], vectors_out[i]);
+      };
+
       /// Multiply with a Scalar.
       virtual void multiply_with_Scalar(Scalar value) {
         error("multiply_with_Scalar() undefined.");
@@ -0,0 +1,123 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file iterative_solver.h
+\brief Native preconditioned Krylov solvers (CG, GMRES, BiCGStab) working on CSCMatrix or matrix-free operators.
+*/
+#ifndef __HERMES_COMMON_ITERATIVE_SOLVER_H_
+#define __HERMES_COMMON_ITERATIVE_SOLVER_H_
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "linear_solver.h"
+#include "umfpack_solver.h"
+#include "precond_csc.h"
+#include "precond_amg.h"
+
+namespace Hermes
+{
+  namespace Solvers
+  {
+    /// \brief Preconditioned Krylov solvers working directly on CSCMatrix / UMFPackVector,
+    /// without any third party library. Only the matrix, the preconditioner and a few
+    /// vectors are stored, no factorization with fill-in.
+    ///
+    /// The convergence criterion is the relative residual |b - Ax| / |b| < tolerance.
+    /// The preconditioner is applied from the left in CG and from the right in GMRES
+    /// and BiCGStab (so that the true residual is monitored).
+    ///
+    /// @ingroup solvers
+    template <typename Scalar>
+    class HERMES_API IterativeSolver : public IterSolver<Scalar>
+    {
+    public:
+      IterativeSolver(CSCMatrix<Scalar> *m, UMFPackVector<Scalar> *rhs);
+
+      /// Solver for an operator given only by its product with a vector (SparseMatrix::multiply_with_vector(),
+      /// e.g. a matrix-free operator). A preconditioner can only be used if an assembled matrix pc_matrix
+      /// (e.g. a lower order approximation of the operator) is given to compute it from.
+      IterativeSolver(SparseMatrix<Scalar> *op, UMFPackVector<Scalar> *rhs, CSCMatrix<Scalar> *pc_matrix = NULL);
+      virtual ~IterativeSolver();
+
+      /// Set the type of the solver.
+      /// @param[in] name - name of the solver [ cg | gmres | bicgstab | richardson ]
+      /// (richardson iterates x += M^{-1} (b - Ax), with the AMG preconditioner it is a standalone multigrid solver)
+      void set_solver(const char *name);
+
+      /// Set the preconditioner.
+      /// @param[in] name - name of the preconditioner [ none | jacobi | ilu0 | ssor | amg ]
+      virtual void set_precond(const char *name);
+
+      /// Set a preconditioner created by the user (not deleted by the solver).
+      void set_precond(Preconditioners::CSCPrecond<Scalar> *pc);
+
+      /// Set the number of iterations after which GMRES is restarted.
+      void set_restart(int restart);
+
+      virtual bool solve();
+      virtual int get_matrix_size();
+      virtual int get_num_iters();
+      virtual double get_residual();
+
+      /// Reuse of the preconditioner: HERMES_REUSE_FACTORIZATION_COMPLETELY keeps the preconditioner
+      /// computed in the previous solve, anything else recomputes it from the current matrix.
+      virtual void set_factorization_scheme(FactorizationScheme reuse_scheme);
+
+    protected:
+      /// Only the Epetra-based preconditioners are of this type, they cannot be used here.
+      virtual void set_precond(Precond<Scalar> *pc);
+
+      enum Method
+      {
+        METHOD_CG,
+        METHOD_GMRES,
+        METHOD_BICGSTAB,
+        METHOD_RICHARDSON
+      };
+
+      bool solve_cg(Scalar* x, const Scalar* b, double norm_b);
+      bool solve_gmres(Scalar* x, const Scalar* b, double norm_b);
+      bool solve_bicgstab(Scalar* x, const Scalar* b, double norm_b);
+      bool solve_richardson(Scalar* x, const Scalar* b, double norm_b);
+
+      /// Applies the preconditioner (identity if none).
+      void precondition(const Scalar* r, Scalar* z);
+
+      /// The matrix the preconditioner is computed from (NULL for a matrix-free operator without one).
+      CSCMatrix<Scalar> *m;
+      /// The operator of the system, the same as m unless given separately.
+      SparseMatrix<Scalar> *op;
+      UMFPackVector<Scalar> *rhs;
+
+      Method method;
+      int restart;
+      Preconditioners::CSCPrecond<Scalar> *pc;
+      /// True if pc was created in set_precond(const char*) and is deleted by the solver.
+      bool own_pc;
+      /// True if pc has been computed and may be reused.
+      bool pc_computed;
+      FactorizationScheme reuse_scheme;
+
+      int num_iters;
+      double residual;
+
+      template<typename T> friend LinearSolver<T>* create_linear_solver(Hermes::MatrixSolverType matrix_solver_type, Matrix<T>* matrix, Vector<T>* rhs);
+    };
+  }
+}
+#endif
+#endif
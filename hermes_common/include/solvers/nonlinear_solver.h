@@ -51,13 +51,13 @@ namespace Hermes
       /// Sets the attribute verbose_output to the paramater passed.
       void set_verbose_output(bool verbose_output_to_set);
 
-      /// Set the name of the iterative method employed by AztecOO (ignored
-      /// by the other solvers).
+      /// Set the name of the iterative method employed by AztecOO or the Hermes iterative
+      /// solver (ignored by the other solvers).
       /// \param[in] preconditioner_name See the attribute preconditioner.
       void set_iterative_method(const char* iterative_method_name);
 
-      /// Set the name of the preconditioner employed by AztecOO (ignored by
-      /// the other solvers).
+      /// Set the name of the preconditioner employed by AztecOO or the Hermes iterative
+      /// solver (ignored by the other solvers).
       /// \param[in] preconditioner_name See the attribute preconditioner.
       void set_preconditioner(const char* preconditioner_name);
 
@@ -85,15 +85,17 @@ namespace Hermes
       /// Preconditioned solver.
       bool precond_yes;
 
-      /// Name of the iterative method employed by AztecOO (ignored
-      /// by the other solvers).
-      /// Possibilities: gmres, cg, cgs, tfqmr, bicgstab.
+      /// Name of the iterative method employed by AztecOO or the Hermes iterative solver
+      /// (ignored by the other solvers), NULL if not set.
+      /// Possibilities: gmres, cg, cgs, tfqmr, bicgstab (AztecOO), cg, gmres, bicgstab,
+      /// richardson (Hermes iterative solver, see IterativeSolver::set_solver()).
       char* iterative_method;
 
-      /// Name of the preconditioner employed by AztecOO (ignored by
-      /// the other solvers).
+      /// Name of the preconditioner employed by AztecOO or the Hermes iterative solver
+      /// (ignored by the other solvers), NULL if not set.
       /// Possibilities: none, jacobi, neumann, least-squares, or a
-      ///  preconditioner from IFPACK (see solver/aztecoo.h).
+      ///  preconditioner from IFPACK (see solver/aztecoo.h) for AztecOO, none, jacobi,
+      ///  ilu0, ssor, amg for the Hermes iterative solver (see IterativeSolver::set_precond()).
       char* preconditioner;
     };
   }
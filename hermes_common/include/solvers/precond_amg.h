@@ -0,0 +1,161 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file precond_amg.h
+\brief Smoothed aggregation algebraic multigrid preconditioner working on CSCMatrix.
+*/
+#ifndef __HERMES_COMMON_PRECOND_AMG_H_
+#define __HERMES_COMMON_PRECOND_AMG_H_
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "precond_csc.h"
+
+namespace Hermes
+{
+  namespace Preconditioners
+  {
+    /// \brief Smoothed aggregation algebraic multigrid.
+    ///
+    /// The hierarchy is built from the connectivity of the matrix: the strongly connected
+    /// unknowns (|a_ij| > theta sqrt(|a_ii a_jj|)) are grouped into aggregates, the piecewise
+    /// constant tentative prolongator is smoothed by one damped Jacobi step with the filtered
+    /// matrix, and the coarse matrices are the Galerkin products P^T A P. The coarsest level
+    /// is solved by a dense LU factorization.
+    ///
+    /// One application of the preconditioner is one V- or W-cycle with zero initial guess,
+    /// with symmetric Gauss-Seidel or Chebyshev smoothing (the cycle is then symmetric for
+    /// symmetric matrices and can be used with CG). Used with IterativeSolver::set_solver("richardson")
+    /// it makes a standalone multigrid solver.
+    ///
+    /// If the sparse structure of the matrix did not change since the last compute() (typically
+    /// in Newton iterations), the aggregates and the sparse structures of the hierarchy are kept and only
+    /// the values are recomputed.
+    ///
+    /// @ingroup preconds
+    template <typename Scalar>
+    class HERMES_API AMGPrecond : public CSCPrecond<Scalar>
+    {
+    public:
+      enum Smoother
+      {
+        SMOOTHER_GAUSS_SEIDEL,
+        SMOOTHER_CHEBYSHEV
+      };
+
+      enum Cycle
+      {
+        CYCLE_V,
+        CYCLE_W
+      };
+
+      AMGPrecond();
+      virtual ~AMGPrecond();
+      virtual void destroy();
+      virtual void compute();
+      virtual void apply(const Scalar* r, Scalar* z) const;
+
+      /// Set the smoother.
+      /// @param[in] smoother - Gauss-Seidel (forward before, backward after the coarse correction)
+      /// or Chebyshev polynomial of D^{-1}A.
+      /// @param[in] sweeps - number of Gauss-Seidel sweeps / degree of the Chebyshev polynomial.
+      void set_smoother(Smoother smoother, int sweeps = 1);
+      void set_cycle(Cycle cycle);
+      /// Set the strength of connection threshold (default 0.08).
+      void set_strength_threshold(double theta);
+      /// Set the size under which a level is solved directly (default 500).
+      void set_coarse_size(int coarse_size);
+      void set_max_levels(int max_levels);
+      /// Keep the aggregates if the sparse structure of the matrix did not change (default true).
+      void set_reuse_setup(bool reuse);
+
+      int get_num_levels() const;
+      /// Sum of nonzeros on all levels divided by the nonzeros of the matrix.
+      double get_operator_complexity() const;
+      /// True if the last compute() only recomputed the values of the hierarchy.
+      bool setup_reused() const;
+
+    protected:
+      /// Sparse matrix stored by rows.
+      struct SparseRows
+      {
+        SparseRows() : num_rows(0), num_cols(0) { }
+        int num_rows, num_cols;
+        std::vector<int> row_ptr;
+        std::vector<int> col;
+        std::vector<Scalar> val;
+
+        /// y = A x.
+        void multiply(const Scalar* x, Scalar* y) const;
+        /// Structure and values of the transposed matrix.
+        void transpose(SparseRows& t) const;
+        /// c = this * b; the structure of c is computed only if symbolic is true.
+        void multiply(const SparseRows& b, SparseRows& c, bool symbolic) const;
+      };
+
+      struct Level
+      {
+        SparseRows A;
+        /// Position of the diagonal entry in each row of A.
+        std::vector<int> diag;
+        std::vector<Scalar> inv_diag;
+        /// Estimate of the spectral radius of D^{-1}A.
+        double rho;
+        /// Aggregate of each unknown (the unknown of the coarser level).
+        std::vector<int> aggregates;
+        int num_aggregates;
+        /// Prolongator from the coarser level and the restriction (its transposition).
+        SparseRows P, R;
+        /// A P, kept for the reuse of its structure.
+        SparseRows AP;
+        /// Work vectors.
+        mutable std::vector<Scalar> x, b, r, d, w;
+      };
+
+      /// Groups strongly connected unknowns of the level into aggregates.
+      void aggregate(Level& level) const;
+      /// Smooths the tentative prolongator of the level.
+      void build_prolongator(Level& level, bool symbolic) const;
+      /// Inverse diagonal and spectral radius estimate.
+      void init_level(Level& level) const;
+      void factorize_coarse();
+      void solve_coarse(const Scalar* b, Scalar* x) const;
+
+      /// One cycle on the level (x is the initial guess).
+      void cycle(int l, const Scalar* b, Scalar* x) const;
+      void smooth(const Level& level, const Scalar* b, Scalar* x, bool pre) const;
+
+      bool is_strong(const Level& level, int i, int k) const;
+
+      std::vector<Level> levels;
+      /// Dense LU factorization of the coarsest matrix (row-wise) and the row permutation.
+      std::vector<Scalar> coarse_lu;
+      std::vector<int> coarse_perm;
+
+      Smoother smoother;
+      int sweeps;
+      Cycle cycle_type;
+      double theta;
+      int coarse_size;
+      int max_levels;
+      bool reuse;
+      bool reused;
+    };
+  }
+}
+#endif
+#endif
@@ -0,0 +1,134 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file precond_csc.h
+\brief Preconditioners for the Hermes iterative solvers (Jacobi, ILU(0), SSOR) working on CSCMatrix.
+*/
+#ifndef __HERMES_COMMON_PRECOND_CSC_H_
+#define __HERMES_COMMON_PRECOND_CSC_H_
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "umfpack_solver.h"
+
+namespace Hermes
+{
+  namespace Preconditioners
+  {
+    /// \brief Abstract class for preconditioners of the Hermes iterative solvers.
+    /// Unlike Precond, it does not depend on Epetra: it is created from a CSCMatrix
+    /// and applied to plain arrays.
+    ///
+    /// @ingroup preconds
+    template <typename Scalar>
+    class HERMES_API CSCPrecond
+    {
+    public:
+      CSCPrecond();
+      virtual ~CSCPrecond();
+
+      /// Sets the matrix to precondition. compute() has to be called before apply().
+      virtual void create(CSCMatrix<Scalar>* mat);
+      /// Releases the data computed by compute().
+      virtual void destroy() = 0;
+      /// Computes the preconditioner from the current values of the matrix.
+      virtual void compute() = 0;
+      /// Applies the inverse of the preconditioner: z = M^{-1} r.
+      virtual void apply(const Scalar* r, Scalar* z) const = 0;
+
+    protected:
+      /// Copies the row-wise structure and values of the matrix (arrays allocated here).
+      void copy_rows(int*& row_ptr, int*& col, Scalar*& val, int*& diag) const;
+      /// Extracts the diagonal of the matrix.
+      void extract_diagonal(Scalar* d) const;
+
+      CSCMatrix<Scalar>* mat;
+    };
+
+    /// \brief Jacobi (diagonal) preconditioner.
+    ///
+    /// @ingroup preconds
+    template <typename Scalar>
+    class HERMES_API JacobiPrecond : public CSCPrecond<Scalar>
+    {
+    public:
+      JacobiPrecond();
+      virtual ~JacobiPrecond();
+      virtual void destroy();
+      virtual void compute();
+      virtual void apply(const Scalar* r, Scalar* z) const;
+
+    protected:
+      /// Inverted diagonal of the matrix.
+      Scalar* inv_diag;
+      unsigned int size;
+    };
+
+    /// \brief Incomplete LU factorization with no fill-in.
+    /// The factors have the sparse structure of the matrix, L has a unit diagonal.
+    ///
+    /// @ingroup preconds
+    template <typename Scalar>
+    class HERMES_API ILU0Precond : public CSCPrecond<Scalar>
+    {
+    public:
+      ILU0Precond();
+      virtual ~ILU0Precond();
+      virtual void destroy();
+      virtual void compute();
+      virtual void apply(const Scalar* r, Scalar* z) const;
+
+    protected:
+      /// Row-wise structure of the factors (the structure of the matrix).
+      int* row_ptr;
+      int* col;
+      /// Values of L (strictly lower part) and U (upper part including the diagonal), row-wise.
+      Scalar* lu;
+      /// Position of the diagonal entry in each row.
+      int* diag;
+      unsigned int size;
+    };
+
+    /// \brief Symmetric successive over-relaxation preconditioner
+    /// M = omega / (2 - omega) (D / omega + L) (D / omega)^{-1} (D / omega + U).
+    ///
+    /// @ingroup preconds
+    template <typename Scalar>
+    class HERMES_API SSORPrecond : public CSCPrecond<Scalar>
+    {
+    public:
+      /// @param[in] omega relaxation parameter from (0, 2).
+      SSORPrecond(double omega = 1.0);
+      virtual ~SSORPrecond();
+      virtual void destroy();
+      virtual void compute();
+      virtual void apply(const Scalar* r, Scalar* z) const;
+
+    protected:
+      double omega;
+      /// Row-wise copy of the matrix (the matrix may change while the preconditioner is kept).
+      int* row_ptr;
+      int* col;
+      Scalar* val;
+      /// Position of the diagonal entry in each row.
+      int* diag;
+      unsigned int size;
+    };
+  }
+}
+#endif
+#endif
@@ -35,6 +35,11 @@ namespace Hermes
   {
     template <typename Scalar> class HERMES_API UMFPackLinearSolver;
     template <typename Scalar> class HERMES_API UMFPackIterator;
+    template <typename Scalar> class HERMES_API IterativeSolver;
+  }
+  namespace Preconditioners
+  {
+    template <typename Scalar> class HERMES_API CSCPrecond;
   }
 
   namespace Algebra
@@ -67,6 +72,9 @@ namespace Hermes
       virtual void zero();
       virtual void add(unsigned int m, unsigned int n, Scalar v);
       virtual void add_to_diagonal(Scalar v);
+      /// Ends adding of the values by add() (which may run in parallel and does not invalidate
+      /// the row-wise mirror of the values itself).
+      virtual void finish();
       /// Add matrix.
       /// @param[in] mat matrix to be added
       virtual void add_matrix(CSCMatrix<Scalar>* mat);
@@ -87,7 +95,12 @@ namespace Hermes
       virtual double get_fill_in() const;
 
       // Applies the matrix to vector_in and saves result to vector_out.
+      // Uses the row-wise mirror of the matrix (see #csr_Ap), rows are split
+      // among the threads when built with OpenMP.
       void multiply_with_vector(Scalar* vector_in, Scalar* vector_out);
+      // Applies the matrix to num_vectors vectors at once (multi-component systems,
+      // several right-hand sides); the matrix is read only once for all of them.
+      void multiply_with_vectors(int num_vectors, Scalar** vectors_in, Scalar** vectors_out);
       // Multiplies matrix with a Scalar.
       void multiply_with_Scalar(Scalar value);
       
@@ -113,8 +126,51 @@ namespace Hermes
       int *Ap;
       /// Number of non-zero entries ( =  Ap[size]).
       unsigned int nnz;
+
+      /// States of the assembly map.
+      enum AssemblyMapState
+      {
+        ASSEMBLY_MAP_RECORDING,
+        ASSEMBLY_MAP_REPLAYING,
+        ASSEMBLY_MAP_INVALID
+      };
+
+      /// Persistent assembly map: positions in Ax of all entries inserted by add(m, n, mat, rows, cols),
+      /// in the order of insertion. Recorded during the first assembling after alloc(); when the same
+      /// sequence of local matrices is inserted again after zero(), the values are scattered directly
+      /// to Ax without searching. Every position is checked against Ap/Ai, a different sequence of
+      /// insertions invalidates the map (which is then recorded again in the next assembling).
+      std::vector<int> assembly_map;
+      /// Current position in assembly_map when replaying.
+      unsigned int assembly_map_pos;
+      AssemblyMapState assembly_map_state;
+
+      /// Resets the assembly map (the sparse structure changed).
+      void reset_assembly_map();
+
+      /// Row-wise (CSR) mirror of the matrix used in matrix-vector products. The column-wise
+      /// storage only allows a scatter product which cannot be split among threads.
+      /// Index to csr_Aj/csr_Ax, where each row starts (size is matrix size + 1).
+      int *csr_Ap;
+      /// Column indices of values in csr_Ax.
+      int *csr_Aj;
+      /// Position in Ax of each entry of the mirror.
+      int *csr_perm;
+      /// Matrix entries (row-wise).
+      Scalar *csr_Ax;
+      /// False when Ax may have changed since csr_Ax was last copied from it. Reset by zero(), finish()
+      /// and the other methods changing the values, but not by add(), so that concurrent add() calls
+      /// do not write it.
+      bool csr_values_valid;
+
+      /// Builds the structure of the mirror (if not built yet) and refreshes its values.
+      void update_csr_mirror();
+      /// Releases the mirror (the sparse structure changed).
+      void free_csr_mirror();
       template <typename T> friend class Hermes::Solvers::UMFPackLinearSolver;
       template <typename T> friend class Hermes::Solvers::UMFPackIterator;
+      template <typename T> friend class Hermes::Solvers::IterativeSolver;
+      template <typename T> friend class Hermes::Preconditioners::CSCPrecond;
       template<typename T> friend SparseMatrix<T>*  create_matrix(Hermes::MatrixSolverType matrix_solver_type);
     };
 
@@ -159,6 +215,7 @@ namespace Hermes
       /// UMFPack specific data structures for storing the rhs.
       Scalar *v;
       template <typename T> friend class Hermes::Solvers::UMFPackLinearSolver;
+      template <typename T> friend class Hermes::Solvers::IterativeSolver;
       template <typename T> friend class Hermes::Solvers::UMFPackIterator;
       template<typename T> friend Vector<T>* Hermes::Algebra::create_vector(Hermes::MatrixSolverType matrix_solver_type);
     };
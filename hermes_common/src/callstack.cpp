@@ -19,10 +19,14 @@
 /*! \file callstack.cpp
     \brief File containing functionality for investigating call stack.
 */
+#include "config.h"
 #include "callstack.h"
 #include "third_party_codes/trilinos-teuchos/Teuchos_stacktrace.hpp"
 #include <signal.h>
 #include <stdlib.h>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
 
 /// Definition of the global CallStack instance.
 CallStack callstack;
@@ -33,6 +37,12 @@ CallStackObj::CallStackObj(int ln, const char *func, const char *file)
   this->func = func;
   this->file = file;
 
+#ifdef WITH_OPENMP
+  // The call stack is not thread-safe, only the master thread is recorded.
+  if (omp_get_thread_num() != 0)
+    return;
+#endif
+
   // add this object to the call stack
   if (callstack.size < callstack.max_size)
   {
@@ -43,6 +53,11 @@ CallStackObj::CallStackObj(int ln, const char *func, const char *file)
 
 CallStackObj::~CallStackObj()
 {
+#ifdef WITH_OPENMP
+  if (omp_get_thread_num() != 0)
+    return;
+#endif
+
   // remove the object only if it is on the top of the call stack
   if (callstack.size > 0 && callstack.stack[callstack.size - 1] == this)
   {
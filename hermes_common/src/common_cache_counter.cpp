@@ -0,0 +1,132 @@
+// This file is part of HermesCommon
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file common_cache_counter.cpp
+    \brief File containing the class CacheMissCounter for measuring cache misses.
+*/
+#include <time.h>
+#include <string.h>
+#include <string>
+#include <fstream>
+#include "common_cache_counter.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace Hermes
+{
+#ifdef __linux__
+  static int open_hw_counter(unsigned long long config)
+  {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // This thread on any cpu.
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    return fd;
+  }
+#endif
+
+  CacheMissCounter::CacheMissCounter() : fd_misses(-1), fd_references(-1)
+  {
+#ifdef __linux__
+    fd_misses = open_hw_counter(PERF_COUNT_HW_CACHE_MISSES);
+    if (fd_misses >= 0)
+      fd_references = open_hw_counter(PERF_COUNT_HW_CACHE_REFERENCES);
+#endif
+    reset();
+  }
+
+  CacheMissCounter::~CacheMissCounter()
+  {
+#ifdef __linux__
+    if (fd_misses >= 0)
+      close(fd_misses);
+    if (fd_references >= 0)
+      close(fd_references);
+#endif
+  }
+
+  bool CacheMissCounter::available() const
+  {
+    return fd_misses >= 0;
+  }
+
+  long long CacheMissCounter::read_counter(int fd) const
+  {
+#ifdef __linux__
+    long long count;
+    if (fd >= 0 && read(fd, &count, sizeof(count)) == sizeof(count))
+      return count;
+#endif
+    return -1;
+  }
+
+  const CacheMissCounter& CacheMissCounter::tick(TimerPeriodTickType type)
+  {
+    long long misses = read_counter(fd_misses);
+    long long references = read_counter(fd_references);
+    if (type == HERMES_ACCUMULATE && misses >= 0)
+    {
+      last_period_misses = misses - last_count_misses;
+      accum_misses += last_period_misses;
+      if (references >= 0)
+        accum_references += references - last_count_references;
+    }
+    else
+      last_period_misses = 0;
+
+    last_count_misses = misses;
+    last_count_references = references;
+    return *this;
+  }
+
+  const CacheMissCounter& CacheMissCounter::reset()
+  {
+    accum_misses = accum_references = 0;
+    last_period_misses = 0;
+    last_count_misses = read_counter(fd_misses);
+    last_count_references = read_counter(fd_references);
+    return *this;
+  }
+
+  long long CacheMissCounter::accumulated_misses() const
+  {
+    return available() ? accum_misses : -1;
+  }
+
+  long long CacheMissCounter::accumulated_references() const
+  {
+    return fd_references >= 0 ? accum_references : -1;
+  }
+
+  long long CacheMissCounter::last_misses() const
+  {
+    return available() ? last_period_misses : -1;
+  }
+}
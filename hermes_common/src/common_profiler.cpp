@@ -0,0 +1,268 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file common_profiler.cpp
+    \brief File containing the scoped timers and counters of the hot paths (class Profiler).
+*/
+#include "config.h"
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "common_profiler.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+namespace Hermes
+{
+  bool Profiler::enabled = true;
+  ProfilerSection* Profiler::sections = NULL;
+
+  ProfilerSection::ProfilerSection(const char* name) : name(name)
+  {
+    memset(slots, 0, sizeof(slots));
+#ifdef WITH_OPENMP
+#pragma omp critical (hermes_profiler)
+#endif
+    {
+      next = Profiler::sections;
+      Profiler::sections = this;
+    }
+  }
+
+  ProfilerSection::Slot* ProfilerSection::get_slot()
+  {
+#ifdef WITH_OPENMP
+    int thread = omp_get_thread_num();
+    if (thread >= HERMES_PROFILER_MAX_THREADS)
+      return NULL;
+    return &slots[thread];
+#else
+    return &slots[0];
+#endif
+  }
+
+  void ProfilerSection::add(double time)
+  {
+    Slot* slot = get_slot();
+    if (slot == NULL)
+      return;
+    slot->calls++;
+    slot->time += time;
+  }
+
+  void ProfilerSection::count(long long n)
+  {
+    if (!Profiler::enabled)
+      return;
+    Slot* slot = get_slot();
+    if (slot != NULL)
+      slot->count += n;
+  }
+
+  double Profiler::now()
+  {
+#ifdef WIN32
+    LARGE_INTEGER ticks, freq;
+    QueryPerformanceCounter(&ticks);
+    QueryPerformanceFrequency(&freq);
+    return (double) ticks.QuadPart / (double) freq.QuadPart;
+#elif defined(__APPLE__)
+    return (double) clock() / CLOCKS_PER_SEC;
+#else
+    timespec tm;
+    clock_gettime(CLOCK_MONOTONIC, &tm);
+    return tm.tv_sec + tm.tv_nsec * 1e-9;
+#endif
+  }
+
+  void Profiler::enable(bool enable)
+  {
+    enabled = enable;
+  }
+
+  bool Profiler::is_enabled()
+  {
+    return enabled;
+  }
+
+  bool Profiler::is_compiled_in()
+  {
+#ifdef WITH_PROFILING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void Profiler::reset()
+  {
+    for (ProfilerSection* s = sections; s != NULL; s = s->next)
+      memset(s->slots, 0, sizeof(s->slots));
+  }
+
+  /// Results of the sections of one name summed over the threads.
+  struct ProfilerTotal
+  {
+    ProfilerTotal() : calls(0), count(0), time(0.0), max_thread_time(0.0), threads(0) {}
+    std::string name;
+    long long calls, count;
+    double time, max_thread_time;
+    int threads;
+  };
+
+  static bool compare_totals(const ProfilerTotal& a, const ProfilerTotal& b)
+  {
+    if (a.time != b.time)
+      return a.time > b.time;
+    return a.name < b.name;
+  }
+
+  double Profiler::get_time(const char* name, long long* calls)
+  {
+    double time = 0.0;
+    if (calls != NULL)
+      *calls = 0;
+    for (ProfilerSection* s = sections; s != NULL; s = s->next)
+      if (strcmp(s->name, name) == 0)
+        for (int i = 0; i < HERMES_PROFILER_MAX_THREADS; i++)
+        {
+          time += s->slots[i].time;
+          if (calls != NULL)
+            *calls += s->slots[i].calls;
+        }
+    return time;
+  }
+
+  long long Profiler::get_count(const char* name)
+  {
+    long long count = 0;
+    for (ProfilerSection* s = sections; s != NULL; s = s->next)
+      if (strcmp(s->name, name) == 0)
+        for (int i = 0; i < HERMES_PROFILER_MAX_THREADS; i++)
+          count += s->slots[i].count;
+    return count;
+  }
+
+  void Profiler::report(FILE* file, ProfilerReportFormat format)
+  {
+    // Sum up the sections of the same name, per thread first to get the load balance.
+    std::map<std::string, ProfilerTotal> by_name;
+    std::map<std::string, std::vector<double> > thread_times;
+    for (ProfilerSection* s = sections; s != NULL; s = s->next)
+    {
+      ProfilerTotal& total = by_name[s->name];
+      total.name = s->name;
+      std::vector<double>& times = thread_times[s->name];
+      times.resize(HERMES_PROFILER_MAX_THREADS, 0.0);
+      for (int i = 0; i < HERMES_PROFILER_MAX_THREADS; i++)
+      {
+        total.calls += s->slots[i].calls;
+        total.count += s->slots[i].count;
+        total.time += s->slots[i].time;
+        times[i] += s->slots[i].time;
+      }
+    }
+
+    std::vector<ProfilerTotal> totals;
+    for (std::map<std::string, ProfilerTotal>::iterator it = by_name.begin(); it != by_name.end(); it++)
+    {
+      std::vector<double>& times = thread_times[it->first];
+      for (int i = 0; i < HERMES_PROFILER_MAX_THREADS; i++)
+        if (times[i] > 0.0)
+        {
+          it->second.threads++;
+          it->second.max_thread_time = std::max(it->second.max_thread_time, times[i]);
+        }
+      if (it->second.calls > 0 || it->second.count != 0)
+        totals.push_back(it->second);
+    }
+    std::sort(totals.begin(), totals.end(), compare_totals);
+
+    if (format == HERMES_PROFILER_JSON)
+    {
+      fprintf(file, "[");
+      for (unsigned int i = 0; i < totals.size(); i++)
+      {
+        // Section names are string literals of the library, only quotes and backslashes are escaped.
+        std::string name;
+        for (unsigned int j = 0; j < totals[i].name.size(); j++)
+        {
+          if (totals[i].name[j] == '"' || totals[i].name[j] == '\\')
+            name += '\\';
+          name += totals[i].name[j];
+        }
+        fprintf(file, "%s\n  {\"name\": \"%s\", \"calls\": %lld, \"time\": %.9g, \"max_thread_time\": %.9g, \"threads\": %d, \"count\": %lld}",
+          i == 0 ? "" : ",", name.c_str(), totals[i].calls, totals[i].time, totals[i].max_thread_time,
+          totals[i].threads, totals[i].count);
+      }
+      fprintf(file, "\n]\n");
+    }
+    else
+    {
+      fprintf(file, "Profile (times in seconds, including nested sections):\n");
+      fprintf(file, "%-36s %12s %12s %12s %12s %8s %14s\n", "section", "calls", "total", "mean", "max thread", "threads", "count");
+      for (unsigned int i = 0; i < totals.size(); i++)
+        fprintf(file, "%-36s %12lld %12.6f %12.3e %12.6f %8d %14lld\n", totals[i].name.c_str(), totals[i].calls,
+          totals[i].time, totals[i].calls > 0 ? totals[i].time / totals[i].calls : 0.0,
+          totals[i].max_thread_time, totals[i].threads, totals[i].count);
+    }
+    fflush(file);
+  }
+
+  bool Profiler::report(const char* filename, ProfilerReportFormat format)
+  {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+      return false;
+    report(file, format);
+    fclose(file);
+    return true;
+  }
+
+  static std::string profiler_exit_filename;
+  static ProfilerReportFormat profiler_exit_format = HERMES_PROFILER_TEXT;
+  static bool profiler_exit_registered = false;
+
+  static void profiler_report_at_exit()
+  {
+    if (profiler_exit_filename.empty())
+      Profiler::report(stdout, profiler_exit_format);
+    else if (!Profiler::report(profiler_exit_filename.c_str(), profiler_exit_format))
+      fprintf(stderr, "Profiler: unable to write the report to %s.\n", profiler_exit_filename.c_str());
+  }
+
+  void Profiler::report_at_exit(const char* filename, ProfilerReportFormat format)
+  {
+    profiler_exit_filename = filename == NULL ? "" : filename;
+    profiler_exit_format = format;
+    if (!profiler_exit_registered)
+    {
+      atexit(profiler_report_at_exit);
+      profiler_exit_registered = true;
+    }
+  }
+}
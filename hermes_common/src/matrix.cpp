@@ -266,6 +266,15 @@ SparseMatrix<Scalar>* Hermes::Algebra::create_matrix(Hermes::MatrixSolverType ma
       return new SuperLUMatrix<Scalar>;
 #else
       error("SuperLU was not installed.");
+#endif
+      break;
+    }
+  case Hermes::SOLVER_HERMES_ITERATIVE:
+    {
+#ifdef WITH_UMFPACK
+      return new UMFPackMatrix<Scalar>;
+#else
+      error("The Hermes iterative solvers need UMFPACK data structures, UMFPACK was not installed.");
 #endif
       break;
     }
@@ -332,6 +341,15 @@ Vector<Scalar>* Hermes::Algebra::create_vector(Hermes::MatrixSolverType matrix_s
       return new SuperLUVector<Scalar>;
 #else
       error("SuperLU was not installed.");
+#endif
+      break;
+    }
+  case Hermes::SOLVER_HERMES_ITERATIVE:
+    {
+#ifdef WITH_UMFPACK
+      return new UMFPackVector<Scalar>;
+#else
+      error("The Hermes iterative solvers need UMFPACK data structures, UMFPACK was not installed.");
 #endif
       break;
     }
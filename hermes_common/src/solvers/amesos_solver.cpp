@@ -23,6 +23,7 @@
 #ifdef HAVE_AMESOS
 #include "amesos_solver.h"
 #include "callstack.h"
+#include "common_profiler.h"
 #include "error.h"
 #include <Amesos_ConfigDefs.h>
 
@@ -84,6 +85,7 @@ namespace Hermes
     bool AmesosSolver<double>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
 
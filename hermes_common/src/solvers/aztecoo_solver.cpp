@@ -23,6 +23,7 @@
 #ifdef HAVE_AZTECOO
 #include "aztecoo_solver.h"
 #include "callstack.h"
+#include "common_profiler.h"
 #include <Komplex_LinearProblem.h>
 
 using namespace Hermes::Error;
@@ -125,6 +126,7 @@ namespace Hermes
     bool AztecOOSolver<double>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
       assert(m->size == rhs->size);
@@ -167,6 +169,7 @@ namespace Hermes
     bool AztecOOSolver<std::complex<double> >::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
       assert(m->size == rhs->size);
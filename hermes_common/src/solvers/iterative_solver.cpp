@@ -0,0 +1,522 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file iterative_solver.cpp
+\brief Native preconditioned Krylov solvers (CG, GMRES, BiCGStab) working on CSCMatrix.
+*/
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "iterative_solver.h"
+#include "callstack.h"
+#include "common_profiler.h"
+#include "common_time_period.h"
+
+using namespace Hermes::Error;
+using namespace Hermes::Preconditioners;
+using namespace Hermes::Algebra::DenseMatrixOperations;
+
+namespace Hermes
+{
+  namespace Solvers
+  {
+    static inline double conj_value(double x)
+    {
+      return x;
+    }
+
+    static inline std::complex<double> conj_value(std::complex<double> x)
+    {
+      return std::conj(x);
+    }
+
+    /// Inner product (a, b) = sum conj(a_i) b_i.
+    template<typename Scalar>
+    static Scalar dot(int n, const Scalar* a, const Scalar* b)
+    {
+      Scalar sum = 0.0;
+      for (int i = 0; i < n; i++)
+        sum += conj_value(a[i]) * b[i];
+      return sum;
+    }
+
+    template<typename Scalar>
+    static double norm(int n, const Scalar* a)
+    {
+      double sum = 0.0;
+      for (int i = 0; i < n; i++)
+        sum += Hermes::sqr(a[i]);
+      return sqrt(sum);
+    }
+
+    template<typename Scalar>
+    IterativeSolver<Scalar>::IterativeSolver(CSCMatrix<Scalar> *m, UMFPackVector<Scalar> *rhs)
+      : IterSolver<Scalar>(), m(m), op(m), rhs(rhs), method(METHOD_CG), restart(30), pc(NULL), own_pc(false),
+      pc_computed(false), reuse_scheme(HERMES_FACTORIZE_FROM_SCRATCH), num_iters(0), residual(0.0)
+    {
+      _F_;
+    }
+
+    template<typename Scalar>
+    IterativeSolver<Scalar>::IterativeSolver(SparseMatrix<Scalar> *op, UMFPackVector<Scalar> *rhs, CSCMatrix<Scalar> *pc_matrix)
+      : IterSolver<Scalar>(), m(pc_matrix), op(op), rhs(rhs), method(METHOD_CG), restart(30), pc(NULL), own_pc(false),
+      pc_computed(false), reuse_scheme(HERMES_FACTORIZE_FROM_SCRATCH), num_iters(0), residual(0.0)
+    {
+      _F_;
+    }
+
+    template<typename Scalar>
+    IterativeSolver<Scalar>::~IterativeSolver()
+    {
+      _F_;
+      if (own_pc)
+        delete pc;
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_solver(const char *name)
+    {
+      _F_;
+      if (name == NULL || strcasecmp(name, "cg") == 0) method = METHOD_CG;
+      else if (strcasecmp(name, "gmres") == 0) method = METHOD_GMRES;
+      else if (strcasecmp(name, "bicgstab") == 0) method = METHOD_BICGSTAB;
+      else if (strcasecmp(name, "richardson") == 0) method = METHOD_RICHARDSON;
+      else
+      {
+        warning("Unknown iterative solver '%s', using CG.", name);
+        method = METHOD_CG;
+      }
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_precond(const char *name)
+    {
+      _F_;
+      CSCPrecond<Scalar>* new_pc;
+      if (name == NULL || strcasecmp(name, "none") == 0) new_pc = NULL;
+      else if (strcasecmp(name, "jacobi") == 0) new_pc = new JacobiPrecond<Scalar>();
+      else if (strcasecmp(name, "ilu0") == 0) new_pc = new ILU0Precond<Scalar>();
+      else if (strcasecmp(name, "ssor") == 0) new_pc = new SSORPrecond<Scalar>();
+      else if (strcasecmp(name, "amg") == 0) new_pc = new AMGPrecond<Scalar>();
+      else
+      {
+        warning("Unknown preconditioner '%s', none used.", name);
+        new_pc = NULL;
+      }
+      set_precond(new_pc);
+      own_pc = true;
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_precond(CSCPrecond<Scalar> *pc)
+    {
+      _F_;
+      if (own_pc)
+        delete this->pc;
+      this->pc = pc;
+      own_pc = false;
+      pc_computed = false;
+      this->precond_yes = (pc != NULL);
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_precond(Precond<Scalar> *pc)
+    {
+      _F_;
+      warning("IterativeSolver can only use the preconditioners derived from CSCPrecond.");
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_restart(int restart)
+    {
+      if (restart < 1)
+        error("GMRES restart has to be positive.");
+      this->restart = restart;
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::set_factorization_scheme(FactorizationScheme reuse_scheme)
+    {
+      this->reuse_scheme = reuse_scheme;
+    }
+
+    template<typename Scalar>
+    int IterativeSolver<Scalar>::get_matrix_size()
+    {
+      return op->get_size();
+    }
+
+    template<typename Scalar>
+    int IterativeSolver<Scalar>::get_num_iters()
+    {
+      return num_iters;
+    }
+
+    template<typename Scalar>
+    double IterativeSolver<Scalar>::get_residual()
+    {
+      return residual;
+    }
+
+    template<typename Scalar>
+    void IterativeSolver<Scalar>::precondition(const Scalar* r, Scalar* z)
+    {
+      if (pc != NULL)
+        pc->apply(r, z);
+      else
+        memcpy(z, r, op->get_size() * sizeof(Scalar));
+    }
+
+    template<typename Scalar>
+    bool IterativeSolver<Scalar>::solve()
+    {
+      _F_;
+      HERMES_PROFILE("solve");
+      assert(op != NULL);
+      assert(rhs != NULL);
+      assert(op->get_size() == rhs->length());
+
+      Hermes::TimePeriod tmr;
+
+      int n = op->get_size();
+      if (this->sln)
+        delete [] this->sln;
+      this->sln = new Scalar[n];
+      MEM_CHECK(this->sln);
+      memset(this->sln, 0, n * sizeof(Scalar));
+
+      if (pc != NULL && (!pc_computed || reuse_scheme != HERMES_REUSE_FACTORIZATION_COMPLETELY))
+      {
+        if (m == NULL)
+          error("The preconditioner of a matrix-free operator requires an assembled matrix.");
+        pc->create(m);
+        pc->compute();
+        pc_computed = true;
+      }
+
+      num_iters = 0;
+      residual = 0.0;
+      double norm_b = norm(n, rhs->v);
+      bool converged = true;
+      if (norm_b > 0.0)
+      {
+        switch (method)
+        {
+        case METHOD_CG: converged = solve_cg(this->sln, rhs->v, norm_b); break;
+        case METHOD_GMRES: converged = solve_gmres(this->sln, rhs->v, norm_b); break;
+        case METHOD_BICGSTAB: converged = solve_bicgstab(this->sln, rhs->v, norm_b); break;
+        case METHOD_RICHARDSON: converged = solve_richardson(this->sln, rhs->v, norm_b); break;
+        }
+      }
+
+      tmr.tick();
+      this->time = tmr.accumulated();
+
+      if (!converged)
+        warning("Iterative solver did not converge in %d iterations (relative residual %g).", num_iters, residual);
+      return converged;
+    }
+
+    template<typename Scalar>
+    bool IterativeSolver<Scalar>::solve_cg(Scalar* x, const Scalar* b, double norm_b)
+    {
+      _F_;
+      int n = op->get_size();
+      Scalar* r = new Scalar[n];
+      Scalar* z = new Scalar[n];
+      Scalar* p = new Scalar[n];
+      Scalar* q = new Scalar[n];
+
+      // x = 0, r = b.
+      memcpy(r, b, n * sizeof(Scalar));
+      precondition(r, z);
+      memcpy(p, z, n * sizeof(Scalar));
+      Scalar rz = dot(n, r, z);
+
+      bool converged = false;
+      for (num_iters = 0; num_iters < this->max_iters; )
+      {
+        op->multiply_with_vector(p, q);
+        Scalar alpha = rz / dot(n, p, q);
+        for (int i = 0; i < n; i++)
+        {
+          x[i] += alpha * p[i];
+          r[i] -= alpha * q[i];
+        }
+        num_iters++;
+
+        residual = norm(n, r) / norm_b;
+        if (residual < this->tolerance)
+        {
+          converged = true;
+          break;
+        }
+
+        precondition(r, z);
+        Scalar rz_new = dot(n, r, z);
+        Scalar beta = rz_new / rz;
+        rz = rz_new;
+        for (int i = 0; i < n; i++)
+          p[i] = z[i] + beta * p[i];
+      }
+
+      delete [] r;
+      delete [] z;
+      delete [] p;
+      delete [] q;
+      return converged;
+    }
+
+    template<typename Scalar>
+    bool IterativeSolver<Scalar>::solve_gmres(Scalar* x, const Scalar* b, double norm_b)
+    {
+      _F_;
+      int n = op->get_size();
+      int k_max = std::min(restart, n);
+
+      // Krylov basis, Hessenberg matrix (column-wise) and Givens rotations.
+      Scalar** v = new_matrix<Scalar>(k_max + 1, n);
+      Scalar** h = new_matrix<Scalar>(k_max, k_max + 1);
+      Scalar* cs = new Scalar[k_max];
+      Scalar* sn = new Scalar[k_max];
+      Scalar* g = new Scalar[k_max + 1];
+      Scalar* y = new Scalar[k_max];
+      Scalar* w = new Scalar[n];
+
+      bool converged = false;
+      num_iters = 0;
+      while (!converged && num_iters < this->max_iters)
+      {
+        // r = b - A x.
+        op->multiply_with_vector(x, w);
+        for (int i = 0; i < n; i++)
+          v[0][i] = b[i] - w[i];
+        double beta = norm(n, v[0]);
+        residual = beta / norm_b;
+        if (residual < this->tolerance)
+        {
+          converged = true;
+          break;
+        }
+        for (int i = 0; i < n; i++)
+          v[0][i] /= beta;
+        g[0] = beta;
+
+        int k;
+        for (k = 0; k < k_max && num_iters < this->max_iters; k++)
+        {
+          // w = A M^{-1} v_k, orthogonalized against the basis (modified Gram-Schmidt).
+          precondition(v[k], w);
+          op->multiply_with_vector(w, v[k + 1]);
+          for (int j = 0; j <= k; j++)
+          {
+            h[k][j] = dot(n, v[j], v[k + 1]);
+            for (int i = 0; i < n; i++)
+              v[k + 1][i] -= h[k][j] * v[j][i];
+          }
+          double h_next = norm(n, v[k + 1]);
+          h[k][k + 1] = h_next;
+          if (h_next != 0.0)
+            for (int i = 0; i < n; i++)
+              v[k + 1][i] /= h_next;
+
+          // Apply the previous rotations to the new column and compute a new one.
+          for (int j = 0; j < k; j++)
+          {
+            Scalar t = conj_value(cs[j]) * h[k][j] + conj_value(sn[j]) * h[k][j + 1];
+            h[k][j + 1] = -sn[j] * h[k][j] + cs[j] * h[k][j + 1];
+            h[k][j] = t;
+          }
+          double d = sqrt(Hermes::sqr(h[k][k]) + Hermes::sqr(h[k][k + 1]));
+          if (d == 0.0)
+          {
+            cs[k] = 1.0;
+            sn[k] = 0.0;
+          }
+          else
+          {
+            cs[k] = h[k][k] / d;
+            sn[k] = h[k][k + 1] / d;
+          }
+          h[k][k] = d;
+          h[k][k + 1] = 0.0;
+          g[k + 1] = -sn[k] * g[k];
+          g[k] = conj_value(cs[k]) * g[k];
+
+          num_iters++;
+          residual = std::abs(g[k + 1]) / norm_b;
+          if (residual < this->tolerance)
+          {
+            converged = true;
+            k++;
+            break;
+          }
+        }
+
+        // Solve the triangular system and update x += M^{-1} V y.
+        for (int i = k - 1; i >= 0; i--)
+        {
+          Scalar sum = g[i];
+          for (int j = i + 1; j < k; j++)
+            sum -= h[j][i] * y[j];
+          y[i] = sum / h[i][i];
+        }
+        memset(w, 0, n * sizeof(Scalar));
+        for (int j = 0; j < k; j++)
+          for (int i = 0; i < n; i++)
+            w[i] += y[j] * v[j][i];
+        precondition(w, v[k_max]);
+        for (int i = 0; i < n; i++)
+          x[i] += v[k_max][i];
+      }
+
+      delete [] v;
+      delete [] h;
+      delete [] cs;
+      delete [] sn;
+      delete [] g;
+      delete [] y;
+      delete [] w;
+      return converged;
+    }
+
+    template<typename Scalar>
+    bool IterativeSolver<Scalar>::solve_bicgstab(Scalar* x, const Scalar* b, double norm_b)
+    {
+      _F_;
+      int n = op->get_size();
+      Scalar* r = new Scalar[n];
+      Scalar* r_hat = new Scalar[n];
+      Scalar* p = new Scalar[n];
+      Scalar* p_hat = new Scalar[n];
+      Scalar* v = new Scalar[n];
+      Scalar* s_hat = new Scalar[n];
+      Scalar* t = new Scalar[n];
+
+      // x = 0, r = b.
+      memcpy(r, b, n * sizeof(Scalar));
+      memcpy(r_hat, b, n * sizeof(Scalar));
+      memset(p, 0, n * sizeof(Scalar));
+      memset(v, 0, n * sizeof(Scalar));
+      Scalar rho = 1.0, alpha = 1.0, omega = 1.0;
+
+      bool converged = false;
+      for (num_iters = 0; num_iters < this->max_iters; )
+      {
+        Scalar rho_new = dot(n, r_hat, r);
+        if (rho_new == 0.0)
+        {
+          warning("BiCGStab breakdown (rho = 0).");
+          break;
+        }
+        Scalar beta = (rho_new / rho) * (alpha / omega);
+        rho = rho_new;
+        for (int i = 0; i < n; i++)
+          p[i] = r[i] + beta * (p[i] - omega * v[i]);
+
+        precondition(p, p_hat);
+        op->multiply_with_vector(p_hat, v);
+        alpha = rho / dot(n, r_hat, v);
+
+        // s = r - alpha v (stored in r).
+        for (int i = 0; i < n; i++)
+        {
+          r[i] -= alpha * v[i];
+          x[i] += alpha * p_hat[i];
+        }
+        num_iters++;
+        residual = norm(n, r) / norm_b;
+        if (residual < this->tolerance)
+        {
+          converged = true;
+          break;
+        }
+
+        precondition(r, s_hat);
+        op->multiply_with_vector(s_hat, t);
+        double tt = norm(n, t);
+        if (tt == 0.0)
+        {
+          warning("BiCGStab breakdown (t = 0).");
+          break;
+        }
+        omega = dot(n, t, r) / (tt * tt);
+        for (int i = 0; i < n; i++)
+        {
+          x[i] += omega * s_hat[i];
+          r[i] -= omega * t[i];
+        }
+        residual = norm(n, r) / norm_b;
+        if (residual < this->tolerance)
+        {
+          converged = true;
+          break;
+        }
+        if (omega == 0.0)
+        {
+          warning("BiCGStab breakdown (omega = 0).");
+          break;
+        }
+      }
+
+      delete [] r;
+      delete [] r_hat;
+      delete [] p;
+      delete [] p_hat;
+      delete [] v;
+      delete [] s_hat;
+      delete [] t;
+      return converged;
+    }
+
+    template<typename Scalar>
+    bool IterativeSolver<Scalar>::solve_richardson(Scalar* x, const Scalar* b, double norm_b)
+    {
+      _F_;
+      int n = op->get_size();
+      Scalar* r = new Scalar[n];
+      Scalar* z = new Scalar[n];
+
+      bool converged = false;
+      for (num_iters = 0; ; num_iters++)
+      {
+        op->multiply_with_vector(x, r);
+        for (int i = 0; i < n; i++)
+          r[i] = b[i] - r[i];
+        residual = norm(n, r) / norm_b;
+        if (residual < this->tolerance)
+        {
+          converged = true;
+          break;
+        }
+        if (num_iters == this->max_iters)
+          break;
+        precondition(r, z);
+        for (int i = 0; i < n; i++)
+          x[i] += z[i];
+      }
+
+      delete [] r;
+      delete [] z;
+      return converged;
+    }
+
+    template class HERMES_API IterativeSolver<double>;
+    template class HERMES_API IterativeSolver<std::complex<double> >;
+  }
+}
+#endif
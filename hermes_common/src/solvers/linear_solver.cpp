@@ -27,6 +27,7 @@
 #include "mumps_solver.h"
 #include "newton_solver_nox.h"
 #include "aztecoo_solver.h"
+#include "iterative_solver.h"
 
 using namespace Hermes::Algebra;
 
@@ -143,6 +144,17 @@ namespace Hermes
           else return new SuperLUSolver<Scalar>(static_cast<SuperLUMatrix<Scalar>*>(matrix), static_cast<SuperLUVector<Scalar>*>(rhs_dummy));
 #else
           error("SuperLU was not installed.");
+#endif
+          break;
+        }
+      case Hermes::SOLVER_HERMES_ITERATIVE:
+        {
+#ifdef WITH_UMFPACK
+          info("Using Hermes iterative solver.");
+          if (rhs != NULL) return new IterativeSolver<Scalar>(static_cast<CSCMatrix<Scalar>*>(matrix), static_cast<UMFPackVector<Scalar>*>(rhs));
+          else return new IterativeSolver<Scalar>(static_cast<CSCMatrix<Scalar>*>(matrix), static_cast<UMFPackVector<Scalar>*>(rhs_dummy));
+#else
+          error("The Hermes iterative solvers need UMFPACK data structures, UMFPACK was not installed.");
 #endif
           break;
         }
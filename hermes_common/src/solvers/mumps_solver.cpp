@@ -25,6 +25,7 @@
 #include "trace.h"
 #include "error.h"
 #include "callstack.h"
+#include "common_profiler.h"
 
 using namespace Hermes::Error;
 
@@ -719,6 +720,7 @@ namespace Hermes
     bool MumpsSolver<Scalar>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       bool ret = false;
       assert(m != NULL);
       assert(rhs != NULL);
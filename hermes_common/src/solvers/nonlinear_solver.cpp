@@ -28,12 +28,14 @@ namespace Hermes
   namespace Solvers
   {
     template<typename Scalar>
-    NonlinearSolver<Scalar>::NonlinearSolver(DiscreteProblemInterface<Scalar>* dp) : dp(dp), sln_vector(NULL), time(-1.0), matrix_solver_type(SOLVER_UMFPACK),  verbose_output(true)
+    NonlinearSolver<Scalar>::NonlinearSolver(DiscreteProblemInterface<Scalar>* dp) : dp(dp), sln_vector(NULL), time(-1.0), matrix_solver_type(SOLVER_UMFPACK),  verbose_output(true),
+      iterative_method(NULL), preconditioner(NULL)
     {
     }
 
     template<typename Scalar>
-    NonlinearSolver<Scalar>::NonlinearSolver(DiscreteProblemInterface<Scalar>* dp, Hermes::MatrixSolverType matrix_solver_type) : dp(dp), sln_vector(NULL), time(-1.0), matrix_solver_type(matrix_solver_type), verbose_output(true)
+    NonlinearSolver<Scalar>::NonlinearSolver(DiscreteProblemInterface<Scalar>* dp, Hermes::MatrixSolverType matrix_solver_type) : dp(dp), sln_vector(NULL), time(-1.0), matrix_solver_type(matrix_solver_type), verbose_output(true),
+      iterative_method(NULL), preconditioner(NULL)
     {
     }
 
@@ -72,9 +74,9 @@ namespace Hermes
     template<typename Scalar>
     void NonlinearSolver<Scalar>::set_iterative_method(const char* iterative_method_name)
     {
-      if(this->matrix_solver_type != SOLVER_AZTECOO)
+      if(this->matrix_solver_type != SOLVER_AZTECOO && this->matrix_solver_type != SOLVER_HERMES_ITERATIVE)
       {
-        warning("Trying to set iterative method for a different solver than AztecOO.");
+        warning("Trying to set iterative method for a different solver than AztecOO or the Hermes iterative solver.");
         return;
       }
       else
@@ -86,9 +88,9 @@ namespace Hermes
     template<typename Scalar>
     void NonlinearSolver<Scalar>::set_preconditioner(const char* preconditioner_name)
     {
-      if(this->matrix_solver_type != SOLVER_AZTECOO)
+      if(this->matrix_solver_type != SOLVER_AZTECOO && this->matrix_solver_type != SOLVER_HERMES_ITERATIVE)
       {
-        warning("Trying to set iterative method for a different solver than AztecOO.");
+        warning("Trying to set iterative method for a different solver than AztecOO or the Hermes iterative solver.");
         return;
       }
       else
@@ -25,6 +25,7 @@
 #include "trace.h"
 #include "error.h"
 #include "callstack.h"
+#include "common_profiler.h"
 
 /// \todo Check #ifdef WITH_MPI and use the parallel methods from PETSc accordingly.
 
@@ -543,6 +544,7 @@ namespace Hermes
     bool PetscLinearSolver<Scalar>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
 
@@ -0,0 +1,625 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file precond_amg.cpp
+\brief Smoothed aggregation algebraic multigrid preconditioner working on CSCMatrix.
+*/
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "precond_amg.h"
+#include "callstack.h"
+#include <algorithm>
+
+namespace Hermes
+{
+  namespace Preconditioners
+  {
+    /// Number of power iterations used to estimate the spectral radius of D^{-1}A.
+    static const int AMG_POWER_ITERATIONS = 20;
+    /// Size of the coarsest level above which a warning about a slow coarse solve is issued.
+    static const int AMG_MAX_DIRECT_SIZE = 5000;
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::SparseRows::multiply(const Scalar* x, Scalar* y) const
+    {
+      for (int i = 0; i < num_rows; i++)
+      {
+        Scalar sum = 0.0;
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+          sum += val[k] * x[col[k]];
+        y[i] = sum;
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::SparseRows::transpose(SparseRows& t) const
+    {
+      t.num_rows = num_cols;
+      t.num_cols = num_rows;
+      t.row_ptr.assign(num_cols + 1, 0);
+      for (unsigned int k = 0; k < col.size(); k++)
+        t.row_ptr[col[k] + 1]++;
+      for (int i = 0; i < num_cols; i++)
+        t.row_ptr[i + 1] += t.row_ptr[i];
+      t.col.resize(col.size());
+      t.val.resize(col.size());
+      std::vector<int> next(t.row_ptr.begin(), t.row_ptr.end() - 1);
+      for (int i = 0; i < num_rows; i++)
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+        {
+          int pos = next[col[k]]++;
+          t.col[pos] = i;
+          t.val[pos] = val[k];
+        }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::SparseRows::multiply(const SparseRows& b, SparseRows& c, bool symbolic) const
+    {
+      if (symbolic)
+      {
+        c.num_rows = num_rows;
+        c.num_cols = b.num_cols;
+        c.row_ptr.assign(num_rows + 1, 0);
+        c.col.clear();
+        std::vector<int> marker(b.num_cols, -1);
+        for (int i = 0; i < num_rows; i++)
+        {
+          int row_begin = c.col.size();
+          for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+            for (int q = b.row_ptr[col[k]]; q < b.row_ptr[col[k] + 1]; q++)
+              if (marker[b.col[q]] != i)
+              {
+                marker[b.col[q]] = i;
+                c.col.push_back(b.col[q]);
+              }
+          std::sort(c.col.begin() + row_begin, c.col.end());
+          c.row_ptr[i + 1] = c.col.size();
+        }
+        c.val.resize(c.col.size());
+      }
+
+      // Numeric product into the structure of c (dense accumulator).
+      std::vector<Scalar> acc(b.num_cols, Scalar(0.0));
+      for (int i = 0; i < num_rows; i++)
+      {
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+        {
+          Scalar a = val[k];
+          for (int q = b.row_ptr[col[k]]; q < b.row_ptr[col[k] + 1]; q++)
+            acc[b.col[q]] += a * b.val[q];
+        }
+        for (int p = c.row_ptr[i]; p < c.row_ptr[i + 1]; p++)
+        {
+          c.val[p] = acc[c.col[p]];
+          acc[c.col[p]] = 0.0;
+        }
+      }
+    }
+
+    template<typename Scalar>
+    AMGPrecond<Scalar>::AMGPrecond() : CSCPrecond<Scalar>(), smoother(SMOOTHER_GAUSS_SEIDEL), sweeps(1), cycle_type(CYCLE_V),
+      theta(0.08), coarse_size(500), max_levels(25), reuse(true), reused(false)
+    {
+    }
+
+    template<typename Scalar>
+    AMGPrecond<Scalar>::~AMGPrecond()
+    {
+      destroy();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::destroy()
+    {
+      levels.clear();
+      coarse_lu.clear();
+      coarse_perm.clear();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_smoother(Smoother smoother, int sweeps)
+    {
+      if (sweeps < 1)
+        error("Number of smoothing sweeps has to be positive.");
+      this->smoother = smoother;
+      this->sweeps = sweeps;
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_cycle(Cycle cycle)
+    {
+      this->cycle_type = cycle;
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_strength_threshold(double theta)
+    {
+      this->theta = theta;
+      levels.clear();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_coarse_size(int coarse_size)
+    {
+      this->coarse_size = coarse_size;
+      levels.clear();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_max_levels(int max_levels)
+    {
+      if (max_levels < 1)
+        error("Number of multigrid levels has to be positive.");
+      this->max_levels = max_levels;
+      levels.clear();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::set_reuse_setup(bool reuse)
+    {
+      this->reuse = reuse;
+    }
+
+    template<typename Scalar>
+    int AMGPrecond<Scalar>::get_num_levels() const
+    {
+      return levels.size();
+    }
+
+    template<typename Scalar>
+    double AMGPrecond<Scalar>::get_operator_complexity() const
+    {
+      if (levels.empty())
+        return 0.0;
+      double nnz = 0.0;
+      for (unsigned int l = 0; l < levels.size(); l++)
+        nnz += levels[l].A.col.size();
+      return nnz / levels[0].A.col.size();
+    }
+
+    template<typename Scalar>
+    bool AMGPrecond<Scalar>::setup_reused() const
+    {
+      return reused;
+    }
+
+    template<typename Scalar>
+    bool AMGPrecond<Scalar>::is_strong(const Level& level, int i, int k) const
+    {
+      const SparseRows& A = level.A;
+      int j = A.col[k];
+      if (j == i || level.diag[i] < 0 || level.diag[j] < 0)
+        return false;
+      return std::abs(A.val[k]) > theta * sqrt(std::abs(A.val[level.diag[i]]) * std::abs(A.val[level.diag[j]]));
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::aggregate(Level& level) const
+    {
+      _F_;
+      const SparseRows& A = level.A;
+      int n = A.num_rows;
+      level.aggregates.assign(n, -1);
+      level.num_aggregates = 0;
+
+      // 1. Unknowns whose strong neighbors are all free form an aggregate with them.
+      for (int i = 0; i < n; i++)
+      {
+        if (level.aggregates[i] >= 0)
+          continue;
+        bool free = true;
+        bool isolated = true;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1] && free; k++)
+          if (is_strong(level, i, k))
+          {
+            isolated = false;
+            if (level.aggregates[A.col[k]] >= 0)
+              free = false;
+          }
+        if (!free || isolated)
+          continue;
+        level.aggregates[i] = level.num_aggregates;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+          if (is_strong(level, i, k))
+            level.aggregates[A.col[k]] = level.num_aggregates;
+        level.num_aggregates++;
+      }
+
+      // 2. The remaining unknowns join an aggregate of a strong neighbor.
+      std::vector<int> aggregates_1(level.aggregates);
+      for (int i = 0; i < n; i++)
+      {
+        if (level.aggregates[i] >= 0)
+          continue;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+          if (is_strong(level, i, k) && aggregates_1[A.col[k]] >= 0)
+          {
+            level.aggregates[i] = aggregates_1[A.col[k]];
+            break;
+          }
+      }
+
+      // 3. What is left forms new aggregates with the free strong neighbors (isolated unknowns
+      // become aggregates of their own).
+      for (int i = 0; i < n; i++)
+      {
+        if (level.aggregates[i] >= 0)
+          continue;
+        level.aggregates[i] = level.num_aggregates;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+          if (is_strong(level, i, k) && level.aggregates[A.col[k]] < 0)
+            level.aggregates[A.col[k]] = level.num_aggregates;
+        level.num_aggregates++;
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::build_prolongator(Level& level, bool symbolic) const
+    {
+      _F_;
+      const SparseRows& A = level.A;
+      SparseRows& P = level.P;
+      int n = A.num_rows;
+
+      // P = (I - omega D_F^{-1} A_F) P_tent, where P_tent is the piecewise constant prolongator
+      // and A_F the matrix with the weak connections lumped into the diagonal (D_F).
+      if (symbolic)
+      {
+        P.num_rows = n;
+        P.num_cols = level.num_aggregates;
+        P.row_ptr.assign(n + 1, 0);
+        P.col.clear();
+        std::vector<int> marker(level.num_aggregates, -1);
+        for (int i = 0; i < n; i++)
+        {
+          int row_begin = P.col.size();
+          marker[level.aggregates[i]] = i;
+          P.col.push_back(level.aggregates[i]);
+          for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+            if (is_strong(level, i, k) && marker[level.aggregates[A.col[k]]] != i)
+            {
+              marker[level.aggregates[A.col[k]]] = i;
+              P.col.push_back(level.aggregates[A.col[k]]);
+            }
+          std::sort(P.col.begin() + row_begin, P.col.end());
+          P.row_ptr[i + 1] = P.col.size();
+        }
+        P.val.resize(P.col.size());
+      }
+
+      // With a reused structure, connections which became strong but whose aggregates are
+      // not in the row of P are treated as weak.
+      double omega = level.rho > 0.0 ? 4.0 / (3.0 * level.rho) : 0.0;
+      std::vector<int> position(level.num_aggregates, -1);
+      for (int i = 0; i < n; i++)
+      {
+        for (int p = P.row_ptr[i]; p < P.row_ptr[i + 1]; p++)
+        {
+          position[P.col[p]] = p;
+          P.val[p] = 0.0;
+        }
+
+        Scalar diag_f = level.diag[i] >= 0 ? A.val[level.diag[i]] : Scalar(0.0);
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+          if (A.col[k] != i && !(is_strong(level, i, k) && position[level.aggregates[A.col[k]]] >= 0))
+            diag_f += A.val[k];
+
+        P.val[position[level.aggregates[i]]] += 1.0;
+        if (diag_f != 0.0)
+        {
+          P.val[position[level.aggregates[i]]] -= omega;
+          for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+            if (is_strong(level, i, k) && position[level.aggregates[A.col[k]]] >= 0)
+              P.val[position[level.aggregates[A.col[k]]]] -= omega / diag_f * A.val[k];
+        }
+
+        for (int p = P.row_ptr[i]; p < P.row_ptr[i + 1]; p++)
+          position[P.col[p]] = -1;
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::init_level(Level& level) const
+    {
+      _F_;
+      const SparseRows& A = level.A;
+      int n = A.num_rows;
+      level.inv_diag.resize(n);
+      for (int i = 0; i < n; i++)
+      {
+        Scalar d = level.diag[i] >= 0 ? A.val[level.diag[i]] : Scalar(0.0);
+        level.inv_diag[i] = d != 0.0 ? Scalar(1.0) / d : Scalar(0.0);
+      }
+      level.x.resize(n);
+      level.b.resize(n);
+      level.r.resize(n);
+      level.d.resize(n);
+      level.w.resize(n);
+
+      // Power iteration for the spectral radius of D^{-1}A.
+      std::vector<Scalar>& v = level.x;
+      std::vector<Scalar>& w = level.r;
+      // Pseudo-random start, a smooth vector has almost no component in the upper part of the spectrum.
+      unsigned int seed = 12345;
+      for (int i = 0; i < n; i++)
+      {
+        seed = seed * 1103515245 + 12345;
+        v[i] = ((seed >> 16) & 0x7fff) / 32768.0 - 0.5;
+      }
+      level.rho = 0.0;
+      for (int it = 0; it < AMG_POWER_ITERATIONS; it++)
+      {
+        double norm_v = 0.0;
+        for (int i = 0; i < n; i++)
+          norm_v += Hermes::sqr(v[i]);
+        norm_v = sqrt(norm_v);
+        if (norm_v == 0.0)
+          break;
+        A.multiply(&v[0], &w[0]);
+        double norm_w = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+          w[i] *= level.inv_diag[i];
+          norm_w += Hermes::sqr(w[i]);
+        }
+        norm_w = sqrt(norm_w);
+        level.rho = norm_w / norm_v;
+        for (int i = 0; i < n; i++)
+          v[i] = w[i] / norm_w;
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::factorize_coarse()
+    {
+      _F_;
+      const Level& level = levels.back();
+      const SparseRows& A = level.A;
+      int n = A.num_rows;
+      if (n > AMG_MAX_DIRECT_SIZE)
+        warning("AMG: the coarsest level has %d unknowns, the coarse solve will be slow.", n);
+
+      coarse_lu.assign((size_t) n * n, Scalar(0.0));
+      coarse_perm.resize(n);
+      for (int i = 0; i < n; i++)
+      {
+        coarse_perm[i] = i;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+          coarse_lu[(size_t) i * n + A.col[k]] = A.val[k];
+      }
+
+      // LU with partial pivoting, rows swapped in place.
+      for (int j = 0; j < n; j++)
+      {
+        int pivot = j;
+        for (int i = j + 1; i < n; i++)
+          if (std::abs(coarse_lu[(size_t) i * n + j]) > std::abs(coarse_lu[(size_t) pivot * n + j]))
+            pivot = i;
+        if (coarse_lu[(size_t) pivot * n + j] == 0.0)
+          throw Exceptions::LinearSolverException("AMG: singular coarse matrix.");
+        if (pivot != j)
+        {
+          std::swap_ranges(coarse_lu.begin() + (size_t) j * n, coarse_lu.begin() + (size_t) (j + 1) * n, coarse_lu.begin() + (size_t) pivot * n);
+          std::swap(coarse_perm[j], coarse_perm[pivot]);
+        }
+        Scalar* row_j = &coarse_lu[(size_t) j * n];
+        for (int i = j + 1; i < n; i++)
+        {
+          Scalar* row_i = &coarse_lu[(size_t) i * n];
+          if (row_i[j] == 0.0)
+            continue;
+          row_i[j] /= row_j[j];
+          for (int k = j + 1; k < n; k++)
+            row_i[k] -= row_i[j] * row_j[k];
+        }
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::solve_coarse(const Scalar* b, Scalar* x) const
+    {
+      int n = levels.back().A.num_rows;
+      for (int i = 0; i < n; i++)
+      {
+        Scalar sum = b[coarse_perm[i]];
+        const Scalar* row = &coarse_lu[(size_t) i * n];
+        for (int k = 0; k < i; k++)
+          sum -= row[k] * x[k];
+        x[i] = sum;
+      }
+      for (int i = n - 1; i >= 0; i--)
+      {
+        Scalar sum = x[i];
+        const Scalar* row = &coarse_lu[(size_t) i * n];
+        for (int k = i + 1; k < n; k++)
+          sum -= row[k] * x[k];
+        x[i] = sum / row[i];
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::compute()
+    {
+      _F_;
+      int *row_ptr, *col, *diag;
+      Scalar* val;
+      this->copy_rows(row_ptr, col, val, diag);
+      int n = this->mat->get_size();
+      int nnz = row_ptr[n];
+
+      // Keep the hierarchy structure if the matrix has the same sparse structure.
+      reused = reuse && !levels.empty() && levels[0].A.num_rows == n && (int) levels[0].A.col.size() == nnz
+        && std::equal(row_ptr, row_ptr + n + 1, levels[0].A.row_ptr.begin())
+        && std::equal(col, col + nnz, levels[0].A.col.begin());
+      if (!reused)
+      {
+        levels.clear();
+        levels.resize(1);
+        levels[0].A.num_rows = levels[0].A.num_cols = n;
+        levels[0].A.row_ptr.assign(row_ptr, row_ptr + n + 1);
+        levels[0].A.col.assign(col, col + nnz);
+        levels[0].diag.assign(diag, diag + n);
+      }
+      levels[0].A.val.assign(val, val + nnz);
+      delete [] row_ptr;
+      delete [] col;
+      delete [] val;
+      delete [] diag;
+
+      for (unsigned int l = 0; ; l++)
+      {
+        init_level(levels[l]);
+        if (reused)
+        {
+          if (l + 1 == levels.size())
+            break;
+        }
+        else
+        {
+          if (levels[l].A.num_rows <= coarse_size || (int) l + 1 >= max_levels)
+            break;
+          aggregate(levels[l]);
+          if (levels[l].num_aggregates >= levels[l].A.num_rows)
+            break;
+          levels.push_back(Level());
+        }
+
+        Level& fine = levels[l];
+        Level& coarse = levels[l + 1];
+        build_prolongator(fine, !reused);
+        fine.P.transpose(fine.R);
+        fine.A.multiply(fine.P, fine.AP, !reused);
+        fine.R.multiply(fine.AP, coarse.A, !reused);
+
+        if (!reused)
+        {
+          coarse.diag.assign(coarse.A.num_rows, -1);
+          for (int i = 0; i < coarse.A.num_rows; i++)
+            for (int k = coarse.A.row_ptr[i]; k < coarse.A.row_ptr[i + 1]; k++)
+              if (coarse.A.col[k] == i)
+                coarse.diag[i] = k;
+        }
+      }
+
+      factorize_coarse();
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::smooth(const Level& level, const Scalar* b, Scalar* x, bool pre) const
+    {
+      const SparseRows& A = level.A;
+      int n = A.num_rows;
+
+      if (smoother == SMOOTHER_GAUSS_SEIDEL)
+      {
+        for (int s = 0; s < sweeps; s++)
+          for (int ii = 0; ii < n; ii++)
+          {
+            int i = pre ? ii : n - 1 - ii;
+            if (level.inv_diag[i] == 0.0)
+              continue;
+            Scalar sum = b[i];
+            for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++)
+              if (A.col[k] != i)
+                sum -= A.val[k] * x[A.col[k]];
+            x[i] = sum * level.inv_diag[i];
+          }
+        return;
+      }
+
+      // Chebyshev polynomial of D^{-1}A targeting the upper part [rho / 30, 1.1 rho] of its spectrum.
+      double upper = 1.1 * level.rho;
+      double lower = level.rho / 30.0;
+      double theta_c = (upper + lower) / 2.0;
+      double delta = (upper - lower) / 2.0;
+      double sigma = theta_c / delta;
+      double rho_k = 1.0 / sigma;
+      Scalar* r = &level.r[0];
+      Scalar* d = &level.d[0];
+
+      A.multiply(x, r);
+      for (int i = 0; i < n; i++)
+      {
+        r[i] = level.inv_diag[i] * (b[i] - r[i]);
+        d[i] = r[i] / theta_c;
+      }
+      for (int k = 0; k < sweeps; k++)
+      {
+        for (int i = 0; i < n; i++)
+          x[i] += d[i];
+        if (k + 1 == sweeps)
+          break;
+        A.multiply(d, &level.w[0]);
+        double rho_next = 1.0 / (2.0 * sigma - rho_k);
+        for (int i = 0; i < n; i++)
+        {
+          r[i] -= level.inv_diag[i] * level.w[i];
+          d[i] = rho_next * rho_k * d[i] + 2.0 * rho_next / delta * r[i];
+        }
+        rho_k = rho_next;
+      }
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::cycle(int l, const Scalar* b, Scalar* x) const
+    {
+      if (l + 1 == (int) levels.size())
+      {
+        solve_coarse(b, x);
+        return;
+      }
+
+      const Level& fine = levels[l];
+      const Level& coarse = levels[l + 1];
+      int n = fine.A.num_rows;
+
+      smooth(fine, b, x, true);
+
+      Scalar* r = &fine.r[0];
+      fine.A.multiply(x, r);
+      for (int i = 0; i < n; i++)
+        r[i] = b[i] - r[i];
+      fine.R.multiply(r, &coarse.b[0]);
+      std::fill(coarse.x.begin(), coarse.x.end(), Scalar(0.0));
+
+      int gamma = (cycle_type == CYCLE_W && l + 2 < (int) levels.size()) ? 2 : 1;
+      for (int g = 0; g < gamma; g++)
+        cycle(l + 1, &coarse.b[0], &coarse.x[0]);
+
+      fine.P.multiply(&coarse.x[0], r);
+      for (int i = 0; i < n; i++)
+        x[i] += r[i];
+
+      smooth(fine, b, x, false);
+    }
+
+    template<typename Scalar>
+    void AMGPrecond<Scalar>::apply(const Scalar* r, Scalar* z) const
+    {
+      if (levels.empty())
+        error("AMGPrecond::compute() has to be called before apply().");
+      memset(z, 0, levels[0].A.num_rows * sizeof(Scalar));
+      cycle(0, r, z);
+    }
+
+    template class HERMES_API AMGPrecond<double>;
+    template class HERMES_API AMGPrecond<std::complex<double> >;
+  }
+}
+#endif
@@ -0,0 +1,303 @@
+// This file is part of HermesCommon
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+/*! \file precond_csc.cpp
+\brief Preconditioners for the Hermes iterative solvers (Jacobi, ILU(0), SSOR) working on CSCMatrix.
+*/
+#include "config.h"
+#ifdef WITH_UMFPACK
+#include "precond_csc.h"
+#include "callstack.h"
+
+namespace Hermes
+{
+  namespace Preconditioners
+  {
+    template<typename Scalar>
+    CSCPrecond<Scalar>::CSCPrecond() : mat(NULL)
+    {
+    }
+
+    template<typename Scalar>
+    CSCPrecond<Scalar>::~CSCPrecond()
+    {
+    }
+
+    template<typename Scalar>
+    void CSCPrecond<Scalar>::create(CSCMatrix<Scalar>* mat)
+    {
+      _F_;
+      this->mat = mat;
+    }
+
+    template<typename Scalar>
+    void CSCPrecond<Scalar>::copy_rows(int*& row_ptr, int*& col, Scalar*& val, int*& diag) const
+    {
+      _F_;
+      assert(mat != NULL);
+      mat->update_csr_mirror();
+      unsigned int size = mat->get_size();
+      unsigned int nnz = mat->get_nnz();
+
+      row_ptr = new int[size + 1];
+      MEM_CHECK(row_ptr);
+      col = new int[nnz];
+      MEM_CHECK(col);
+      val = new Scalar[nnz];
+      MEM_CHECK(val);
+      diag = new int[size];
+      MEM_CHECK(diag);
+      memcpy(row_ptr, mat->csr_Ap, (size + 1) * sizeof(int));
+      memcpy(col, mat->csr_Aj, nnz * sizeof(int));
+      memcpy(val, mat->csr_Ax, nnz * sizeof(Scalar));
+
+      for (unsigned int i = 0; i < size; i++)
+      {
+        diag[i] = -1;
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+          if (col[k] == (int) i)
+          {
+            diag[i] = k;
+            break;
+          }
+        if (diag[i] < 0)
+          throw Exceptions::LinearSolverException("Missing diagonal entry in the preconditioned matrix.");
+      }
+    }
+
+    template<typename Scalar>
+    void CSCPrecond<Scalar>::extract_diagonal(Scalar* d) const
+    {
+      _F_;
+      assert(mat != NULL);
+      for (unsigned int j = 0; j < mat->size; j++)
+      {
+        d[j] = 0.0;
+        for (int i = mat->Ap[j]; i < mat->Ap[j + 1]; i++)
+          if (mat->Ai[i] == (int) j)
+          {
+            d[j] = mat->Ax[i];
+            break;
+          }
+      }
+    }
+
+    template<typename Scalar>
+    JacobiPrecond<Scalar>::JacobiPrecond() : CSCPrecond<Scalar>(), inv_diag(NULL), size(0)
+    {
+    }
+
+    template<typename Scalar>
+    JacobiPrecond<Scalar>::~JacobiPrecond()
+    {
+      destroy();
+    }
+
+    template<typename Scalar>
+    void JacobiPrecond<Scalar>::destroy()
+    {
+      delete [] inv_diag;
+      inv_diag = NULL;
+      size = 0;
+    }
+
+    template<typename Scalar>
+    void JacobiPrecond<Scalar>::compute()
+    {
+      _F_;
+      destroy();
+      size = this->mat->get_size();
+      inv_diag = new Scalar[size];
+      MEM_CHECK(inv_diag);
+      this->extract_diagonal(inv_diag);
+      for (unsigned int i = 0; i < size; i++)
+      {
+        if (inv_diag[i] == 0.0)
+          throw Exceptions::LinearSolverException("Zero diagonal entry in the Jacobi preconditioner.");
+        inv_diag[i] = 1.0 / inv_diag[i];
+      }
+    }
+
+    template<typename Scalar>
+    void JacobiPrecond<Scalar>::apply(const Scalar* r, Scalar* z) const
+    {
+      for (unsigned int i = 0; i < size; i++)
+        z[i] = inv_diag[i] * r[i];
+    }
+
+    template<typename Scalar>
+    ILU0Precond<Scalar>::ILU0Precond() : CSCPrecond<Scalar>(), row_ptr(NULL), col(NULL), lu(NULL), diag(NULL), size(0)
+    {
+    }
+
+    template<typename Scalar>
+    ILU0Precond<Scalar>::~ILU0Precond()
+    {
+      destroy();
+    }
+
+    template<typename Scalar>
+    void ILU0Precond<Scalar>::destroy()
+    {
+      delete [] row_ptr;
+      row_ptr = NULL;
+      delete [] col;
+      col = NULL;
+      delete [] lu;
+      lu = NULL;
+      delete [] diag;
+      diag = NULL;
+      size = 0;
+    }
+
+    template<typename Scalar>
+    void ILU0Precond<Scalar>::compute()
+    {
+      _F_;
+      destroy();
+      size = this->mat->get_size();
+      this->copy_rows(row_ptr, col, lu, diag);
+
+      // IKJ variant of the Gaussian elimination restricted to the structure of the matrix.
+      // Columns in each row are sorted; pos[j] is the position of column j in the current row.
+      int* pos = new int[size];
+      MEM_CHECK(pos);
+      for (unsigned int j = 0; j < size; j++)
+        pos[j] = -1;
+
+      for (unsigned int i = 0; i < size; i++)
+      {
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+          pos[col[k]] = k;
+
+        for (int p = row_ptr[i]; p < diag[i]; p++)
+        {
+          int k = col[p];
+          lu[p] /= lu[diag[k]];
+          for (int q = diag[k] + 1; q < row_ptr[k + 1]; q++)
+            if (pos[col[q]] >= 0)
+              lu[pos[col[q]]] -= lu[p] * lu[q];
+        }
+
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++)
+          pos[col[k]] = -1;
+
+        if (lu[diag[i]] == 0.0)
+        {
+          delete [] pos;
+          throw Exceptions::LinearSolverException("Zero pivot in the ILU(0) preconditioner.");
+        }
+      }
+      delete [] pos;
+    }
+
+    template<typename Scalar>
+    void ILU0Precond<Scalar>::apply(const Scalar* r, Scalar* z) const
+    {
+      // L y = r (unit diagonal).
+      for (unsigned int i = 0; i < size; i++)
+      {
+        Scalar sum = r[i];
+        for (int k = row_ptr[i]; k < diag[i]; k++)
+          sum -= lu[k] * z[col[k]];
+        z[i] = sum;
+      }
+      // U z = y.
+      for (int i = size - 1; i >= 0; i--)
+      {
+        Scalar sum = z[i];
+        for (int k = diag[i] + 1; k < row_ptr[i + 1]; k++)
+          sum -= lu[k] * z[col[k]];
+        z[i] = sum / lu[diag[i]];
+      }
+    }
+
+    template<typename Scalar>
+    SSORPrecond<Scalar>::SSORPrecond(double omega) : CSCPrecond<Scalar>(), omega(omega), row_ptr(NULL), col(NULL), val(NULL), diag(NULL), size(0)
+    {
+      if (omega <= 0.0 || omega >= 2.0)
+        error("SSOR relaxation parameter has to be from (0, 2).");
+    }
+
+    template<typename Scalar>
+    SSORPrecond<Scalar>::~SSORPrecond()
+    {
+      destroy();
+    }
+
+    template<typename Scalar>
+    void SSORPrecond<Scalar>::destroy()
+    {
+      delete [] row_ptr;
+      row_ptr = NULL;
+      delete [] col;
+      col = NULL;
+      delete [] val;
+      val = NULL;
+      delete [] diag;
+      diag = NULL;
+      size = 0;
+    }
+
+    template<typename Scalar>
+    void SSORPrecond<Scalar>::compute()
+    {
+      _F_;
+      destroy();
+      size = this->mat->get_size();
+      this->copy_rows(row_ptr, col, val, diag);
+      for (unsigned int i = 0; i < size; i++)
+        if (val[diag[i]] == 0.0)
+          throw Exceptions::LinearSolverException("Zero diagonal entry in the SSOR preconditioner.");
+    }
+
+    template<typename Scalar>
+    void SSORPrecond<Scalar>::apply(const Scalar* r, Scalar* z) const
+    {
+      // (D / omega + L) y = r.
+      for (unsigned int i = 0; i < size; i++)
+      {
+        Scalar sum = r[i];
+        for (int k = row_ptr[i]; k < diag[i]; k++)
+          sum -= val[k] * z[col[k]];
+        z[i] = sum * omega / val[diag[i]];
+      }
+      // y := (2 - omega) / omega * (D / omega) y.
+      for (unsigned int i = 0; i < size; i++)
+        z[i] *= (2.0 - omega) / (omega * omega) * val[diag[i]];
+      // (D / omega + U) z = y.
+      for (int i = size - 1; i >= 0; i--)
+      {
+        Scalar sum = z[i];
+        for (int k = diag[i] + 1; k < row_ptr[i + 1]; k++)
+          sum -= val[k] * z[col[k]];
+        z[i] = sum * omega / val[diag[i]];
+      }
+    }
+
+    template class HERMES_API CSCPrecond<double>;
+    template class HERMES_API CSCPrecond<std::complex<double> >;
+    template class HERMES_API JacobiPrecond<double>;
+    template class HERMES_API JacobiPrecond<std::complex<double> >;
+    template class HERMES_API ILU0Precond<double>;
+    template class HERMES_API ILU0Precond<std::complex<double> >;
+    template class HERMES_API SSORPrecond<double>;
+    template class HERMES_API SSORPrecond<std::complex<double> >;
+  }
+}
+#endif
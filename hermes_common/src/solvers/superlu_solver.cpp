@@ -25,6 +25,7 @@
 #include "trace.h"
 #include "error.h"
 #include "callstack.h"
+#include "common_profiler.h"
 
 using namespace Hermes::Error;
 
@@ -686,6 +687,7 @@ namespace Hermes
     bool SuperLUSolver<Scalar>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
 
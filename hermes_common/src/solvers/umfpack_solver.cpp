@@ -25,6 +25,14 @@
 #include "trace.h"
 #include "error.h"
 #include "callstack.h"
+#include "common_profiler.h"
+#include <algorithm>
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 extern "C"
 {
@@ -73,6 +81,12 @@ namespace Hermes
       Ap = NULL;
       Ai = NULL;
       Ax = NULL;
+      csr_Ap = NULL;
+      csr_Aj = NULL;
+      csr_perm = NULL;
+      csr_Ax = NULL;
+      csr_values_valid = false;
+      reset_assembly_map();
     }
 
     template<typename Scalar>
@@ -80,6 +94,12 @@ namespace Hermes
     {
       _F_;
       this->size = size;
+      csr_Ap = NULL;
+      csr_Aj = NULL;
+      csr_perm = NULL;
+      csr_Ax = NULL;
+      csr_values_valid = false;
+      reset_assembly_map();
       this->alloc();
     }
 
@@ -90,16 +110,173 @@ namespace Hermes
       free();
     }
 
+    /// Product of one row of a CSR matrix with a vector.
+    template<typename Scalar>
+    static inline Scalar csr_row_product(const Scalar* val, const int* col, int len, const Scalar* x)
+    {
+      Scalar sum = 0.0;
+      for (int k = 0; k < len; k++)
+        sum += val[k] * x[col[k]];
+      return sum;
+    }
+
+#ifdef __AVX2__
+    static inline double csr_row_product(const double* val, const int* col, int len, const double* x)
+    {
+      __m256d acc = _mm256_setzero_pd();
+      int k = 0;
+      for (; k + 4 <= len; k += 4)
+      {
+        __m256d xv = _mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i*) (col + k)), sizeof(double));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(val + k), xv));
+      }
+      double part[4];
+      _mm256_storeu_pd(part, acc);
+      double sum = (part[0] + part[1]) + (part[2] + part[3]);
+      for (; k < len; k++)
+        sum += val[k] * x[col[k]];
+      return sum;
+    }
+
+    static inline std::complex<double> csr_row_product(const std::complex<double>* val, const int* col, int len, const std::complex<double>* x)
+    {
+      // Two complex numbers per register, stored as (re, im) pairs. The products
+      // of the real and imaginary parts of val are accumulated separately and
+      // combined once at the end.
+      const double* v = reinterpret_cast<const double*>(val);
+      const double* xd = reinterpret_cast<const double*>(x);
+      __m256d acc_re = _mm256_setzero_pd();
+      __m256d acc_im = _mm256_setzero_pd();
+      int k = 0;
+      for (; k + 2 <= len; k += 2)
+      {
+        __m256d a = _mm256_loadu_pd(v + 2 * k);
+        __m256d b = _mm256_set_m128d(_mm_loadu_pd(xd + 2 * col[k + 1]), _mm_loadu_pd(xd + 2 * col[k]));
+        acc_re = _mm256_add_pd(acc_re, _mm256_mul_pd(_mm256_movedup_pd(a), b));
+        acc_im = _mm256_add_pd(acc_im, _mm256_mul_pd(_mm256_permute_pd(a, 0xF), _mm256_permute_pd(b, 0x5)));
+      }
+      double part[4];
+      _mm256_storeu_pd(part, _mm256_addsub_pd(acc_re, acc_im));
+      std::complex<double> sum(part[0] + part[2], part[1] + part[3]);
+      for (; k < len; k++)
+        sum += val[k] * x[col[k]];
+      return sum;
+    }
+#endif
+
+    /// Minimum number of nonzeros for which the product is split among threads.
+    static const unsigned int CSR_PARALLEL_MIN_NNZ = 20000;
+
+    /// Rows [row_begin, row_end) of a part of the matrix with roughly nnz / num_parts nonzeros.
+    static void csr_row_range(const int* row_ptr, int size, int part, int num_parts, int& row_begin, int& row_end)
+    {
+      long long nnz = row_ptr[size];
+      row_begin = part == 0 ? 0 : (int) (std::lower_bound(row_ptr, row_ptr + size, (int) (nnz * part / num_parts)) - row_ptr);
+      row_end = part == num_parts - 1 ? size : (int) (std::lower_bound(row_ptr, row_ptr + size, (int) (nnz * (part + 1) / num_parts)) - row_ptr);
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::free_csr_mirror()
+    {
+      if (csr_Ap != NULL) {delete [] csr_Ap; csr_Ap = NULL;}
+      if (csr_Aj != NULL) {delete [] csr_Aj; csr_Aj = NULL;}
+      if (csr_perm != NULL) {delete [] csr_perm; csr_perm = NULL;}
+      if (csr_Ax != NULL) {delete [] csr_Ax; csr_Ax = NULL;}
+      csr_values_valid = false;
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::update_csr_mirror()
+    {
+      _F_;
+      if (csr_Ap == NULL)
+      {
+        // Transpose the structure (counting sort by rows, columns stay sorted).
+        csr_Ap = new int[this->size + 1];
+        MEM_CHECK(csr_Ap);
+        csr_Aj = new int[nnz];
+        MEM_CHECK(csr_Aj);
+        csr_perm = new int[nnz];
+        MEM_CHECK(csr_perm);
+        csr_Ax = new Scalar[nnz];
+        MEM_CHECK(csr_Ax);
+
+        memset(csr_Ap, 0, sizeof(int) * (this->size + 1));
+        for (unsigned int i = 0; i < nnz; i++)
+          csr_Ap[Ai[i] + 1]++;
+        for (unsigned int i = 0; i < this->size; i++)
+          csr_Ap[i + 1] += csr_Ap[i];
+
+        int* next = new int[this->size];
+        MEM_CHECK(next);
+        memcpy(next, csr_Ap, sizeof(int) * this->size);
+        for (unsigned int j = 0; j < this->size; j++)
+          for (int i = Ap[j]; i < Ap[j + 1]; i++)
+          {
+            int pos = next[Ai[i]]++;
+            csr_Aj[pos] = j;
+            csr_perm[pos] = i;
+          }
+        delete [] next;
+        csr_values_valid = false;
+      }
+
+      if (!csr_values_valid)
+      {
+        for (unsigned int i = 0; i < nnz; i++)
+          csr_Ax[i] = Ax[csr_perm[i]];
+        csr_values_valid = true;
+      }
+    }
+
     template<typename Scalar>
     void CSCMatrix<Scalar>::multiply_with_vector(Scalar* vector_in, Scalar* vector_out)
     {
+      _F_;
+      update_csr_mirror();
+      int n = this->size;
+      int num_parts = 1;
+#ifdef WITH_OPENMP
+      if (nnz >= CSR_PARALLEL_MIN_NNZ && !omp_in_parallel())
+        num_parts = omp_get_max_threads();
+#pragma omp parallel for schedule(static, 1) num_threads(num_parts) if(num_parts > 1)
+#endif
+      for (int part = 0; part < num_parts; part++)
+      {
+        int row_begin, row_end;
+        csr_row_range(csr_Ap, n, part, num_parts, row_begin, row_end);
+        for (int i = row_begin; i < row_end; i++)
+          vector_out[i] = csr_row_product(csr_Ax + csr_Ap[i], csr_Aj + csr_Ap[i], csr_Ap[i + 1] - csr_Ap[i], vector_in);
+      }
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::multiply_with_vectors(int num_vectors, Scalar** vectors_in, Scalar** vectors_out)
+    {
+      _F_;
+      update_csr_mirror();
       int n = this->size;
-      for (int j = 0; j<n; j++) vector_out[j] = 0;
-      for (int j = 0; j<n; j++)
+      int num_parts = 1;
+#ifdef WITH_OPENMP
+      if (nnz >= CSR_PARALLEL_MIN_NNZ && !omp_in_parallel())
+        num_parts = omp_get_max_threads();
+#pragma omp parallel for schedule(static, 1) num_threads(num_parts) if(num_parts > 1)
+#endif
+      for (int part = 0; part < num_parts; part++)
       {
-        for (int i = Ap[j]; i < Ap[j + 1]; i++)
+        int row_begin, row_end;
+        csr_row_range(csr_Ap, n, part, num_parts, row_begin, row_end);
+        for (int i = row_begin; i < row_end; i++)
         {
-         vector_out[Ai[i]] += vector_in[j]*Ax[i];
+          for (int v = 0; v < num_vectors; v++)
+            vectors_out[v][i] = 0.0;
+          for (int k = csr_Ap[i]; k < csr_Ap[i + 1]; k++)
+          {
+            Scalar a = csr_Ax[k];
+            int j = csr_Aj[k];
+            for (int v = 0; v < num_vectors; v++)
+              vectors_out[v][i] += a * vectors_in[v][j];
+          }
         }
       }
     }
@@ -108,6 +285,7 @@ namespace Hermes
     void CSCMatrix<Scalar>::multiply_with_Scalar(Scalar value)
     {
       for (unsigned int i = 0; i < this->nnz; i++) Ax[i] *= value;
+      csr_values_valid = false;
     }
 
     template<typename Scalar>
@@ -141,6 +319,17 @@ namespace Hermes
       Ax = new Scalar [nnz];
       MEM_CHECK(Ax);
       memset(Ax, 0, sizeof(Scalar) * nnz);
+
+      reset_assembly_map();
+      free_csr_mirror();
+    }
+
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::reset_assembly_map()
+    {
+      assembly_map.clear();
+      assembly_map_pos = 0;
+      assembly_map_state = ASSEMBLY_MAP_RECORDING;
     }
 
     template<typename Scalar>
@@ -151,6 +340,8 @@ namespace Hermes
       if (Ap != NULL) {delete [] Ap; Ap = NULL;}
       if (Ai != NULL) {delete [] Ai; Ai = NULL;}
       if (Ax != NULL) {delete [] Ax; Ax = NULL;}
+      reset_assembly_map();
+      free_csr_mirror();
     }
 
     template<typename Scalar>
@@ -171,6 +362,14 @@ namespace Hermes
     {
       _F_;
       memset(Ax, 0, sizeof(Scalar) * nnz);
+      csr_values_valid = false;
+
+      // A new assembling with the same sparse structure starts.
+      if (assembly_map_state == ASSEMBLY_MAP_INVALID)
+        reset_assembly_map();
+      else if (!assembly_map.empty())
+        assembly_map_state = ASSEMBLY_MAP_REPLAYING;
+      assembly_map_pos = 0;
     }
 
     template<typename Scalar>
@@ -222,6 +421,7 @@ namespace Hermes
     template<typename Scalar>
     void CSCMatrix<Scalar>::add_as_block(unsigned int offset_i, unsigned int offset_j, CSCMatrix<Scalar>* mat)
     {
+      csr_values_valid = false;
       UMFPackIterator<Scalar> mat_it(mat);
       UMFPackIterator<Scalar> this_it(this);
 
@@ -253,6 +453,7 @@ namespace Hermes
     {
       _F_;
       assert(this->get_size() == mat->get_size());
+      csr_values_valid = false;
       // Create iterators for both matrices.
       UMFPackIterator<Scalar> mat_it(mat);
       UMFPackIterator<Scalar> this_it(this);
@@ -295,16 +496,67 @@ namespace Hermes
       {
         add(i, i, v);
       }
+      csr_values_valid = false;
     };
 
+    template<typename Scalar>
+    void CSCMatrix<Scalar>::finish()
+    {
+      // The values added since zero() are copied to the mirror when it is used next.
+      csr_values_valid = false;
+    }
+
     template<typename Scalar>
     void CSCMatrix<Scalar>::add(unsigned int m, unsigned int n, Scalar **mat, int *rows, int *cols)
     {
       _F_;
+#ifdef WITH_OPENMP
+      // The assembly map is not used in threaded assembling (the order of insertions is not given).
+      if (omp_in_parallel())
+      {
+        for (unsigned int i = 0; i < m; i++)
+          for (unsigned int j = 0; j < n; j++)
+            if(rows[i] >= 0 && cols[j] >= 0)
+              add(rows[i], cols[j], mat[i][j]);
+        return;
+      }
+#endif
       for (unsigned int i = 0; i < m; i++)       // rows
         for (unsigned int j = 0; j < n; j++)     // cols
-          if(rows[i] >= 0 && cols[j] >= 0) // not Dir. dofs.
-            add(rows[i], cols[j], mat[i][j]);
+        {
+          if(rows[i] < 0 || cols[j] < 0) // Dir. dofs.
+            continue;
+
+          if (assembly_map_state == ASSEMBLY_MAP_REPLAYING)
+          {
+            // Check that the recorded position still belongs to this entry.
+            if (assembly_map_pos < assembly_map.size())
+            {
+              int pos = assembly_map[assembly_map_pos];
+              if (pos >= Ap[cols[j]] && pos < Ap[cols[j] + 1] && Ai[pos] == rows[i])
+              {
+                Ax[pos] += mat[i][j];
+                assembly_map_pos++;
+                continue;
+              }
+            }
+            assembly_map_state = ASSEMBLY_MAP_INVALID;
+          }
+          else if (assembly_map_state == ASSEMBLY_MAP_RECORDING)
+          {
+            int pos = find_position(Ai + Ap[cols[j]], Ap[cols[j] + 1] - Ap[cols[j]], rows[i]);
+            if (pos < 0)
+            {
+              info("CSCMatrix<Scalar>::add(): i = %d, j = %d.", rows[i], cols[j]);
+              error("Sparse matrix entry not found");
+            }
+            assembly_map.push_back(Ap[cols[j]] + pos);
+            Ax[Ap[cols[j]] + pos] += mat[i][j];
+            continue;
+          }
+
+          add(rows[i], cols[j], mat[i][j]);
+        }
     }
 
     double inline real(double x)
@@ -561,6 +813,8 @@ namespace Hermes
       this->Ap = new int[this->size + 1]; assert(this->Ap != NULL);
       this->Ai = new int[nnz];    assert(this->Ai != NULL);
       this->Ax = new Scalar[nnz]; assert(this->Ax != NULL);
+      reset_assembly_map();
+      free_csr_mirror();
       for (unsigned int i = 0; i < this->size + 1; i++) this->Ap[i] = ap[i];
       for (unsigned int i = 0; i < nnz; i++)
       {
@@ -593,6 +847,8 @@ namespace Hermes
     template<typename Scalar>
     Scalar *CSCMatrix<Scalar>::get_Ax()
     {
+      // The values may be changed through the pointer.
+      csr_values_valid = false;
       return this->Ax;
     }
 
@@ -1014,6 +1270,7 @@ namespace Hermes
     bool UMFPackLinearSolver<double>::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
 
@@ -1047,6 +1304,7 @@ namespace Hermes
     bool UMFPackLinearSolver<std::complex<double> >::solve()
     {
       _F_;
+      HERMES_PROFILE("solve");
       assert(m != NULL);
       assert(rhs != NULL);
 
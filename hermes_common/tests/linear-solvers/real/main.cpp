@@ -335,6 +335,19 @@ double* sln;
     UMFPackLinearSolver<double> solver(&mat, &rhs);
     solve(solver, n);
 	sln = solver.get_sln_vector();
+#endif
+  }
+  else if (strcasecmp(argv[1], "hermes-iterative") == 0) {
+#ifdef WITH_UMFPACK
+    UMFPackMatrix<double> mat;
+    UMFPackVector<double> rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    IterativeSolver<double> solver(&mat, &rhs);
+    solver.set_solver("gmres");
+    solver.set_tolerance(1e-10);
+    solve(solver, n);
+	sln = solver.get_sln_vector();
 #endif
   }
   else if (strcasecmp(argv[1], "aztecoo") == 0) {
@@ -0,0 +1,217 @@
+#define HERMES_REPORT_WARN
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_VERBOSE
+
+#include "hermes_common.h"
+
+using namespace Hermes::Algebra;
+
+// Micro-benchmark of the sparse matrix-vector product of CSCMatrix.
+//
+// Usage: test-spmv-benchmark real|complex [matrix file]
+//
+// The matrix file is a matrix dumped by an example in the DF_HERMES_BIN format
+// (CSCMatrix::dump()). Without it, the matrix of the five-point Laplacian on a square
+// grid is used. The product is checked against the column-wise product, and the
+// GFLOP/s and the effective memory bandwidth (every nonzero, index and vector entry
+// read or written once) are reported for the single and multiple vector products.
+
+// Grid size of the default matrix.
+#define GRID_SIZE 500
+// Number of products measured.
+#define NUM_PRODUCTS 50
+// Number of vectors in the multiple vector product.
+#define NUM_VECTORS 4
+
+/// Matrix in the CSC format.
+template<typename Scalar>
+struct CSCArrays
+{
+  CSCArrays() : size(0), nnz(0), ap(NULL), ai(NULL), ax(NULL) { }
+  ~CSCArrays() { delete [] ap; delete [] ai; delete [] ax; }
+  int size, nnz;
+  int* ap;
+  int* ai;
+  Scalar* ax;
+};
+
+template<typename Scalar>
+bool read_matrix(const char* file_name, CSCArrays<Scalar>& a)
+{
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL)
+    return false;
+
+  char id[8];
+  int ssize;
+  bool ok = fread(id, 1, 8, file) == 8 && memcmp(id, "HERMESX\001", 8) == 0
+    && fread(&ssize, sizeof(int), 1, file) == 1 && ssize == sizeof(Scalar)
+    && fread(&a.size, sizeof(int), 1, file) == 1 && fread(&a.nnz, sizeof(int), 1, file) == 1;
+  if (ok)
+  {
+    a.ap = new int[a.size + 1];
+    a.ai = new int[a.nnz];
+    a.ax = new Scalar[a.nnz];
+    ok = fread(a.ap, sizeof(int), a.size + 1, file) == (size_t) a.size + 1
+      && fread(a.ai, sizeof(int), a.nnz, file) == (size_t) a.nnz
+      && fread(a.ax, sizeof(Scalar), a.nnz, file) == (size_t) a.nnz;
+  }
+  fclose(file);
+  return ok;
+}
+
+template<typename Scalar>
+void build_laplace_matrix(int m, Scalar shift, CSCArrays<Scalar>& a)
+{
+  a.size = m * m;
+  a.ap = new int[a.size + 1];
+  a.ai = new int[5 * a.size];
+  a.ax = new Scalar[5 * a.size];
+  a.nnz = 0;
+  for (int j = 0; j < a.size; j++)
+  {
+    a.ap[j] = a.nnz;
+    int rows[5] = { j - m, j - 1, j, j + 1, j + m };
+    bool present[5] = { j >= m, j % m > 0, true, j % m < m - 1, j < a.size - m };
+    for (int k = 0; k < 5; k++)
+      if (present[k])
+      {
+        a.ai[a.nnz] = rows[k];
+        a.ax[a.nnz++] = k == 2 ? 4.0 + shift : -1.0;
+      }
+  }
+  a.ap[a.size] = a.nnz;
+}
+
+void report(const char* msg, double time, double flops, double bytes)
+{
+  info("%s: %g s per product, %.3f GFLOP/s, %.3f GB/s.", msg, time, flops / time * 1e-9, bytes / time * 1e-9);
+}
+
+template<typename Scalar>
+int benchmark(CSCArrays<Scalar>& a, SparseMatrix<Scalar>* mat, Scalar x_value)
+{
+  int n = a.size;
+  int nnz = a.nnz;
+  info("Matrix size: %d, nonzeros: %d.", n, nnz);
+
+  Scalar** x = Hermes::Algebra::DenseMatrixOperations::new_matrix<Scalar>(NUM_VECTORS, n);
+  Scalar** y = Hermes::Algebra::DenseMatrixOperations::new_matrix<Scalar>(NUM_VECTORS, n);
+  Scalar* y_ref = new Scalar[n];
+  for (int v = 0; v < NUM_VECTORS; v++)
+    for (int i = 0; i < n; i++)
+      x[v][i] = x_value * (double) ((i + v) % 17 + 1);
+
+  // Reference column-wise product.
+  int* Ap = a.ap;
+  int* Ai = a.ai;
+  Scalar* Ax = a.ax;
+  memset(y_ref, 0, n * sizeof(Scalar));
+  Hermes::TimePeriod timer;
+  timer.tick();
+  for (int k = 0; k < NUM_PRODUCTS; k++)
+  {
+    memset(y_ref, 0, n * sizeof(Scalar));
+    for (int j = 0; j < n; j++)
+      for (int i = Ap[j]; i < Ap[j + 1]; i++)
+        y_ref[Ai[i]] += x[0][j] * Ax[i];
+  }
+  timer.tick();
+
+  double flops = 2.0 * nnz;
+  double bytes = (double) nnz * (sizeof(Scalar) + sizeof(int)) + (n + 1) * sizeof(int) + 2.0 * n * sizeof(Scalar);
+  report("Column-wise product", timer.last() / NUM_PRODUCTS, flops, bytes);
+
+  // The first product builds the row-wise mirror.
+  timer.tick();
+  mat->multiply_with_vector(x[0], y[0]);
+  timer.tick();
+  info("Row-wise mirror set up in %g s.", timer.last());
+
+  timer.tick();
+  for (int k = 0; k < NUM_PRODUCTS; k++)
+    mat->multiply_with_vector(x[0], y[0]);
+  timer.tick();
+  report("Row-wise product", timer.last() / NUM_PRODUCTS, flops, bytes);
+
+  int ret = TEST_SUCCESS;
+  for (int i = 0; i < n; i++)
+    if (std::abs(y[0][i] - y_ref[i]) > 1e-10 * (1.0 + std::abs(y_ref[i])))
+    {
+      info("Row-wise product differs in row %d.", i);
+      ret = TEST_FAILURE;
+      break;
+    }
+
+  timer.tick();
+  for (int k = 0; k < NUM_PRODUCTS; k++)
+    mat->multiply_with_vectors(NUM_VECTORS, x, y);
+  timer.tick();
+  report("Multiple vector product (per vector)", timer.last() / (NUM_PRODUCTS * NUM_VECTORS), flops,
+    ((double) nnz * (sizeof(Scalar) + sizeof(int)) + (n + 1) * sizeof(int)) / NUM_VECTORS + 2.0 * n * sizeof(Scalar));
+
+  for (int v = 0; v < NUM_VECTORS && ret == TEST_SUCCESS; v++)
+  {
+    mat->multiply_with_vector(x[v], y_ref);
+    for (int i = 0; i < n; i++)
+      if (std::abs(y[v][i] - y_ref[i]) > 1e-10 * (1.0 + std::abs(y_ref[i])))
+      {
+        info("Multiple vector product differs in vector %d, row %d.", v, i);
+        ret = TEST_FAILURE;
+        break;
+      }
+  }
+
+  delete [] x;
+  delete [] y;
+  delete [] y_ref;
+  return ret;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) error("Not enough parameters.");
+
+  int ret = TEST_FAILURE;
+#ifdef WITH_UMFPACK
+  if (strcasecmp(argv[1], "real") == 0)
+  {
+    CSCArrays<double> a;
+    if (argc > 2)
+    {
+      if (!read_matrix(argv[2], a))
+        error("Failed to read the matrix.");
+    }
+    else
+      build_laplace_matrix<double>(GRID_SIZE, 0.0, a);
+    UMFPackMatrix<double> mat;
+    mat.create(a.size, a.nnz, a.ap, a.ai, a.ax);
+    ret = benchmark<double>(a, &mat, 1.0);
+  }
+  else if (strcasecmp(argv[1], "complex") == 0)
+  {
+    CSCArrays<std::complex<double> > a;
+    if (argc > 2)
+    {
+      if (!read_matrix(argv[2], a))
+        error("Failed to read the matrix.");
+    }
+    else
+      build_laplace_matrix<std::complex<double> >(GRID_SIZE, std::complex<double>(0.0, 1.0), a);
+    UMFPackMatrix<std::complex<double> > mat;
+    mat.create(a.size, a.nnz, a.ap, a.ai, a.ax);
+    ret = benchmark<std::complex<double> >(a, &mat, std::complex<double>(1.0, -0.5));
+  }
+  else
+    error("Unknown scalar type.");
+#else
+  info("UMFPACK not available, nothing to benchmark.");
+  ret = TEST_SUCCESS;
+#endif
+
+  if (ret == TEST_SUCCESS)
+    printf("Success!\n");
+  else
+    printf("Failure!\n");
+  return ret;
+}